@@ -0,0 +1,77 @@
+#ifndef BATCHEXPORTER_H
+#define BATCHEXPORTER_H
+
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include "htmlexporter.h"
+
+/**
+ * Exports every note below a folder to HTML, keeping the folder layout.
+ *
+ * Notes are exported in parallel by a bounded number of workers. The
+ * output folder keeps a manifest with the content hash of each note and
+ * of the included notes and images its page was built from; a note
+ * whose hashes all match and whose page is still there is skipped, so
+ * exporting the same tree again only redoes what changed. Pages of
+ * notes that were removed are removed as well, also when the settings
+ * changed since.
+ */
+class BatchExporter : public QObject {
+    Q_OBJECT
+
+   public:
+    struct Summary {
+        int exported = 0;
+        int skipped = 0;
+        int removed = 0;
+        QStringList errors;
+        bool cancelled = false;
+    };
+
+    static const char MANIFEST_NAME[];
+
+    explicit BatchExporter(QObject* parent = nullptr);
+    ~BatchExporter();
+
+    /** Workers used when none are given: one per core, at most four. */
+    static int defaultWorkerCount();
+
+    /**
+     * Exports folder to outputDir on the thread pool. Returns false if
+     * a batch is already running.
+     */
+    bool start(const QString& folder, const QString& outputDir,
+               const HtmlExporter::Options& options);
+    bool isRunning() const { return m_watcher->isRunning(); }
+
+    /** Stops the running batch after the notes in progress. */
+    void cancel() { m_cancelled.storeRelaxed(1); }
+
+    /**
+     * Exports folder to outputDir with up to maxWorkers notes at a time
+     * and blocks until done. The manifest is written even if cancelled,
+     * so the notes finished so far are not exported again.
+     */
+    static Summary exportFolder(
+        const QString& folder, const QString& outputDir,
+        const HtmlExporter::Options& options, int maxWorkers,
+        const QAtomicInt* cancelled = nullptr,
+        const HtmlExporter::ProgressCallback& progress = {});
+
+   signals:
+    void progressChanged(int percent, const QString& step);
+    void finished(int exported, int skipped, const QStringList& errors);
+
+   private slots:
+    void onBatchFinished();
+
+   private:
+    QFutureWatcher<Summary>* m_watcher;
+    QAtomicInt m_cancelled;
+};
+
+#endif  // BATCHEXPORTER_H
@@ -0,0 +1,85 @@
+#ifndef COMPLETIONINDEX_H
+#define COMPLETIONINDEX_H
+
+#include <QChar>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+/**
+ * Immutable lookup structure for word completion. The vocabulary is
+ * stored sorted, so a word's id is its alphabetical rank, and every
+ * prefix maps to a trie node that covers a contiguous id range and
+ * caches the most frequent completion below it. Bigram followers are
+ * grouped by previous-word id and sorted by follower id, so the
+ * followers that share the typed prefix form one contiguous slice; a
+ * segment tree over all followers gives the most frequent one in it.
+ *
+ * Building is O(vocabulary + bigrams). complete() is O(prefix length);
+ * completeAfter() adds O(log bigrams) for finding the slice and
+ * querying the tree, however many followers match.
+ */
+class CompletionIndex {
+   public:
+    CompletionIndex() = default;
+    CompletionIndex(const QHash<QString, int>& wordFrequency,
+                    const QHash<QPair<QString, QString>, int>& bigramFrequency);
+
+    bool isEmpty() const { return m_words.isEmpty(); }
+    int wordCount() const { return m_words.size(); }
+
+    /** Id of word, or -1 if it is not in the vocabulary. */
+    int wordId(const QString& word) const;
+    QString word(int id) const;
+    int frequency(int id) const;
+    int bigramFrequency(int previousId, int id) const;
+
+    /**
+     * Most frequent word that starts with prefix and is longer than it.
+     * Ties go to the alphabetically first word. Returns -1 if none.
+     */
+    int complete(const QString& prefix) const;
+
+    /**
+     * Most frequent word that follows previousId, starts with prefix
+     * and is longer than it. Returns -1 if none.
+     */
+    int completeAfter(int previousId, const QString& prefix) const;
+
+   private:
+    struct Node {
+        int firstEdge = 0;
+        int edgeCount = 0;
+        int firstWord = 0;  // Range of word ids sharing this prefix.
+        int endWord = 0;
+        int terminal = -1;  // Word that ends exactly at this node.
+        int best = -1;      // Best strictly longer completion.
+    };
+
+    int findNode(const QString& prefix) const;
+    bool isBetter(int candidate, int current) const;
+    // Of two follower positions, the more frequent one; on a tie the
+    // lower, which is the alphabetically first word.
+    int betterFollower(int a, int b) const;
+    // Position of the best follower in [begin, end), or -1 if empty.
+    int bestFollower(int begin, int end) const;
+
+    QVector<Node> m_nodes;
+    QVector<QChar> m_edgeLabels;
+    QVector<int> m_edgeTargets;
+
+    QVector<QString> m_words;
+    QVector<int> m_frequencies;
+
+    // Followers of word i are m_followers[m_followerOffsets[i] ..
+    // m_followerOffsets[i + 1]), sorted by id.
+    QVector<int> m_followerOffsets;
+    QVector<int> m_followers;
+    QVector<int> m_followerFrequencies;
+    // Segment tree of follower positions: leaf i is at size + i, and
+    // every node holds the better follower of its two children.
+    QVector<int> m_bestFollowers;
+};
+
+#endif  // COMPLETIONINDEX_H
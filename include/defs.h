@@ -6,5 +6,9 @@ constexpr char APP_VERSION[] = "0.8";
 constexpr int DEFAULT_LINK_SEARCH_DEPTH = 2;
 constexpr int MIN_LINK_SEARCH_DEPTH = 0;
 constexpr int MAX_LINK_SEARCH_DEPTH = 10;
+constexpr int DEFAULT_LARGE_FILE_THRESHOLD_MB = 5;
+constexpr int DEFAULT_PREDICTION_MODEL_BUDGET_MB = 32;
+constexpr char DEFAULT_PDF_PAGE_SIZE[] = "A4";
+constexpr int DEFAULT_PDF_MARGIN_MM = 15;
 
 #endif  // DEFS_H
@@ -0,0 +1,113 @@
+#ifndef EXTERNALTOOLS_H
+#define EXTERNALTOOLS_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+class QProcess;
+class QTimer;
+
+/**
+ * Finds and runs the external programs the application uses, such as
+ * pandoc and the desktop's file managers, without blocking the UI.
+ *
+ * Looking a program up searches the PATH once; the result, found or
+ * not, is kept for the session, so menus and exports can ask freely.
+ * Jobs run asynchronously with a timeout and can be cancelled; their
+ * result is handed to a callback on the caller's thread.
+ */
+class ExternalTools : public QObject {
+    Q_OBJECT
+
+   public:
+    struct Job {
+        QString program;
+        QStringList arguments;
+        QString workingDirectory;
+        // Killed after this long; 0 waits forever.
+        int timeoutMs = 30000;
+        // Shown in the status bar while the job runs.
+        QString description;
+    };
+
+    struct Result {
+        bool started = false;
+        bool timedOut = false;
+        bool cancelled = false;
+        int exitCode = -1;
+        QByteArray standardOutput;
+        QByteArray standardError;
+        QString errorString;
+
+        bool succeeded() const {
+            return started && !timedOut && !cancelled && exitCode == 0;
+        }
+    };
+
+    using Callback = std::function<void(const Result&)>;
+
+    static ExternalTools* instance();
+
+    /**
+     * Absolute path of program as found on the PATH, or an empty string
+     * if it is not there. Thread-safe.
+     */
+    QString findTool(const QString& program);
+    bool isAvailable(const QString& program) {
+        return !findTool(program).isEmpty();
+    }
+
+    /** Forgets every lookup, e.g. after a tool was installed. */
+    void clearCache();
+
+    /**
+     * Starts job and returns its id. callback runs on the service's
+     * thread once the job ended, however it ended, unless context, which
+     * must be given, was destroyed first. Must be called from the
+     * thread the service lives in.
+     */
+    int run(const Job& job, QObject* context, Callback callback);
+
+    /** Kills the job; its callback reports it as cancelled. */
+    void cancel(int jobId);
+    bool isRunning(int jobId) const { return m_jobs.contains(jobId); }
+    int runningCount() const { return m_jobs.size(); }
+
+   signals:
+    /**
+     * The running jobs changed; description is that of the most recent
+     * one still running, empty once none are.
+     */
+    void runningJobsChanged(int count, const QString& description);
+
+   private:
+    struct RunningJob {
+        QProcess* process = nullptr;
+        QTimer* timer = nullptr;
+        QPointer<QObject> context;
+        Callback callback;
+        QString description;
+        bool timedOut = false;
+        bool cancelled = false;
+    };
+
+    ExternalTools();
+
+    void finishJob(int jobId, bool started);
+    void reportRunningJobs();
+
+    mutable QMutex m_mutex;
+    QHash<QString, QString> m_paths;
+
+    QHash<int, RunningJob> m_jobs;
+    QList<int> m_jobOrder;
+    int m_nextJobId;
+};
+
+#endif  // EXTERNALTOOLS_H
@@ -0,0 +1,96 @@
+#ifndef FILEOPERATIONQUEUE_H
+#define FILEOPERATIONQUEUE_H
+
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <functional>
+
+/**
+ * Runs copies, moves and deletions of files and folders one after the
+ * other on the thread pool, so that pasting a large folder does not
+ * freeze the window.
+ *
+ * Progress is reported in bytes across the whole operation. A cancelled
+ * copy removes what it already wrote; a cancelled move leaves the source
+ * in place. On Linux, files are cloned where the filesystem supports
+ * reflinks and copied with copy_file_range() otherwise, so the data does
+ * not pass through the application.
+ */
+class FileOperationQueue : public QObject {
+    Q_OBJECT
+
+   public:
+    enum Type { Copy, Move, Delete };
+
+    struct Operation {
+        Type type = Copy;
+        QString source;
+        // Unused for Delete.
+        QString target;
+    };
+
+    // Called with the bytes done so far, the bytes in total and the file
+    // being worked on.
+    using ProgressCallback =
+        std::function<void(qint64, qint64, const QString&)>;
+
+    explicit FileOperationQueue(QObject* parent = nullptr);
+    ~FileOperationQueue();
+
+    /** Queues the operation and returns its id. */
+    int copy(const QString& source, const QString& target);
+    int move(const QString& source, const QString& target);
+    int remove(const QString& path);
+
+    /** Stops the operation, or drops it if it has not started yet. */
+    void cancel(int jobId);
+    void cancelAll();
+
+    bool isBusy() const { return m_current.id != 0; }
+    int pendingCount() const { return m_queue.size(); }
+
+    /**
+     * Runs operation and blocks until done. Returns an empty string on
+     * success, the error otherwise. Safe to call from any thread.
+     */
+    static QString run(const Operation& operation,
+                       const QAtomicInt* cancelled = nullptr,
+                       const ProgressCallback& progress = {});
+
+    /**
+     * Copies the file source to target, which must not exist yet. bytes
+     * is called after each chunk with its size.
+     */
+    static QString copyFile(const QString& source, const QString& target,
+                            const QAtomicInt* cancelled,
+                            const std::function<void(qint64)>& bytes);
+
+   signals:
+    void progressChanged(int percent, const QString& step);
+    void finished(int jobId, const FileOperationQueue::Operation& operation,
+                  bool success, bool cancelled, const QString& errorMessage);
+    void busyChanged(bool busy);
+
+   private slots:
+    void onJobFinished();
+
+   private:
+    struct Job {
+        int id = 0;
+        Operation operation;
+    };
+
+    int enqueue(const Operation& operation);
+    void startNext();
+
+    QList<Job> m_queue;
+    Job m_current;
+    int m_nextId;
+    QFutureWatcher<QString>* m_watcher;
+    QAtomicInt m_cancelled;
+};
+
+#endif  // FILEOPERATIONQUEUE_H
@@ -2,10 +2,12 @@
 #define FILESYSTEMTREEVIEW_H
 
 #include <QFileSystemModel>
-#include <QFileSystemWatcher>
 #include <QSortFilterProxyModel>
 #include <QTreeView>
 
+#include "fileoperationqueue.h"
+#include "workspacewatcher.h"
+
 /**
  * This class represents a tree view for displaying
  * and managing the file system. It provides functionalities
@@ -39,6 +41,15 @@ class FileSystemTreeView : public QTreeView {
 
     void setNameFilter(const QString& filter);
 
+    /**
+     * Reports external changes to the selected note from watcher, which
+     * watches the workspace the tree shows.
+     */
+    void setWorkspaceWatcher(WorkspaceWatcher* watcher);
+
+    /** Runs the tree's copies, moves and deletions in the background. */
+    FileOperationQueue* fileOperationQueue() const { return fileOperations; }
+
    signals:
     void fileSelected(const QString& filePath);
     void fileDoubleClicked(const QString& filePath);
@@ -57,8 +68,7 @@ class FileSystemTreeView : public QTreeView {
    private slots:
     void onSelectionChanged(const QModelIndex& current,
                             const QModelIndex& previous);
-    void onDirectoryChanged(const QString& path);
-    void onFileChanged(const QString& path);
+    void onWorkspaceChanged(const WorkspaceChangeSet& changes);
     void createNewFile();
     void createNewFolder();
     void renameItem();
@@ -77,18 +87,20 @@ class FileSystemTreeView : public QTreeView {
     void onItemRenamed(const QModelIndex& topLeft,
                        const QModelIndex& bottomRight);
     void onEditStarted();
+    void onFileOperationFinished(int jobId,
+                                 const FileOperationQueue::Operation& operation,
+                                 bool success, bool cancelled,
+                                 const QString& errorMessage);
 
    private:
     void setupModel();
     void setupView();
     void createContextMenu();
-    bool copyDirectory(const QString& srcPath, const QString& dstPath);
-    void setupFileSystemWatcher();
-    void addDirectoriesToWatcher(const QString& path);
 
     QFileSystemModel* fileSystemModel;
     QSortFilterProxyModel* proxyModel;
-    QFileSystemWatcher* fileSystemWatcher;
+    WorkspaceWatcher* workspaceWatcher;
+    FileOperationQueue* fileOperations;
     QMenu* contextMenu;
     QAction* newFileAction;
     QAction* newFolderAction;
@@ -98,6 +110,7 @@ class FileSystemTreeView : public QTreeView {
     QAction* copyAction;
     QAction* pasteAction;
     QAction* refreshAction;
+    QAction* cancelOperationsAction;
     QAction* setCurrentFolderAction;
     QAction* goToParentAction;
     QAction* openInNewWindowAction;
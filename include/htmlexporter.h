@@ -0,0 +1,89 @@
+#ifndef HTMLEXPORTER_H
+#define HTMLEXPORTER_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+/**
+ * Exports a note to a single standalone HTML file, without pandoc.
+ *
+ * The note goes through the preview's MarkdownRenderer, with math and
+ * code prerendered and Mermaid diagrams taken from the workspace's
+ * diagram cache. Stylesheets, KaTeX fonts and local images are inlined,
+ * so the file can be moved or mailed on its own. Links to other notes
+ * point at their .html exports next to it.
+ *
+ * Diagrams that were never shown in the preview, and math when the
+ * prerender scripts are missing, are left to the Mermaid and KaTeX
+ * scripts, which are then embedded as well.
+ */
+class HtmlExporter : public QObject {
+    Q_OBJECT
+
+   public:
+    struct Options {
+        // CSS of the page, as MarkdownPreview::pageStyleSheet() gives it.
+        QString styleSheet;
+        bool darkScheme = false;
+        bool latexEnabled = true;
+        // Workspace whose diagram cache is looked up; empty skips it.
+        QString workspacePath;
+        // Images that are not inlined (too large, unreadable) point at
+        // their file with an absolute URL, for pages that are not
+        // written next to the note.
+        bool absoluteImageLinks = false;
+    };
+
+    // Called with a percentage and a description of the current step.
+    using ProgressCallback = std::function<void(int, const QString&)>;
+
+    explicit HtmlExporter(QObject* parent = nullptr);
+    ~HtmlExporter();
+
+    /**
+     * Exports the note at sourcePath to outputPath on the thread pool.
+     * Returns false if an export is already running.
+     */
+    bool start(const QString& sourcePath, const QString& outputPath,
+               const Options& options);
+    bool isRunning() const { return m_watcher->isRunning(); }
+
+    /**
+     * Builds the page for markdown read from sourcePath, whose directory
+     * relative links and images resolve against. If dependencies is
+     * given, it is set to the included notes and images the page was
+     * built from. Safe to call from any thread.
+     */
+    static QString exportDocument(const QString& markdown,
+                                  const QString& sourcePath,
+                                  const Options& options,
+                                  const ProgressCallback& progress = {},
+                                  QStringList* dependencies = nullptr);
+
+    /**
+     * Reads sourcePath and writes its page to outputPath. Returns an
+     * empty string on success, the error otherwise.
+     */
+    static QString exportFile(const QString& sourcePath,
+                              const QString& outputPath,
+                              const Options& options,
+                              const ProgressCallback& progress = {},
+                              QStringList* dependencies = nullptr);
+
+   signals:
+    void progressChanged(int percent, const QString& step);
+    void finished(bool success, const QString& outputPath,
+                  const QString& errorMessage);
+
+   private slots:
+    void onExportFinished();
+
+   private:
+    QFutureWatcher<QString>* m_watcher;
+    QString m_outputPath;
+};
+
+#endif  // HTMLEXPORTER_H
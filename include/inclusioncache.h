@@ -0,0 +1,86 @@
+#ifndef INCLUSIONCACHE_H
+#define INCLUSIONCACHE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * Remembers what [[!inclusion]] targets resolve to, the text of included
+ * files and the HTML they render to, so refreshing a preview does not
+ * probe, read and parse unchanged files again.
+ *
+ * Entries are checked against the modification time and size of every
+ * file they were built from, and dropped early through invalidate() when
+ * the preview's file watcher reports a change. Shared by all previews
+ * and safe to use from their render threads.
+ */
+class InclusionCache {
+   public:
+    static InclusionCache* instance();
+
+    /**
+     * Returns the first existing file among target + each suffix in dir,
+     * or an empty string if there is none.
+     */
+    QString resolve(const QString& dir, const QString& target,
+                    const QStringList& suffixes);
+
+    /**
+     * Returns the UTF-8 text of path. On failure, returns a null string
+     * and sets errorMsg.
+     */
+    QString readText(const QString& path, QString& errorMsg);
+
+    /**
+     * Looks up the HTML stored under key. On a hit, also returns the
+     * files it was rendered from and how deep its own inclusions go.
+     */
+    bool findRendered(const QString& key, QString& html,
+                      QStringList& dependencies, int& depth);
+    void storeRendered(const QString& key, const QString& html,
+                       const QStringList& dependencies, int depth);
+
+    /** Drops everything that was built from path. */
+    void invalidate(const QString& path);
+    void clear();
+
+   private:
+    InclusionCache() = default;
+
+    struct FileStamp {
+        QString path;
+        QDateTime modified;
+        qint64 size = -1;
+
+        bool operator==(const FileStamp& other) const {
+            return path == other.path && modified == other.modified &&
+                   size == other.size;
+        }
+    };
+
+    struct TextEntry {
+        FileStamp stamp;
+        QString text;
+    };
+
+    struct RenderedEntry {
+        QVector<FileStamp> stamps;
+        QString html;
+        int depth = 0;
+    };
+
+    static FileStamp stamp(const QString& path);
+    static bool isCurrent(const QVector<FileStamp>& stamps);
+    void trim();
+
+    QMutex m_mutex;
+    QHash<QString, QString> m_resolved;
+    QHash<QString, TextEntry> m_texts;
+    QHash<QString, RenderedEntry> m_rendered;
+};
+
+#endif  // INCLUSIONCACHE_H
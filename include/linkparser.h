@@ -7,6 +7,8 @@
 #include <QString>
 #include <QVector>
 
+#include "workspacewatcher.h"
+
 class BacklinksManager;
 
 struct WikiLink {
@@ -47,10 +49,29 @@ class LinkParser : public QObject {
     QVector<WikiLink> parseLinks(const QString& text);
     QVector<QString> extractLinksFromFile(const QString& filePath);
     void buildLinkIndex(const QString& rootPath, int maxDepth);
+    /**
+     * Updates the index built by buildLinkIndex() for changes in the
+     * workspace, re-reading only the notes that changed. Must not run
+     * at the same time as itself or buildLinkIndex(): batches applied
+     * out of order could put a deleted note back.
+     */
+    void applyChanges(const WorkspaceChangeSet& changes);
     QVector<QString> getBacklinks(const QString& filePath) const;
     QString resolveLinkTarget(const QString& linkTarget,
                               const QString& currentFilePath,
                               int maxDepth) const;
+    /**
+     * Resolves linkTarget as if the note now at renamedPath were still at
+     * originalPath, to tell which links pointed at a note that was just
+     * renamed. The note is returned as originalPath, with its directory
+     * made canonical. Reads the file system, not the index, so it may
+     * run on the thread pool.
+     */
+    QString resolveLinkTargetBeforeRename(const QString& linkTarget,
+                                          const QString& currentFilePath,
+                                          int maxDepth,
+                                          const QString& originalPath,
+                                          const QString& renamedPath) const;
     static LinkTarget parseLinkTarget(const QString& linkTarget);
 
    signals:
@@ -59,6 +80,12 @@ class LinkParser : public QObject {
     void indexBuildProgress(int current, int total);
 
    private:
+    // A note that was renamed from one path to another.
+    struct Rename {
+        QString from;
+        QString to;
+    };
+
     QMap<QString, QVector<QString>> forwardLinks;
     BacklinksManager* backlinksManager;
     QString rootPath;
@@ -68,10 +95,16 @@ class LinkParser : public QObject {
 
     void scanDirectoryIterative(const QString& dirPath);
     void processFile(const QString& filePath);
+    bool removeFromIndex(const QString& path);
     bool isWithinHomeDirectory(const QString& path) const;
+    QString resolve(const QString& linkTarget, const QString& currentFilePath,
+                    int searchDepth, const Rename* rename) const;
+    // path if it exists, as it did before rename; empty otherwise.
+    static QString existingPath(const QString& path, const Rename* rename);
     void searchInDirectory(const QString& dirPath,
                            const QString& targetBaseName, QString& result,
-                           int depth, int maxDepth) const;
+                           int depth, int maxDepth,
+                           const Rename* rename = nullptr) const;
 };
 
 #endif  // LINKPARSER_H
@@ -0,0 +1,101 @@
+#ifndef LINKREWRITER_H
+#define LINKREWRITER_H
+
+#include <QFutureWatcher>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+/**
+ * Points wiki and markdown links at a note's new name after it was
+ * renamed.
+ *
+ * The notes to rewrite come from the backlink index, so a rename only
+ * touches the notes that link to it. They are rewritten in parallel on
+ * the thread pool, each with an atomic write; open documents are
+ * patched in place instead, see linkEdits().
+ */
+class LinkRewriter : public QObject {
+    Q_OBJECT
+
+   public:
+    // Replaces length characters at position with text.
+    struct Edit {
+        int position = 0;
+        int length = 0;
+        QString text;
+    };
+
+    struct Summary {
+        int updated = 0;
+        QStringList errors;
+    };
+
+    /**
+     * Whether target, as written in the note at referrer, links to the
+     * renamed note. Called from the thread pool.
+     */
+    using LinkFilter =
+        std::function<bool(const QString& target, const QString& referrer)>;
+
+    explicit LinkRewriter(QObject* parent = nullptr);
+    ~LinkRewriter();
+
+    /**
+     * Edits that point the links to oldFileName in content at
+     * newFileName, in ascending order. Links written without the
+     * extension keep leaving it out. Without a filter, every link of
+     * that name counts; with one, only those it accepts for referrer,
+     * the note content was read from.
+     */
+    static QList<Edit> linkEdits(const QString& content,
+                                 const QString& oldFileName,
+                                 const QString& newFileName,
+                                 const QString& referrer = QString(),
+                                 const LinkFilter& filter = LinkFilter());
+    static QString applyEdits(const QString& content,
+                              const QList<Edit>& edits);
+
+    /**
+     * Rewrites the links in files with up to maxWorkers files at a time
+     * and blocks until done. Files without such links are left alone.
+     */
+    static Summary rewriteFiles(const QStringList& files,
+                                const QString& oldFileName,
+                                const QString& newFileName, int maxWorkers,
+                                const LinkFilter& filter = LinkFilter());
+
+    /**
+     * Rewrites files on the thread pool, after the rewrites queued
+     * before, so that two renames in a row do not race on a note that
+     * links to both.
+     */
+    void start(const QStringList& files, const QString& oldFileName,
+               const QString& newFileName,
+               const LinkFilter& filter = LinkFilter());
+    bool isRunning() const { return m_running; }
+
+   signals:
+    void finished(int updated, const QStringList& errors);
+
+   private slots:
+    void onRewriteFinished();
+
+   private:
+    struct Request {
+        QStringList files;
+        QString oldFileName;
+        QString newFileName;
+        LinkFilter filter;
+    };
+
+    void startNext();
+
+    QList<Request> m_queue;
+    QFutureWatcher<Summary>* m_watcher;
+    bool m_running;
+};
+
+#endif  // LINKREWRITER_H
@@ -3,6 +3,9 @@
 
 #include <QMainWindow>
 #include <QSettings>
+#include <QThreadPool>
+
+#include "workspacewatcher.h"
 
 class QAction;
 class QMenu;
@@ -19,12 +22,19 @@ class TabEditor;
 class MarkdownEditor;
 class MarkdownPreview;
 class LinkParser;
+class LinkRewriter;
+class NgramIndexer;
+class WorkspaceCatalog;
 class SearchDialog;
 class SettingsDialog;
 class QuickOpenDialog;
 class OutlinePanel;
 class AIAssistDialog;
 class NavigationHistory;
+class PreviewScheduler;
+class HtmlExporter;
+class PdfExporter;
+class BatchExporter;
 class SidebarPanel;
 
 class MainWindow : public QMainWindow {
@@ -55,9 +65,11 @@ class MainWindow : public QMainWindow {
     void onFileSelected(const QString& filePath);
     void onFileDoubleClicked(const QString& filePath);
     void onFileModifiedExternally(const QString& filePath);
+    void onWorkspaceChanged(const WorkspaceChangeSet& changes);
     void onFolderChanged(const QString& folderPath);
     void onFileDeleted(const QString& filePath);
     void onFileRenamed(const QString& oldPath, const QString& newPath);
+    void onLinkRewriteFinished(int updated, const QStringList& errors);
     void onDocumentModified();
     void autoSave();
     void find();
@@ -103,6 +115,15 @@ class MainWindow : public QMainWindow {
     void exportToPdf();
     void exportToDocx();
     void exportToPlainText();
+    void exportFolderToHtml();
+    void showExportProgress(int percent, const QString& step);
+    void showFileOperationProgress(int percent, const QString& step);
+    void onFileOperationsBusyChanged(bool busy);
+    void showExternalToolJobs(int count, const QString& description);
+    void onExportFinished(bool success, const QString& outputPath,
+                          const QString& errorMessage);
+    void onBatchExportFinished(int exported, int skipped,
+                               const QStringList& errors);
     void showKeyboardShortcuts();
     void breakLines();
     void joinLines();
@@ -140,11 +161,15 @@ class MainWindow : public QMainWindow {
     TabEditor* createNewTab();
     TabEditor* findTabByPath(const QString& filePath) const;
     int findTabIndexByPath(const QString& filePath) const;
+    void updateLinksAfterRename(const QString& oldPath,
+                                const QString& newPath);
     bool createFileFromLink(const QString& targetFile,
                             const QString& linkTarget,
                             const QString& label = QString());
     int getLinkSearchDepth() const;
     void buildLinkIndexAsync();
+    void updatePredictionModel();
+    bool isExporting() const;
 
     QMenu* fileMenu;
     QMenu* editMenu;
@@ -167,6 +192,7 @@ class MainWindow : public QMainWindow {
     QAction* exportPdfAction;
     QAction* exportDocxAction;
     QAction* exportPlainTextAction;
+    QAction* exportFolderHtmlAction;
     QAction* insertImageAction;
     QAction* insertFormulaAction;
     QAction* insertWikiLinkAction;
@@ -237,13 +263,24 @@ class MainWindow : public QMainWindow {
     QListWidget* historyView;
     QLineEdit* historyFilterInput;
     LinkParser* linkParser;
+    LinkRewriter* linkRewriter;
+    NgramIndexer* predictionIndexer;
+    WorkspaceWatcher* workspaceWatcher;
+    WorkspaceCatalog* workspaceCatalog;
+    // Runs link index builds and updates one at a time, in order.
+    QThreadPool linkIndexPool;
 
     QStringList recentFiles;
     QStringList recentFolders;
     QString currentFolder;
     QString currentFilePath;
     QTimer* autoSaveTimer;
-    QTimer* previewUpdateTimer;
+    PreviewScheduler* previewScheduler;
+    HtmlExporter* htmlExporter;
+    PdfExporter* pdfExporter;
+    BatchExporter* batchExporter;
+    // Id of the running Word export's ExternalTools job, if any.
+    int docxExportJob;
     QString m_startupPath;
     QString m_startupFile;
 
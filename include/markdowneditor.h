@@ -1,13 +1,18 @@
 #ifndef MARKDOWNEDITOR_H
 #define MARKDOWNEDITOR_H
 
+#include <QPlainTextEdit>
+#include <QStringList>
 #include <QTextEdit>
 #include <memory>
 
+class QScrollBar;
 class QSyntaxHighlighter;
 class LineNumberArea;
+class LargeFileView;
 class MarkdownHighlighter;
 class WordPredictor;
+class NgramModel;
 
 class MarkdownEditor : public QTextEdit {
     Q_OBJECT
@@ -21,13 +26,69 @@ class MarkdownEditor : public QTextEdit {
 
     void setLineNumbersVisible(bool visible);
     void setPredictionEnabled(bool enabled);
+    void setLanguageModel(std::shared_ptr<const NgramModel> model);
+    /**
+     * Re-reads filePath into word prediction if it is a note next to the
+     * current one; it may have been changed, added or removed on disk.
+     */
+    void refreshPredictionFile(const QString& filePath);
     void setAIAssistEnabled(bool enabled);
     void setFocusModeEnabled(bool enabled);
     void setFocusModeMaxWidth(int maxWidth);
 
+    /**
+     * Large-file mode keeps very big documents editable. The document,
+     * with its cursor and undo history, moves to a LargeFileView whose
+     * QPlainTextDocumentLayout only lays out the blocks on screen, and
+     * moves back when the mode is left. The view hands its key, mouse
+     * and drop events to this editor, so lists, tasks and links work
+     * as usual. Wrapping is off, highlighting only covers the blocks
+     * around the viewport, and word prediction and list hanging
+     * indents are paused.
+     *
+     * Switching lays the document out for the new mode, so switch while
+     * it holds the smaller of the old and new text.
+     */
+    void setLargeFileMode(bool enabled);
+    bool isLargeFileMode() const { return m_largeFileMode; }
+
     bool isModified() const;
     void setModified(bool modified);
 
+    /**
+     * These shadow QTextEdit so callers reach the document and view that
+     * are shown: the large-file view in large-file mode, this editor
+     * otherwise.
+     */
+    QTextDocument* document() const;
+    QTextCursor textCursor() const;
+    void setTextCursor(const QTextCursor& cursor);
+    QString toPlainText() const;
+    void setPlainText(const QString& text);
+    void insertPlainText(const QString& text);
+    void selectAll();
+    void undo();
+    void redo();
+    void cut();
+    void copy();
+    void paste();
+    QTextCursor cursorForPosition(const QPoint& pos) const;
+    void ensureCursorVisible();
+    QWidget* viewport() const;
+    QScrollBar* verticalScrollBar() const;
+    void setTabStopDistance(qreal distance);
+
+    /**
+     * Source line at the top of the viewport, counted from 1; the
+     * fraction is how far the view has scrolled into that line.
+     */
+    double topSourceLine() const;
+    /**
+     * Scrolls so that line, as returned by topSourceLine(), is at the
+     * top. Lines past the end of the document are ignored.
+     */
+    void scrollToSourceLine(double line);
+
     MarkdownHighlighter* getHighlighter() const;
     MarkdownHighlighter* highlighter() const { return getHighlighter(); }
 
@@ -52,6 +113,8 @@ class MarkdownEditor : public QTextEdit {
     void aiAssistWithPromptRequested(const QString& promptText);
     void fileDeleteRequested(const QString& filePath);
     void fileRenameRequested(const QString& filePath);
+    // The viewport moved through the document, in either mode.
+    void scrolled();
 
    protected:
     void resizeEvent(QResizeEvent* event) override;
@@ -81,8 +144,13 @@ class MarkdownEditor : public QTextEdit {
 
    private:
     void setupEditor();
+    void showLargeFileView();
+    void hideLargeFileView();
     QString saveImageFromClipboard(const QImage& image);
-    void updateWordFrequency();
+    void flushPredictionParagraph();
+    // Replaces the counted blocks first..last with texts.
+    void applyPredictionBlocks(int first, int last, const QStringList& texts);
+    void resetPredictionParagraph();
     void showPrediction();
     void hidePrediction();
     void acceptPrediction();
@@ -113,20 +181,34 @@ class MarkdownEditor : public QTextEdit {
 
    private slots:
     void applyDeferredFormatting();
+    void updateVisibleHighlighting();
+    void onCursorBlockChanged();
+    void onPredictionContentsChange(int position, int removed, int added);
+    void syncWordPredictor();
 
    private:
+    friend class LargeFileView;
+
     LineNumberArea* lineNumberArea;
     MarkdownHighlighter* m_highlighter;
     QString m_currentFilePath;
     class QTimer* m_formatTimer;
+    class QTimer* m_visibleHighlightTimer;
 
     std::unique_ptr<WordPredictor> m_wordPredictor;
+    // Text of every block as the predictor last counted it.
+    QStringList m_predictionBlocks;
+    // Paragraph whose edits have not been handed to the predictor yet.
+    int m_predictionBlockNumber;
+    int m_predictionPendingEdits;
     QString m_currentPrediction;
     bool m_predictionEnabled;
     bool m_aiAssistEnabled;
     bool m_lineNumbersVisible;
     bool m_focusModeEnabled;
     int m_focusModeMaxWidth;
+    bool m_largeFileMode;
+    LargeFileView* m_largeFileView;
 };
 
 class LineNumberArea : public QWidget {
@@ -149,4 +231,73 @@ class LineNumberArea : public QWidget {
     MarkdownEditor* codeEditor;
 };
 
+/**
+ * Shows the document in large-file mode. Its key, mouse, context menu
+ * and drop events go to the MarkdownEditor that owns it, which falls
+ * back on the default*() handlers for what it does not handle itself.
+ */
+class LargeFileView : public QPlainTextEdit {
+    Q_OBJECT
+
+   public:
+    LargeFileView(MarkdownEditor* editor)
+        : QPlainTextEdit(editor), codeEditor(editor) {}
+
+    using QPlainTextEdit::blockBoundingGeometry;
+    using QPlainTextEdit::blockBoundingRect;
+    using QPlainTextEdit::contentOffset;
+    using QPlainTextEdit::firstVisibleBlock;
+
+    void defaultKeyPressEvent(QKeyEvent* event) {
+        QPlainTextEdit::keyPressEvent(event);
+    }
+    void defaultMousePressEvent(QMouseEvent* event) {
+        QPlainTextEdit::mousePressEvent(event);
+    }
+    void defaultMouseMoveEvent(QMouseEvent* event) {
+        QPlainTextEdit::mouseMoveEvent(event);
+    }
+    void defaultDragEnterEvent(QDragEnterEvent* event) {
+        QPlainTextEdit::dragEnterEvent(event);
+    }
+    void defaultDragMoveEvent(QDragMoveEvent* event) {
+        QPlainTextEdit::dragMoveEvent(event);
+    }
+    void defaultDropEvent(QDropEvent* event) {
+        QPlainTextEdit::dropEvent(event);
+    }
+    void defaultInsertFromMimeData(const QMimeData* source) {
+        QPlainTextEdit::insertFromMimeData(source);
+    }
+
+   protected:
+    void keyPressEvent(QKeyEvent* event) override {
+        codeEditor->keyPressEvent(event);
+    }
+    void mousePressEvent(QMouseEvent* event) override {
+        codeEditor->mousePressEvent(event);
+    }
+    void mouseMoveEvent(QMouseEvent* event) override {
+        codeEditor->mouseMoveEvent(event);
+    }
+    void contextMenuEvent(QContextMenuEvent* event) override {
+        codeEditor->contextMenuEvent(event);
+    }
+    void dragEnterEvent(QDragEnterEvent* event) override {
+        codeEditor->dragEnterEvent(event);
+    }
+    void dragMoveEvent(QDragMoveEvent* event) override {
+        codeEditor->dragMoveEvent(event);
+    }
+    void dropEvent(QDropEvent* event) override {
+        codeEditor->dropEvent(event);
+    }
+    void insertFromMimeData(const QMimeData* source) override {
+        codeEditor->insertFromMimeData(source);
+    }
+
+   private:
+    MarkdownEditor* codeEditor;
+};
+
 #endif  // MARKDOWNEDITOR_H
@@ -17,6 +17,17 @@ class MarkdownHighlighter : public QSyntaxHighlighter {
     QString getColorScheme() const { return currentColorScheme; }
     void setCurrentCursorLine(int lineNumber);
 
+    /**
+     * In lazy mode only the blocks inside the range given with
+     * setVisibleBlockRange() are formatted; every other block is left
+     * plain until the editor asks for it again. This keeps loading and
+     * rehighlighting cost proportional to the viewport instead of the
+     * document, which is what the editor's large-file mode relies on.
+     */
+    void setLazyHighlighting(bool enabled);
+    bool isLazyHighlighting() const { return lazyHighlighting; }
+    void setVisibleBlockRange(int firstBlock, int lastBlock);
+
    public slots:
     void updateColorScheme();
 
@@ -66,6 +77,9 @@ class MarkdownHighlighter : public QSyntaxHighlighter {
     QString currentCodeLanguage;
     bool codeSyntaxEnabled;
     int currentCursorLine;
+    bool lazyHighlighting;
+    int firstVisibleBlock;
+    int lastVisibleBlock;
     bool checkWikiLinkExists(const QString& linkText) const;
     void highlightCodeLine(const QString& text, const QString& language);
     QColor getSubtleColor() const;
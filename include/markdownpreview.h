@@ -1,8 +1,18 @@
 #ifndef MARKDOWNPREVIEW_H
 #define MARKDOWNPREVIEW_H
 
+#include <QAtomicInt>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
 #include <QWebEngineView>
 
+#include "markdownrenderer.h"
+#include "previewrendercache.h"
+
+class PreviewBridge;
+class QFileSystemWatcher;
+
 class MarkdownPreview : public QWebEngineView {
     Q_OBJECT
 
@@ -10,14 +20,51 @@ class MarkdownPreview : public QWebEngineView {
     explicit MarkdownPreview(QWidget* parent = nullptr);
     ~MarkdownPreview();
 
-    void setMarkdownContent(const QString& markdown);
+    /**
+     * Renders markdown into the page. A document id and revision, as
+     * tabs pass them, let an unchanged document shown before reuse its
+     * last output instead of being rendered again.
+     */
+    void setMarkdownContent(const QString& markdown, int documentId = 0,
+                            quint64 revision = 0);
     void setTheme(const QString& theme);
     void setBasePath(const QString& path);
     void setLatexEnabled(bool enabled);
+
+    /**
+     * Sets the workspace whose disk cache keeps rendered Mermaid
+     * diagrams.
+     */
+    void setWorkspacePath(const QString& path);
     void scrollToPercentage(double percentage);
     double currentScrollPercentage() const;
+
+    /**
+     * Scrolls so that the given source line, which may have a fraction,
+     * is at the top, placing it between the blocks around it. Falls back
+     * to percentage when the page has no source lines.
+     */
+    void scrollToSourceLine(double line, double percentage);
+    double currentSourceLine() const { return lastSourceLine; }
     void scrollToAnchor(const QString& anchor);
 
+    /**
+     * Rebuilds the page around the current content after a style
+     * setting changed, e.g. the custom stylesheet. Theme changes are
+     * picked up on their own.
+     */
+    void reloadStyles();
+
+    /**
+     * The stylesheet of the page: the theme's, task lists and the
+     * user's custom CSS. Exports use it to look like the preview.
+     */
+    QString pageStyleSheet() const;
+
+    /** Whether the preview color setting picks the dark scheme. */
+    bool isDarkScheme() const;
+    bool isLatexEnabled() const { return renderer.isLatexEnabled(); }
+
    signals:
     void wikiLinkClicked(const QString& linkTarget);
     void markdownLinkClicked(const QString& linkTarget);
@@ -25,30 +72,91 @@ class MarkdownPreview : public QWebEngineView {
     void openLinkInNewTabRequested(const QString& linkTarget);
     void internalLinkClicked(const QString& anchor);
     void scrollPercentageChanged(double percentage);
+    /** The user scrolled the preview to the given source line. */
+    void sourceLineScrolled(double line);
+    /** A render of documentId, 0 if it has none, took msec. */
+    void renderFinished(int documentId, qint64 msec);
 
    private slots:
     void showContextMenu(const QPoint& pos);
     void reloadPreview();
     void onThemeChanged();
-    void checkScrollPosition();
+    void onPageScrolled(double line, double percentage);
+    void onDiagramRendered(const QString& key, const QString& svg);
+    void onLoadFinished(bool ok);
+    void onIncludedFileChanged(const QString& path);
 
    private:
-    QString convertMarkdownToHtml(const QString& markdown);
     QString getStyleSheet(const QString& theme);
-    QString processLatexFormulas(const QString& html);
-    QString processWikiLinks(const QString& html);
-    QString resolveAndIncludeFile(const QString& linkTarget,
-                                  const QString& displayText);
-    QString readFileContent(const QString& linkTarget, QString& errorMsg);
-    QString addHeadingIds(const QString& html);
+    void rebuildPageShell();
+    void loadPage(const QStringList& blocks);
+    void applyBlocks(const QStringList& blocks);
+    void showRenderedBlocks(int generation, const QStringList& blocks,
+                            const QStringList& includedFiles);
+    void watchIncludedFiles(const QStringList& files);
+    QVector<int> blockLines(const QStringList& blocks) const;
+    // Markdown of a document at some revision, and the render settings
+    // it is rendered with.
+    struct RenderRequest {
+        QString markdown;
+        int documentId = 0;
+        quint64 revision = 0;
+        QString settings;
+    };
+    void startRender(RenderRequest request);
+    void finishRender(int generation, const RenderRequest& request,
+                      bool rendered, const QStringList& blocks,
+                      const QStringList& includedFiles, qint64 elapsedMs);
+    QString renderSettings() const;
+    void storeRenderedBlocks(const RenderRequest& request,
+                             const QStringList& blocks,
+                             const QStringList& includedFiles);
+    static QString blocksToJson(const QStringList& blocks);
+    static QString linesToJson(const QVector<int>& lines);
 
     QString currentTheme;
     QString basePath;
-    bool latexEnabled;
+    QString workspacePath;
+    QString mermaidTheme;
+    MarkdownRenderer renderer;
+    QThreadPool renderPool;
+    QAtomicInt renderGeneration;
+    // Last output of each document, least recently shown dropped first.
+    PreviewRenderCache renderCache;
     double lastScrollPercentage;
+    double lastSourceLine;
     QString lastMarkdownContent;
-    QTimer* scrollCheckTimer;
     bool isScrollingFromEditor;
+    // Receives scroll positions and rendered diagrams from the page.
+    PreviewBridge* bridge;
+    // Files pulled in by [[!inclusions]]; a change re-renders the note.
+    QFileSystemWatcher* inclusionWatcher;
+
+    // Identifies this preview's page in PreviewSchemeHandler.
+    static int nextPreviewId;
+    int previewId;
+
+    // The page template with theme and styles filled in, split around
+    // the scroll position and the initial blocks. It is rebuilt when a
+    // style changes, which bumps its version.
+    QStringList shellParts;
+    int shellVersion;
+
+    // State of the loaded page: the shell version it was built from and
+    // the keys and source lines of the top-level blocks it shows.
+    int loadedShellVersion;
+    QString loadedBasePath;
+    bool pageLoaded;
+    QVector<size_t> renderedBlockKeys;
+    QVector<int> renderedBlockLines;
+    QStringList pendingBlocks;
+    bool hasPendingBlocks;
+
+    // The render on the pool, if any, and the latest request waiting
+    // for it to finish.
+    bool renderInFlight;
+    bool hasQueuedRender;
+    RenderRequest queuedRender;
 };
 
 #endif  // MARKDOWNPREVIEW_H
@@ -0,0 +1,85 @@
+#ifndef MARKDOWNRENDERER_H
+#define MARKDOWNRENDERER_H
+
+#include <QString>
+#include <QStringList>
+
+struct MarkdownInclusionState;
+
+/**
+ * Renders markdown to the HTML shown in the preview.
+ *
+ * Drives the md4c parser with its own renderer, so wiki links,
+ * inclusions, heading ids and math spans are written in their final
+ * form while the document is rendered, in one pass over it.
+ */
+class MarkdownRenderer {
+   public:
+    MarkdownRenderer();
+
+    /**
+     * Sets the directory that inclusion targets are resolved against.
+     */
+    void setBasePath(const QString& path);
+    QString basePath() const { return m_basePath; }
+
+    /**
+     * When enabled, math spans are written with $ and $$ delimiters for
+     * KaTeX; otherwise they are left as <x-equation> elements.
+     */
+    void setLatexEnabled(bool enabled);
+    bool isLatexEnabled() const { return m_latexEnabled; }
+
+    /**
+     * When enabled, math and fenced code are rendered to static KaTeX
+     * and highlight.js markup through PrerenderPool, so the page does
+     * not have to. Falls back to the plain output if that fails.
+     */
+    void setPrerenderEnabled(bool enabled);
+    bool isPrerenderEnabled() const { return m_prerenderEnabled; }
+
+    /**
+     * Looks Mermaid diagrams up in the MermaidCache of workspace for the
+     * given Mermaid theme. Diagrams found there are written as their
+     * SVG; the others keep a data-mermaid-key attribute so the page can
+     * store what it renders. An empty theme turns the lookup off.
+     */
+    void setDiagramCache(const QString& workspace, const QString& theme);
+
+    /**
+     * When enabled, each top-level block of the document gets a
+     * data-source-line attribute with the 1-based line of the markdown
+     * it starts on, for scroll sync. Included notes are not marked.
+     */
+    void setSourceLinesEnabled(bool enabled);
+    bool isSourceLinesEnabled() const { return m_sourceLinesEnabled; }
+
+    /**
+     * Renders markdown, with [[!inclusions]] expanded up to
+     * MAX_INCLUSION_DEPTH levels deep. If includedFiles is given, it is
+     * set to every file the result was built from.
+     */
+    QString render(const QString& markdown,
+                   QStringList* includedFiles = nullptr) const;
+
+    static const int MAX_INCLUSION_DEPTH = 8;
+
+   private:
+    friend struct MarkdownRenderContext;
+
+    QString renderDocument(const QString& markdown,
+                           MarkdownInclusionState& state) const;
+    QString includeFile(const QString& linkTarget, const QString& displayText,
+                        MarkdownInclusionState& state) const;
+    QString readFileContent(const QString& linkTarget, QString& errorMsg,
+                            MarkdownInclusionState& state) const;
+
+    QString m_basePath;
+    bool m_latexEnabled;
+    bool m_prerenderEnabled;
+    bool m_sourceLinesEnabled;
+    QString m_diagramWorkspace;
+    QString m_diagramTheme;
+};
+
+#endif  // MARKDOWNRENDERER_H
@@ -0,0 +1,44 @@
+#ifndef MERMAIDCACHE_H
+#define MERMAIDCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/**
+ * SVGs of rendered Mermaid diagrams, keyed by a hash of the diagram
+ * source and the Mermaid theme. The preview page renders a diagram once
+ * and hands the SVG back; later renders of the same diagram put the SVG
+ * straight into the HTML instead of running Mermaid again.
+ *
+ * Entries are kept in memory and, per workspace, on disk under the
+ * cache location, so they survive restarts. Safe to use from render
+ * threads.
+ */
+class MermaidCache {
+   public:
+    static MermaidCache* instance();
+
+    static QString diagramKey(const QString& source, const QString& theme);
+
+    /**
+     * Returns the SVG stored for key, or an empty string. Without a
+     * workspace only the in-memory entries are searched.
+     */
+    QString find(const QString& workspace, const QString& key);
+    void store(const QString& workspace, const QString& key,
+               const QString& svg);
+
+   private:
+    MermaidCache();
+
+    static QString cacheDirectory(const QString& workspace);
+    static bool isValidKey(const QString& key);
+    void remember(const QString& key, const QString& svg);
+
+    QMutex m_mutex;
+    QHash<QString, QString> m_svgs;
+    qint64 m_memoryBytes;
+};
+
+#endif  // MERMAIDCACHE_H
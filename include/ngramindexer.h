@@ -0,0 +1,71 @@
+#ifndef NGRAMINDEXER_H
+#define NGRAMINDEXER_H
+
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+#include <memory>
+
+class NgramModel;
+class QTimer;
+
+/**
+ * Keeps the workspace trigram model used for word prediction up to date.
+ *
+ * Models are cached per workspace under the application cache
+ * directory and keyed by a stamp of every markdown file's path, size
+ * and modification time. Opening a workspace maps the last cached model
+ * right away; a background job then rebuilds it only if the stamp no
+ * longer matches.
+ */
+class NgramIndexer : public QObject {
+    Q_OBJECT
+
+   public:
+    explicit NgramIndexer(QObject* parent = nullptr);
+    ~NgramIndexer();
+
+    /**
+     * Switches to rootPath, maps its cached model if there is one, and
+     * starts a background refresh. An empty path drops the model.
+     */
+    void setWorkspace(const QString& rootPath);
+
+    /**
+     * Refreshes the model shortly after the workspace changed, e.g. on
+     * save. Bursts of calls trigger a single refresh.
+     */
+    void scheduleRefresh();
+
+    std::shared_ptr<const NgramModel> model() const { return m_model; }
+
+   public slots:
+    void refresh();
+
+   signals:
+    void modelChanged();
+
+   private slots:
+    void onBuildFinished();
+
+   private:
+    static QString cacheDirectory();
+    static QString cacheKey(const QString& rootPath);
+    static std::shared_ptr<const NgramModel> openLatestModel(
+        const QString& rootPath);
+    static std::shared_ptr<const NgramModel> buildModel(
+        const QString& rootPath, qint64 budgetBytes,
+        const QAtomicInt* cancelled);
+
+    void setModel(std::shared_ptr<const NgramModel> model);
+
+    QString m_rootPath;
+    std::shared_ptr<const NgramModel> m_model;
+    QFutureWatcher<std::shared_ptr<const NgramModel>>* m_watcher;
+    QTimer* m_refreshTimer;
+    QAtomicInt m_cancelled;
+    bool m_refreshPending;
+};
+
+#endif  // NGRAMINDEXER_H
@@ -0,0 +1,115 @@
+#ifndef NGRAMMODEL_H
+#define NGRAMMODEL_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+#include <memory>
+
+/**
+ * On-disk layout shared by NgramModel and NgramModelBuilder. Sections
+ * follow the header in declaration order, each padded to 4 bytes.
+ */
+struct NgramFileHeader {
+    static constexpr quint32 MAGIC = 0x4c4b4d54;  // "TMKL" on little-endian.
+    static constexpr quint32 VERSION = 1;
+    static constexpr quint32 UNIGRAM_BLOCK = 64;
+
+    quint32 magic;
+    quint32 version;
+    quint64 sourceStamp;
+    quint32 vocabularySize;  // Word 0 is the sentence-start marker.
+    quint32 stringBytes;
+    quint32 bigramCount;
+    quint32 trigramCount;
+};
+
+struct NgramBigramRecord {
+    quint32 word;
+    quint8 probability;  // Quantized log10 P(word | previous).
+    quint8 backoff;      // Quantized log10 weight of (previous, word) as context.
+    quint16 reserved;
+};
+
+namespace NgramQuantizer {
+// Log10 values are clamped to [-FLOOR, 0] and stored as 0..255.
+constexpr float FLOOR = 10.0f;
+
+inline quint8 encode(float log10Value) {
+    float clamped = qBound(-FLOOR, log10Value, 0.0f);
+    return static_cast<quint8>(qRound(-clamped / FLOOR * 255.0f));
+}
+
+inline float decode(quint8 value) { return -FLOOR * value / 255.0f; }
+}  // namespace NgramQuantizer
+
+/**
+ * Read-only trigram language model memory-mapped from the binary file
+ * written by NgramModelBuilder.
+ *
+ * Probabilities are interpolated Kneser-Ney estimates stored in backoff
+ * form and quantized to 8 bits. Words are interned as ids in sorted
+ * order, so a typed prefix maps to a contiguous id range and follower
+ * lists can be searched by range instead of by scanning the vocabulary.
+ * Nothing is parsed on load; open() validates the header, offset
+ * tables and word ids in one pass and points into the mapping.
+ */
+class NgramModel {
+   public:
+    struct Prediction {
+        QString word;
+        int order = 0;  // 3 = trigram, 2 = bigram, 1 = unigram, 0 = none.
+        float log10Probability = 0.0f;
+
+        bool isValid() const { return order > 0; }
+    };
+
+    ~NgramModel();
+
+    /**
+     * Maps the model stored at filePath. Returns nullptr if the file is
+     * missing, truncated, damaged, or was written by another format
+     * version.
+     */
+    static std::shared_ptr<const NgramModel> open(const QString& filePath);
+
+    /**
+     * Most probable word that starts with prefix, is longer than it,
+     * and follows previousWord (and beforePrevious, if given). Context
+     * words that are not in the vocabulary are ignored.
+     */
+    Prediction predict(const QString& prefix, const QString& previousWord,
+                       const QString& beforePrevious = QString()) const;
+
+    quint32 vocabularySize() const;
+    quint64 sourceStamp() const;
+    qint64 sizeInBytes() const { return m_size; }
+
+   private:
+    NgramModel() = default;
+
+    quint32 findWord(const QByteArray& word) const;
+    void prefixRange(const QByteArray& prefix, quint32& first,
+                     quint32& end) const;
+    QByteArray wordAt(quint32 id) const;
+    quint32 findBigram(quint32 previous, quint32 word) const;
+    quint32 bestUnigram(quint32 first, quint32 end, quint32 skip) const;
+
+    QFile m_file;
+    const uchar* m_data = nullptr;
+    qint64 m_size = 0;
+
+    const NgramFileHeader* m_header = nullptr;
+    const quint32* m_wordOffsets = nullptr;
+    const char* m_strings = nullptr;
+    const quint8* m_unigramProb = nullptr;
+    const quint8* m_unigramBackoff = nullptr;
+    const quint32* m_blockBest = nullptr;
+    const quint32* m_bigramOffsets = nullptr;
+    const NgramBigramRecord* m_bigrams = nullptr;
+    const quint32* m_trigramOffsets = nullptr;
+    const quint32* m_trigrams = nullptr;
+};
+
+#endif  // NGRAMMODEL_H
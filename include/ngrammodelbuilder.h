@@ -0,0 +1,50 @@
+#ifndef NGRAMMODELBUILDER_H
+#define NGRAMMODELBUILDER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/**
+ * Counts trigrams over a stream of documents and writes the trigram
+ * model file read by NgramModel.
+ *
+ * Sentences are padded with a start marker, so bigram and unigram
+ * statistics are derived from the trigram counts as Kneser-Ney
+ * continuation counts. The builder never uses much more than the given
+ * budget: once the count table outgrows it, singleton trigrams are
+ * dropped, and write() prunes rare n-grams until the file fits.
+ */
+class NgramModelBuilder {
+   public:
+    explicit NgramModelBuilder(qint64 memoryBudgetBytes);
+
+    void addText(const QString& text);
+
+    /**
+     * Estimates the model and saves it atomically to filePath. Returns
+     * false if the file could not be written or the vocabulary alone
+     * does not fit in the budget.
+     */
+    bool write(const QString& filePath, quint64 sourceStamp) const;
+
+    int vocabularySize() const { return m_words.size(); }
+    qint64 tokenCount() const { return m_tokenCount; }
+
+   private:
+    quint32 intern(const QString& word);
+    void countTrigram(quint32 first, quint32 second, quint32 third);
+    void pruneSingletons();
+
+    qint64 m_memoryBudget;
+    qint64 m_tokenCount;
+    int m_maxTrigramEntries;
+
+    QHash<QByteArray, quint32> m_ids;
+    QVector<QByteArray> m_words;
+    // Trigram (u, v, w) packed as 21-bit ids into one key.
+    QHash<quint64, quint32> m_trigramCounts;
+};
+
+#endif  // NGRAMMODELBUILDER_H
@@ -0,0 +1,83 @@
+#ifndef PDFEXPORTER_H
+#define PDFEXPORTER_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QPageLayout>
+#include <QQueue>
+#include <QString>
+#include <QTemporaryDir>
+
+#include "htmlexporter.h"
+
+class QTimer;
+class QWebEnginePage;
+
+/**
+ * Exports notes to PDF without pandoc or LaTeX.
+ *
+ * Each note is built into a standalone page by HtmlExporter on the
+ * thread pool, loaded into an offscreen QWebEnginePage and printed with
+ * printToPdf(), so the PDF looks like the preview. Exports are queued
+ * and run one after the other; none of them blocks the UI.
+ */
+class PdfExporter : public QObject {
+    Q_OBJECT
+
+   public:
+    struct Options {
+        HtmlExporter::Options html;
+        QPageLayout pageLayout;
+    };
+
+    explicit PdfExporter(QObject* parent = nullptr);
+    ~PdfExporter();
+
+    /**
+     * Page layout for a page size name as the settings store it ("A4",
+     * "Letter", ...), an orientation and equal margins in millimeters.
+     * Unknown names give A4.
+     */
+    static QPageLayout pageLayout(const QString& pageSize, bool landscape,
+                                  double marginMillimeters);
+
+    /** Queues the export of sourcePath to outputPath. */
+    void enqueue(const QString& sourcePath, const QString& outputPath,
+                 const Options& options);
+
+    /** Exports not finished yet, including the running one. */
+    int pendingCount() const { return m_jobs.size() + (m_busy ? 1 : 0); }
+
+   signals:
+    void progressChanged(int percent, const QString& step);
+    void finished(bool success, const QString& outputPath,
+                  const QString& errorMessage);
+
+   private slots:
+    void onPageWritten();
+    void onPageLoaded(bool ok);
+    void checkPageReady();
+    void onPdfPrinted(const QString& filePath, bool success);
+
+   private:
+    struct Job {
+        QString sourcePath;
+        QString outputPath;
+        Options options;
+    };
+
+    void startNext();
+    void finishJob(const QString& errorMessage);
+    QString pagePath() const;
+
+    QQueue<Job> m_jobs;
+    Job m_current;
+    bool m_busy;
+    QFutureWatcher<QString>* m_htmlWatcher;
+    QWebEnginePage* m_page;
+    QTimer* m_readyTimer;
+    int m_readyChecks;
+    QTemporaryDir m_pageDir;
+};
+
+#endif  // PDFEXPORTER_H
@@ -0,0 +1,58 @@
+#ifndef PRERENDERPOOL_H
+#define PRERENDERPOOL_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QThreadPool;
+
+/**
+ * Renders math with KaTeX and code with highlight.js into static HTML,
+ * outside the preview page.
+ *
+ * Each worker thread of the pool runs its own headless QJSEngine with
+ * the bundled scripts loaded, so formulas and code blocks of a note are
+ * rendered in parallel, and results are kept by a hash of their source.
+ * The page then shows finished markup instead of typesetting it.
+ */
+class PrerenderPool {
+   public:
+    enum Kind { InlineMath, DisplayMath, Code };
+
+    struct Item {
+        Kind kind = InlineMath;
+        QString source;
+        // Code only; empty lets highlight.js pick the language.
+        QString language;
+    };
+
+    static PrerenderPool* instance();
+
+    /** False if the scripts could not be loaded. */
+    bool isAvailable() const { return !m_script.isEmpty(); }
+
+    /**
+     * Returns the HTML of each item, in order. Items that could not be
+     * rendered come back as null strings. Blocks until all are done.
+     */
+    QStringList render(const QVector<Item>& items);
+
+   private:
+    PrerenderPool();
+
+    static QByteArray cacheKey(const Item& item);
+    QString renderItem(const Item& item) const;
+
+    QThreadPool* m_pool;
+    QString m_script;
+
+    QMutex m_mutex;
+    QHash<QByteArray, QString> m_cache;
+    qint64 m_cacheBytes;
+};
+
+#endif  // PRERENDERPOOL_H
@@ -0,0 +1,39 @@
+#ifndef PREVIEWBRIDGE_H
+#define PREVIEWBRIDGE_H
+
+#include <QObject>
+#include <QString>
+
+/**
+ * The object the preview page talks to over QWebChannel, as
+ * "treemkBridge". The page pushes scroll positions and rendered
+ * diagrams through its slots when they happen, instead of the preview
+ * polling for them.
+ */
+class PreviewBridge : public QObject {
+    Q_OBJECT
+
+   public:
+    explicit PreviewBridge(QObject* parent = nullptr) : QObject(parent) {}
+
+   public slots:
+    /**
+     * The user scrolled the page. line is the source line at the top of
+     * the view, with a fraction for how far into it the view is, or 0
+     * if the page has no marked blocks.
+     */
+    void reportScroll(double line, double percentage) {
+        emit scrolled(line, percentage);
+    }
+
+    /** Mermaid rendered the diagram stored under key. */
+    void reportDiagram(const QString& key, const QString& svg) {
+        emit diagramRendered(key, svg);
+    }
+
+   signals:
+    void scrolled(double line, double percentage);
+    void diagramRendered(const QString& key, const QString& svg);
+};
+
+#endif  // PREVIEWBRIDGE_H
@@ -0,0 +1,56 @@
+#ifndef PREVIEWPATCH_H
+#define PREVIEWPATCH_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace PreviewPatch {
+
+/**
+ * A change to the list of top-level blocks shown in the preview.
+ *
+ * removeCount blocks starting at start are replaced by blocks. An empty
+ * patch leaves the page untouched.
+ */
+struct Patch {
+    int start = 0;
+    int removeCount = 0;
+    QStringList blocks;
+
+    bool isEmpty() const { return removeCount == 0 && blocks.isEmpty(); }
+};
+
+/**
+ * Splits rendered HTML into its top-level elements.
+ *
+ * Whitespace between elements is dropped. Unbalanced raw HTML keeps the
+ * rest of the document in one block, so every block parses on its own
+ * the same way it would as part of the whole page.
+ */
+QStringList splitBlocks(const QString& html);
+
+/**
+ * Returns one key per block; equal blocks have equal keys. The
+ * data-source-line attribute of a block is left out, so a block that
+ * only moved to another line keeps its key.
+ */
+QVector<size_t> blockKeys(const QStringList& blocks);
+
+/**
+ * Returns the data-source-line attribute of the block's leading tag,
+ * or 0 if it has none.
+ */
+int sourceLine(const QString& block);
+
+/**
+ * Computes the patch that turns the blocks keyed by oldKeys into
+ * newBlocks. Blocks shared at the start and at the end are kept, so an
+ * edit inside one paragraph replaces just that paragraph.
+ */
+Patch diff(const QVector<size_t>& oldKeys, const QVector<size_t>& newKeys,
+           const QStringList& newBlocks);
+
+}  // namespace PreviewPatch
+
+#endif  // PREVIEWPATCH_H
@@ -0,0 +1,48 @@
+#ifndef PREVIEWRENDERCACHE_H
+#define PREVIEWRENDERCACHE_H
+
+#include <QCache>
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * The last rendered blocks of each document shown in a preview, so
+ * switching back to a tab whose note has not changed shows its output
+ * again without rendering it.
+ *
+ * Entries are keyed by a document id and hold the revision and render
+ * settings they were made for; any other revision or settings is a
+ * miss, and so is an entry whose included files changed on disk. The
+ * least recently shown documents are dropped once the entries exceed
+ * the byte limit.
+ */
+class PreviewRenderCache {
+   public:
+    explicit PreviewRenderCache(qint64 maxBytes = DEFAULT_MAX_BYTES);
+
+    static const qint64 DEFAULT_MAX_BYTES = 16 * 1024 * 1024;
+
+    bool find(int documentId, quint64 revision, const QString& settings,
+              QStringList& blocks, QStringList& includedFiles);
+    void store(int documentId, quint64 revision, const QString& settings,
+               const QStringList& blocks, const QStringList& includedFiles);
+    void remove(int documentId);
+    void clear();
+
+   private:
+    struct Entry {
+        quint64 revision = 0;
+        QString settings;
+        QStringList blocks;
+        QStringList includedFiles;
+        QVector<QDateTime> includedModified;
+    };
+
+    static QVector<QDateTime> modificationTimes(const QStringList& files);
+
+    QCache<int, Entry> m_entries;
+};
+
+#endif  // PREVIEWRENDERCACHE_H
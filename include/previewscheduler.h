@@ -0,0 +1,53 @@
+#ifndef PREVIEWSCHEDULER_H
+#define PREVIEWSCHEDULER_H
+
+#include <QHash>
+#include <QObject>
+
+class QTimer;
+
+/**
+ * Decides when the preview of a window renders after edits.
+ *
+ * Every edit asks for a render; requests made before the wait runs out
+ * become one. The wait is at least the refresh rate setting and grows
+ * with the measured render time of the document, so a note that takes
+ * long to render is not rendered again after every short pause in
+ * typing.
+ */
+class PreviewScheduler : public QObject {
+    Q_OBJECT
+
+   public:
+    explicit PreviewScheduler(QObject* parent = nullptr);
+
+    static constexpr int DEFAULT_MINIMUM_INTERVAL = 500;
+    static constexpr int MAXIMUM_INTERVAL = 3000;
+
+    void setMinimumInterval(int msec);
+    int minimumInterval() const { return m_minimumInterval; }
+
+    /** How long edits to documentId must pause before it renders. */
+    int interval(int documentId) const;
+
+    /** Asks for a render of documentId once edits pause. */
+    void schedule(int documentId);
+
+    /** Drops the scheduled render, if any. */
+    void cancel();
+
+   public slots:
+    /** Takes the time a render of documentId took into account. */
+    void recordRenderTime(int documentId, qint64 msec);
+
+   signals:
+    void renderDue();
+
+   private:
+    QTimer* m_timer;
+    int m_minimumInterval;
+    // Smoothed render time of each document, in milliseconds.
+    QHash<int, double> m_renderTimes;
+};
+
+#endif  // PREVIEWSCHEDULER_H
@@ -0,0 +1,71 @@
+#ifndef PREVIEWSCHEMEHANDLER_H
+#define PREVIEWSCHEMEHANDLER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QUrl>
+#include <QWebEngineUrlSchemeHandler>
+
+/**
+ * Serves preview pages through the treemk: scheme instead of setHtml(),
+ * which rejects documents over 2 MB.
+ *
+ * - treemk://preview/<dir>/?document=<id> is a rendered page, held in
+ *   memory until the preview replaces it.
+ * - treemk://preview/<path> is a local file, so relative links in a page
+ *   resolve against the note's directory like they did with file: URLs.
+ * - treemk://resource/<path> is a bundled resource (scripts, styles,
+ *   fonts, help pages), served with long-lived cache headers.
+ */
+class PreviewSchemeHandler : public QWebEngineUrlSchemeHandler {
+    Q_OBJECT
+
+   public:
+    static const QByteArray SCHEME;
+
+    /**
+     * Registers the scheme with the web engine. Must run before the
+     * QApplication is created.
+     */
+    static void registerScheme();
+
+    /**
+     * Returns the handler installed on the default profile, installing
+     * it on first use.
+     */
+    static PreviewSchemeHandler* instance();
+
+    /**
+     * Stores html as the page of preview id and returns the URL that
+     * loads it with relative links resolved against basePath, which is
+     * a directory or a qrc: path.
+     */
+    QUrl setDocument(int id, const QString& basePath, const QByteArray& html);
+    void removeDocument(int id);
+
+    /**
+     * Returns the URL relative links resolve against for basePath, as
+     * used by setDocument().
+     */
+    static QUrl baseUrl(const QString& basePath);
+
+    /**
+     * Returns the local file a treemk://preview URL refers to, or an
+     * empty string for any other URL.
+     */
+    static QString localFilePath(const QUrl& url);
+
+    void requestStarted(QWebEngineUrlRequestJob* job) override;
+
+   private:
+    explicit PreviewSchemeHandler(QObject* parent = nullptr);
+
+    QByteArray resource(const QString& path);
+
+    QHash<int, QByteArray> m_documents;
+    QHash<QString, QByteArray> m_resources;
+    quint64 m_revision;
+};
+
+#endif  // PREVIEWSCHEMEHANDLER_H
@@ -2,17 +2,20 @@
 #define QUICKOPENDIALOG_H
 
 #include <QDialog>
-#include <QList>
 #include <QString>
+#include <QStringList>
+#include <QStringView>
 
 class QLineEdit;
 class QListWidget;
+class WorkspaceCatalog;
 
 class QuickOpenDialog : public QDialog {
     Q_OBJECT
 
    public:
-    explicit QuickOpenDialog(const QString& rootPath,
+    /** catalog supplies the files and must outlive the dialog. */
+    explicit QuickOpenDialog(const WorkspaceCatalog* catalog,
                              const QStringList& recentFiles,
                              QWidget* parent = nullptr);
     ~QuickOpenDialog();
@@ -31,13 +34,12 @@ class QuickOpenDialog : public QDialog {
 
    private:
     void setupUI();
-    void scanFilesIterative(const QString& dirPath, QList<QString>& files,
-                            int maxDepth = 10);
-    bool fuzzyMatch(const QString& pattern, const QString& text) const;
+    // pattern must be lower case; text is compared case-insensitively.
+    bool fuzzyMatch(const QString& pattern, QStringView text) const;
 
+    const WorkspaceCatalog* catalog;
     QString rootPath;
     QStringList recentFiles;
-    QList<QString> allFiles;
 
     QLineEdit* searchEdit;
     QListWidget* fileListWidget;
@@ -69,6 +69,8 @@ class SettingsDialog : public QDialog {
     QCheckBox* enableWordPredictionCheckBox;
     QCheckBox* lineBreakCheckBox;
     QSpinBox* lineBreakColumnsSpinBox;
+    QSpinBox* largeFileThresholdSpinBox;
+    QSpinBox* predictionModelBudgetSpinBox;
 
     // Preview settings
     QSpinBox* previewRefreshRateSpinBox;
@@ -76,6 +78,11 @@ class SettingsDialog : public QDialog {
     QLineEdit* customCSSLineEdit;
     QPushButton* browseCSSButton;
 
+    // PDF export settings
+    QComboBox* pdfPageSizeComboBox;
+    QComboBox* pdfOrientationComboBox;
+    QSpinBox* pdfMarginSpinBox;
+
     // General settings
     QSpinBox* autoSaveIntervalSpinBox;
     QCheckBox* autoSaveEnabledCheck;
@@ -87,6 +94,7 @@ class SettingsDialog : public QDialog {
 
     // Workspace settings
     QSpinBox* linkSearchDepthSpinBox;
+    QCheckBox* updateLinksOnRenameCheckBox;
 
     // Appearance settings
     QComboBox* themeComboBox;
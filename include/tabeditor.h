@@ -9,7 +9,6 @@ class MarkdownPreview;
 class NavigationHistory;
 class OutlinePanel;
 class QSplitter;
-class QTimer;
 
 class TabEditor : public QWidget {
     Q_OBJECT
@@ -32,7 +31,10 @@ class TabEditor : public QWidget {
     void setSharedPreview(MarkdownPreview* preview);
     void updatePreviewContent(MarkdownPreview* preview);
     double scrollPercentage() const { return m_lastScrollPercentage; }
+    /** Source line at the top of the editor, with a fraction. */
+    double sourceLine() const { return m_lastSourceLine; }
     NavigationHistory* navigationHistory() const { return m_navigationHistory; }
+    int documentId() const { return m_documentId; }
 
    signals:
     void modificationChanged(bool modified);
@@ -50,6 +52,7 @@ class TabEditor : public QWidget {
     void updatePreview();
     void onEditorScrolled();
     void setEditorScrollFromPreview(double percentage);
+    void setEditorLineFromPreview(double line);
 
    private slots:
     void onDocumentModified();
@@ -58,13 +61,19 @@ class TabEditor : public QWidget {
     void setupUI();
     MarkdownEditor* m_editor;
     MarkdownPreview* m_sharedPreview;
-    QTimer* m_previewTimer;
     NavigationHistory* m_navigationHistory;
     QString m_filePath;
     bool m_isModified;
     bool m_ownSaved;
     double m_lastScrollPercentage;
+    double m_lastSourceLine;
     bool m_isScrollingFromPreview;
+    // Identify this tab's text in the preview's render cache; the
+    // revision counts edits and never repeats, unlike the document's.
+    int m_documentId;
+    quint64 m_revision;
+
+    static int nextDocumentId;
 };
 
 #endif  // TABEDITOR_H
@@ -1,26 +1,128 @@
 #ifndef WORDPREDICTOR_H
 #define WORDPREDICTOR_H
 
-#include <QMap>
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
 #include <QPair>
 #include <QString>
+#include <QThreadPool>
+#include <functional>
+#include <memory>
 
+#include "completionindex.h"
+
+class NgramModel;
+
+class QFileInfo;
+
+/**
+ * Word completion model built from unigram and bigram frequencies of the
+ * current document and of the markdown files next to it.
+ *
+ * Every update runs in order on a private single-thread pool, so the
+ * GUI thread never waits for tokenizing or disk I/O. Once the queue
+ * drains, the worker publishes a new CompletionIndex; predict() only
+ * takes a short lock to grab the current one and then costs
+ * O(prefix length).
+ */
 class WordPredictor {
 public:
     WordPredictor();
-    
-    void updateFromText(const QString& text);
-    void updateFromDirectory(const QString& dirPath, const QString& currentFilePath);
+    ~WordPredictor();
+
+    /**
+     * Replaces the statistics of the current document with the ones
+     * computed from text.
+     */
+    void setDocumentText(const QString& text);
+
+    /**
+     * Applies the difference between two versions of a range of
+     * paragraphs of the current document, so an edit only re-tokenizes
+     * the paragraphs it touched. wordBefore and wordAfter are the words
+     * around the range, which form bigrams with its first and last word.
+     */
+    void applyParagraphEdit(const QString& oldText, const QString& newText,
+                            const QString& wordBefore = QString(),
+                            const QString& wordAfter = QString());
+
+    /** First and last word of text as the predictor counts words. */
+    static QString firstWord(const QString& text);
+    static QString lastWord(const QString& text);
+
+    /**
+     * Counts the markdown files in dirPath, except currentFilePath whose
+     * live text comes from setDocumentText(). Files are read once; later
+     * calls only re-read files whose size or modification time changed
+     * and drop files that no longer exist.
+     */
+    void updateFromDirectory(const QString& dirPath,
+                             const QString& currentFilePath);
+
+    /**
+     * Re-reads one file of the current directory if it changed on disk,
+     * or drops it if it is gone. Fed from the workspace watcher.
+     */
+    void refreshFile(const QString& filePath);
+
     void clear();
-    
-    QString predict(const QString& prefix, const QString& previousWord = QString()) const;
-    
+
+    /**
+     * Sets the workspace-wide trigram model consulted alongside the local
+     * statistics. Pass nullptr to use local statistics only.
+     */
+    void setLanguageModel(std::shared_ptr<const NgramModel> model);
+
+    /**
+     * Blocks until every queued update has been applied. Meant for
+     * tests and shutdown, never for the typing path.
+     */
+    void waitForUpdates();
+
+    QString predict(const QString& prefix,
+                    const QString& previousWord = QString(),
+                    const QString& beforePrevious = QString()) const;
+
 private:
-    QString predictUnigram(const QString& prefix) const;
-    QString predictBigram(const QString& previousWord, const QString& prefix) const;
-    
-    QMap<QString, int> m_wordFrequency;
-    QMap<QPair<QString, QString>, int> m_bigramFrequency;
+    struct WordStats {
+        QHash<QString, int> words;
+        QHash<QPair<QString, QString>, int> bigrams;
+    };
+
+    struct FileEntry {
+        QDateTime lastModified;
+        qint64 size = -1;
+        WordStats stats;
+        bool counted = false;
+    };
+
+    void enqueue(std::function<void()> job);
+    void publishIndex();
+
+    static WordStats tokenize(const QString& text);
+    static void mergeStats(WordStats& target, const WordStats& delta,
+                           int sign);
+    void applyToTotals(const WordStats& delta, int sign);
+    void refreshFileEntry(const QFileInfo& fileInfo);
+    void dropFileEntry(const QString& filePath);
+
+    QThreadPool m_pool;
+    QAtomicInt m_pendingUpdates;
+
+    // Snapshots read by predict(); guarded by m_mutex.
+    mutable QMutex m_mutex;
+    std::shared_ptr<const CompletionIndex> m_index;
+    std::shared_ptr<const NgramModel> m_languageModel;
+
+    // Only touched from the worker thread.
+    QHash<QString, int> m_wordFrequency;
+    QHash<QPair<QString, QString>, int> m_bigramFrequency;
+    WordStats m_documentStats;
+    QString m_directoryPath;
+    QString m_excludedFilePath;
+    QHash<QString, FileEntry> m_fileEntries;
 };
 
 #endif // WORDPREDICTOR_H
@@ -0,0 +1,99 @@
+#ifndef WORKSPACECATALOG_H
+#define WORKSPACECATALOG_H
+
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+#include "workspacewatcher.h"
+
+/**
+ * The markdown files of a workspace, for Quick Open.
+ *
+ * The folder is listed once in the background and then kept current
+ * from WorkspaceWatcher batches, so opening Quick Open does not walk the
+ * tree. Paths are stored relative to the root, sorted, in one string
+ * pool; an entry is an offset and a length into it. A Rescan lists only
+ * the directory it names, again in the background.
+ *
+ * Like the old per-dialog scan, hidden files and directories, symbolic
+ * links and files more than ten folders deep are left out.
+ */
+class WorkspaceCatalog : public QObject {
+    Q_OBJECT
+
+   public:
+    struct Entry {
+        int offset = 0;
+        int length = 0;
+    };
+
+    // Sorted relative paths of the files below one directory.
+    struct Listing {
+        QString pool;
+        QVector<Entry> entries;
+    };
+
+    explicit WorkspaceCatalog(QObject* parent = nullptr);
+    ~WorkspaceCatalog();
+
+    /** Lists rootPath in the background. An empty path clears it. */
+    void setRootPath(const QString& rootPath);
+    QString rootPath() const { return m_rootPath; }
+
+    /** False until the first listing of the root is in. */
+    bool isReady() const { return m_ready; }
+
+    int count() const { return m_entries.size(); }
+    /** Valid until the catalog next changes. */
+    QStringView relativePath(int index) const;
+    QString filePath(int index) const;
+    bool contains(const QString& relativePath) const;
+
+    /**
+     * Lists the files below directory, relative to rootPath. Safe to
+     * call from any thread.
+     */
+    static Listing list(const QString& rootPath, const QString& directory,
+                        const QAtomicInt* cancelled = nullptr);
+
+   public slots:
+    void applyChanges(const WorkspaceChangeSet& changes);
+
+   signals:
+    void catalogChanged();
+
+   private slots:
+    void onListingFinished();
+
+   private:
+    void processPending();
+    // Returns false if relativePath is listed already.
+    bool insert(const QString& relativePath);
+    void removeTree(const QString& relativePath);
+    void replaceTree(const QString& relativePath, const Listing& listing);
+    void startListing(const QString& directory);
+    bool toRelative(const QString& path, QString* relativePath) const;
+    int lowerBound(QStringView relativePath) const;
+    void compact();
+
+    QString m_rootPath;
+    QString m_pool;
+    QVector<Entry> m_entries;
+    // Pool characters no entry refers to any more.
+    int m_deadChars;
+    bool m_ready;
+
+    // Changes wait here while a listing runs, to be applied in order.
+    WorkspaceChangeSet m_pending;
+    // The directory being listed, empty if none.
+    QString m_listingPath;
+    QFutureWatcher<Listing>* m_watcher;
+    QAtomicInt m_cancelled;
+};
+
+#endif  // WORKSPACECATALOG_H
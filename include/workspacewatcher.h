@@ -0,0 +1,137 @@
+#ifndef WORKSPACEWATCHER_H
+#define WORKSPACEWATCHER_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QFileSystemWatcher;
+class QSocketNotifier;
+class QTimer;
+
+struct WorkspaceChange {
+    enum Type {
+        Added,
+        Modified,
+        Removed,
+        // path was oldPath; for a directory, so was everything below it.
+        Renamed,
+        // Changes below path were not tracked one by one, e.g. after the
+        // kernel dropped events; everything below it may have changed.
+        Rescan
+    };
+
+    Type type;
+    QString path;
+    QString oldPath;
+    bool isDir;
+
+    WorkspaceChange() : type(Modified), isDir(false) {}
+    WorkspaceChange(Type t, const QString& p, bool dir,
+                    const QString& old = QString())
+        : type(t), path(p), oldPath(old), isDir(dir) {}
+};
+
+using WorkspaceChangeSet = QList<WorkspaceChange>;
+
+/**
+ * Watches a workspace folder and everything below it, and publishes
+ * what changed in batches.
+ *
+ * On Linux one inotify instance watches every directory of the tree,
+ * so file events need no per-file watches and renames are reported as
+ * such. Elsewhere, or if inotify is unavailable, a QFileSystemWatcher
+ * on the directories reports each changed directory as a Rescan.
+ * Hidden directories (.git and the like) are not watched.
+ *
+ * Events are collected for a short quiet period, at most a second in
+ * total, and merged per path, so a save that writes a temporary file
+ * and renames it over the note arrives as a single change. Files that
+ * appear inside a new directory are reported one by one.
+ */
+class WorkspaceWatcher : public QObject {
+    Q_OBJECT
+
+   public:
+    explicit WorkspaceWatcher(QObject* parent = nullptr);
+    ~WorkspaceWatcher();
+
+    /**
+     * Watches rootPath instead of the current folder. Directories below
+     * it are added in the background. An empty path stops watching.
+     */
+    void setRootPath(const QString& rootPath);
+    QString rootPath() const { return m_rootPath; }
+
+    /** Quiet period before a batch is published, in milliseconds. */
+    void setDebounceInterval(int msec);
+
+    int watchedDirectoryCount() const { return m_watchedPaths.size(); }
+
+    /** Emits the pending batch now instead of after the quiet period. */
+    void flush();
+
+   signals:
+    void changesReady(const WorkspaceChangeSet& changes);
+
+    /**
+     * The system refused further watches; directories beyond the first
+     * watched ones are not tracked until the root is set again.
+     */
+    void watchLimitReached(int watchedDirectories);
+
+   private slots:
+    void onInotifyActivated();
+    void onDirectoryChanged(const QString& path);
+    void onScanFinished();
+
+   private:
+    struct PendingMove {
+        QString path;
+        bool isDir = false;
+    };
+
+    static QStringList collectDirectories(const QString& rootPath,
+                                          const QAtomicInt* cancelled);
+    static bool isHidden(const QString& path);
+
+    void stopWatching();
+    void startScan();
+    void watchDirectory(const QString& path);
+    void watchTree(const QString& path, bool reportFiles);
+    void unwatchTree(const QString& path);
+    void moveWatches(const QString& oldPath, const QString& newPath);
+    void record(const WorkspaceChange& change);
+    void recordRename(const QString& oldPath, const QString& newPath,
+                      bool isDir);
+    void resolvePendingMoves();
+    void scheduleFlush();
+
+    QString m_rootPath;
+    int m_inotifyFd;
+    QSocketNotifier* m_notifier;
+    QFileSystemWatcher* m_fallbackWatcher;
+    // Watched directories by watch descriptor, and the other way round.
+    // The fallback watcher uses -1 for every directory.
+    QHash<int, QString> m_watchPaths;
+    QHash<QString, int> m_watchedPaths;
+    // Halves of inotify renames whose other half has not arrived yet.
+    QHash<quint32, PendingMove> m_pendingMoves;
+    bool m_limitReached;
+
+    QFutureWatcher<QStringList>* m_scanWatcher;
+    QAtomicInt m_scanCancelled;
+    QString m_scanRoot;
+
+    QHash<QString, WorkspaceChange> m_pending;
+    QTimer* m_debounceTimer;
+    int m_debounceInterval;
+    QElapsedTimer m_batchAge;
+};
+
+#endif  // WORKSPACEWATCHER_H
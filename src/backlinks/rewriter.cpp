@@ -0,0 +1,280 @@
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QUrl>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+
+#include "linkrewriter.h"
+#include "regexpatterns.h"
+
+namespace {
+
+const char* HTTP_PREFIX = "http://";
+const char* HTTPS_PREFIX = "https://";
+
+const int WIKI_TARGET_GROUP = 2;  // target filename
+const int MD_URL_GROUP = 3;       // URL or path
+
+// Splits "name.ext" into "name" and ".ext"; dot files have no extension.
+void splitExtension(const QString& fileName, QString* base, QString* ext) {
+    const int dotPos = fileName.lastIndexOf('.');
+    if (dotPos > 0) {
+        *base = fileName.left(dotPos);
+        *ext = fileName.mid(dotPos);
+    } else {
+        *base = fileName;
+        ext->clear();
+    }
+}
+
+// Whether a link written without an extension can mean this file.
+bool isMarkdownExtension(const QString& ext) {
+    return ext.isEmpty() || ext.compare(".md", Qt::CaseInsensitive) == 0 ||
+           ext.compare(".markdown", Qt::CaseInsensitive) == 0;
+}
+
+struct FileResult {
+    bool updated = false;
+    QString error;
+};
+
+FileResult rewriteFile(const QString& path, const QString& oldFileName,
+                       const QString& newFileName,
+                       const LinkRewriter::LinkFilter& filter) {
+    FileResult result;
+    QFile source(path);
+    if (!source.open(QIODevice::ReadOnly)) {
+        result.error = path + ": " + source.errorString();
+        return result;
+    }
+    const QString content = QString::fromUtf8(source.readAll());
+    source.close();
+
+    const QList<LinkRewriter::Edit> edits =
+        LinkRewriter::linkEdits(content, oldFileName, newFileName, path,
+                                filter);
+    if (edits.isEmpty()) {
+        return result;
+    }
+
+    // Readers see either the old note or the new one, never a torn write.
+    QSaveFile output(path);
+    if (!output.open(QIODevice::WriteOnly)) {
+        result.error = path + ": " + output.errorString();
+        return result;
+    }
+    output.write(LinkRewriter::applyEdits(content, edits).toUtf8());
+    if (!output.commit()) {
+        result.error = path + ": " + output.errorString();
+        return result;
+    }
+    result.updated = true;
+    return result;
+}
+
+}  // namespace
+
+LinkRewriter::LinkRewriter(QObject* parent)
+    : QObject(parent),
+      m_watcher(new QFutureWatcher<Summary>(this)),
+      m_running(false) {
+    connect(m_watcher, &QFutureWatcherBase::finished, this,
+            &LinkRewriter::onRewriteFinished);
+}
+
+LinkRewriter::~LinkRewriter() {
+    // A half-finished rewrite would leave some notes pointing at the old
+    // name, so let the running one complete. Queued ones are dropped.
+    m_queue.clear();
+    m_watcher->waitForFinished();
+}
+
+QList<LinkRewriter::Edit> LinkRewriter::linkEdits(
+    const QString& content, const QString& oldFileName,
+    const QString& newFileName, const QString& referrer,
+    const LinkFilter& filter) {
+    QList<Edit> edits;
+    if (oldFileName.isEmpty() || newFileName.isEmpty()) {
+        return edits;
+    }
+
+    QString oldFileBase;
+    QString oldFileExt;
+    splitExtension(oldFileName, &oldFileBase, &oldFileExt);
+    QString newFileBase;
+    QString newFileExt;
+    splitExtension(newFileName, &newFileBase, &newFileExt);
+    const bool matchesWithoutExtension = isMarkdownExtension(oldFileExt);
+
+    static const QRegularExpression wikiLinkPattern(RegexPatterns::WIKI_LINK);
+    QRegularExpressionMatchIterator wikiIterator =
+        wikiLinkPattern.globalMatch(content);
+
+    while (wikiIterator.hasNext()) {
+        QRegularExpressionMatch match = wikiIterator.next();
+        const QString rawTarget = match.captured(WIKI_TARGET_GROUP);
+        const QString written = rawTarget.trimmed();
+        QString target = written;
+
+        // A heading or block anchor stays as it is
+        QString anchor;
+        const int hashPos = target.indexOf('#');
+        if (hashPos >= 0) {
+            anchor = target.mid(hashPos);
+            target = target.left(hashPos);
+        }
+
+        // The full file name, or the name without a markdown extension:
+        // [[note.png]] is not a link to note.md.
+        const QString targetFileName = QFileInfo(target).fileName();
+        const bool withExtension = targetFileName == oldFileName;
+        if (target.isEmpty() ||
+            (!withExtension &&
+             (!matchesWithoutExtension ||
+              targetFileName.compare(oldFileBase, Qt::CaseInsensitive) != 0))) {
+            continue;
+        }
+        // Another note of the same name, in a folder closer to referrer
+        if (filter && !filter(target, referrer)) {
+            continue;
+        }
+
+        // Preserve the path structure if present, and leave the
+        // extension out if the link did
+        QString newTarget = withExtension ? newFileName : newFileBase;
+        if (target.contains('/') || target.contains('\\')) {
+            QString path = QFileInfo(target).path();
+            if (path != ".") {
+                newTarget = path + "/" + newTarget;
+            }
+        }
+
+        // Only the target changes; the "!" marker, the display text and
+        // the spacing around the target are kept.
+        Edit edit;
+        edit.position = match.capturedStart(WIKI_TARGET_GROUP) +
+                        rawTarget.indexOf(written);
+        edit.length = written.length();
+        edit.text = newTarget + anchor;
+        edits.append(edit);
+    }
+
+    // Markdown links with optional !: ![text](url) or [text](url)
+    static const QRegularExpression markdownLinkPattern(
+        RegexPatterns::MARKDOWN_LINK_WITH_IMAGE);
+    QRegularExpressionMatchIterator mdIterator =
+        markdownLinkPattern.globalMatch(content);
+
+    while (mdIterator.hasNext()) {
+        QRegularExpressionMatch match = mdIterator.next();
+        const QString rawUrl = match.captured(MD_URL_GROUP);
+        QString url = rawUrl.trimmed();
+
+        // Skip external links
+        if (url.startsWith(HTTP_PREFIX) || url.startsWith(HTTPS_PREFIX)) {
+            continue;
+        }
+
+        // Compare the path without its fragment, decoded: note%20one.md
+        // is "note one.md"
+        QString path = url;
+        const int hashPos = path.indexOf('#');
+        if (hashPos >= 0) {
+            path = path.left(hashPos);
+        }
+        const int nameStart = path.lastIndexOf('/') + 1;
+        const QString rawName = path.mid(nameStart);
+        const QString name = QUrl::fromPercentEncoding(rawName.toUtf8());
+        if (name != oldFileName) {
+            continue;
+        }
+        if (filter &&
+            !filter(QUrl::fromPercentEncoding(path.toUtf8()), referrer)) {
+            continue;
+        }
+
+        // Keep the same relative path structure, the fragment and the
+        // encoding
+        Edit edit;
+        edit.position =
+            match.capturedStart(MD_URL_GROUP) + rawUrl.indexOf(url) + nameStart;
+        edit.length = rawName.length();
+        edit.text = newFileName;
+        if (rawName != name) {
+            edit.text = QString::fromUtf8(QUrl::toPercentEncoding(newFileName));
+        }
+        edits.append(edit);
+    }
+
+    std::sort(edits.begin(), edits.end(), [](const Edit& a, const Edit& b) {
+        return a.position < b.position;
+    });
+    return edits;
+}
+
+QString LinkRewriter::applyEdits(const QString& content,
+                                 const QList<Edit>& edits) {
+    // Back to front, so that earlier positions stay valid
+    QString result = content;
+    for (auto it = edits.crbegin(); it != edits.crend(); ++it) {
+        result.replace(it->position, it->length, it->text);
+    }
+    return result;
+}
+
+LinkRewriter::Summary LinkRewriter::rewriteFiles(const QStringList& files,
+                                                 const QString& oldFileName,
+                                                 const QString& newFileName,
+                                                 int maxWorkers,
+                                                 const LinkFilter& filter) {
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, maxWorkers));
+    const QList<FileResult> results = QtConcurrent::blockingMapped(
+        &pool, files, [&](const QString& path) {
+            return rewriteFile(path, oldFileName, newFileName, filter);
+        });
+
+    Summary summary;
+    for (const FileResult& result : results) {
+        if (!result.error.isEmpty()) {
+            summary.errors.append(result.error);
+        } else if (result.updated) {
+            ++summary.updated;
+        }
+    }
+    return summary;
+}
+
+void LinkRewriter::start(const QStringList& files, const QString& oldFileName,
+                         const QString& newFileName, const LinkFilter& filter) {
+    m_queue.append({files, oldFileName, newFileName, filter});
+    // Not the watcher's state: a future that is done but whose finished()
+    // has not been delivered yet would be dropped by setFuture().
+    if (!m_running) {
+        startNext();
+    }
+}
+
+void LinkRewriter::startNext() {
+    if (m_queue.isEmpty()) {
+        return;
+    }
+    m_running = true;
+    const Request request = m_queue.takeFirst();
+    const int workers = qBound(1, QThread::idealThreadCount(), 4);
+    m_watcher->setFuture(QtConcurrent::run([request, workers]() {
+        return rewriteFiles(request.files, request.oldFileName,
+                            request.newFileName, workers, request.filter);
+    }));
+}
+
+void LinkRewriter::onRewriteFinished() {
+    m_running = false;
+    const Summary summary = m_watcher->result();
+    emit finished(summary.updated, summary.errors);
+    startNext();
+}
@@ -0,0 +1,356 @@
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include "batchexporter.h"
+
+namespace {
+
+// Bumped when pages change for the same notes and settings, so that a
+// new version exports everything once.
+const int MANIFEST_VERSION = 1;
+
+// File systems that store modification times in whole seconds, or two
+// of them, can date a change up to this long before it happened.
+const int MODIFICATION_TIME_SLACK_SECS = 2;
+
+struct ManifestEntry {
+    QString hash;
+    // Content hash of each included note and image, by absolute path.
+    QHash<QString, QString> dependencies;
+};
+
+// Entries by the note's path relative to the exported folder.
+using Manifest = QHash<QString, ManifestEntry>;
+
+struct NoteResult {
+    QString relativePath;
+    ManifestEntry entry;
+    bool exported = false;
+    bool skipped = false;
+    bool hasEntry = false;
+    QString error;
+};
+
+QString contentHash(const QByteArray& content) {
+    return QString::fromLatin1(
+        QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex());
+}
+
+QString fileHash(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(&file);
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+// Hashes of dependencies, shared by the workers, so that an image used
+// by many notes is read once per batch.
+class DependencyHashes {
+   public:
+    QString hash(const QString& path) {
+        {
+            QMutexLocker locker(&m_mutex);
+            auto it = m_hashes.constFind(path);
+            if (it != m_hashes.constEnd()) {
+                return *it;
+            }
+        }
+        const QString result = fileHash(path);
+        QMutexLocker locker(&m_mutex);
+        m_hashes.insert(path, result);
+        return result;
+    }
+
+   private:
+    QMutex m_mutex;
+    QHash<QString, QString> m_hashes;
+};
+
+QString optionsKey(const HtmlExporter::Options& options) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(MANIFEST_VERSION) + '\n');
+    hash.addData(options.styleSheet.toUtf8() + '\n');
+    hash.addData(QByteArray::number(int(options.darkScheme)) +
+                 QByteArray::number(int(options.latexEnabled)) + '\n');
+    hash.addData(options.workspacePath.toUtf8());
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+// An unreadable manifest is empty. key is set to the options the pages
+// were exported with.
+Manifest readManifest(const QString& path, QString* key) {
+    Manifest manifest;
+    key->clear();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return manifest;
+    }
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    *key = root.value("options").toString();
+    const QJsonObject notes = root.value("notes").toObject();
+    for (auto it = notes.constBegin(); it != notes.constEnd(); ++it) {
+        const QJsonObject note = it.value().toObject();
+        ManifestEntry entry;
+        entry.hash = note.value("hash").toString();
+        const QJsonObject dependencies = note.value("dependencies").toObject();
+        for (auto dep = dependencies.constBegin();
+             dep != dependencies.constEnd(); ++dep) {
+            entry.dependencies.insert(dep.key(), dep.value().toString());
+        }
+        manifest.insert(it.key(), entry);
+    }
+    return manifest;
+}
+
+bool writeManifest(const QString& path, const QString& key,
+                   const Manifest& manifest) {
+    QJsonObject notes;
+    for (auto it = manifest.constBegin(); it != manifest.constEnd(); ++it) {
+        QJsonObject dependencies;
+        for (auto dep = it->dependencies.constBegin();
+             dep != it->dependencies.constEnd(); ++dep) {
+            dependencies.insert(dep.key(), dep.value());
+        }
+        QJsonObject note;
+        note.insert("hash", it->hash);
+        note.insert("dependencies", dependencies);
+        notes.insert(it.key(), note);
+    }
+    QJsonObject root;
+    root.insert("version", MANIFEST_VERSION);
+    root.insert("options", key);
+    root.insert("notes", notes);
+
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) &&
+           file.write(QJsonDocument(root).toJson()) >= 0 && file.commit();
+}
+
+// Notes below folder, relative to it, leaving out the output folder
+// when it is inside.
+QStringList collectNotes(const QDir& folder, const QString& outputDir) {
+    QStringList notes;
+    const QString outputPrefix = QDir::cleanPath(outputDir) + '/';
+    QDirIterator it(folder.absolutePath(),
+                    QStringList() << "*.md" << "*.markdown", QDir::Files,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString path = it.next();
+        if (path.startsWith(outputPrefix)) {
+            continue;
+        }
+        notes.append(folder.relativeFilePath(path));
+    }
+    notes.sort();
+    return notes;
+}
+
+QString pagePath(const QDir& outputDir, const QString& relativePath) {
+    const QString suffix = QFileInfo(relativePath).suffix();
+    return outputDir.filePath(
+        relativePath.left(relativePath.size() - suffix.size()) + "html");
+}
+
+bool dependenciesUnchanged(const ManifestEntry& entry,
+                           DependencyHashes& hashes) {
+    for (auto it = entry.dependencies.constBegin();
+         it != entry.dependencies.constEnd(); ++it) {
+        if (hashes.hash(it.key()) != it.value()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+const char BatchExporter::MANIFEST_NAME[] = ".treemk-export.json";
+
+BatchExporter::BatchExporter(QObject* parent)
+    : QObject(parent),
+      m_watcher(new QFutureWatcher<Summary>(this)) {
+    connect(m_watcher, &QFutureWatcherBase::finished, this,
+            &BatchExporter::onBatchFinished);
+}
+
+BatchExporter::~BatchExporter() {
+    m_cancelled.storeRelaxed(1);
+    m_watcher->waitForFinished();
+}
+
+int BatchExporter::defaultWorkerCount() {
+    return qBound(1, QThread::idealThreadCount(), 4);
+}
+
+bool BatchExporter::start(const QString& folder, const QString& outputDir,
+                          const HtmlExporter::Options& options) {
+    if (m_watcher->isRunning()) {
+        return false;
+    }
+    m_cancelled.storeRelaxed(0);
+    // As in HtmlExporter::start(), the destructor waits for the job.
+    HtmlExporter::ProgressCallback progress = [this](int percent,
+                                                     const QString& step) {
+        QMetaObject::invokeMethod(
+            this,
+            [this, percent, step]() { emit progressChanged(percent, step); },
+            Qt::QueuedConnection);
+    };
+    const int workers = defaultWorkerCount();
+    m_watcher->setFuture(QtConcurrent::run(
+        [this, folder, outputDir, options, workers, progress]() {
+            return exportFolder(folder, outputDir, options, workers,
+                                &m_cancelled, progress);
+        }));
+    return true;
+}
+
+void BatchExporter::onBatchFinished() {
+    const Summary summary = m_watcher->result();
+    emit finished(summary.exported, summary.skipped, summary.errors);
+}
+
+BatchExporter::Summary BatchExporter::exportFolder(
+    const QString& folder, const QString& outputDir,
+    const HtmlExporter::Options& options, int maxWorkers,
+    const QAtomicInt* cancelled,
+    const HtmlExporter::ProgressCallback& progress) {
+    Summary summary;
+    const QDir sourceDir(folder);
+    const QDir targetDir(QDir(outputDir).absolutePath());
+    if (!sourceDir.exists()) {
+        summary.errors.append(tr("Folder not found: %1").arg(folder));
+        return summary;
+    }
+    if (!targetDir.mkpath(".")) {
+        summary.errors.append(tr("Cannot create %1").arg(outputDir));
+        return summary;
+    }
+
+    const QString manifestPath = targetDir.filePath(MANIFEST_NAME);
+    const QString key = optionsKey(options);
+    QString previousKey;
+    Manifest previous = readManifest(manifestPath, &previousKey);
+    if (previousKey != key) {
+        // Pages for other settings are never skipped, but their notes are
+        // still listed so that pages of deleted notes are removed.
+        for (ManifestEntry& entry : previous) {
+            entry.hash.clear();
+        }
+    }
+    const QStringList notes =
+        collectNotes(sourceDir, targetDir.absolutePath());
+
+    DependencyHashes hashes;
+    QAtomicInt done;
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, maxWorkers));
+    const QList<NoteResult> results = QtConcurrent::blockingMapped(
+        &pool, notes, [&](const QString& relativePath) {
+            NoteResult result;
+            result.relativePath = relativePath;
+            auto old = previous.constFind(relativePath);
+            const bool known = old != previous.constEnd();
+            if (cancelled && cancelled->loadRelaxed()) {
+                // Keeps what the note was last exported from.
+                result.hasEntry = known;
+                result.entry = known ? *old : ManifestEntry();
+                return result;
+            }
+
+            const QString sourcePath = sourceDir.filePath(relativePath);
+            const QString outputPath = pagePath(targetDir, relativePath);
+            QFile source(sourcePath);
+            if (!source.open(QIODevice::ReadOnly)) {
+                result.error = relativePath + ": " + source.errorString();
+                return result;
+            }
+            const QString hash = contentHash(source.readAll());
+            source.close();
+
+            if (known && old->hash == hash && QFileInfo::exists(outputPath) &&
+                dependenciesUnchanged(*old, hashes)) {
+                result.skipped = true;
+                result.hasEntry = true;
+                result.entry = *old;
+            } else {
+                // Dependencies are only known once the page is built, so
+                // they are hashed after it. One that may have changed
+                // since rendering began gets no hash, and the note is
+                // exported again next time instead of keeping a page
+                // built from the older content.
+                const QDateTime renderStart =
+                    QDateTime::currentDateTime().addSecs(
+                        -MODIFICATION_TIME_SLACK_SECS);
+                QStringList dependencies;
+                const QString error = HtmlExporter::exportFile(
+                    sourcePath, outputPath, options, {}, &dependencies);
+                if (!error.isEmpty()) {
+                    result.error = relativePath + ": " + error;
+                } else {
+                    result.exported = true;
+                    result.hasEntry = true;
+                    result.entry.hash = hash;
+                    for (const QString& dependency : dependencies) {
+                        const bool settled =
+                            QFileInfo(dependency).lastModified() <
+                            renderStart;
+                        result.entry.dependencies.insert(
+                            dependency,
+                            settled ? hashes.hash(dependency) : QString());
+                    }
+                }
+            }
+            if (progress) {
+                const int finished = done.fetchAndAddRelaxed(1) + 1;
+                progress(finished * 100 / notes.size(), relativePath);
+            }
+            return result;
+        });
+
+    Manifest manifest;
+    for (const NoteResult& result : results) {
+        if (!result.error.isEmpty()) {
+            summary.errors.append(result.error);
+        } else if (result.exported) {
+            ++summary.exported;
+        } else if (result.skipped) {
+            ++summary.skipped;
+        }
+        if (result.hasEntry) {
+            manifest.insert(result.relativePath, result.entry);
+        }
+    }
+    summary.cancelled = cancelled && cancelled->loadRelaxed();
+
+    // Pages of notes that are gone would leave dead links behind.
+    const QSet<QString> current(notes.constBegin(), notes.constEnd());
+    for (auto it = previous.constBegin(); it != previous.constEnd(); ++it) {
+        if (!current.contains(it.key()) &&
+            QFile::remove(pagePath(targetDir, it.key()))) {
+            ++summary.removed;
+        }
+    }
+
+    if (!writeManifest(manifestPath, key, manifest)) {
+        summary.errors.append(tr("Cannot write %1").arg(manifestPath));
+    }
+    return summary;
+}
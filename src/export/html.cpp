@@ -0,0 +1,375 @@
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QUrl>
+#include <QtConcurrent/QtConcurrent>
+
+#include "htmlexporter.h"
+#include "markdownrenderer.h"
+#include "prerenderpool.h"
+
+namespace {
+
+// Images larger than this stay links to their file.
+const qint64 MAX_INLINED_IMAGE_BYTES = 16 * 1024 * 1024;
+
+QString readResource(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    return QString::fromUtf8(file.readAll());
+}
+
+QString dataUrl(const QByteArray& data, const QString& mimeType) {
+    return "data:" + mimeType + ";base64," +
+           QString::fromLatin1(data.toBase64());
+}
+
+// KaTeX's stylesheet names each font in three formats inside the
+// resources; only the WOFF2 one is kept, as a data URL.
+QString inlineKatexFonts(const QString& css) {
+    static const QRegularExpression fontSource(
+        "src:url\\(qrc:([^)]+\\.woff2)\\) format\\(\"woff2\"\\)[^;}]*");
+    QString result;
+    result.reserve(css.size());
+    qsizetype position = 0;
+    QRegularExpressionMatchIterator it = fontSource.globalMatch(css);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        result += css.mid(position, match.capturedStart() - position);
+        QFile font(":" + match.captured(1).mid(1));
+        if (font.open(QIODevice::ReadOnly)) {
+            result += "src:url(" + dataUrl(font.readAll(), "font/woff2") +
+                      ") format(\"woff2\")";
+        } else {
+            result += match.captured(0);
+        }
+        position = match.capturedEnd();
+    }
+    result += css.mid(position);
+    return result;
+}
+
+QString unescapeAttribute(QString value) {
+    value.replace("&quot;", "\"");
+    value.replace("&lt;", "<");
+    value.replace("&gt;", ">");
+    value.replace("&#x27;", "'");
+    value.replace("&amp;", "&");
+    return value;
+}
+
+// Note links lead to the exports of those notes, which a batch export
+// writes next to this one.
+QString exportedLink(const QString& target, bool isWikiLink) {
+    QString path = target;
+    QString fragment;
+    const int hash = path.indexOf('#');
+    if (hash >= 0) {
+        fragment = path.mid(hash);
+        path.truncate(hash);
+    }
+    if (path.isEmpty()) {
+        return fragment;
+    }
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "md" || suffix == "markdown") {
+        path = path.left(path.size() - suffix.size()) + "html";
+    } else if (isWikiLink) {
+        path += ".html";
+    }
+    return path + fragment;
+}
+
+QString rewriteLinks(const QString& html) {
+    static const QRegularExpression noteLink(
+        "href=\"(markdown|wiki):([^\"]*)\"");
+    QString result;
+    result.reserve(html.size());
+    qsizetype position = 0;
+    QRegularExpressionMatchIterator it = noteLink.globalMatch(html);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        result += html.mid(position, match.capturedStart() - position);
+        const QString target = QUrl::fromPercentEncoding(
+            unescapeAttribute(match.captured(2)).toUtf8());
+        const QString link =
+            exportedLink(target, match.captured(1) == "wiki");
+        result += "href=\"" + link.toHtmlEscaped() + '"';
+        position = match.capturedEnd();
+    }
+    result += html.mid(position);
+    return result;
+}
+
+QString inlineImages(const QString& html, const QDir& baseDir,
+                     bool absoluteLinks, QStringList* images) {
+    static const QRegularExpression imageSource("<img src=\"([^\"]*)\"");
+    QMimeDatabase mimeDatabase;
+    QString result;
+    result.reserve(html.size());
+    qsizetype position = 0;
+    QRegularExpressionMatchIterator it = imageSource.globalMatch(html);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        result += html.mid(position, match.capturedStart() - position);
+        position = match.capturedEnd();
+
+        const QString source = unescapeAttribute(match.captured(1));
+        const QUrl url(source);
+        QString path;
+        if (url.isLocalFile()) {
+            path = url.toLocalFile();
+        } else if (url.scheme().isEmpty()) {
+            path = baseDir.absoluteFilePath(
+                QUrl::fromPercentEncoding(source.toUtf8()));
+        }
+        QFile image(path);
+        if (path.isEmpty() || image.size() > MAX_INLINED_IMAGE_BYTES ||
+            !image.open(QIODevice::ReadOnly)) {
+            if (absoluteLinks && url.scheme().isEmpty() && !path.isEmpty()) {
+                result += "<img src=\"" +
+                          QString::fromUtf8(
+                              QUrl::fromLocalFile(path).toEncoded())
+                              .toHtmlEscaped() +
+                          '"';
+            } else {
+                result += match.captured(0);
+            }
+            continue;
+        }
+        const QByteArray data = image.readAll();
+        if (images) {
+            images->append(QFileInfo(path).absoluteFilePath());
+        }
+        const QString mimeType =
+            mimeDatabase.mimeTypeForFileNameAndData(path, data).name();
+        result += "<img src=\"" + dataUrl(data, mimeType) + '"';
+    }
+    result += html.mid(position);
+    return result;
+}
+
+// Diagrams missing from the cache are left for the embedded Mermaid
+// script, in the form it renders. Highlighted blocks ("hljs" class and
+// markup) are accepted too; Mermaid only reads the text.
+int markUncachedDiagrams(QString& html) {
+    static const QRegularExpression diagram(
+        "<pre([^>]*)><code class=\"(?:hljs )?language-mermaid\"[^>]*>"
+        "(.*?)</code></pre>",
+        QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression tag("<[^>]*>");
+    int count = 0;
+    QString result;
+    qsizetype position = 0;
+    QRegularExpressionMatchIterator it = diagram.globalMatch(html);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        result += html.mid(position, match.capturedStart() - position);
+        result += "<pre class=\"mermaid\"" + match.captured(1) + '>' +
+                  match.captured(2).remove(tag) + "</pre>";
+        position = match.capturedEnd();
+        ++count;
+    }
+    if (count > 0) {
+        result += html.mid(position);
+        html = result;
+    }
+    return count;
+}
+
+QString documentTitle(const QString& html, const QString& sourcePath) {
+    static const QRegularExpression heading("<h1[^>]*>(.*?)</h1>");
+    static const QRegularExpression tag("<[^>]*>");
+    const QRegularExpressionMatch match = heading.match(html);
+    if (match.hasMatch()) {
+        QString title = match.captured(1);
+        title.remove(tag);
+        if (!title.trimmed().isEmpty()) {
+            return title.trimmed();
+        }
+    }
+    return QFileInfo(sourcePath).completeBaseName().toHtmlEscaped();
+}
+
+QString pageScripts(const QString& mermaidTheme) {
+    QString bundle = readResource(":/js/preview-bundle.min.js");
+    if (bundle.isEmpty()) {
+        return QString();
+    }
+    bundle.replace("</script", "<\\/script", Qt::CaseInsensitive);
+    // The same steps the preview page runs on new blocks. The flag tells
+    // the PDF exporter when the diagrams are drawn.
+    return "<script>\n" + bundle + "\n</script>\n<script>\n" +
+           QString(R"(window.treemkExportReady = false;
+document.addEventListener('DOMContentLoaded', () => {
+  window.mermaid.initialize({ startOnLoad: false, theme: '%1' });
+  window.renderMathInElement(document.body, {
+    delimiters: [
+      {left: '$$', right: '$$', display: true},
+      {left: '$', right: '$', display: false}
+    ],
+    throwOnError: false,
+    strict: false,
+    ignoredClasses: ['mermaid', 'mermaid-container', 'katex']
+  });
+  document.querySelectorAll('pre code:not(.hljs)').forEach((block) => {
+    window.hljs.highlightElement(block);
+  });
+  let counter = 0;
+  const renders = [];
+  document.querySelectorAll('pre.mermaid').forEach((pre) => {
+    const container = document.createElement('div');
+    container.className = 'mermaid-container';
+    const code = pre.textContent;
+    pre.replaceWith(container);
+    renders.push(window.mermaid.render('mermaid-' + (++counter), code)
+      .then((result) => {
+        container.innerHTML = result.svg;
+      }));
+  });
+  Promise.allSettled(renders).then(() => {
+    window.treemkExportReady = true;
+  });
+});
+)")
+               .arg(mermaidTheme) +
+           "</script>\n";
+}
+
+}  // namespace
+
+HtmlExporter::HtmlExporter(QObject* parent)
+    : QObject(parent), m_watcher(new QFutureWatcher<QString>(this)) {
+    connect(m_watcher, &QFutureWatcherBase::finished, this,
+            &HtmlExporter::onExportFinished);
+}
+
+HtmlExporter::~HtmlExporter() { m_watcher->waitForFinished(); }
+
+bool HtmlExporter::start(const QString& sourcePath, const QString& outputPath,
+                         const Options& options) {
+    if (m_watcher->isRunning()) {
+        return false;
+    }
+    m_outputPath = outputPath;
+    // Progress is posted back to this object's thread; the destructor
+    // waits for the job, so it outlives every call.
+    ProgressCallback progress = [this](int percent, const QString& step) {
+        QMetaObject::invokeMethod(
+            this,
+            [this, percent, step]() { emit progressChanged(percent, step); },
+            Qt::QueuedConnection);
+    };
+    m_watcher->setFuture(
+        QtConcurrent::run([sourcePath, outputPath, options, progress]() {
+            return exportFile(sourcePath, outputPath, options, progress);
+        }));
+    return true;
+}
+
+void HtmlExporter::onExportFinished() {
+    const QString error = m_watcher->result();
+    emit finished(error.isEmpty(), m_outputPath, error);
+}
+
+QString HtmlExporter::exportDocument(const QString& markdown,
+                                     const QString& sourcePath,
+                                     const Options& options,
+                                     const ProgressCallback& progress,
+                                     QStringList* dependencies) {
+    const QFileInfo sourceInfo(sourcePath);
+    const QString mermaidTheme = options.darkScheme ? "dark" : "default";
+
+    if (progress) {
+        progress(0, QObject::tr("Rendering"));
+    }
+    MarkdownRenderer renderer;
+    renderer.setBasePath(sourceInfo.absolutePath());
+    renderer.setLatexEnabled(options.latexEnabled);
+    renderer.setPrerenderEnabled(true);
+    // Also without a workspace: diagrams must not be highlighted as code.
+    renderer.setDiagramCache(options.workspacePath, mermaidTheme);
+    QStringList includedFiles;
+    QString body = renderer.render(markdown, &includedFiles);
+
+    if (progress) {
+        progress(50, QObject::tr("Inlining images"));
+    }
+    QStringList images;
+    body = inlineImages(rewriteLinks(body), sourceInfo.absoluteDir(),
+                        options.absoluteImageLinks, &images);
+    if (dependencies) {
+        *dependencies = includedFiles + images;
+        dependencies->removeDuplicates();
+    }
+    const bool needsScripts = markUncachedDiagrams(body) > 0 ||
+                              (options.latexEnabled &&
+                               !PrerenderPool::instance()->isAvailable());
+
+    if (progress) {
+        progress(75, QObject::tr("Inlining styles"));
+    }
+    QString html;
+    html.reserve(body.size() + options.styleSheet.size() + 4096);
+    html += "<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"UTF-8\">\n"
+            "<meta name=\"viewport\" content=\"width=device-width, "
+            "initial-scale=1\">\n";
+    html += "<title>" + documentTitle(body, sourcePath) + "</title>\n";
+    if (body.contains("class=\"katex") || needsScripts) {
+        html += "<style>\n" +
+                inlineKatexFonts(readResource(":/css-libs/katex.min.css")) +
+                "\n</style>\n";
+    }
+    html += "<style>\n" +
+            readResource(options.darkScheme
+                             ? ":/css-libs/highlight-github-dark.min.css"
+                             : ":/css-libs/highlight-github.min.css") +
+            "\n</style>\n";
+    html += "<style>\n" + options.styleSheet +
+            "\n.mermaid-container { margin: 16px 0; background: white; "
+            "padding: 16px; border-radius: 3px; }\n</style>\n";
+    if (needsScripts) {
+        html += pageScripts(mermaidTheme);
+    }
+    html += "</head>\n<body>\n" + body + "</body>\n</html>\n";
+    return html;
+}
+
+QString HtmlExporter::exportFile(const QString& sourcePath,
+                                 const QString& outputPath,
+                                 const Options& options,
+                                 const ProgressCallback& progress,
+                                 QStringList* dependencies) {
+    QFile source(sourcePath);
+    if (!source.open(QIODevice::ReadOnly)) {
+        return QObject::tr("Cannot read %1: %2")
+            .arg(sourcePath, source.errorString());
+    }
+    const QString markdown = QString::fromUtf8(source.readAll());
+    source.close();
+
+    const QString html =
+        exportDocument(markdown, sourcePath, options, progress, dependencies);
+
+    if (progress) {
+        progress(90, QObject::tr("Writing"));
+    }
+    QDir().mkpath(QFileInfo(outputPath).absolutePath());
+    // Written in full or not at all, so a failed export leaves an
+    // earlier one in place.
+    QSaveFile output(outputPath);
+    if (!output.open(QIODevice::WriteOnly) ||
+        output.write(html.toUtf8()) < 0 || !output.commit()) {
+        return QObject::tr("Cannot write %1: %2")
+            .arg(outputPath, output.errorString());
+    }
+    if (progress) {
+        progress(100, QObject::tr("Done"));
+    }
+    return QString();
+}
@@ -0,0 +1,165 @@
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QPageSize>
+#include <QTimer>
+#include <QUrl>
+#include <QWebEnginePage>
+#include <QtConcurrent/QtConcurrent>
+
+#include "pdfexporter.h"
+
+namespace {
+
+// Diagrams are drawn by the page after it loaded; a page whose scripts
+// never report back is printed after this many checks anyway.
+const int READY_CHECK_INTERVAL_MS = 100;
+const int MAX_READY_CHECKS = 100;
+
+}  // namespace
+
+PdfExporter::PdfExporter(QObject* parent)
+    : QObject(parent),
+      m_busy(false),
+      m_htmlWatcher(new QFutureWatcher<QString>(this)),
+      m_page(nullptr),
+      m_readyTimer(new QTimer(this)),
+      m_readyChecks(0) {
+    m_readyTimer->setSingleShot(true);
+    m_readyTimer->setInterval(READY_CHECK_INTERVAL_MS);
+    connect(m_readyTimer, &QTimer::timeout, this,
+            &PdfExporter::checkPageReady);
+    connect(m_htmlWatcher, &QFutureWatcherBase::finished, this,
+            &PdfExporter::onPageWritten);
+}
+
+PdfExporter::~PdfExporter() { m_htmlWatcher->waitForFinished(); }
+
+QPageLayout PdfExporter::pageLayout(const QString& pageSize, bool landscape,
+                                    double marginMillimeters) {
+    QPageSize::PageSizeId id = QPageSize::A4;
+    if (pageSize == "Letter") {
+        id = QPageSize::Letter;
+    } else if (pageSize == "Legal") {
+        id = QPageSize::Legal;
+    } else if (pageSize == "A3") {
+        id = QPageSize::A3;
+    } else if (pageSize == "A5") {
+        id = QPageSize::A5;
+    }
+    const qreal margin = qMax(0.0, marginMillimeters);
+    return QPageLayout(QPageSize(id),
+                       landscape ? QPageLayout::Landscape
+                                 : QPageLayout::Portrait,
+                       QMarginsF(margin, margin, margin, margin),
+                       QPageLayout::Millimeter);
+}
+
+void PdfExporter::enqueue(const QString& sourcePath,
+                          const QString& outputPath, const Options& options) {
+    Job job;
+    job.sourcePath = sourcePath;
+    job.outputPath = outputPath;
+    job.options = options;
+    m_jobs.enqueue(job);
+    if (!m_busy) {
+        startNext();
+    }
+}
+
+QString PdfExporter::pagePath() const {
+    return m_pageDir.filePath("export.html");
+}
+
+void PdfExporter::startNext() {
+    if (m_jobs.isEmpty()) {
+        return;
+    }
+    if (!m_pageDir.isValid()) {
+        m_jobs.clear();
+        emit finished(false, QString(),
+                      tr("Cannot create a temporary directory."));
+        return;
+    }
+    m_busy = true;
+    m_current = m_jobs.dequeue();
+    emit progressChanged(0, tr("Rendering"));
+
+    // The page is too large for setHtml() once fonts and images are
+    // inlined, so it goes through a file. That file is in a temporary
+    // folder, so images left as links must not be relative to the note.
+    Job job = m_current;
+    job.options.html.absoluteImageLinks = true;
+    const QString path = pagePath();
+    m_htmlWatcher->setFuture(QtConcurrent::run([job, path]() {
+        return HtmlExporter::exportFile(job.sourcePath, path,
+                                        job.options.html);
+    }));
+}
+
+void PdfExporter::onPageWritten() {
+    const QString error = m_htmlWatcher->result();
+    if (!error.isEmpty()) {
+        finishJob(error);
+        return;
+    }
+    if (!m_page) {
+        m_page = new QWebEnginePage(this);
+        connect(m_page, &QWebEnginePage::loadFinished, this,
+                &PdfExporter::onPageLoaded);
+        connect(m_page, &QWebEnginePage::pdfPrintingFinished, this,
+                &PdfExporter::onPdfPrinted);
+    }
+    emit progressChanged(40, tr("Laying out pages"));
+    m_page->load(QUrl::fromLocalFile(pagePath()));
+}
+
+void PdfExporter::onPageLoaded(bool ok) {
+    if (!m_busy) {
+        return;
+    }
+    if (!ok) {
+        finishJob(tr("The page could not be loaded."));
+        return;
+    }
+    m_readyChecks = 0;
+    checkPageReady();
+}
+
+void PdfExporter::checkPageReady() {
+    // Pages without scripts have nothing left to draw.
+    m_page->runJavaScript(
+        "window.treemkExportReady !== false", [this](const QVariant& ready) {
+            if (!m_busy) {
+                return;
+            }
+            if (!ready.toBool() && ++m_readyChecks < MAX_READY_CHECKS) {
+                m_readyTimer->start();
+                return;
+            }
+            emit progressChanged(70, tr("Printing"));
+            QDir().mkpath(QFileInfo(m_current.outputPath).absolutePath());
+            m_page->printToPdf(m_current.outputPath,
+                               m_current.options.pageLayout);
+        });
+}
+
+void PdfExporter::onPdfPrinted(const QString& filePath, bool success) {
+    if (!m_busy || filePath != m_current.outputPath) {
+        return;
+    }
+    finishJob(success ? QString()
+                      : tr("Cannot write %1.").arg(m_current.outputPath));
+}
+
+void PdfExporter::finishJob(const QString& errorMessage) {
+    m_busy = false;
+    m_readyTimer->stop();
+    QFile::remove(pagePath());
+    if (errorMessage.isEmpty()) {
+        emit progressChanged(100, tr("Done"));
+    }
+    emit finished(errorMessage.isEmpty(), m_current.outputPath,
+                  errorMessage);
+    startNext();
+}
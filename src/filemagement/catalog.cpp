@@ -0,0 +1,303 @@
+#include <QDir>
+#include <QDirIterator>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+
+#include "workspacecatalog.h"
+
+namespace {
+
+// Folders below the root, as Quick Open always had it.
+const int MAX_DEPTH = 10;
+
+// Past this many unused pool characters, the pool is rebuilt.
+const int MIN_COMPACT_CHARS = 64 * 1024;
+
+bool isCatalogued(const QString& relativePath) {
+    if (relativePath.isEmpty() || relativePath.count('/') > MAX_DEPTH) {
+        return false;
+    }
+    if (!relativePath.endsWith(".md", Qt::CaseInsensitive) &&
+        !relativePath.endsWith(".markdown", Qt::CaseInsensitive)) {
+        return false;
+    }
+    // Nothing hidden, neither the file nor a folder above it.
+    return !relativePath.startsWith('.') && !relativePath.contains("/.");
+}
+
+QStringView entryView(const QString& pool,
+                      const WorkspaceCatalog::Entry& entry) {
+    return QStringView(pool).mid(entry.offset, entry.length);
+}
+
+}  // namespace
+
+WorkspaceCatalog::WorkspaceCatalog(QObject* parent)
+    : QObject(parent),
+      m_deadChars(0),
+      m_ready(false),
+      m_watcher(new QFutureWatcher<Listing>(this)) {
+    connect(m_watcher, &QFutureWatcherBase::finished, this,
+            &WorkspaceCatalog::onListingFinished);
+}
+
+WorkspaceCatalog::~WorkspaceCatalog() {
+    m_cancelled.storeRelaxed(1);
+    m_watcher->waitForFinished();
+}
+
+void WorkspaceCatalog::setRootPath(const QString& rootPath) {
+    const QString path =
+        rootPath.isEmpty() ? QString() : QDir(rootPath).absolutePath();
+    if (path == m_rootPath) {
+        return;
+    }
+    m_cancelled.storeRelaxed(1);
+    m_watcher->waitForFinished();
+    m_listingPath.clear();
+
+    m_rootPath = path;
+    m_pool.clear();
+    m_entries.clear();
+    m_deadChars = 0;
+    m_ready = false;
+    m_pending.clear();
+    emit catalogChanged();
+
+    if (!m_rootPath.isEmpty()) {
+        m_pending.append(
+            WorkspaceChange(WorkspaceChange::Rescan, m_rootPath, true));
+        processPending();
+    }
+}
+
+QStringView WorkspaceCatalog::relativePath(int index) const {
+    return entryView(m_pool, m_entries.at(index));
+}
+
+QString WorkspaceCatalog::filePath(int index) const {
+    return m_rootPath + '/' + relativePath(index).toString();
+}
+
+bool WorkspaceCatalog::contains(const QString& relativePath) const {
+    const int index = lowerBound(relativePath);
+    return index < m_entries.size() &&
+           WorkspaceCatalog::relativePath(index) == relativePath;
+}
+
+WorkspaceCatalog::Listing WorkspaceCatalog::list(const QString& rootPath,
+                                                 const QString& directory,
+                                                 const QAtomicInt* cancelled) {
+    Listing listing;
+    QDirIterator it(directory, QStringList() << "*.md" << "*.markdown",
+                    QDir::Files | QDir::NoSymLinks,
+                    QDirIterator::Subdirectories);
+    const int prefixLength = rootPath.length() + 1;
+    while (it.hasNext()) {
+        if (cancelled && cancelled->loadRelaxed()) {
+            return Listing();
+        }
+        const QString path = it.next();
+        const QStringView relativePath = QStringView(path).mid(prefixLength);
+        if (relativePath.count('/') > MAX_DEPTH) {
+            continue;
+        }
+        Entry entry;
+        entry.offset = listing.pool.size();
+        entry.length = relativePath.size();
+        listing.entries.append(entry);
+        listing.pool.append(relativePath);
+    }
+    listing.pool.squeeze();
+
+    const QString& pool = listing.pool;
+    std::sort(listing.entries.begin(), listing.entries.end(),
+              [&pool](const Entry& a, const Entry& b) {
+                  return entryView(pool, a) < entryView(pool, b);
+              });
+    return listing;
+}
+
+void WorkspaceCatalog::applyChanges(const WorkspaceChangeSet& changes) {
+    if (m_rootPath.isEmpty()) {
+        return;
+    }
+    m_pending.append(changes);
+    if (m_listingPath.isEmpty()) {
+        processPending();
+    }
+}
+
+void WorkspaceCatalog::processPending() {
+    bool changed = false;
+    while (!m_pending.isEmpty() && m_listingPath.isEmpty()) {
+        const WorkspaceChange change = m_pending.takeFirst();
+        QString relativePath;
+        QString oldRelativePath;
+        const bool inside = toRelative(change.path, &relativePath);
+
+        switch (change.type) {
+            case WorkspaceChange::Added:
+            case WorkspaceChange::Modified:
+                // Files of a new directory are reported one by one.
+                if (inside && !change.isDir && isCatalogued(relativePath)) {
+                    changed |= insert(relativePath);
+                }
+                break;
+            case WorkspaceChange::Removed:
+                if (inside) {
+                    removeTree(relativePath);
+                    changed = true;
+                }
+                break;
+            case WorkspaceChange::Renamed:
+                if (toRelative(change.oldPath, &oldRelativePath)) {
+                    removeTree(oldRelativePath);
+                    changed = true;
+                }
+                if (!inside) {
+                    break;
+                }
+                if (change.isDir) {
+                    // The depth of every file below it may have changed.
+                    startListing(change.path);
+                } else if (isCatalogued(relativePath)) {
+                    insert(relativePath);
+                }
+                break;
+            case WorkspaceChange::Rescan:
+                if (inside) {
+                    startListing(change.path);
+                }
+                break;
+        }
+    }
+    if (changed) {
+        emit catalogChanged();
+    }
+}
+
+void WorkspaceCatalog::startListing(const QString& directory) {
+    m_listingPath = directory;
+    m_cancelled.storeRelaxed(0);
+    const QString rootPath = m_rootPath;
+    m_watcher->setFuture(QtConcurrent::run([this, rootPath, directory]() {
+        return list(rootPath, directory, &m_cancelled);
+    }));
+}
+
+void WorkspaceCatalog::onListingFinished() {
+    if (m_listingPath.isEmpty()) {
+        return;
+    }
+    QString relativePath;
+    toRelative(m_listingPath, &relativePath);
+    m_listingPath.clear();
+
+    replaceTree(relativePath, m_watcher->result());
+    if (relativePath.isEmpty()) {
+        m_ready = true;
+    }
+    emit catalogChanged();
+    processPending();
+}
+
+bool WorkspaceCatalog::toRelative(const QString& path,
+                                  QString* relativePath) const {
+    if (path == m_rootPath) {
+        relativePath->clear();
+        return true;
+    }
+    if (!path.startsWith(m_rootPath + '/')) {
+        return false;
+    }
+    *relativePath = path.mid(m_rootPath.length() + 1);
+    return true;
+}
+
+int WorkspaceCatalog::lowerBound(QStringView relativePath) const {
+    auto it = std::lower_bound(m_entries.constBegin(), m_entries.constEnd(),
+                               relativePath,
+                               [this](const Entry& entry, QStringView path) {
+                                   return entryView(m_pool, entry) < path;
+                               });
+    return it - m_entries.constBegin();
+}
+
+bool WorkspaceCatalog::insert(const QString& relativePath) {
+    const int index = lowerBound(relativePath);
+    if (index < m_entries.size() &&
+        WorkspaceCatalog::relativePath(index) == relativePath) {
+        return false;
+    }
+    Entry entry;
+    entry.offset = m_pool.size();
+    entry.length = relativePath.size();
+    m_entries.insert(index, entry);
+    m_pool.append(relativePath);
+    return true;
+}
+
+void WorkspaceCatalog::removeTree(const QString& relativePath) {
+    if (relativePath.isEmpty()) {
+        m_pool.clear();
+        m_entries.clear();
+        m_deadChars = 0;
+        return;
+    }
+
+    // The path itself, then everything below it: "a/" up to "a0", as
+    // '0' follows '/'. Names such as "a-b" sort in between.
+    int first = lowerBound(relativePath);
+    if (first < m_entries.size() &&
+        WorkspaceCatalog::relativePath(first) == relativePath) {
+        m_deadChars += m_entries.at(first).length;
+        m_entries.remove(first);
+    }
+    first = lowerBound(relativePath + '/');
+    const int last = lowerBound(relativePath + '0');
+    for (int i = first; i < last; ++i) {
+        m_deadChars += m_entries.at(i).length;
+    }
+    m_entries.remove(first, last - first);
+
+    if (m_deadChars > MIN_COMPACT_CHARS && m_deadChars > m_pool.size() / 2) {
+        compact();
+    }
+}
+
+void WorkspaceCatalog::replaceTree(const QString& relativePath,
+                                   const Listing& listing) {
+    if (relativePath.isEmpty()) {
+        m_pool = listing.pool;
+        m_entries = listing.entries;
+        m_deadChars = 0;
+        return;
+    }
+
+    removeTree(relativePath);
+    // Everything listed lies below relativePath and so sorts into the
+    // gap its old entries left.
+    const int offset = m_pool.size();
+    const int position = lowerBound(relativePath + '/');
+    QVector<Entry> entries = listing.entries;
+    for (Entry& entry : entries) {
+        entry.offset += offset;
+    }
+    m_pool.append(listing.pool);
+    m_entries.insert(position, entries.size(), Entry());
+    std::copy(entries.constBegin(), entries.constEnd(),
+              m_entries.begin() + position);
+}
+
+void WorkspaceCatalog::compact() {
+    QString pool;
+    pool.reserve(m_pool.size() - m_deadChars);
+    for (Entry& entry : m_entries) {
+        const int offset = pool.size();
+        pool.append(entryView(m_pool, entry));
+        entry.offset = offset;
+    }
+    m_pool = pool;
+    m_deadChars = 0;
+}
@@ -0,0 +1,443 @@
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+
+#include "fileoperationqueue.h"
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const qint64 CHUNK_SIZE = 8 * 1024 * 1024;
+
+struct Entry {
+    QString path;
+    bool isDir = false;
+    bool isLink = false;
+    qint64 size = 0;
+};
+
+Entry entryFor(const QFileInfo& info) {
+    Entry entry;
+    entry.path = info.filePath();
+    entry.isLink = info.isSymLink();
+    entry.isDir = info.isDir() && !entry.isLink;
+    entry.size = entry.isDir || entry.isLink ? 0 : info.size();
+    return entry;
+}
+
+// path and everything below it, each folder before its contents.
+QList<Entry> collectEntries(const QString& path) {
+    QList<Entry> entries;
+    entries.append(entryFor(QFileInfo(path)));
+    if (entries.first().isDir) {
+        QDirIterator it(path,
+                        QDir::AllEntries | QDir::NoDotAndDotDot |
+                            QDir::Hidden | QDir::System,
+                        QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            entries.append(entryFor(it.fileInfo()));
+        }
+    }
+    // A folder's path is a prefix of its contents' paths.
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.path < b.path; });
+    return entries;
+}
+
+bool isCancelled(const QAtomicInt* cancelled) {
+    return cancelled && cancelled->loadRelaxed();
+}
+
+#ifdef Q_OS_LINUX
+QString systemError() { return QString::fromLocal8Bit(strerror(errno)); }
+
+bool writeAll(int fd, const char* data, qint64 size) {
+    while (size > 0) {
+        const ssize_t written = ::write(fd, data, size_t(size));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+// Copies in the kernel, through a reflink if the filesystem shares
+// extents, and by reading and writing where copy_file_range() is not
+// supported between the two files.
+QString copyContents(int in, int out, qint64 size, const QAtomicInt* cancelled,
+                     const std::function<void(qint64)>& bytes) {
+#ifdef FICLONE
+    if (::ioctl(out, FICLONE, in) == 0) {
+        if (bytes) {
+            bytes(size);
+        }
+        return QString();
+    }
+#endif
+    bool useCopyRange = true;
+    qint64 copied = 0;
+    QByteArray buffer;
+    for (;;) {
+        if (isCancelled(cancelled)) {
+            return FileOperationQueue::tr("Cancelled");
+        }
+        ssize_t count;
+        if (useCopyRange) {
+            count = ::copy_file_range(in, nullptr, out, nullptr,
+                                      size_t(CHUNK_SIZE), 0);
+            if (count < 0 && copied == 0 &&
+                (errno == ENOSYS || errno == EXDEV || errno == EINVAL ||
+                 errno == EOPNOTSUPP)) {
+                useCopyRange = false;
+                continue;
+            }
+        } else {
+            if (buffer.isEmpty()) {
+                buffer.resize(int(qMin(CHUNK_SIZE, qint64(1024 * 1024))));
+            }
+            count = ::read(in, buffer.data(), size_t(buffer.size()));
+            if (count > 0 && !writeAll(out, buffer.constData(), count)) {
+                return systemError();
+            }
+        }
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return systemError();
+        }
+        if (count == 0) {
+            return QString();
+        }
+        copied += count;
+        if (bytes) {
+            bytes(count);
+        }
+    }
+}
+#endif
+
+QString copyEntries(const QList<Entry>& entries, const QString& source,
+                    const QString& target, const QAtomicInt* cancelled,
+                    const std::function<void(qint64)>& bytes,
+                    QString& current) {
+    for (const Entry& entry : entries) {
+        if (isCancelled(cancelled)) {
+            return FileOperationQueue::tr("Cancelled");
+        }
+        const QString path = target + entry.path.mid(source.size());
+        current = entry.path;
+        if (entry.isDir) {
+            if (!QDir().mkdir(path)) {
+                return FileOperationQueue::tr("Cannot create %1").arg(path);
+            }
+        } else if (entry.isLink) {
+            if (!QFile::link(QFileInfo(entry.path).symLinkTarget(), path)) {
+                return FileOperationQueue::tr("Cannot create %1").arg(path);
+            }
+        } else {
+            const QString error = FileOperationQueue::copyFile(
+                entry.path, path, cancelled, bytes);
+            if (!error.isEmpty()) {
+                return error;
+            }
+        }
+    }
+    return QString();
+}
+
+// Contents before their folders; stops at the first failure.
+QString removeEntries(const QList<Entry>& entries,
+                      const QAtomicInt* cancelled,
+                      const std::function<void(qint64)>& bytes,
+                      QString& current) {
+    for (auto it = entries.crbegin(); it != entries.crend(); ++it) {
+        if (isCancelled(cancelled)) {
+            return FileOperationQueue::tr("Cancelled");
+        }
+        current = it->path;
+        const bool removed =
+            it->isDir ? QDir().rmdir(it->path) : QFile::remove(it->path);
+        if (!removed) {
+            return FileOperationQueue::tr("Cannot remove %1").arg(it->path);
+        }
+        if (bytes) {
+            bytes(it->size);
+        }
+    }
+    return QString();
+}
+
+}  // namespace
+
+FileOperationQueue::FileOperationQueue(QObject* parent)
+    : QObject(parent),
+      m_nextId(1),
+      m_watcher(new QFutureWatcher<QString>(this)) {
+    connect(m_watcher, &QFutureWatcherBase::finished, this,
+            &FileOperationQueue::onJobFinished);
+}
+
+FileOperationQueue::~FileOperationQueue() {
+    m_queue.clear();
+    m_cancelled.storeRelaxed(1);
+    m_watcher->waitForFinished();
+}
+
+int FileOperationQueue::copy(const QString& source, const QString& target) {
+    Operation operation;
+    operation.type = Copy;
+    operation.source = source;
+    operation.target = target;
+    return enqueue(operation);
+}
+
+int FileOperationQueue::move(const QString& source, const QString& target) {
+    Operation operation;
+    operation.type = Move;
+    operation.source = source;
+    operation.target = target;
+    return enqueue(operation);
+}
+
+int FileOperationQueue::remove(const QString& path) {
+    Operation operation;
+    operation.type = Delete;
+    operation.source = path;
+    return enqueue(operation);
+}
+
+int FileOperationQueue::enqueue(const Operation& operation) {
+    Job job;
+    job.id = m_nextId++;
+    job.operation = operation;
+    m_queue.append(job);
+
+    const bool wasBusy = isBusy();
+    startNext();
+    if (!wasBusy) {
+        emit busyChanged(true);
+    }
+    return job.id;
+}
+
+void FileOperationQueue::cancel(int jobId) {
+    if (jobId != 0 && jobId == m_current.id) {
+        m_cancelled.storeRelaxed(1);
+        return;
+    }
+    for (int i = 0; i < m_queue.size(); ++i) {
+        if (m_queue.at(i).id == jobId) {
+            const Job job = m_queue.takeAt(i);
+            emit finished(job.id, job.operation, false, true, tr("Cancelled"));
+            return;
+        }
+    }
+}
+
+void FileOperationQueue::cancelAll() {
+    const QList<Job> queued = m_queue;
+    m_queue.clear();
+    for (const Job& job : queued) {
+        emit finished(job.id, job.operation, false, true, tr("Cancelled"));
+    }
+    if (isBusy()) {
+        m_cancelled.storeRelaxed(1);
+    }
+}
+
+void FileOperationQueue::startNext() {
+    if (isBusy() || m_queue.isEmpty()) {
+        return;
+    }
+    m_current = m_queue.takeFirst();
+    m_cancelled.storeRelaxed(0);
+
+    const Operation operation = m_current.operation;
+    QString verb = operation.type == Copy   ? tr("Copying %1")
+                   : operation.type == Move ? tr("Moving %1")
+                                            : tr("Deleting %1");
+    // Reports whole percents only, as the worker sees every chunk.
+    int lastPercent = -1;
+    ProgressCallback progress = [this, verb, lastPercent](
+                                    qint64 done, qint64 total,
+                                    const QString& path) mutable {
+        const int percent = total > 0 ? int(done * 100 / total) : 100;
+        if (percent == lastPercent) {
+            return;
+        }
+        lastPercent = percent;
+        const QString step = verb.arg(QFileInfo(path).fileName());
+        QMetaObject::invokeMethod(
+            this,
+            [this, percent, step]() { emit progressChanged(percent, step); },
+            Qt::QueuedConnection);
+    };
+    m_watcher->setFuture(QtConcurrent::run([this, operation, progress]() {
+        return run(operation, &m_cancelled, progress);
+    }));
+}
+
+void FileOperationQueue::onJobFinished() {
+    const QString error = m_watcher->result();
+    const Job job = m_current;
+    m_current = Job();
+
+    const bool cancelled = !error.isEmpty() && m_cancelled.loadRelaxed();
+    emit finished(job.id, job.operation, error.isEmpty(), cancelled, error);
+
+    startNext();
+    if (!isBusy()) {
+        emit busyChanged(false);
+    }
+}
+
+QString FileOperationQueue::run(const Operation& operation,
+                                const QAtomicInt* cancelled,
+                                const ProgressCallback& progress) {
+    const QString source = QDir::cleanPath(operation.source);
+    const QString target = QDir::cleanPath(operation.target);
+    const QFileInfo sourceInfo(source);
+    if (!sourceInfo.exists() && !sourceInfo.isSymLink()) {
+        return tr("%1 does not exist").arg(source);
+    }
+    if (operation.type != Delete) {
+        if (QFileInfo(target).exists() || QFileInfo(target).isSymLink()) {
+            return tr("%1 already exists").arg(target);
+        }
+        if (target.startsWith(source + '/')) {
+            return tr("Cannot put %1 inside itself").arg(source);
+        }
+        // Within one filesystem a move is a rename, whatever its size.
+        if (operation.type == Move && QDir().rename(source, target)) {
+            return QString();
+        }
+    }
+
+    const QList<Entry> entries = collectEntries(source);
+    qint64 total = 0;
+    for (const Entry& entry : entries) {
+        total += entry.size;
+    }
+    qint64 done = 0;
+    QString current = source;
+    auto bytes = [&](qint64 count) {
+        done += count;
+        if (progress) {
+            progress(done, total, current);
+        }
+    };
+
+    if (operation.type == Delete) {
+        return removeEntries(entries, cancelled, bytes, current);
+    }
+
+    const QString error =
+        copyEntries(entries, source, target, cancelled, bytes, current);
+    if (!error.isEmpty()) {
+        // Leaves no half copy behind.
+        if (QFileInfo(target).exists() || QFileInfo(target).isSymLink()) {
+            QString ignored;
+            removeEntries(collectEntries(target), nullptr, {}, ignored);
+        }
+        return error;
+    }
+    if (operation.type == Move) {
+        // The copy is complete, so the move is no longer cancelled.
+        return removeEntries(entries, nullptr, {}, current);
+    }
+    return QString();
+}
+
+QString FileOperationQueue::copyFile(const QString& source,
+                                     const QString& target,
+                                     const QAtomicInt* cancelled,
+                                     const std::function<void(qint64)>& bytes) {
+#ifdef Q_OS_LINUX
+    const int in =
+        ::open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return tr("Cannot read %1: %2").arg(source, systemError());
+    }
+    struct stat info;
+    if (::fstat(in, &info) != 0) {
+        const QString error = systemError();
+        ::close(in);
+        return tr("Cannot read %1: %2").arg(source, error);
+    }
+    const QByteArray targetName = QFile::encodeName(target);
+    const int out = ::open(targetName.constData(),
+                           O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                           info.st_mode & 07777);
+    if (out < 0) {
+        const QString error = systemError();
+        ::close(in);
+        return tr("Cannot write %1: %2").arg(target, error);
+    }
+
+    QString error = copyContents(in, out, info.st_size, cancelled, bytes);
+    ::close(in);
+    if (::close(out) != 0 && error.isEmpty()) {
+        error = systemError();
+    }
+    if (!error.isEmpty()) {
+        ::unlink(targetName.constData());
+        return isCancelled(cancelled)
+                   ? error
+                   : tr("Cannot copy %1: %2").arg(source, error);
+    }
+    return QString();
+#else
+    QFile in(source);
+    if (!in.open(QIODevice::ReadOnly)) {
+        return tr("Cannot read %1: %2").arg(source, in.errorString());
+    }
+    QFile out(target);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::NewOnly)) {
+        return tr("Cannot write %1: %2").arg(target, out.errorString());
+    }
+    QByteArray buffer;
+    buffer.resize(1024 * 1024);
+    for (;;) {
+        if (isCancelled(cancelled)) {
+            out.remove();
+            return tr("Cancelled");
+        }
+        const qint64 count = in.read(buffer.data(), buffer.size());
+        if (count < 0 || (count > 0 && out.write(buffer.constData(), count) !=
+                                           count)) {
+            const QString error =
+                count < 0 ? in.errorString() : out.errorString();
+            out.remove();
+            return tr("Cannot copy %1: %2").arg(source, error);
+        }
+        if (count == 0) {
+            break;
+        }
+        if (bytes) {
+            bytes(count);
+        }
+    }
+    out.close();
+    out.setPermissions(in.permissions());
+    return QString();
+#endif
+}
@@ -16,14 +16,20 @@
 #include <QSortFilterProxyModel>
 #include <QUrl>
 
+#include "externaltools.h"
 #include "fileutils.h"
 
 FileSystemTreeView::FileSystemTreeView(QWidget* parent)
-    : QTreeView(parent), clipboardIsCut(false) {
+    : QTreeView(parent), workspaceWatcher(nullptr), clipboardIsCut(false) {
     setupModel();
     setupView();
     createContextMenu();
-    setupFileSystemWatcher();
+
+    fileOperations = new FileOperationQueue(this);
+    connect(fileOperations, &FileOperationQueue::finished, this,
+            &FileSystemTreeView::onFileOperationFinished);
+    connect(fileOperations, &FileOperationQueue::busyChanged,
+            cancelOperationsAction, &QAction::setEnabled);
 }
 
 FileSystemTreeView::~FileSystemTreeView() {}
@@ -49,6 +55,11 @@ void FileSystemTreeView::setupModel() {
                    const QString& newName) {
                 QString oldPath = QDir(path).filePath(oldName);
                 QString newPath = QDir(path).filePath(newName);
+                // Reported here already, so onItemRenamed() must not
+                // report it again and update the links twice.
+                if (oldPath == renameOldPath) {
+                    renameOldPath.clear();
+                }
                 emit fileRenamed(oldPath, newPath);
             });
 }
@@ -110,6 +121,10 @@ void FileSystemTreeView::createContextMenu() {
     pasteAction->setShortcut(QKeySequence::Paste);
     connect(pasteAction, &QAction::triggered, this,
             &FileSystemTreeView::pasteItem);
+    cancelOperationsAction = new QAction(tr("Stop File Operations"), this);
+    cancelOperationsAction->setEnabled(false);
+    connect(cancelOperationsAction, &QAction::triggered, this,
+            [this]() { fileOperations->cancelAll(); });
     refreshAction = new QAction(tr("Refresh"), this);
     refreshAction->setShortcut(QKeySequence::Refresh);
     connect(refreshAction, &QAction::triggered, this,
@@ -148,7 +163,7 @@ void FileSystemTreeView::createContextMenu() {
         desktopEnv.contains("XFCE", Qt::CaseInsensitive) ||
         desktopEnv.contains("MATE", Qt::CaseInsensitive)) {
         // Check if gio is available
-        if (QProcess::execute("which", QStringList() << "gio") == 0) {
+        if (ExternalTools::instance()->isAvailable("gio")) {
             openWithAction = new QAction(tr("Open With..."), this);
             connect(openWithAction, &QAction::triggered, this,
                     &FileSystemTreeView::openFileWith);
@@ -173,6 +188,7 @@ void FileSystemTreeView::createContextMenu() {
     contextMenu->addAction(cutAction);
     contextMenu->addAction(copyAction);
     contextMenu->addAction(pasteAction);
+    contextMenu->addAction(cancelOperationsAction);
     contextMenu->addSeparator();
     contextMenu->addAction(setCurrentFolderAction);
     contextMenu->addAction(goToParentAction);
@@ -188,13 +204,15 @@ void FileSystemTreeView::createContextMenu() {
     addAction(refreshAction);
 }
 
-void FileSystemTreeView::setupFileSystemWatcher() {
-    fileSystemWatcher = new QFileSystemWatcher(this);
-
-    connect(fileSystemWatcher, &QFileSystemWatcher::directoryChanged, this,
-            &FileSystemTreeView::onDirectoryChanged);
-    connect(fileSystemWatcher, &QFileSystemWatcher::fileChanged, this,
-            &FileSystemTreeView::onFileChanged);
+void FileSystemTreeView::setWorkspaceWatcher(WorkspaceWatcher* watcher) {
+    if (workspaceWatcher) {
+        disconnect(workspaceWatcher, nullptr, this, nullptr);
+    }
+    workspaceWatcher = watcher;
+    if (workspaceWatcher) {
+        connect(workspaceWatcher, &WorkspaceWatcher::changesReady, this,
+                &FileSystemTreeView::onWorkspaceChanged);
+    }
 }
 
 void FileSystemTreeView::setRootPath(const QString& path) {
@@ -202,11 +220,6 @@ void FileSystemTreeView::setRootPath(const QString& path) {
         return;
     }
 
-    if (!currentRootPath.isEmpty() &&
-        fileSystemWatcher->directories().contains(currentRootPath)) {
-        fileSystemWatcher->removePath(currentRootPath);
-    }
-
     currentRootPath = path;
     currentRootSourceIndex = fileSystemModel->setRootPath(path);
     QModelIndex proxyRootIndex = proxyModel->mapFromSource(currentRootSourceIndex);
@@ -215,10 +228,6 @@ void FileSystemTreeView::setRootPath(const QString& path) {
     if (proxyRootIndex.isValid()) {
         expand(proxyRootIndex);
     }
-
-    fileSystemWatcher->addPath(path);
-
-    addDirectoriesToWatcher(path);
 }
 
 QString FileSystemTreeView::currentFilePath() const {
@@ -247,45 +256,36 @@ void FileSystemTreeView::onSelectionChanged(const QModelIndex& current,
             (suffix == "md" || suffix == "markdown" || suffix == "txt");
 
         if (isMarkdownFile) {
-            if (!watchedFilePath.isEmpty() && watchedFilePath != filePath) {
-                if (fileSystemWatcher->files().contains(watchedFilePath)) {
-                    fileSystemWatcher->removePath(watchedFilePath);
-                }
-            }
             watchedFilePath = filePath;
-            if (!fileSystemWatcher->files().contains(filePath)) {
-                fileSystemWatcher->addPath(filePath);
-            }
-
             emit fileSelected(filePath);
         }
     }
 }
 
-void FileSystemTreeView::onDirectoryChanged(const QString& path) {
-    Q_UNUSED(path);
-
-    // QFileSystemModel automatically handles directory changes and updates the
-    // view. No additional action needed here.
-}
-
-void FileSystemTreeView::onFileChanged(const QString& path) {
-    if (path == fileSavingPath) {
-        fileSavingPath.clear();
-        if (!fileSystemWatcher->files().contains(path)) {
-            fileSystemWatcher->addPath(path);
-        }
+void FileSystemTreeView::onWorkspaceChanged(
+    const WorkspaceChangeSet& changes) {
+    // QFileSystemModel keeps the tree itself up to date; only the
+    // selected note is of interest here.
+    if (watchedFilePath.isEmpty()) {
         return;
     }
-    if (path == watchedFilePath) {
-        if (QFile::exists(path)) {
-            emit fileModifiedExternally(path);
-            if (!fileSystemWatcher->files().contains(path)) {
-                fileSystemWatcher->addPath(path);
-            }
-        } else {
+    for (const WorkspaceChange& change : changes) {
+        if (change.type == WorkspaceChange::Renamed &&
+            change.oldPath == watchedFilePath) {
             watchedFilePath.clear();
+            return;
+        }
+        if (change.path != watchedFilePath) {
+            continue;
         }
+        if (change.type == WorkspaceChange::Removed) {
+            watchedFilePath.clear();
+        } else if (watchedFilePath == fileSavingPath) {
+            fileSavingPath.clear();
+        } else {
+            emit fileModifiedExternally(watchedFilePath);
+        }
+        return;
     }
 }
 
@@ -530,21 +530,7 @@ void FileSystemTreeView::deleteItem() {
         return;
     }
 
-    bool success = false;
-
-    if (fileInfo.isDir()) {
-        QDir dir(filePath);
-        success = dir.removeRecursively();
-    } else {
-        success = QFile::remove(filePath);
-    }
-
-    if (!success) {
-        QMessageBox::warning(this, tr("Error"),
-                             tr("Failed to delete %1!").arg(itemType));
-    } else {
-        emit fileDeleted(filePath);
-    }
+    fileOperations->remove(filePath);
 }
 
 void FileSystemTreeView::cutItem() {
@@ -588,85 +574,36 @@ void FileSystemTreeView::pasteItem() {
                              tr("An item with this name already exists!"));
         return;
     }
-    bool success = false;
     if (clipboardIsCut) {
-        if (sourceInfo.isDir()) {
-            success = QDir().rename(clipboardPath, newPath);
-        } else {
-            success = QFile::rename(clipboardPath, newPath);
-        }
-
-        if (success) {
-            clipboardPath.clear();
-        }
+        fileOperations->move(clipboardPath, newPath);
     } else {
-        if (sourceInfo.isDir()) {
-            success = copyDirectory(clipboardPath, newPath);
-        } else {
-            success = QFile::copy(clipboardPath, newPath);
-        }
-    }
-    if (!success) {
-        QMessageBox::warning(this, tr("Error"), tr("Failed to paste item!"));
+        fileOperations->copy(clipboardPath, newPath);
     }
 }
 
-bool FileSystemTreeView::copyDirectory(const QString& srcPath,
-                                       const QString& dstPath) {
-    QDir srcDir(srcPath);
-    if (!srcDir.exists()) {
-        return false;
-    }
-
-    QDir dstDir(dstPath);
-    if (!dstDir.exists()) {
-        if (!QDir().mkdir(dstPath)) {
-            return false;
-        }
-    }
-
-    foreach (
-        const QFileInfo& fileInfo,
-        srcDir.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot)) {
-        QString srcFilePath = fileInfo.filePath();
-        QString dstFilePath = dstPath + "/" + fileInfo.fileName();
-
-        if (fileInfo.isDir()) {
-            if (!copyDirectory(srcFilePath, dstFilePath)) {
-                return false;
-            }
-        } else {
-            if (!QFile::copy(srcFilePath, dstFilePath)) {
-                return false;
-            }
+void FileSystemTreeView::onFileOperationFinished(
+    int jobId, const FileOperationQueue::Operation& operation, bool success,
+    bool cancelled, const QString& errorMessage) {
+    Q_UNUSED(jobId);
+    if (success) {
+        if (operation.type == FileOperationQueue::Delete) {
+            emit fileDeleted(operation.source);
+        } else if (operation.type == FileOperationQueue::Move &&
+                   clipboardIsCut && clipboardPath == operation.source) {
+            clipboardPath.clear();
         }
-    }
-
-    return true;
-}
-
-void FileSystemTreeView::addDirectoriesToWatcher(const QString& path) {
-    QDir dir(path);
-    if (!dir.exists()) {
         return;
     }
-
-    // Skip system/private directories to avoid permission errors
-    if (path.contains("/systemd-private-") || path.startsWith("/proc") ||
-        path.startsWith("/sys") || path.startsWith("/dev")) {
+    if (cancelled) {
         return;
     }
-
-    if (!fileSystemWatcher->directories().contains(path)) {
-        // Try to add, but don't show error if permission denied
-        fileSystemWatcher->addPath(path);
-        // Silently ignore errors - QFileSystemWatcher returns false on error
-    }
-
-    // NOTE: We only watch the root directory, not all subdirectories.
-    // QFileSystemModel automatically handles subdirectory updates.
-    // Recursively watching all subdirectories causes severe performance issues
-    // with large directory trees and blocks the UI.
+    const QString message = operation.type == FileOperationQueue::Delete
+                                ? tr("Failed to delete %1!")
+                                : tr("Failed to paste %1!");
+    QMessageBox::warning(
+        this, tr("Error"),
+        message.arg(QFileInfo(operation.source).fileName()) + "\n\n" +
+            errorMessage);
 }
 
 void FileSystemTreeView::refreshDirectory() {
@@ -820,7 +757,7 @@ void FileSystemTreeView::openInFileExplorer() {
     
     // KDE Plasma - use Dolphin
     if (desktopEnv.contains("KDE", Qt::CaseInsensitive)) {
-        if (QProcess::execute("which", QStringList() << "dolphin") == 0) {
+        if (ExternalTools::instance()->isAvailable("dolphin")) {
             QProcess::startDetached("dolphin", QStringList() << "--select" << filePath);
             return;
         }
@@ -828,14 +765,14 @@ void FileSystemTreeView::openInFileExplorer() {
     
     // GNOME - use Nautilus
     if (desktopEnv.contains("GNOME", Qt::CaseInsensitive)) {
-        if (QProcess::execute("which", QStringList() << "nautilus") == 0) {
+        if (ExternalTools::instance()->isAvailable("nautilus")) {
             QProcess::startDetached("nautilus", QStringList() << "--select" << filePath);
             return;
         }
     }
     
     // Try generic xdg-open to open the directory
-    if (QProcess::execute("which", QStringList() << "xdg-open") == 0) {
+    if (ExternalTools::instance()->isAvailable("xdg-open")) {
         QDesktopServices::openUrl(QUrl::fromLocalFile(dirPath));
         return;
     }
@@ -0,0 +1,481 @@
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+
+#include "workspacewatcher.h"
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const int DEFAULT_DEBOUNCE_MS = 200;
+// Keeps a steady stream of events from holding a batch back forever.
+const int MAX_BATCH_AGE_MS = 1000;
+
+#ifdef Q_OS_LINUX
+const uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY |
+                            IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO |
+                            IN_DELETE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+#endif
+
+bool isUnder(const QString& path, const QString& directory) {
+    return path.size() > directory.size() && path.startsWith(directory) &&
+           path.at(directory.size()) == '/';
+}
+
+}  // namespace
+
+WorkspaceWatcher::WorkspaceWatcher(QObject* parent)
+    : QObject(parent),
+      m_inotifyFd(-1),
+      m_notifier(nullptr),
+      m_fallbackWatcher(nullptr),
+      m_limitReached(false),
+      m_scanWatcher(new QFutureWatcher<QStringList>(this)),
+      m_debounceTimer(new QTimer(this)),
+      m_debounceInterval(DEFAULT_DEBOUNCE_MS) {
+    m_debounceTimer->setSingleShot(true);
+    connect(m_debounceTimer, &QTimer::timeout, this, &WorkspaceWatcher::flush);
+    connect(m_scanWatcher, &QFutureWatcherBase::finished, this,
+            &WorkspaceWatcher::onScanFinished);
+
+#ifdef Q_OS_LINUX
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd >= 0) {
+        m_notifier =
+            new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this,
+                &WorkspaceWatcher::onInotifyActivated);
+        return;
+    }
+#endif
+    m_fallbackWatcher = new QFileSystemWatcher(this);
+    connect(m_fallbackWatcher, &QFileSystemWatcher::directoryChanged, this,
+            &WorkspaceWatcher::onDirectoryChanged);
+}
+
+WorkspaceWatcher::~WorkspaceWatcher() {
+    m_scanCancelled.storeRelaxed(1);
+    m_scanWatcher->waitForFinished();
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd >= 0) {
+        delete m_notifier;
+        close(m_inotifyFd);
+    }
+#endif
+}
+
+void WorkspaceWatcher::setRootPath(const QString& rootPath) {
+    const QString path =
+        rootPath.isEmpty() ? QString() : QDir(rootPath).absolutePath();
+    if (path == m_rootPath) {
+        return;
+    }
+
+    stopWatching();
+    m_rootPath = path;
+    if (path.isEmpty() || !QFileInfo(path).isDir()) {
+        return;
+    }
+    // The root is live right away; the rest follows once it is listed.
+    watchDirectory(path);
+    startScan();
+}
+
+void WorkspaceWatcher::setDebounceInterval(int msec) {
+    m_debounceInterval = qMax(0, msec);
+}
+
+void WorkspaceWatcher::stopWatching() {
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd >= 0) {
+        for (auto it = m_watchPaths.constBegin(); it != m_watchPaths.constEnd();
+             ++it) {
+            inotify_rm_watch(m_inotifyFd, it.key());
+        }
+    }
+#endif
+    if (m_fallbackWatcher && !m_watchedPaths.isEmpty()) {
+        m_fallbackWatcher->removePaths(m_watchedPaths.keys());
+    }
+    m_watchPaths.clear();
+    m_watchedPaths.clear();
+    m_pendingMoves.clear();
+    m_limitReached = false;
+
+    // Changes of the previous root mean nothing to the new one.
+    m_pending.clear();
+    m_debounceTimer->stop();
+}
+
+void WorkspaceWatcher::startScan() {
+    if (m_scanWatcher->isRunning()) {
+        // onScanFinished() starts over once the running scan stopped.
+        m_scanCancelled.storeRelaxed(1);
+        return;
+    }
+    m_scanCancelled.storeRelaxed(0);
+    m_scanRoot = m_rootPath;
+    const QString rootPath = m_rootPath;
+    m_scanWatcher->setFuture(QtConcurrent::run([this, rootPath]() {
+        return collectDirectories(rootPath, &m_scanCancelled);
+    }));
+}
+
+void WorkspaceWatcher::onScanFinished() {
+    if (m_scanCancelled.loadRelaxed() || m_scanRoot != m_rootPath) {
+        if (!m_rootPath.isEmpty()) {
+            startScan();
+        }
+        return;
+    }
+    const QStringList directories = m_scanWatcher->result();
+    for (const QString& directory : directories) {
+        if (m_limitReached) {
+            break;
+        }
+        watchDirectory(directory);
+    }
+}
+
+QStringList WorkspaceWatcher::collectDirectories(
+    const QString& rootPath, const QAtomicInt* cancelled) {
+    QStringList directories;
+    // Without QDir::Hidden the iterator does not descend into hidden
+    // directories either.
+    QDirIterator it(rootPath,
+                    QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext() && !cancelled->loadRelaxed()) {
+        directories.append(it.next());
+    }
+    return directories;
+}
+
+bool WorkspaceWatcher::isHidden(const QString& path) {
+    return path.mid(path.lastIndexOf('/') + 1).startsWith('.');
+}
+
+void WorkspaceWatcher::watchDirectory(const QString& path) {
+    if (m_limitReached || m_watchedPaths.contains(path) ||
+        (isHidden(path) && path != m_rootPath)) {
+        return;
+    }
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd >= 0) {
+        const int wd = inotify_add_watch(
+            m_inotifyFd, QFile::encodeName(path).constData(), WATCH_MASK);
+        if (wd < 0) {
+            if (errno == ENOSPC) {
+                m_limitReached = true;
+                emit watchLimitReached(m_watchedPaths.size());
+            }
+            return;
+        }
+        m_watchPaths.insert(wd, path);
+        m_watchedPaths.insert(path, wd);
+        return;
+    }
+#endif
+    if (m_fallbackWatcher->addPath(path)) {
+        m_watchedPaths.insert(path, -1);
+    }
+}
+
+void WorkspaceWatcher::watchTree(const QString& path, bool reportFiles) {
+    if (isHidden(path)) {
+        return;
+    }
+    watchDirectory(path);
+    // Entries made before the watch was in place sent no events.
+    QDirIterator it(path, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        if (info.isDir()) {
+            if (!info.isSymLink()) {
+                watchDirectory(info.filePath());
+            }
+        } else if (reportFiles) {
+            record(WorkspaceChange(WorkspaceChange::Added, info.filePath(),
+                                   false));
+        }
+    }
+}
+
+void WorkspaceWatcher::unwatchTree(const QString& path) {
+    for (auto it = m_watchedPaths.begin(); it != m_watchedPaths.end();) {
+        if (it.key() != path && !isUnder(it.key(), path)) {
+            ++it;
+            continue;
+        }
+#ifdef Q_OS_LINUX
+        // Directories moved out of the tree are still watched otherwise.
+        if (m_inotifyFd >= 0) {
+            inotify_rm_watch(m_inotifyFd, it.value());
+            m_watchPaths.remove(it.value());
+        }
+#endif
+        if (m_fallbackWatcher) {
+            m_fallbackWatcher->removePath(it.key());
+        }
+        it = m_watchedPaths.erase(it);
+    }
+}
+
+void WorkspaceWatcher::moveWatches(const QString& oldPath,
+                                   const QString& newPath) {
+    QHash<QString, int> moved;
+    for (auto it = m_watchedPaths.begin(); it != m_watchedPaths.end();) {
+        if (it.key() != oldPath && !isUnder(it.key(), oldPath)) {
+            ++it;
+            continue;
+        }
+        const QString path = newPath + it.key().mid(oldPath.size());
+        moved.insert(path, it.value());
+        m_watchPaths.insert(it.value(), path);
+        it = m_watchedPaths.erase(it);
+    }
+    m_watchedPaths.insert(moved);
+}
+
+void WorkspaceWatcher::onInotifyActivated() {
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    for (;;) {
+        const ssize_t length = read(m_inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (const char* p = buffer; p < buffer + length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                record(WorkspaceChange(WorkspaceChange::Rescan, m_rootPath,
+                                       true));
+                continue;
+            }
+            const QString directory = m_watchPaths.value(event->wd);
+            if (directory.isEmpty()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                // The directory is gone, or its watch was removed.
+                m_watchPaths.remove(event->wd);
+                if (m_watchedPaths.value(directory, -1) == event->wd) {
+                    m_watchedPaths.remove(directory);
+                }
+                continue;
+            }
+            if (event->mask & IN_DELETE_SELF) {
+                if (directory == m_rootPath) {
+                    record(WorkspaceChange(WorkspaceChange::Removed,
+                                           directory, true));
+                }
+                continue;
+            }
+            if (event->len == 0) {
+                continue;
+            }
+
+            const QString path =
+                directory + '/' + QFile::decodeName(event->name);
+            const bool isDir = event->mask & IN_ISDIR;
+            if (event->mask & IN_MOVED_FROM) {
+                PendingMove move;
+                move.path = path;
+                move.isDir = isDir;
+                m_pendingMoves.insert(event->cookie, move);
+                scheduleFlush();
+            } else if (event->mask & IN_MOVED_TO) {
+                auto move = m_pendingMoves.find(event->cookie);
+                if (move == m_pendingMoves.end() || isHidden(move->path)) {
+                    // Moved in from outside, or from a name not watched.
+                    if (move != m_pendingMoves.end()) {
+                        m_pendingMoves.erase(move);
+                    }
+                    if (isDir) {
+                        watchTree(path, true);
+                    }
+                    record(WorkspaceChange(WorkspaceChange::Added, path,
+                                           isDir));
+                } else {
+                    const QString oldPath = move->path;
+                    m_pendingMoves.erase(move);
+                    if (isHidden(path)) {
+                        if (isDir) {
+                            unwatchTree(oldPath);
+                        }
+                        record(WorkspaceChange(WorkspaceChange::Removed,
+                                               oldPath, isDir));
+                    } else {
+                        if (isDir) {
+                            moveWatches(oldPath, path);
+                        }
+                        recordRename(oldPath, path, isDir);
+                    }
+                }
+            } else if (event->mask & IN_CREATE) {
+                if (isDir) {
+                    watchTree(path, true);
+                }
+                record(WorkspaceChange(WorkspaceChange::Added, path, isDir));
+            } else if (event->mask & IN_DELETE) {
+                // The kernel drops a deleted directory's own watch.
+                record(WorkspaceChange(WorkspaceChange::Removed, path, isDir));
+            } else if ((event->mask & (IN_MODIFY | IN_CLOSE_WRITE)) &&
+                       !isDir) {
+                record(WorkspaceChange(WorkspaceChange::Modified, path,
+                                       false));
+            }
+        }
+    }
+#endif
+}
+
+void WorkspaceWatcher::onDirectoryChanged(const QString& path) {
+    if (!QFileInfo(path).isDir()) {
+        unwatchTree(path);
+        record(WorkspaceChange(WorkspaceChange::Removed, path, true));
+        return;
+    }
+    // QFileSystemWatcher does not tell what changed, so new directories
+    // are looked for and the directory is handed on for a rescan.
+    const QFileInfoList entries = QDir(path).entryInfoList(
+        QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+    for (const QFileInfo& entry : entries) {
+        if (!m_watchedPaths.contains(entry.filePath())) {
+            watchTree(entry.filePath(), false);
+        }
+    }
+    record(WorkspaceChange(WorkspaceChange::Rescan, path, true));
+}
+
+void WorkspaceWatcher::record(const WorkspaceChange& change) {
+    if (isHidden(change.path)) {
+        return;
+    }
+    scheduleFlush();
+
+    auto it = m_pending.find(change.path);
+    if (it == m_pending.end()) {
+        m_pending.insert(change.path, change);
+        return;
+    }
+    WorkspaceChange& previous = *it;
+    switch (change.type) {
+        case WorkspaceChange::Added:
+        case WorkspaceChange::Modified:
+            // Added, Renamed and Rescan already cover a later write.
+            if (previous.type == WorkspaceChange::Removed ||
+                previous.type == WorkspaceChange::Modified) {
+                previous = WorkspaceChange(WorkspaceChange::Modified,
+                                           change.path, change.isDir);
+            }
+            break;
+        case WorkspaceChange::Removed:
+            if (previous.type == WorkspaceChange::Added) {
+                m_pending.erase(it);
+            } else if (previous.type == WorkspaceChange::Renamed) {
+                const QString oldPath = previous.oldPath;
+                m_pending.erase(it);
+                record(WorkspaceChange(WorkspaceChange::Removed, oldPath,
+                                       change.isDir));
+            } else {
+                previous = change;
+            }
+            break;
+        case WorkspaceChange::Renamed:
+        case WorkspaceChange::Rescan:
+            previous = change;
+            break;
+    }
+}
+
+void WorkspaceWatcher::recordRename(const QString& oldPath,
+                                    const QString& newPath, bool isDir) {
+    if (isDir) {
+        // Pending changes below the directory move along with it.
+        QList<WorkspaceChange> moved;
+        for (auto it = m_pending.begin(); it != m_pending.end();) {
+            if (isUnder(it.key(), oldPath)) {
+                WorkspaceChange change = *it;
+                change.path = newPath + change.path.mid(oldPath.size());
+                moved.append(change);
+                it = m_pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (const WorkspaceChange& change : moved) {
+            m_pending.insert(change.path, change);
+        }
+    }
+
+    WorkspaceChange change(WorkspaceChange::Renamed, newPath, isDir, oldPath);
+    auto it = m_pending.find(oldPath);
+    if (it != m_pending.end()) {
+        const WorkspaceChange previous = *it;
+        m_pending.erase(it);
+        if (previous.type == WorkspaceChange::Added) {
+            // A temporary file renamed over the note, as safe saves do.
+            change = WorkspaceChange(WorkspaceChange::Added, newPath, isDir);
+        } else if (previous.type == WorkspaceChange::Renamed) {
+            change.oldPath = previous.oldPath;
+        }
+    }
+    if (change.type == WorkspaceChange::Renamed && change.oldPath == newPath) {
+        change = WorkspaceChange(WorkspaceChange::Modified, newPath, isDir);
+    }
+    m_pending.insert(newPath, change);
+    scheduleFlush();
+}
+
+void WorkspaceWatcher::resolvePendingMoves() {
+    // Renames whose target never showed up left the tree.
+    const QList<PendingMove> moves = m_pendingMoves.values();
+    m_pendingMoves.clear();
+    for (const PendingMove& move : moves) {
+        if (move.isDir) {
+            unwatchTree(move.path);
+        }
+        record(WorkspaceChange(WorkspaceChange::Removed, move.path,
+                               move.isDir));
+    }
+}
+
+void WorkspaceWatcher::scheduleFlush() {
+    if (!m_debounceTimer->isActive()) {
+        m_batchAge.start();
+    }
+    const int left = MAX_BATCH_AGE_MS - int(m_batchAge.elapsed());
+    m_debounceTimer->start(qBound(0, left, m_debounceInterval));
+}
+
+void WorkspaceWatcher::flush() {
+    resolvePendingMoves();
+    m_debounceTimer->stop();
+    if (m_pending.isEmpty()) {
+        return;
+    }
+
+    WorkspaceChangeSet changes = m_pending.values();
+    m_pending.clear();
+    std::sort(changes.begin(), changes.end(),
+              [](const WorkspaceChange& a, const WorkspaceChange& b) {
+                  return a.path < b.path;
+              });
+    emit changesReady(changes);
+}
@@ -13,6 +13,16 @@
 static const QString MARKDOWN_FILTERS[] = {"*.md", "*.markdown"};
 static const int MARKDOWN_FILTER_COUNT = 2;
 
+// Absolute path with the directory resolved, for files that may no
+// longer exist, such as a note's name before it was renamed.
+static QString normalizedFilePath(const QString& path) {
+    const QFileInfo info(path);
+    const QString directory =
+        QFileInfo(info.absolutePath()).canonicalFilePath();
+    return (directory.isEmpty() ? info.absolutePath() : directory) + '/' +
+           info.fileName();
+}
+
 LinkParser::LinkParser(QObject* parent)
     : QObject(parent), maxDepth(2), enforceHomeBoundary(true) {
     backlinksManager = new BacklinksManager(this);
@@ -21,6 +31,7 @@ LinkParser::LinkParser(QObject* parent)
 LinkParser::~LinkParser() {}
 
 void LinkParser::setEnforceHomeBoundary(bool enforce) {
+    QMutexLocker locker(&mutex);
     enforceHomeBoundary = enforce;
 }
 
@@ -90,6 +101,77 @@ void LinkParser::buildLinkIndex(const QString& path, int depth) {
     emit indexBuildCompleted();
 }
 
+void LinkParser::applyChanges(const WorkspaceChangeSet& changes) {
+    QMutexLocker locker(&mutex);
+    if (rootPath.isEmpty()) {
+        return;
+    }
+    const QDir rootDir(rootPath);
+    const int depthLimit = maxDepth;
+    const bool homeOnly = enforceHomeBoundary;
+    locker.unlock();
+
+    bool changed = false;
+    for (const WorkspaceChange& change : changes) {
+        if (change.type == WorkspaceChange::Renamed) {
+            changed |= removeFromIndex(change.oldPath);
+        } else if (change.type == WorkspaceChange::Removed ||
+                   change.type == WorkspaceChange::Rescan) {
+            changed |= removeFromIndex(change.path);
+        }
+        if (change.type == WorkspaceChange::Removed) {
+            continue;
+        }
+
+        if (change.isDir) {
+            // Files of a new directory are reported one by one.
+            if (change.type != WorkspaceChange::Added &&
+                QFileInfo(change.path).isDir()) {
+                scanDirectoryIterative(change.path);
+                changed = true;
+            }
+            continue;
+        }
+        const QString suffix = QFileInfo(change.path).suffix().toLower();
+        if (suffix != "md" && suffix != "markdown") {
+            continue;
+        }
+        const QString relativePath = rootDir.relativeFilePath(change.path);
+        if (relativePath.startsWith("../") ||
+            relativePath.count('/') > depthLimit ||
+            (homeOnly && !isWithinHomeDirectory(change.path))) {
+            continue;
+        }
+        processFile(change.path);
+        changed = true;
+    }
+    if (!changed) {
+        return;
+    }
+
+    locker.relock();
+    const QMap<QString, QVector<QString>> links = forwardLinks;
+    locker.unlock();
+    backlinksManager->buildBacklinks(links);
+
+    emit indexBuildCompleted();
+}
+
+bool LinkParser::removeFromIndex(const QString& path) {
+    QMutexLocker locker(&mutex);
+    const QString prefix = path + '/';
+    bool removed = false;
+    for (auto it = forwardLinks.begin(); it != forwardLinks.end();) {
+        if (it.key() == path || it.key().startsWith(prefix)) {
+            it = forwardLinks.erase(it);
+            removed = true;
+        } else {
+            ++it;
+        }
+    }
+    return removed;
+}
+
 QVector<QString> LinkParser::getBacklinks(const QString& filePath) const {
     return backlinksManager->getBacklinks(filePath);
 }
@@ -97,6 +179,35 @@ QVector<QString> LinkParser::getBacklinks(const QString& filePath) const {
 QString LinkParser::resolveLinkTarget(const QString& linkTarget,
                                       const QString& currentFilePath,
                                       int searchDepth) const {
+    return resolve(linkTarget, currentFilePath, searchDepth, nullptr);
+}
+
+QString LinkParser::resolveLinkTargetBeforeRename(
+    const QString& linkTarget, const QString& currentFilePath,
+    int searchDepth, const QString& originalPath,
+    const QString& renamedPath) const {
+    Rename rename;
+    rename.from = normalizedFilePath(originalPath);
+    rename.to = normalizedFilePath(renamedPath);
+    return resolve(linkTarget, currentFilePath, searchDepth, &rename);
+}
+
+QString LinkParser::existingPath(const QString& path, const Rename* rename) {
+    if (rename) {
+        const QString normalized = normalizedFilePath(path);
+        if (normalized == rename->from) {
+            return rename->from;
+        }
+        if (normalized == rename->to) {
+            return QString();
+        }
+    }
+    return QFileInfo::exists(path) ? path : QString();
+}
+
+QString LinkParser::resolve(const QString& linkTarget,
+                            const QString& currentFilePath, int searchDepth,
+                            const Rename* rename) const {
     QString cleanTarget = linkTarget.trimmed();
     QFileInfo currentFileInfo(currentFilePath);
     QDir currentDir = currentFileInfo.dir();
@@ -109,14 +220,15 @@ QString LinkParser::resolveLinkTarget(const QString& linkTarget,
     for (int depth = 0; depth <= searchDepth; ++depth) {
         if (depth == 0) {
             for (const QString& ext : possibleExtensions) {
-                QString fullPath = currentDir.filePath(cleanTarget + ext);
-                if (QFileInfo::exists(fullPath)) {
+                QString fullPath = existingPath(
+                    currentDir.filePath(cleanTarget + ext), rename);
+                if (!fullPath.isEmpty()) {
                     return fullPath;
                 }
             }
 
             searchInDirectory(currentDir.absolutePath(), cleanTarget, result, 0,
-                              searchDepth);
+                              searchDepth, rename);
             if (!result.isEmpty()) {
                 return result;
             }
@@ -131,7 +243,7 @@ QString LinkParser::resolveLinkTarget(const QString& linkTarget,
                 QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
             for (const QFileInfo& entry : entries) {
                 searchInDirectory(entry.absoluteFilePath(), cleanTarget, result,
-                                  0, searchDepth);
+                                  0, searchDepth, rename);
                 if (!result.isEmpty()) {
                     return result;
                 }
@@ -151,7 +263,8 @@ void LinkParser::scanDirectoryIterative(const QString& dirPath) {
     QDirIterator it(dirPath, filters, QDir::Files | QDir::NoSymLinks,
                     QDirIterator::Subdirectories);
 
-    QDir rootDir(dirPath);
+    // Depth counts from the workspace root, also when rescanning below it.
+    QDir rootDir(rootPath);
     int fileCount = 0;
 
     while (it.hasNext()) {
@@ -194,7 +307,7 @@ bool LinkParser::isWithinHomeDirectory(const QString& path) const {
 void LinkParser::searchInDirectory(const QString& dirPath,
                                    const QString& targetBaseName,
                                    QString& result, int depth,
-                                   int maxDepth) const {
+                                   int maxDepth, const Rename* rename) const {
     if (depth > maxDepth || !result.isEmpty() ||
         (enforceHomeBoundary && !isWithinHomeDirectory(dirPath))) {
         return;
@@ -213,8 +326,15 @@ void LinkParser::searchInDirectory(const QString& dirPath,
     QFileInfoList files = dir.entryInfoList(filters, QDir::Files, QDir::Name);
     for (const QFileInfo& fileInfo : files) {
         QString baseName = fileInfo.completeBaseName();
+        QString filePath = fileInfo.absoluteFilePath();
+        if (rename && fileInfo.fileName() == QFileInfo(rename->to).fileName() &&
+            normalizedFilePath(filePath) == rename->to) {
+            // Still found under the name it had.
+            baseName = QFileInfo(rename->from).completeBaseName();
+            filePath = rename->from;
+        }
         if (baseName.compare(targetBaseName, Qt::CaseInsensitive) == 0) {
-            result = fileInfo.absoluteFilePath();
+            result = filePath;
             return;
         }
     }
@@ -223,7 +343,7 @@ void LinkParser::searchInDirectory(const QString& dirPath,
         dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
     for (const QFileInfo& subdirInfo : subdirs) {
         searchInDirectory(subdirInfo.absoluteFilePath(), targetBaseName, result,
-                          depth + 1, maxDepth);
+                          depth + 1, maxDepth, rename);
         if (!result.isEmpty()) {
             return;
         }
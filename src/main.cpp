@@ -7,6 +7,7 @@
 #include "fileutils.h"
 #include "mainwindow.h"
 #include "managers/windowmanager.h"
+#include "previewschemehandler.h"
 #include "appinit.h"
 
 namespace {
@@ -105,6 +106,8 @@ void messageHandler(QtMsgType type, const QMessageLogContext& context,
  */
 int main(int argc, char* argv[]) {
     qInstallMessageHandler(messageHandler);
+    // Custom URL schemes must be known before the web engine starts.
+    PreviewSchemeHandler::registerScheme();
     QApplication app(argc, argv);
     app.setApplicationName(APP_LABEL);
     app.setOrganizationName(APP_LABEL);
@@ -139,6 +139,14 @@ void MainWindow::createActions() {
     connect(exportPlainTextAction, &QAction::triggered, this,
             &MainWindow::exportToPlainText);
 
+    exportFolderHtmlAction = createAction(
+        this, adaptiveSvgIcon(":/icons/icons/export-html.svg"),
+        tr("Export &Folder to HTML..."),
+        tr("Export every note of a folder to HTML"),
+        tr("Export folder to HTML"));
+    connect(exportFolderHtmlAction, &QAction::triggered, this,
+            &MainWindow::exportFolderToHtml);
+
     insertImageAction = createAction(
         this, iconWithFallback("insert-image", QStyle::SP_FileDialogInfoView),
         tr("Insert &Image..."), tr("Insert an image into the document"),
@@ -129,7 +129,7 @@ void MainWindow::quickOpen() {
         return;
     }
 
-    QuickOpenDialog dialog(currentFolder, recentFiles, this);
+    QuickOpenDialog dialog(workspaceCatalog, recentFiles, this);
     if (dialog.exec() == QDialog::Accepted) {
         QString selectedFile = dialog.getSelectedFile();
         if (!selectedFile.isEmpty()) {
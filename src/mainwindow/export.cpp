@@ -1,18 +1,40 @@
+#include <QDir>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QPrintDialog>
 #include <QPrinter>
-#include <QProcess>
 #include <QStatusBar>
+#include <QTabWidget>
 #include <QTextDocument>
 #include <QTextStream>
 
+#include "batchexporter.h"
+#include "defs.h"
+#include "externaltools.h"
 #include "fileutils.h"
+#include "htmlexporter.h"
 #include "mainwindow.h"
 #include "markdowneditor.h"
+#include "markdownpreview.h"
+#include "pdfexporter.h"
 #include "tabeditor.h"
 
+namespace {
+
+// Exported pages look like the preview: same styles, same diagrams.
+HtmlExporter::Options previewExportOptions(const MarkdownPreview* preview,
+                                           const QString& workspacePath) {
+    HtmlExporter::Options options;
+    options.styleSheet = preview->pageStyleSheet();
+    options.darkScheme = preview->isDarkScheme();
+    options.latexEnabled = preview->isLatexEnabled();
+    options.workspacePath = workspacePath;
+    return options;
+}
+
+}  // namespace
+
 void MainWindow::exportToHtml() {
     TabEditor* tab = currentTabEditor();
     if (!tab || currentFilePath.isEmpty()) {
@@ -20,6 +42,11 @@ void MainWindow::exportToHtml() {
                              tr("Please save the document before exporting."));
         return;
     }
+    if (htmlExporter->isRunning()) {
+        statusBar()->showMessage(tr("An HTML export is already running."),
+                                 3000);
+        return;
+    }
     QString outputPath = QFileDialog::getSaveFileName(
         this, tr("Export to HTML"),
         currentFilePath.left(currentFilePath.lastIndexOf('.')) + ".html",
@@ -30,34 +57,115 @@ void MainWindow::exportToHtml() {
     if (tab->isModified()) {
         save();
     }
-    QStringList pandocArgs;
-    pandocArgs << currentFilePath << "-o" << outputPath << "--standalone"
-               << "--mathjax";
-    // Add Mermaid filter if available with proper working directory
-    QProcess checkFilter;
-    checkFilter.start("which", QStringList() << "mermaid-filter");
-    if (checkFilter.waitForFinished(2000) && checkFilter.exitCode() == 0) {
-        pandocArgs << "--filter" << "mermaid-filter";
+    htmlExporter->start(currentFilePath, outputPath,
+                        previewExportOptions(sharedPreview, currentFolder));
+}
+
+void MainWindow::exportFolderToHtml() {
+    if (batchExporter->isRunning()) {
+        QMessageBox::StandardButton answer = QMessageBox::question(
+            this, tr("Export Folder to HTML"),
+            tr("A folder export is running. Stop it?"));
+        if (answer == QMessageBox::Yes) {
+            batchExporter->cancel();
+        }
+        return;
+    }
+    QString folder = QFileDialog::getExistingDirectory(
+        this, tr("Folder to Export"),
+        currentFolder.isEmpty() ? QDir::homePath() : currentFolder);
+    if (folder.isEmpty()) {
+        return;
     }
-    QProcess pandoc;
-    // Set working directory to a writable location for mermaid-filter
-    QString workDir = QFileInfo(currentFilePath).absolutePath();
-    pandoc.setWorkingDirectory(workDir);
-    pandoc.start("pandoc", pandocArgs);
-    if (!pandoc.waitForFinished(30000)) {
-        QMessageBox::warning(this, tr("Export Failed"),
-                             tr("Pandoc process timed out."));
+    QString outputDir = QFileDialog::getExistingDirectory(
+        this, tr("Export Into"), QFileInfo(folder).absolutePath());
+    if (outputDir.isEmpty()) {
         return;
     }
-    if (pandoc.exitCode() != 0) {
-        QMessageBox::warning(
-            this, tr("Export Failed"),
-            tr("Failed to export to HTML.\nError: %1")
-                .arg(QString::fromUtf8(pandoc.readAllStandardError())));
-    } else {
-        statusBar()->showMessage(tr("Exported to HTML: %1").arg(outputPath),
-                                 3000);
+    // Pages of open notes reflect what is on disk.
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        TabEditor* tab = qobject_cast<TabEditor*>(tabWidget->widget(i));
+        if (tab && tab->isModified() && !tab->filePath().isEmpty()) {
+            tab->saveFile();
+        }
+    }
+    batchExporter->start(folder, outputDir,
+                         previewExportOptions(sharedPreview, currentFolder));
+}
+
+void MainWindow::onBatchExportFinished(int exported, int skipped,
+                                       const QStringList& errors) {
+    progressBar->setVisible(false);
+    QString message = tr("Exported %1 notes, %2 unchanged.")
+                          .arg(exported)
+                          .arg(skipped);
+    if (errors.isEmpty()) {
+        statusBar()->showMessage(message, 5000);
+        return;
+    }
+    statusBar()->clearMessage();
+    // A few errors are enough to tell what went wrong.
+    QMessageBox::warning(this, tr("Export Failed"),
+                         message + "\n\n" + errors.mid(0, 10).join("\n"));
+}
+
+void MainWindow::showExternalToolJobs(int count,
+                                      const QString& description) {
+    // External programs report no progress; the bar just shows they run.
+    if (count == 0) {
+        progressBar->setVisible(false);
+        statusBar()->clearMessage();
+        return;
+    }
+    progressBar->setRange(0, 0);
+    progressBar->setVisible(true);
+    statusBar()->showMessage(description);
+}
+
+void MainWindow::showExportProgress(int percent, const QString& step) {
+    progressBar->setRange(0, 100);
+    progressBar->setValue(percent);
+    progressBar->setVisible(percent < 100);
+    statusBar()->showMessage(tr("Exporting: %1").arg(step));
+}
+
+bool MainWindow::isExporting() const {
+    return htmlExporter->isRunning() || pdfExporter->pendingCount() > 0 ||
+           batchExporter->isRunning();
+}
+
+void MainWindow::showFileOperationProgress(int percent, const QString& step) {
+    // The bar and the status line belong to a running export.
+    if (isExporting()) {
+        return;
     }
+    progressBar->setRange(0, 100);
+    progressBar->setValue(percent);
+    progressBar->setVisible(percent < 100);
+    statusBar()->showMessage(tr("Files: %1").arg(step));
+}
+
+void MainWindow::onFileOperationsBusyChanged(bool busy) {
+    if (busy || isExporting()) {
+        return;
+    }
+    progressBar->setVisible(false);
+    statusBar()->clearMessage();
+}
+
+void MainWindow::onExportFinished(bool success, const QString& outputPath,
+                                  const QString& errorMessage) {
+    const QString format = QFileInfo(outputPath).suffix().toUpper();
+    progressBar->setVisible(false);
+    if (!success) {
+        statusBar()->clearMessage();
+        QMessageBox::warning(this, tr("Export Failed"),
+                             tr("Failed to export to %1.\nError: %2")
+                                 .arg(format, errorMessage));
+        return;
+    }
+    statusBar()->showMessage(
+        tr("Exported to %1: %2").arg(format, outputPath), 3000);
 }
 
 void MainWindow::exportToPdf() {
@@ -81,39 +189,22 @@ void MainWindow::exportToPdf() {
         save();
     }
 
-    QStringList pandocArgs;
-    pandocArgs << currentFilePath << "-o" << outputPath
-               << "--pdf-engine=xelatex";
-
-    // Add Mermaid filter if available with proper working directory
-    QProcess checkFilter;
-    checkFilter.start("which", QStringList() << "mermaid-filter");
-    if (checkFilter.waitForFinished(2000) && checkFilter.exitCode() == 0) {
-        pandocArgs.insert(pandocArgs.size() - 2, "--filter");
-        pandocArgs.insert(pandocArgs.size() - 2, "mermaid-filter");
-    }
-
-    QProcess pandoc;
-    // Set working directory to a writable location for mermaid-filter
-    QString workDir = QFileInfo(currentFilePath).absolutePath();
-    pandoc.setWorkingDirectory(workDir);
-    pandoc.start("pandoc", pandocArgs);
-
-    if (!pandoc.waitForFinished(60000)) {
-        QMessageBox::warning(this, tr("Export Failed"),
-                             tr("Pandoc process timed out."));
-        return;
-    }
-
-    if (pandoc.exitCode() != 0) {
-        QMessageBox::warning(
-            this, tr("Export Failed"),
-            tr("Failed to export to PDF.\nError: %1")
-                .arg(QString::fromUtf8(pandoc.readAllStandardError())));
-    } else {
-        statusBar()->showMessage(tr("Exported to PDF: %1").arg(outputPath),
+    PdfExporter::Options options;
+    options.html = previewExportOptions(sharedPreview, currentFolder);
+    // Paper is white whatever the preview's color scheme.
+    options.html.darkScheme = false;
+    options.pageLayout = PdfExporter::pageLayout(
+        settings->value("export/pdfPageSize", DEFAULT_PDF_PAGE_SIZE)
+            .toString(),
+        settings->value("export/pdfOrientation", "portrait").toString() ==
+            "landscape",
+        settings->value("export/pdfMarginMM", DEFAULT_PDF_MARGIN_MM)
+            .toDouble());
+    if (pdfExporter->pendingCount() > 0) {
+        statusBar()->showMessage(tr("PDF export queued: %1").arg(outputPath),
                                  3000);
     }
+    pdfExporter->enqueue(currentFilePath, outputPath, options);
 }
 
 void MainWindow::exportToDocx() {
@@ -124,6 +215,23 @@ void MainWindow::exportToDocx() {
         return;
     }
 
+    ExternalTools* tools = ExternalTools::instance();
+    if (tools->isRunning(docxExportJob)) {
+        QMessageBox::StandardButton answer = QMessageBox::question(
+            this, tr("Export to Word"),
+            tr("A Word export is running. Stop it?"));
+        if (answer == QMessageBox::Yes) {
+            tools->cancel(docxExportJob);
+        }
+        return;
+    }
+    if (!tools->isAvailable("pandoc")) {
+        QMessageBox::warning(this, tr("Export to Word"),
+                             tr("Word export needs pandoc, which was not "
+                                "found on the PATH."));
+        return;
+    }
+
     QString outputPath = QFileDialog::getSaveFileName(
         this, tr("Export to Word"),
         currentFilePath.left(currentFilePath.lastIndexOf('.')) + ".docx",
@@ -137,38 +245,39 @@ void MainWindow::exportToDocx() {
         save();
     }
 
-    QStringList pandocArgs;
-    pandocArgs << currentFilePath << "-o" << outputPath;
-
-    // Add Mermaid filter if available with proper working directory
-    QProcess checkFilter;
-    checkFilter.start("which", QStringList() << "mermaid-filter");
-    if (checkFilter.waitForFinished(2000) && checkFilter.exitCode() == 0) {
-        pandocArgs.insert(pandocArgs.size() - 2, "--filter");
-        pandocArgs.insert(pandocArgs.size() - 2, "mermaid-filter");
+    ExternalTools::Job job;
+    job.program = "pandoc";
+    job.arguments << currentFilePath << "-o" << outputPath;
+    // Add Mermaid filter if available
+    if (tools->isAvailable("mermaid-filter")) {
+        job.arguments.insert(job.arguments.size() - 2, "--filter");
+        job.arguments.insert(job.arguments.size() - 2, "mermaid-filter");
     }
-
-    QProcess pandoc;
     // Set working directory to a writable location for mermaid-filter
-    QString workDir = QFileInfo(currentFilePath).absolutePath();
-    pandoc.setWorkingDirectory(workDir);
-    pandoc.start("pandoc", pandocArgs);
+    job.workingDirectory = QFileInfo(currentFilePath).absolutePath();
+    job.timeoutMs = 60000;
+    job.description = tr("Exporting to Word");
 
-    if (!pandoc.waitForFinished(30000)) {
-        QMessageBox::warning(this, tr("Export Failed"),
-                             tr("Pandoc process timed out."));
-        return;
-    }
-
-    if (pandoc.exitCode() != 0) {
-        QMessageBox::warning(
-            this, tr("Export Failed"),
-            tr("Failed to export to Word.\nError: %1")
-                .arg(QString::fromUtf8(pandoc.readAllStandardError())));
-    } else {
-        statusBar()->showMessage(tr("Exported to Word: %1").arg(outputPath),
-                                 3000);
-    }
+    docxExportJob = tools->run(
+        job, this, [this, outputPath](const ExternalTools::Result& result) {
+            if (result.cancelled) {
+                statusBar()->showMessage(tr("Word export stopped."), 3000);
+            } else if (result.timedOut) {
+                QMessageBox::warning(this, tr("Export Failed"),
+                                     tr("Pandoc process timed out."));
+            } else if (!result.succeeded()) {
+                const QString error =
+                    result.started
+                        ? QString::fromUtf8(result.standardError)
+                        : result.errorString;
+                QMessageBox::warning(
+                    this, tr("Export Failed"),
+                    tr("Failed to export to Word.\nError: %1").arg(error));
+            } else {
+                statusBar()->showMessage(
+                    tr("Exported to Word: %1").arg(outputPath), 3000);
+            }
+        });
 }
 
 void MainWindow::exportToPlainText() {
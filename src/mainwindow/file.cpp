@@ -28,6 +28,7 @@
 #include "markdownhighlighter.h"
 #include "markdownpreview.h"
 #include "navigationhistory.h"
+#include "ngramindexer.h"
 #include "tabeditor.h"
 
 void MainWindow::newFile() { createNewTab(); }
@@ -124,6 +125,7 @@ void MainWindow::save() {
         saveAs();
     } else {
         if (tab->saveFile()) {
+            predictionIndexer->scheduleRefresh();
             statusBar()->showMessage(tr("File saved"), 2000);
         }
     }
@@ -238,6 +240,8 @@ void MainWindow::onFileRenamed(const QString& oldPath, const QString& newPath) {
         statusBar()->showMessage(
             tr("File renamed: %1").arg(QFileInfo(newPath).fileName()), 3000);
     }
+
+    updateLinksAfterRename(oldPath, newPath);
 }
 
 bool MainWindow::maybeSave() {
@@ -375,8 +379,9 @@ bool MainWindow::loadFile(const QString& filePath, bool forceNewTab) {
 void MainWindow::autoSave() {
     for (int i = 0; i < tabWidget->count(); ++i) {
         TabEditor* tab = qobject_cast<TabEditor*>(tabWidget->widget(i));
-        if (tab && tab->isModified() && !tab->filePath().isEmpty()) {
-            tab->saveFile();
+        if (tab && tab->isModified() && !tab->filePath().isEmpty() &&
+            tab->saveFile()) {
+            predictionIndexer->scheduleRefresh();
         }
     }
 }
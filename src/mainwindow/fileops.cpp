@@ -8,6 +8,7 @@
 #include <QMessageBox>
 #include <QPushButton>
 #include <QRegularExpression>
+#include <QSet>
 #include <QStatusBar>
 #include <QTextCursor>
 #include <QTextDocument>
@@ -16,6 +17,7 @@
 #include "defs.h"
 #include "filesystemtreeview.h"
 #include "linkparser.h"
+#include "linkrewriter.h"
 #include "logic/mainfilelocator.h"
 #include "mainwindow.h"
 #include "managers/windowmanager.h"
@@ -38,144 +40,28 @@ static const int MD_URL_GROUP = 3;     // URL or path
 
 static void updateLinksInDocument(QTextDocument* document,
                                   const QString& oldFileName,
-                                  const QString& newFileName) {
-    if (!document || oldFileName.isEmpty() || newFileName.isEmpty()) {
+                                  const QString& newFileName,
+                                  const QString& filePath,
+                                  const LinkRewriter::LinkFilter& filter) {
+    if (!document) {
         return;
     }
 
-    QString content = document->toPlainText();
-    QString updatedContent = content;
-    bool modified = false;
-
-    QList<QPair<int, QPair<int, QString>>>
-        replacements;  // position, length, replacement
-
-    QRegularExpression wikiLinkPattern(RegexPatterns::WIKI_LINK);
-    QRegularExpressionMatchIterator wikiIterator =
-        wikiLinkPattern.globalMatch(content);
-
-    while (wikiIterator.hasNext()) {
-        QRegularExpressionMatch match = wikiIterator.next();
-        QString prefix = match.captured(WIKI_PREFIX_GROUP);  // "!" or empty
-        QString target = match.captured(WIKI_TARGET_GROUP).trimmed();
-
-        // Check if this link references the old file
-        // Extract just the filename without path for comparison
-        QString targetFileName = QFileInfo(target).fileName();
-
-        // Handle both with and without extension
-        QString targetBase = targetFileName;
-        QString targetExt;
-        int dotPos = targetBase.lastIndexOf('.');
-        if (dotPos > 0) {
-            targetExt = targetBase.mid(dotPos);
-            targetBase = targetBase.left(dotPos);
-        }
-
-        QString oldFileBase = oldFileName;
-        QString oldFileExt;
-        dotPos = oldFileBase.lastIndexOf('.');
-        if (dotPos > 0) {
-            oldFileExt = oldFileBase.mid(dotPos);
-            oldFileBase = oldFileBase.left(dotPos);
-        }
-
-        if (targetBase == oldFileBase || targetFileName == oldFileName) {
-            // Build replacement - preserve the path structure if present
-            QString newTarget;
-            if (target.contains('/') || target.contains('\\')) {
-                // Has path, replace just the filename part
-                QString path = QFileInfo(target).path();
-                if (path == ".") {
-                    newTarget = newFileName;
-                } else {
-                    newTarget = path + "/" + newFileName;
-                }
-            } else {
-                newTarget = newFileName;
-            }
-
-            // Remove extension if original didn't have it
-            if (targetExt.isEmpty() && newTarget.contains('.')) {
-                int lastDot = newTarget.lastIndexOf('.');
-                if (lastDot > 0) {
-                    newTarget = newTarget.left(lastDot);
-                }
-            }
-
-            QString replacement;
-            if (match.captured(WIKI_PIPE_GROUP).isEmpty()) {
-                // Simple link: [[target]] or ![[target]]
-                replacement = QString("%1[[%2]]").arg(prefix, newTarget);
-            } else {
-                // Link with display: [[target|display]] or ![[target|display]]
-                replacement = QString("%1[[%2|%3]]")
-                                  .arg(prefix, newTarget,
-                                       match.captured(WIKI_DISPLAY_GROUP));
-            }
-
-            replacements.append(
-                qMakePair(match.capturedStart(),
-                          qMakePair(match.capturedLength(), replacement)));
-            modified = true;
-        }
-    }
-
-    // Pattern for markdown links with optional !: ![text](url) or [text](url)
-    QRegularExpression markdownLinkPattern(
-        RegexPatterns::MARKDOWN_LINK_WITH_IMAGE);
-    QRegularExpressionMatchIterator mdIterator =
-        markdownLinkPattern.globalMatch(content);
-
-    while (mdIterator.hasNext()) {
-        QRegularExpressionMatch match = mdIterator.next();
-        QString prefix = match.captured(MD_PREFIX_GROUP);  // "!" or empty
-        QString text = match.captured(MD_TEXT_GROUP);
-        QString url = match.captured(MD_URL_GROUP).trimmed();
-
-        // Skip external links
-        if (url.startsWith(HTTP_PREFIX) || url.startsWith(HTTPS_PREFIX)) {
-            continue;
-        }
-
-        // Extract just the filename from the path
-        QString urlFileName = QFileInfo(url).fileName();
-
-        if (urlFileName == oldFileName) {
-            // Build replacement with the same relative path structure
-            QString newUrl = url;
-            newUrl.replace(oldFileName, newFileName);
-            QString replacement =
-                QString("%1[%2](%3)").arg(prefix, text, newUrl);
-
-            replacements.append(
-                qMakePair(match.capturedStart(),
-                          qMakePair(match.capturedLength(), replacement)));
-            modified = true;
-        }
-    }
-
-    if (!modified) {
+    const QList<LinkRewriter::Edit> edits = LinkRewriter::linkEdits(
+        document->toPlainText(), oldFileName, newFileName, filePath, filter);
+    if (edits.isEmpty()) {
         return;
     }
 
-    // Apply replacements in reverse order to maintain positions
-    std::sort(replacements.begin(), replacements.end(),
-              [](const auto& a, const auto& b) { return a.first > b.first; });
-
-    for (const auto& repl : replacements) {
-        int pos = repl.first;
-        int length = repl.second.first;
-        QString replacement = repl.second.second;
-
-        updatedContent.replace(pos, length, replacement);
-    }
-
-    // Update the document
+    // Patch each link in place, back to front, so that the rest of the
+    // document, its undo history and the cursors are left alone.
     QTextCursor cursor(document);
     cursor.beginEditBlock();
-    cursor.select(QTextCursor::Document);
-    cursor.insertText(updatedContent);
+    for (auto it = edits.crbegin(); it != edits.crend(); ++it) {
+        cursor.setPosition(it->position);
+        cursor.setPosition(it->position + it->length, QTextCursor::KeepAnchor);
+        cursor.insertText(it->text);
+    }
     cursor.endEditBlock();
 }
 
@@ -305,6 +191,78 @@ static void removeLinksInDocument(QTextDocument* document,
     cursor.endEditBlock();
 }
 
+void MainWindow::updateLinksAfterRename(const QString& oldPath,
+                                        const QString& newPath) {
+    const QFileInfo newInfo(newPath);
+    const QString oldName = QFileInfo(oldPath).fileName();
+    const QString newName = newInfo.fileName();
+    if (!newInfo.isFile() || oldName == newName ||
+        !settings->value("workspace/updateLinksOnRename", true).toBool()) {
+        return;
+    }
+
+    // The watcher reports the rename only after its debounce interval, so
+    // the index still knows the note under its old path.
+    const QString indexedPath =
+        QDir(newInfo.canonicalPath()).filePath(oldName);
+    const QVector<QString> backlinks = linkParser->getBacklinks(indexedPath);
+
+    // Only links that led to the note: [[foo]] may mean another foo.md
+    // closer to the note it is written in.
+    const LinkParser* parser = linkParser;
+    const int searchDepth = getLinkSearchDepth();
+    const QString renamedPath = newInfo.canonicalFilePath();
+    const LinkRewriter::LinkFilter filter =
+        [parser, searchDepth, indexedPath, renamedPath](
+            const QString& target, const QString& referrer) {
+            return !referrer.isEmpty() &&
+                   parser->resolveLinkTargetBeforeRename(
+                       target, referrer, searchDepth, indexedPath,
+                       renamedPath) == indexedPath;
+        };
+
+    // Open notes are patched in their documents, which keeps unsaved
+    // edits and the undo history.
+    QSet<QString> openFiles;
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        TabEditor* tab = qobject_cast<TabEditor*>(tabWidget->widget(i));
+        if (tab && tab->editor()) {
+            updateLinksInDocument(tab->editor()->document(), oldName, newName,
+                                  tab->filePath(), filter);
+            openFiles.insert(QFileInfo(tab->filePath()).canonicalFilePath());
+        }
+    }
+
+    QStringList files;
+    for (const QString& source : backlinks) {
+        QString path = QFileInfo(source).canonicalFilePath();
+        if (path.isEmpty() &&
+            QFileInfo(source).absoluteFilePath() ==
+                QFileInfo(oldPath).absoluteFilePath()) {
+            // The note links to itself.
+            path = newInfo.canonicalFilePath();
+        }
+        if (!path.isEmpty() && !openFiles.contains(path) &&
+            !files.contains(path)) {
+            files.append(path);
+        }
+    }
+    if (!files.isEmpty()) {
+        linkRewriter->start(files, oldName, newName, filter);
+    }
+}
+
+void MainWindow::onLinkRewriteFinished(int updated,
+                                       const QStringList& errors) {
+    const QString message = tr("Updated links in %1 notes.").arg(updated);
+    if (errors.isEmpty()) {
+        statusBar()->showMessage(message, 5000);
+        return;
+    }
+    QMessageBox::warning(this, tr("Link Update Failed"),
+                         message + "\n\n" + errors.mid(0, 10).join("\n"));
+}
+
 void MainWindow::onEditorFileRenameRequested(const QString& filePath) {
     QFileInfo fileInfo(filePath);
     if (!fileInfo.exists() || !fileInfo.isFile()) {
@@ -340,20 +298,9 @@ void MainWindow::onEditorFileRenameRequested(const QString& filePath) {
         return;
     }
 
-    // Update links in all open tabs
-    for (int i = 0; i < tabWidget->count(); ++i) {
-        TabEditor* tab = qobject_cast<TabEditor*>(tabWidget->widget(i));
-        if (tab && tab->editor()) {
-            updateLinksInDocument(tab->editor()->document(), oldName, newName);
-        }
-    }
-
+    // Updates the links to it too; the workspace watcher reindexes both.
     onFileRenamed(filePath, newPath);
 
-    if (!currentFolder.isEmpty()) {
-        buildLinkIndexAsync();
-    }
-
     statusBar()->showMessage(tr("File renamed to: %1").arg(newName), 3000);
 }
 
@@ -10,12 +10,21 @@
 #include <QTimer>
 #include <QtConcurrent/QtConcurrent>
 
+#include "batchexporter.h"
 #include "defs.h"
+#include "externaltools.h"
 #include "filesystemtreeview.h"
+#include "htmlexporter.h"
 #include "linkparser.h"
+#include "linkrewriter.h"
+#include "markdowneditor.h"
+#include "ngramindexer.h"
 #include "markdownpreview.h"
 #include "navigationhistory.h"
+#include "pdfexporter.h"
+#include "previewscheduler.h"
 #include "tabeditor.h"
+#include "workspacecatalog.h"
 
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent),
@@ -82,9 +91,37 @@ MainWindow::MainWindow(QWidget* parent)
       preFocusModePreviewVisible(true),
       preFocusModeSidebarVisible(true) {
     settings = new QSettings(APP_LABEL, APP_LABEL, this);
+    linkIndexPool.setMaxThreadCount(1);
+    // Before linkParser, which its rewrites resolve links with: children
+    // are deleted in the order they were created.
+    linkRewriter = new LinkRewriter(this);
+    connect(linkRewriter, &LinkRewriter::finished, this,
+            &MainWindow::onLinkRewriteFinished);
     linkParser = new LinkParser(this);
     connect(linkParser, &LinkParser::indexBuildCompleted, this,
             &MainWindow::updateBacklinks);
+    predictionIndexer = new NgramIndexer(this);
+    connect(predictionIndexer, &NgramIndexer::modelChanged, this, [this]() {
+        for (int i = 0; i < tabWidget->count(); ++i) {
+            TabEditor* tab = qobject_cast<TabEditor*>(tabWidget->widget(i));
+            if (tab) {
+                tab->editor()->setLanguageModel(predictionIndexer->model());
+            }
+        }
+    });
+
+    workspaceCatalog = new WorkspaceCatalog(this);
+    workspaceWatcher = new WorkspaceWatcher(this);
+    connect(workspaceWatcher, &WorkspaceWatcher::changesReady, this,
+            &MainWindow::onWorkspaceChanged);
+    connect(workspaceWatcher, &WorkspaceWatcher::watchLimitReached, this,
+            [this](int watchedDirectories) {
+                statusBar()->showMessage(
+                    tr("Only %1 folders of the workspace are watched for "
+                       "changes; the system allows no more.")
+                        .arg(watchedDirectories),
+                    10000);
+            });
 
     setWindowTitle("TreeMk - Markdown Editor");
     setWindowIcon(QIcon::fromTheme("text-editor"));
@@ -98,11 +135,32 @@ MainWindow::MainWindow(QWidget* parent)
     autoSaveTimer = new QTimer(this);
     connect(autoSaveTimer, &QTimer::timeout, this, &MainWindow::autoSave);
 
-    previewUpdateTimer = new QTimer(this);
-    previewUpdateTimer->setSingleShot(true);
-    connect(previewUpdateTimer, &QTimer::timeout, this,
+    previewScheduler = new PreviewScheduler(this);
+    connect(previewScheduler, &PreviewScheduler::renderDue, this,
             &MainWindow::updatePreview);
 
+    htmlExporter = new HtmlExporter(this);
+    connect(htmlExporter, &HtmlExporter::progressChanged, this,
+            &MainWindow::showExportProgress);
+    connect(htmlExporter, &HtmlExporter::finished, this,
+            &MainWindow::onExportFinished);
+
+    pdfExporter = new PdfExporter(this);
+    connect(pdfExporter, &PdfExporter::progressChanged, this,
+            &MainWindow::showExportProgress);
+    connect(pdfExporter, &PdfExporter::finished, this,
+            &MainWindow::onExportFinished);
+
+    batchExporter = new BatchExporter(this);
+    connect(batchExporter, &BatchExporter::progressChanged, this,
+            &MainWindow::showExportProgress);
+    connect(batchExporter, &BatchExporter::finished, this,
+            &MainWindow::onBatchExportFinished);
+
+    docxExportJob = 0;
+    connect(ExternalTools::instance(), &ExternalTools::runningJobsChanged,
+            this, &MainWindow::showExternalToolJobs);
+
     createLayout();
     createActions();
     createAIAssistMenu();
@@ -150,7 +208,62 @@ int MainWindow::getLinkSearchDepth() const {
 
 void MainWindow::buildLinkIndexAsync() {
     int depth = getLinkSearchDepth();
-    auto future = QtConcurrent::run(
-        [this, depth]() { linkParser->buildLinkIndex(currentFolder, depth); });
+    const QString folder = currentFolder;
+    auto future = QtConcurrent::run(&linkIndexPool, [this, folder, depth]() {
+        linkParser->buildLinkIndex(folder, depth);
+    });
+    Q_UNUSED(future);
+
+    updatePredictionModel();
+    if (sharedPreview) {
+        sharedPreview->setWorkspacePath(currentFolder);
+    }
+    // Lists the files for Quick Open in the background.
+    workspaceCatalog->setRootPath(currentFolder);
+    // Keeps all of them up to date from here on.
+    workspaceWatcher->setRootPath(currentFolder);
+}
+
+void MainWindow::updatePredictionModel() {
+    // The prediction model covers the same workspace; it only rebuilds
+    // if a markdown file changed since it was last written. With word
+    // prediction off there is no workspace, so no model is kept or
+    // built, and scheduled refreshes do nothing.
+    const bool enabled =
+        settings->value("editor/enableWordPrediction", true).toBool();
+    predictionIndexer->setWorkspace(enabled ? currentFolder : QString());
+}
+
+void MainWindow::onWorkspaceChanged(const WorkspaceChangeSet& changes) {
+    workspaceCatalog->applyChanges(changes);
+
+    auto future = QtConcurrent::run(&linkIndexPool, [this, changes]() {
+        linkParser->applyChanges(changes);
+    });
     Q_UNUSED(future);
+
+    // Open notes count the notes next to them for word prediction.
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        TabEditor* tab = qobject_cast<TabEditor*>(tabWidget->widget(i));
+        if (!tab || !tab->editor()) {
+            continue;
+        }
+        for (const WorkspaceChange& change : changes) {
+            if (change.isDir) {
+                continue;
+            }
+            tab->editor()->refreshPredictionFile(change.path);
+            if (change.type == WorkspaceChange::Renamed) {
+                tab->editor()->refreshPredictionFile(change.oldPath);
+            }
+        }
+    }
+
+    for (const WorkspaceChange& change : changes) {
+        const QString suffix = QFileInfo(change.path).suffix().toLower();
+        if (change.isDir || suffix == "md" || suffix == "markdown") {
+            predictionIndexer->scheduleRefresh();
+            break;
+        }
+    }
 }
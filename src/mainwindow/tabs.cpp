@@ -10,7 +10,9 @@
 #include "markdownhighlighter.h"
 #include "markdownpreview.h"
 #include "navigationhistory.h"
+#include "ngramindexer.h"
 #include "outlinepanel.h"
+#include "previewscheduler.h"
 #include "tabeditor.h"
 #include "thememanager.h"
 
@@ -22,6 +24,7 @@ TabEditor* MainWindow::createNewTab() {
     TabEditor* tab = new TabEditor(this);
 
     tab->setSharedPreview(sharedPreview);
+    tab->editor()->setLanguageModel(predictionIndexer->model());
 
     QString fontFamily =
         settings->value("editor/font", "Sans Serif").toString();
@@ -76,12 +79,16 @@ TabEditor* MainWindow::createNewTab() {
 
     connect(tab->editor(), &MarkdownEditor::textChanged, this, [this]() {
         TabEditor* currentTab = currentTabEditor();
-        if (currentTab && outlineView) {
+        if (currentTab && outlineView &&
+            !currentTab->editor()->isLargeFileMode()) {
             QString markdown = currentTab->editor()->toPlainText();
             outlineView->updateOutline(markdown);
         }
     });
 
+    connect(tab, &TabEditor::documentModified, this,
+            &MainWindow::onDocumentModified);
+
     connect(tab, &TabEditor::modificationChanged, this,
             [this, tab](bool modified) {
                 int index = tabWidget->indexOf(tab);
@@ -147,6 +154,9 @@ void MainWindow::onTabChanged(int index) {
     if (tab) {
         currentFilePath = tab->filePath();
 
+        // The new tab renders now; a render scheduled for the previous
+        // one would only show this tab again.
+        previewScheduler->cancel();
         tab->updatePreviewContent(sharedPreview);
 
         updateBacklinks();
@@ -6,6 +6,7 @@
 #include <QListWidget>
 #include <QMenu>
 #include <QMenuBar>
+#include <QProgressBar>
 #include <QScrollBar>
 #include <QSplitter>
 #include <QStatusBar>
@@ -29,7 +30,9 @@
 #include "markdowneditor.h"
 #include "markdownhighlighter.h"
 #include "markdownpreview.h"
+#include "ngramindexer.h"
 #include "outlinepanel.h"
+#include "previewscheduler.h"
 #include "settingsdialog.h"
 #include "shortcutsdialog.h"
 #include "sidebarpanel.h"
@@ -54,6 +57,8 @@ void MainWindow::createMenus() {
     exportMenu->addAction(exportPdfAction);
     exportMenu->addAction(exportDocxAction);
     exportMenu->addAction(exportPlainTextAction);
+    exportMenu->addSeparator();
+    exportMenu->addAction(exportFolderHtmlAction);
     fileMenu->addSeparator();
     fileMenu->addAction(closeTabAction);
     fileMenu->addAction(closeAllTabsAction);
@@ -257,6 +262,12 @@ void MainWindow::createLayout() {
             &MainWindow::onFileDoubleClicked);
     connect(treeView, &FileSystemTreeView::fileOpenInNewTabRequested, this,
             [this](const QString& filePath) { loadFile(filePath, true); });
+    treeView->setWorkspaceWatcher(workspaceWatcher);
+    connect(treeView->fileOperationQueue(),
+            &FileOperationQueue::progressChanged, this,
+            &MainWindow::showFileOperationProgress);
+    connect(treeView->fileOperationQueue(), &FileOperationQueue::busyChanged,
+            this, &MainWindow::onFileOperationsBusyChanged);
     connect(treeView, &FileSystemTreeView::fileModifiedExternally, this,
             &MainWindow::onFileModifiedExternally);
     connect(treeView, &FileSystemTreeView::folderChanged, this,
@@ -361,6 +372,15 @@ void MainWindow::createLayout() {
             this, &MainWindow::onOpenLinkInNewTab);
     connect(sharedPreview, &MarkdownPreview::internalLinkClicked, this,
             &MainWindow::onInternalLinkClicked);
+    connect(sharedPreview, &MarkdownPreview::renderFinished, previewScheduler,
+            &PreviewScheduler::recordRenderTime);
+    connect(sharedPreview, &MarkdownPreview::sourceLineScrolled, this,
+            [this](double line) {
+                TabEditor* tab = currentTabEditor();
+                if (tab) {
+                    tab->setEditorLineFromPreview(line);
+                }
+            });
     
     editorPreviewSplitter = new QSplitter(Qt::Horizontal, this);
     editorPreviewSplitter->addWidget(tabWidget);
@@ -582,6 +602,13 @@ void MainWindow::applySettings() {
             tab->editor()->setPredictionEnabled(wordPredictionEnabled);
         }
     }
+    // Picks up a changed model budget or word prediction being turned
+    // on or off; an unchanged workspace only costs a directory scan.
+    updatePredictionModel();
+    // The preview caches its page styles, custom stylesheet included.
+    if (sharedPreview) {
+        sharedPreview->reloadStyles();
+    }
     if (settings->value("autoSaveEnabled", true).toBool()) {
         int interval = settings->value("autoSaveInterval", 60).toInt();
         if (autoSaveTimer) {
@@ -678,14 +705,14 @@ void MainWindow::applySettings() {
             tab->editor()->setFont(font);
             tab->editor()->setTabStopDistance(
                 QFontMetrics(font).horizontalAdvance(' ') * tabWidth);
-            tab->editor()->setLineWrapMode(wordWrap ? QTextEdit::WidgetWidth
-                                                    : QTextEdit::NoWrap);
+            if (!tab->editor()->isLargeFileMode()) {
+                tab->editor()->setLineWrapMode(
+                    wordWrap ? QTextEdit::WidgetWidth : QTextEdit::NoWrap);
+            }
         }
     }
     int refreshRate = settings->value("preview/refreshRate", 500).toInt();
-    if (previewUpdateTimer) {
-        previewUpdateTimer->setInterval(refreshRate);
-    }
+    previewScheduler->setMinimumInterval(refreshRate);
 }
 
 void MainWindow::showKeyboardShortcuts() {
@@ -15,6 +15,7 @@
 #include "managers/windowmanager.h"
 #include "markdowneditor.h"
 #include "markdownpreview.h"
+#include "previewscheduler.h"
 #include "sidebarpanel.h"
 #include "tabeditor.h"
 
@@ -334,5 +335,9 @@ void MainWindow::onDocumentModified() {
     TabEditor* tab = currentTabEditor();
     if (!tab) return;
 
-    updatePreview();
+    // Large documents are rendered on load and on tab switches only;
+    // re-rendering them after every pause in typing would stall the UI.
+    if (tab->editor()->isLargeFileMode()) return;
+
+    previewScheduler->schedule(tab->documentId());
 }
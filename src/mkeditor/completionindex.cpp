@@ -0,0 +1,258 @@
+#include "completionindex.h"
+
+#include <algorithm>
+
+namespace {
+
+struct FollowerEntry {
+    int previous;
+    int next;
+    int frequency;
+
+    bool operator<(const FollowerEntry& other) const {
+        return previous != other.previous ? previous < other.previous
+                                          : next < other.next;
+    }
+};
+
+}  // namespace
+
+CompletionIndex::CompletionIndex(
+    const QHash<QString, int>& wordFrequency,
+    const QHash<QPair<QString, QString>, int>& bigramFrequency) {
+    m_words.reserve(wordFrequency.size());
+    for (auto it = wordFrequency.constBegin(); it != wordFrequency.constEnd();
+         ++it) {
+        if (it.value() > 0 && !it.key().isEmpty()) {
+            m_words.append(it.key());
+        }
+    }
+    std::sort(m_words.begin(), m_words.end());
+
+    const int wordTotal = m_words.size();
+    QHash<QString, int> ids;
+    ids.reserve(wordTotal);
+    m_frequencies.resize(wordTotal);
+    for (int i = 0; i < wordTotal; ++i) {
+        ids.insert(m_words[i], i);
+        m_frequencies[i] = wordFrequency.value(m_words[i]);
+    }
+
+    // Build the trie breadth first so the children of every node end up
+    // next to each other in the edge arrays. Each node covers the range
+    // of sorted words that share its prefix.
+    struct PendingNode {
+        int node;
+        int depth;
+    };
+
+    Node root;
+    root.endWord = wordTotal;
+    m_nodes.append(root);
+
+    QVector<PendingNode> queue;
+    queue.append({0, 0});
+    for (int q = 0; q < queue.size(); ++q) {
+        const int nodeIndex = queue[q].node;
+        const int depth = queue[q].depth;
+        int first = m_nodes[nodeIndex].firstWord;
+        const int end = m_nodes[nodeIndex].endWord;
+
+        if (first < end && m_words[first].length() == depth) {
+            m_nodes[nodeIndex].terminal = first;
+            ++first;
+        }
+
+        m_nodes[nodeIndex].firstEdge = m_edgeLabels.size();
+        while (first < end) {
+            const QChar label = m_words[first].at(depth);
+            int groupEnd = first + 1;
+            while (groupEnd < end && m_words[groupEnd].at(depth) == label) {
+                ++groupEnd;
+            }
+
+            Node child;
+            child.firstWord = first;
+            child.endWord = groupEnd;
+            m_edgeLabels.append(label);
+            m_edgeTargets.append(m_nodes.size());
+            queue.append({static_cast<int>(m_nodes.size()), depth + 1});
+            m_nodes.append(child);
+
+            first = groupEnd;
+        }
+        m_nodes[nodeIndex].edgeCount =
+            m_edgeLabels.size() - m_nodes[nodeIndex].firstEdge;
+    }
+
+    // Children always come after their parent, so walking backwards
+    // resolves every subtree before the node above it.
+    for (int i = m_nodes.size() - 1; i >= 0; --i) {
+        Node& node = m_nodes[i];
+        int best = -1;
+        for (int e = node.firstEdge; e < node.firstEdge + node.edgeCount;
+             ++e) {
+            const Node& child = m_nodes[m_edgeTargets[e]];
+            int childBest =
+                isBetter(child.terminal, child.best) ? child.terminal
+                                                     : child.best;
+            if (isBetter(childBest, best)) {
+                best = childBest;
+            }
+        }
+        node.best = best;
+    }
+
+    QVector<FollowerEntry> entries;
+    entries.reserve(bigramFrequency.size());
+    for (auto it = bigramFrequency.constBegin();
+         it != bigramFrequency.constEnd(); ++it) {
+        int previous = ids.value(it.key().first, -1);
+        int next = ids.value(it.key().second, -1);
+        if (previous >= 0 && next >= 0 && it.value() > 0) {
+            entries.append({previous, next, it.value()});
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+
+    m_followerOffsets.fill(0, wordTotal + 1);
+    m_followers.reserve(entries.size());
+    m_followerFrequencies.reserve(entries.size());
+    for (const FollowerEntry& entry : entries) {
+        m_followerOffsets[entry.previous + 1]++;
+        m_followers.append(entry.next);
+        m_followerFrequencies.append(entry.frequency);
+    }
+    for (int i = 0; i < wordTotal; ++i) {
+        m_followerOffsets[i + 1] += m_followerOffsets[i];
+    }
+
+    const int followerTotal = m_followers.size();
+    m_bestFollowers.resize(2 * followerTotal);
+    for (int i = 0; i < followerTotal; ++i) {
+        m_bestFollowers[followerTotal + i] = i;
+    }
+    for (int i = followerTotal - 1; i > 0; --i) {
+        m_bestFollowers[i] =
+            betterFollower(m_bestFollowers[2 * i], m_bestFollowers[2 * i + 1]);
+    }
+}
+
+bool CompletionIndex::isBetter(int candidate, int current) const {
+    if (candidate < 0) {
+        return false;
+    }
+    if (current < 0) {
+        return true;
+    }
+    // Ids are alphabetical ranks, so the lower id wins a tie.
+    return m_frequencies[candidate] > m_frequencies[current] ||
+           (m_frequencies[candidate] == m_frequencies[current] &&
+            candidate < current);
+}
+
+int CompletionIndex::betterFollower(int a, int b) const {
+    if (a < 0) {
+        return b;
+    }
+    if (b < 0) {
+        return a;
+    }
+    const int frequencyA = m_followerFrequencies[a];
+    const int frequencyB = m_followerFrequencies[b];
+    if (frequencyA != frequencyB) {
+        return frequencyA > frequencyB ? a : b;
+    }
+    return qMin(a, b);
+}
+
+int CompletionIndex::bestFollower(int begin, int end) const {
+    const int size = m_followers.size();
+    int best = -1;
+    for (int low = begin + size, high = end + size; low < high;
+         low /= 2, high /= 2) {
+        if (low & 1) {
+            best = betterFollower(best, m_bestFollowers[low++]);
+        }
+        if (high & 1) {
+            best = betterFollower(best, m_bestFollowers[--high]);
+        }
+    }
+    return best;
+}
+
+int CompletionIndex::findNode(const QString& prefix) const {
+    if (m_nodes.isEmpty()) {
+        return -1;
+    }
+
+    int nodeIndex = 0;
+    for (const QChar c : prefix) {
+        const Node& node = m_nodes[nodeIndex];
+        auto begin = m_edgeLabels.constBegin() + node.firstEdge;
+        auto end = begin + node.edgeCount;
+        auto it = std::lower_bound(begin, end, c);
+        if (it == end || *it != c) {
+            return -1;
+        }
+        nodeIndex = m_edgeTargets[it - m_edgeLabels.constBegin()];
+    }
+    return nodeIndex;
+}
+
+int CompletionIndex::wordId(const QString& word) const {
+    int nodeIndex = findNode(word);
+    return nodeIndex < 0 ? -1 : m_nodes[nodeIndex].terminal;
+}
+
+QString CompletionIndex::word(int id) const {
+    return id >= 0 && id < m_words.size() ? m_words[id] : QString();
+}
+
+int CompletionIndex::frequency(int id) const {
+    return id >= 0 && id < m_frequencies.size() ? m_frequencies[id] : 0;
+}
+
+int CompletionIndex::bigramFrequency(int previousId, int id) const {
+    if (previousId < 0 || previousId >= m_words.size()) {
+        return 0;
+    }
+
+    auto begin = m_followers.constBegin() + m_followerOffsets[previousId];
+    auto end = m_followers.constBegin() + m_followerOffsets[previousId + 1];
+    auto it = std::lower_bound(begin, end, id);
+    if (it == end || *it != id) {
+        return 0;
+    }
+    return m_followerFrequencies[it - m_followers.constBegin()];
+}
+
+int CompletionIndex::complete(const QString& prefix) const {
+    int nodeIndex = findNode(prefix);
+    return nodeIndex < 0 ? -1 : m_nodes[nodeIndex].best;
+}
+
+int CompletionIndex::completeAfter(int previousId,
+                                   const QString& prefix) const {
+    if (previousId < 0 || previousId >= m_words.size()) {
+        return -1;
+    }
+    int nodeIndex = findNode(prefix);
+    if (nodeIndex < 0) {
+        return -1;
+    }
+    const Node& node = m_nodes[nodeIndex];
+
+    // Followers are sorted by id, and the words sharing the prefix form
+    // the id range of the node, so the matching followers are one slice.
+    // The prefix itself sorts first in that range and is left out.
+    const int firstWord =
+        node.terminal >= 0 ? node.terminal + 1 : node.firstWord;
+    auto begin = m_followers.constBegin() + m_followerOffsets[previousId];
+    auto end = m_followers.constBegin() + m_followerOffsets[previousId + 1];
+    auto first = std::lower_bound(begin, end, firstWord);
+    auto last = std::lower_bound(first, end, node.endWord);
+    const int best = bestFollower(first - m_followers.constBegin(),
+                                  last - m_followers.constBegin());
+    return best < 0 ? -1 : m_followers[best];
+}
@@ -1,6 +1,7 @@
 #include "markdowneditor.h"
 #include "colorpalette.h"
 
+#include <QAbstractTextDocumentLayout>
 #include <QApplication>
 #include <QClipboard>
 #include <QContextMenuEvent>
@@ -21,6 +22,7 @@
 #include <QMimeData>
 #include <QMouseEvent>
 #include <QPainter>
+#include <QPlainTextEdit>
 #include <QRegularExpression>
 #include <QScrollBar>
 #include <QSettings>
@@ -42,11 +44,15 @@
 
 MarkdownEditor::MarkdownEditor(QWidget* parent)
     : QTextEdit(parent), 
+      m_predictionBlockNumber(-1),
+      m_predictionPendingEdits(0),
       m_predictionEnabled(true), 
       m_aiAssistEnabled(true), 
       m_lineNumbersVisible(true),
       m_focusModeEnabled(false),
-      m_focusModeMaxWidth(900) {
+      m_focusModeMaxWidth(900),
+      m_largeFileMode(false),
+      m_largeFileView(nullptr) {
     lineNumberArea = new LineNumberArea(this);
     m_highlighter = new MarkdownHighlighter(document());
     m_wordPredictor = std::make_unique<WordPredictor>();
@@ -57,6 +63,12 @@ MarkdownEditor::MarkdownEditor(QWidget* parent)
     connect(m_formatTimer, &QTimer::timeout, this,
             &MarkdownEditor::applyDeferredFormatting);
 
+    m_visibleHighlightTimer = new QTimer(this);
+    m_visibleHighlightTimer->setSingleShot(true);
+    m_visibleHighlightTimer->setInterval(30);
+    connect(m_visibleHighlightTimer, &QTimer::timeout, this,
+            &MarkdownEditor::updateVisibleHighlighting);
+
     setupEditor();
 
     setMouseTracking(true);
@@ -64,10 +76,20 @@ MarkdownEditor::MarkdownEditor(QWidget* parent)
 
     connect(document(), &QTextDocument::blockCountChanged, this,
             &MarkdownEditor::updateLineNumberAreaWidth);
+    // Also sees pastes, which run with the editor's signals blocked.
+    connect(document(), &QTextDocument::contentsChange, this,
+            &MarkdownEditor::onPredictionContentsChange);
     connect(this, &QTextEdit::cursorPositionChanged, this,
             &MarkdownEditor::highlightCurrentLine);
+    connect(this, &QTextEdit::cursorPositionChanged, this,
+            &MarkdownEditor::onCursorBlockChanged);
     connect(this, &QTextEdit::textChanged, this,
             &MarkdownEditor::onTextChanged);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, lineNumberArea,
+            [this](int) {
+                lineNumberArea->update();
+                emit scrolled();
+            });
 
     updateLineNumberAreaWidth(0);
     highlightCurrentLine();
@@ -90,7 +112,11 @@ MarkdownEditor::MarkdownEditor(QWidget* parent)
     m_aiAssistEnabled = settings.value("ai/enabled", true).toBool();
 }
 
-MarkdownEditor::~MarkdownEditor() = default;
+MarkdownEditor::~MarkdownEditor() {
+    // The view goes before the document it shows, which is a child of
+    // this editor in large-file mode.
+    delete m_largeFileView;
+}
 
 void MarkdownEditor::onThemeChanged() {
     if (ThemeManager::instance()) {
@@ -117,17 +143,323 @@ void MarkdownEditor::setModified(bool modified) {
     document()->setModified(modified);
 }
 
+QTextDocument* MarkdownEditor::document() const {
+    return m_largeFileView ? m_largeFileView->document()
+                           : QTextEdit::document();
+}
+
+QTextCursor MarkdownEditor::textCursor() const {
+    return m_largeFileView ? m_largeFileView->textCursor()
+                           : QTextEdit::textCursor();
+}
+
+void MarkdownEditor::setTextCursor(const QTextCursor& cursor) {
+    if (m_largeFileView) {
+        m_largeFileView->setTextCursor(cursor);
+    } else {
+        QTextEdit::setTextCursor(cursor);
+    }
+}
+
+QString MarkdownEditor::toPlainText() const {
+    return m_largeFileView ? m_largeFileView->toPlainText()
+                           : QTextEdit::toPlainText();
+}
+
+void MarkdownEditor::setPlainText(const QString& text) {
+    if (m_largeFileView) {
+        m_largeFileView->setPlainText(text);
+    } else {
+        QTextEdit::setPlainText(text);
+    }
+}
+
+void MarkdownEditor::insertPlainText(const QString& text) {
+    if (m_largeFileView) {
+        m_largeFileView->insertPlainText(text);
+    } else {
+        QTextEdit::insertPlainText(text);
+    }
+}
+
+void MarkdownEditor::selectAll() {
+    if (m_largeFileView) {
+        m_largeFileView->selectAll();
+    } else {
+        QTextEdit::selectAll();
+    }
+}
+
+void MarkdownEditor::undo() {
+    if (m_largeFileView) {
+        m_largeFileView->undo();
+    } else {
+        QTextEdit::undo();
+    }
+}
+
+void MarkdownEditor::redo() {
+    if (m_largeFileView) {
+        m_largeFileView->redo();
+    } else {
+        QTextEdit::redo();
+    }
+}
+
+void MarkdownEditor::cut() {
+    if (m_largeFileView) {
+        m_largeFileView->cut();
+    } else {
+        QTextEdit::cut();
+    }
+}
+
+void MarkdownEditor::copy() {
+    if (m_largeFileView) {
+        m_largeFileView->copy();
+    } else {
+        QTextEdit::copy();
+    }
+}
+
+void MarkdownEditor::paste() {
+    if (m_largeFileView) {
+        m_largeFileView->paste();
+    } else {
+        QTextEdit::paste();
+    }
+}
+
+QTextCursor MarkdownEditor::cursorForPosition(const QPoint& pos) const {
+    return m_largeFileView ? m_largeFileView->cursorForPosition(pos)
+                           : QTextEdit::cursorForPosition(pos);
+}
+
+void MarkdownEditor::ensureCursorVisible() {
+    if (m_largeFileView) {
+        m_largeFileView->ensureCursorVisible();
+    } else {
+        QTextEdit::ensureCursorVisible();
+    }
+}
+
+QWidget* MarkdownEditor::viewport() const {
+    return m_largeFileView ? m_largeFileView->viewport()
+                           : QTextEdit::viewport();
+}
+
+QScrollBar* MarkdownEditor::verticalScrollBar() const {
+    return m_largeFileView ? m_largeFileView->verticalScrollBar()
+                           : QTextEdit::verticalScrollBar();
+}
+
+void MarkdownEditor::setTabStopDistance(qreal distance) {
+    QTextEdit::setTabStopDistance(distance);
+    if (m_largeFileView) {
+        m_largeFileView->setTabStopDistance(distance);
+    }
+}
+
+double MarkdownEditor::topSourceLine() const {
+    if (m_largeFileView) {
+        // Without wrapping the view scrolls by whole lines, one per
+        // block.
+        return m_largeFileView->firstVisibleBlock().blockNumber() + 1;
+    }
+
+    // Plain text has one block per line, and the scroll bar counts
+    // pixels of the laid out document.
+    QTextDocument* doc = document();
+    const double top = verticalScrollBar()->value();
+    const int position =
+        doc->documentLayout()->hitTest(QPointF(0, top), Qt::FuzzyHit);
+    const QTextBlock block = doc->findBlock(qMax(0, position));
+    if (!block.isValid()) {
+        return 0.0;
+    }
+    const QRectF rect = doc->documentLayout()->blockBoundingRect(block);
+    double fraction = 0.0;
+    if (rect.height() > 0) {
+        fraction = qBound(0.0, (top - rect.top()) / rect.height(), 1.0);
+    }
+    return block.blockNumber() + 1 + fraction;
+}
+
+void MarkdownEditor::scrollToSourceLine(double line) {
+    QTextDocument* doc = document();
+    const QTextBlock block =
+        doc->findBlockByNumber(static_cast<int>(line) - 1);
+    if (!block.isValid()) {
+        return;
+    }
+    if (m_largeFileView) {
+        // The view's scroll bar counts lines.
+        verticalScrollBar()->setValue(block.blockNumber());
+        return;
+    }
+
+    const QRectF rect = doc->documentLayout()->blockBoundingRect(block);
+    const double fraction = line - static_cast<int>(line);
+    verticalScrollBar()->setValue(
+        static_cast<int>(rect.top() + fraction * rect.height()));
+}
+
 void MarkdownEditor::setPredictionEnabled(bool enabled) {
+    if (m_predictionEnabled == enabled) {
+        return;
+    }
     m_predictionEnabled = enabled;
     if (!enabled) {
+        m_predictionBlocks.clear();
         hidePrediction();
+    } else {
+        syncWordPredictor();
     }
 }
 
+void MarkdownEditor::setLanguageModel(
+    std::shared_ptr<const NgramModel> model) {
+    m_wordPredictor->setLanguageModel(std::move(model));
+}
+
 void MarkdownEditor::setAIAssistEnabled(bool enabled) {
     m_aiAssistEnabled = enabled;
 }
 
+void MarkdownEditor::setLargeFileMode(bool enabled) {
+    if (m_largeFileMode == enabled) {
+        return;
+    }
+    m_largeFileMode = enabled;
+
+    if (enabled) {
+        hidePrediction();
+        m_predictionBlocks.clear();
+        m_wordPredictor->clear();
+        if (m_highlighter) {
+            m_highlighter->setLazyHighlighting(true);
+        }
+        showLargeFileView();
+        m_visibleHighlightTimer->start();
+    } else {
+        m_visibleHighlightTimer->stop();
+        hideLargeFileView();
+        if (m_highlighter) {
+            m_highlighter->setLazyHighlighting(false);
+        }
+    }
+
+    updateLineNumberAreaWidth(0);
+    highlightCurrentLine();
+    emit undoAvailable(document()->isUndoAvailable());
+    emit redoAvailable(document()->isRedoAvailable());
+    emit copyAvailable(textCursor().hasSelection());
+}
+
+void MarkdownEditor::showLargeFileView() {
+    // QTextEdit lays out every block of the document before it can
+    // scroll; QPlainTextDocumentLayout only lays out the blocks on
+    // screen. The document moves to a view with that layout, taking its
+    // cursor, undo history and highlighter along, and this editor keeps
+    // an empty document behind the view.
+    QTextDocument* doc = QTextEdit::document();
+    const QTextCursor cursor = QTextEdit::textCursor();
+    const bool focused = hasFocus();
+    doc->setParent(this);
+    QTextEdit::setDocument(new QTextDocument(this));
+    doc->setDocumentLayout(new QPlainTextDocumentLayout(doc));
+
+    m_largeFileView = new LargeFileView(this);
+    m_largeFileView->setDocument(doc);
+    m_largeFileView->setLineWrapMode(QPlainTextEdit::NoWrap);
+    m_largeFileView->setFrameShape(QFrame::NoFrame);
+    m_largeFileView->setTabStopDistance(tabStopDistance());
+    m_largeFileView->setMouseTracking(true);
+    m_largeFileView->viewport()->setMouseTracking(true);
+    m_largeFileView->setTextCursor(cursor);
+
+    connect(m_largeFileView, &QPlainTextEdit::textChanged, this,
+            &QTextEdit::textChanged);
+    connect(m_largeFileView, &QPlainTextEdit::cursorPositionChanged, this,
+            &QTextEdit::cursorPositionChanged);
+    connect(m_largeFileView, &QPlainTextEdit::selectionChanged, this,
+            &QTextEdit::selectionChanged);
+    connect(m_largeFileView, &QPlainTextEdit::copyAvailable, this,
+            &QTextEdit::copyAvailable);
+    connect(m_largeFileView, &QPlainTextEdit::undoAvailable, this,
+            &QTextEdit::undoAvailable);
+    connect(m_largeFileView, &QPlainTextEdit::redoAvailable, this,
+            &QTextEdit::redoAvailable);
+    connect(m_largeFileView, &QPlainTextEdit::updateRequest, this,
+            &MarkdownEditor::updateLineNumberArea);
+    connect(m_largeFileView->verticalScrollBar(), &QScrollBar::valueChanged,
+            this, [this](int) {
+                m_visibleHighlightTimer->start();
+                emit scrolled();
+            });
+
+    setFocusProxy(m_largeFileView);
+    m_largeFileView->show();
+    if (focused) {
+        m_largeFileView->setFocus();
+    }
+}
+
+void MarkdownEditor::hideLargeFileView() {
+    // The document comes back with its text, cursor and undo history.
+    // Without the plain layout it gets QTextEdit's own layout again,
+    // which lays it out afresh.
+    QTextDocument* doc = m_largeFileView->document();
+    const QTextCursor cursor = m_largeFileView->textCursor();
+    const bool focused = m_largeFileView->hasFocus();
+    setFocusProxy(nullptr);
+    delete m_largeFileView;
+    m_largeFileView = nullptr;
+
+    QTextDocument* emptyDocument = QTextEdit::document();
+    doc->setDocumentLayout(nullptr);
+    QTextEdit::setDocument(doc);
+    delete emptyDocument;
+    setTextCursor(cursor);
+    if (focused) {
+        setFocus();
+    }
+}
+
+void MarkdownEditor::updateVisibleHighlighting() {
+    if (!m_largeFileView || !m_highlighter) {
+        return;
+    }
+
+    QTextBlock first = m_largeFileView->cursorForPosition(QPoint(0, 0)).block();
+    QTextBlock last =
+        m_largeFileView
+            ->cursorForPosition(
+                QPoint(0, m_largeFileView->viewport()->height()))
+            .block();
+    if (!first.isValid()) {
+        return;
+    }
+    if (!last.isValid()) {
+        last = document()->lastBlock();
+    }
+
+    // Keep one extra screen formatted on each side so short scrolls land
+    // on text that is already highlighted.
+    int visibleCount = last.blockNumber() - first.blockNumber() + 1;
+    int firstNumber = qMax(0, first.blockNumber() - visibleCount);
+    int lastNumber = last.blockNumber() + visibleCount;
+    m_highlighter->setVisibleBlockRange(firstNumber, lastNumber);
+
+    QTextBlock block = document()->findBlockByNumber(firstNumber);
+    while (block.isValid() && block.blockNumber() <= lastNumber) {
+        if (!block.userData()) {
+            m_highlighter->rehighlightBlock(block);
+        }
+        block = block.next();
+    }
+}
+
 MarkdownHighlighter* MarkdownEditor::getHighlighter() const {
     return m_highlighter;
 }
@@ -177,7 +509,11 @@ void MarkdownEditor::mousePressEvent(QMouseEvent* event) {
         }
     }
 
-    QTextEdit::mousePressEvent(event);
+    if (m_largeFileView) {
+        m_largeFileView->defaultMousePressEvent(event);
+    } else {
+        QTextEdit::mousePressEvent(event);
+    }
 }
 
 void MarkdownEditor::mouseMoveEvent(QMouseEvent* event) {
@@ -190,18 +526,154 @@ void MarkdownEditor::mouseMoveEvent(QMouseEvent* event) {
         viewport()->setCursor(Qt::IBeamCursor);
     }
 
-    QTextEdit::mouseMoveEvent(event);
+    if (m_largeFileView) {
+        m_largeFileView->defaultMouseMoveEvent(event);
+    } else {
+        QTextEdit::mouseMoveEvent(event);
+    }
 }
 
-void MarkdownEditor::updateWordFrequency() {
-    QString text = toPlainText();
-    m_wordPredictor->updateFromText(text);
-    
+void MarkdownEditor::syncWordPredictor() {
+    if (!m_predictionEnabled || m_largeFileMode) {
+        return;
+    }
+
+    m_predictionBlocks.clear();
+    m_predictionBlocks.reserve(document()->blockCount());
+    for (QTextBlock block = document()->begin(); block.isValid();
+         block = block.next()) {
+        m_predictionBlocks.append(block.text());
+    }
+    m_wordPredictor->setDocumentText(m_predictionBlocks.join('\n'));
     if (!m_currentFilePath.isEmpty()) {
         QFileInfo fileInfo(m_currentFilePath);
-        m_wordPredictor->updateFromDirectory(fileInfo.absolutePath(), 
-                                             m_currentFilePath);
+        m_wordPredictor->updateFromDirectory(fileInfo.absolutePath(),
+                                             fileInfo.absoluteFilePath());
+    }
+    resetPredictionParagraph();
+}
+
+void MarkdownEditor::refreshPredictionFile(const QString& filePath) {
+    if (!m_predictionEnabled || m_largeFileMode ||
+        m_currentFilePath.isEmpty()) {
+        return;
+    }
+    const QFileInfo fileInfo(filePath);
+    const QString suffix = fileInfo.suffix().toLower();
+    const QString directory = QFileInfo(m_currentFilePath).absolutePath();
+    if ((suffix != "md" && suffix != "markdown") ||
+        fileInfo.absolutePath() != directory) {
+        return;
+    }
+    m_wordPredictor->refreshFile(filePath);
+}
+
+void MarkdownEditor::resetPredictionParagraph() {
+    m_predictionBlockNumber = textCursor().blockNumber();
+    m_predictionPendingEdits = 0;
+}
+
+void MarkdownEditor::flushPredictionParagraph() {
+    if (m_predictionPendingEdits == 0) {
+        return;
+    }
+    m_predictionPendingEdits = 0;
+
+    const int number = m_predictionBlockNumber;
+    QTextBlock block = document()->findBlockByNumber(number);
+    if (block.isValid() && number < m_predictionBlocks.size()) {
+        applyPredictionBlocks(number, number, QStringList() << block.text());
+    }
+}
+
+void MarkdownEditor::applyPredictionBlocks(int first, int last,
+                                           const QStringList& texts) {
+    const QStringList oldTexts =
+        m_predictionBlocks.mid(first, last - first + 1);
+    if (oldTexts == texts) {
+        return;
+    }
+
+    QString wordBefore;
+    for (int i = first - 1; i >= 0 && wordBefore.isEmpty(); --i) {
+        wordBefore = WordPredictor::lastWord(m_predictionBlocks.at(i));
+    }
+    QString wordAfter;
+    for (int i = last + 1; i < m_predictionBlocks.size() && wordAfter.isEmpty();
+         ++i) {
+        wordAfter = WordPredictor::firstWord(m_predictionBlocks.at(i));
+    }
+    m_wordPredictor->applyParagraphEdit(oldTexts.join('\n'), texts.join('\n'),
+                                        wordBefore, wordAfter);
+
+    if (texts.size() == oldTexts.size()) {
+        for (int i = 0; i < texts.size(); ++i) {
+            m_predictionBlocks[first + i] = texts.at(i);
+        }
+    } else {
+        m_predictionBlocks = m_predictionBlocks.mid(0, first) + texts +
+                             m_predictionBlocks.mid(last + 1);
+    }
+}
+
+void MarkdownEditor::onPredictionContentsChange(int position, int removed,
+                                                int added) {
+    Q_UNUSED(removed);
+    if (!m_predictionEnabled || m_largeFileMode ||
+        m_predictionBlocks.isEmpty()) {
+        return;
+    }
+
+    // Blocks before the change and after it are the same as before, so
+    // the block counts tell which old blocks the new ones replace.
+    QTextDocument* doc = document();
+    const int end = qMin(position + added, doc->characterCount() - 1);
+    const int first = doc->findBlock(position).blockNumber();
+    const int last = doc->findBlock(end).blockNumber();
+    const int oldLast = last + m_predictionBlocks.size() - doc->blockCount();
+    if (first < 0 || last < first || oldLast < first ||
+        oldLast >= m_predictionBlocks.size()) {
+        syncWordPredictor();
+        return;
+    }
+
+    // Typing within one paragraph is handed over in batches.
+    if (first == last && oldLast == first) {
+        if (first != m_predictionBlockNumber) {
+            flushPredictionParagraph();
+            m_predictionBlockNumber = first;
+        }
+        if (++m_predictionPendingEdits >= 10) {
+            flushPredictionParagraph();
+        }
+        return;
+    }
+
+    // New lines, joined lines and pastes: the replaced blocks are
+    // diffed right away, pending typing in them included.
+    if (m_predictionBlockNumber > oldLast) {
+        m_predictionBlockNumber += last - oldLast;
+    } else if (m_predictionBlockNumber >= first) {
+        m_predictionPendingEdits = 0;
+    }
+    QStringList texts;
+    for (QTextBlock block = doc->findBlockByNumber(first);
+         block.isValid() && block.blockNumber() <= last; block = block.next()) {
+        texts.append(block.text());
+    }
+    applyPredictionBlocks(first, oldLast, texts);
+}
+
+void MarkdownEditor::onCursorBlockChanged() {
+    if (!m_predictionEnabled || m_largeFileMode) {
+        return;
     }
+    if (textCursor().blockNumber() == m_predictionBlockNumber) {
+        return;
+    }
+
+    flushPredictionParagraph();
+    resetPredictionParagraph();
 }
 
 void MarkdownEditor::showPrediction() {
@@ -231,8 +703,15 @@ void MarkdownEditor::showPrediction() {
         prevCursor.movePosition(QTextCursor::PreviousWord, QTextCursor::MoveAnchor);
         prevCursor.movePosition(QTextCursor::EndOfWord, QTextCursor::KeepAnchor);
         QString previousWord = prevCursor.selectedText();
-        
-        QString prediction = m_wordPredictor->predict(currentWord, previousWord);
+
+        QTextCursor olderCursor = prevCursor;
+        olderCursor.movePosition(QTextCursor::StartOfWord, QTextCursor::MoveAnchor);
+        olderCursor.movePosition(QTextCursor::PreviousWord, QTextCursor::MoveAnchor);
+        olderCursor.movePosition(QTextCursor::EndOfWord, QTextCursor::KeepAnchor);
+        QString beforePrevious = olderCursor.selectedText();
+
+        QString prediction = m_wordPredictor->predict(currentWord, previousWord,
+                                                      beforePrevious);
         if (!prediction.isEmpty() &&
             prediction.toLower() != currentWord.toLower()) {
             m_currentPrediction = prediction.mid(currentWord.length());
@@ -261,11 +740,10 @@ void MarkdownEditor::acceptPrediction() {
 }
 
 void MarkdownEditor::onTextChanged() {
-    static int changeCount = 0;
-    changeCount++;
-
-    if (changeCount % 10 == 0) {
-        updateWordFrequency();
+    if (m_largeFileMode) {
+        // Prediction is paused in large-file mode, and the plain layout
+        // ignores block indents, so lists get no hanging indent.
+        return;
     }
 
     showPrediction();
@@ -304,7 +782,8 @@ void MarkdownEditor::paintEvent(QPaintEvent* event) {
 }
 
 void MarkdownEditor::contextMenuEvent(QContextMenuEvent* event) {
-    QMenu* menu = createStandardContextMenu();
+    QMenu* menu = m_largeFileView ? m_largeFileView->createStandardContextMenu()
+                                  : createStandardContextMenu();
 
     QTextCursor cursor = cursorForPosition(event->pos());
     int position = cursor.position();
@@ -403,6 +882,8 @@ void MarkdownEditor::contextMenuEvent(QContextMenuEvent* event) {
 void MarkdownEditor::dragEnterEvent(QDragEnterEvent* event) {
     if (event->mimeData()->hasUrls()) {
         event->acceptProposedAction();
+    } else if (m_largeFileView) {
+        m_largeFileView->defaultDragEnterEvent(event);
     } else {
         QTextEdit::dragEnterEvent(event);
     }
@@ -411,6 +892,8 @@ void MarkdownEditor::dragEnterEvent(QDragEnterEvent* event) {
 void MarkdownEditor::dragMoveEvent(QDragMoveEvent* event) {
     if (event->mimeData()->hasUrls()) {
         event->acceptProposedAction();
+    } else if (m_largeFileView) {
+        m_largeFileView->defaultDragMoveEvent(event);
     } else {
         QTextEdit::dragMoveEvent(event);
     }
@@ -480,6 +963,8 @@ void MarkdownEditor::dropEvent(QDropEvent* event) {
             }
         }
         event->acceptProposedAction();
+    } else if (m_largeFileView) {
+        m_largeFileView->defaultDropEvent(event);
     } else {
         QTextEdit::dropEvent(event);
     }
@@ -553,6 +1038,10 @@ void MarkdownEditor::updateLineNumberAreaWidth(int /* newBlockCount */) {
         
         setViewportMargins(leftMargin, 0, rightMargin, 0);
     }
+
+    if (m_largeFileView) {
+        m_largeFileView->setGeometry(QTextEdit::viewport()->geometry());
+    }
 }
 
 void MarkdownEditor::updateLineNumberArea(const QRect& rect, int dy) {
@@ -568,6 +1057,10 @@ void MarkdownEditor::updateLineNumberArea(const QRect& rect, int dy) {
 void MarkdownEditor::resizeEvent(QResizeEvent* e) {
     QTextEdit::resizeEvent(e);
 
+    if (m_largeFileView) {
+        m_visibleHighlightTimer->start();
+    }
+
     QRect cr = contentsRect();
     
     if (m_focusModeEnabled) {
@@ -590,6 +1083,12 @@ void MarkdownEditor::resizeEvent(QResizeEvent* e) {
         lineNumberArea->setGeometry(
             QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
     }
+
+    // The view covers this editor's viewport, next to the line numbers
+    // and inside the focus-mode margins.
+    if (m_largeFileView) {
+        m_largeFileView->setGeometry(QTextEdit::viewport()->geometry());
+    }
 }
 
 void MarkdownEditor::highlightCurrentLine() {
@@ -613,7 +1112,11 @@ void MarkdownEditor::highlightCurrentLine() {
         extraSelections.append(selection);
     }
 
-    setExtraSelections(extraSelections);
+    if (m_largeFileView) {
+        m_largeFileView->setExtraSelections(extraSelections);
+    } else {
+        setExtraSelections(extraSelections);
+    }
 
     if (m_highlighter) {
         m_highlighter->setCurrentCursorLine(textCursor().blockNumber());
@@ -635,33 +1138,71 @@ void MarkdownEditor::lineNumberAreaPaintEvent(QPaintEvent* event) {
     }
 
     painter.fillRect(event->rect(), backgroundColor);
+    painter.setPen(textColor);
+    const int lineHeight = fontMetrics().height();
+    const QRect exposed = event->rect();
+
+    if (m_largeFileView) {
+        // The plain layout only knows the blocks from the first one on
+        // screen down, relative to the view's content offset.
+        QTextBlock block = m_largeFileView->firstVisibleBlock();
+        int blockTop = qRound(m_largeFileView->blockBoundingGeometry(block)
+                                  .translated(m_largeFileView->contentOffset())
+                                  .top());
+        while (block.isValid() && blockTop <= exposed.bottom()) {
+            const int blockHeight =
+                qRound(m_largeFileView->blockBoundingRect(block).height());
+            if (block.isVisible() && blockTop + blockHeight > exposed.top()) {
+                QString number = QString::number(block.blockNumber() + 1);
+                painter.drawText(0, blockTop, lineNumberArea->width() - 5,
+                                 lineHeight, Qt::AlignRight, number);
+            }
+            blockTop += blockHeight;
+            block = block.next();
+        }
+        return;
+    }
 
-    QTextBlock block = document()->firstBlock();
-    int blockNumber = 0;
+    // Start from the block under the top of the exposed area instead of
+    // walking from the first block, so painting only touches the blocks
+    // that are actually visible. Block geometry comes from the document
+    // layout, which caches it between paints.
+    QAbstractTextDocumentLayout* layout = document()->documentLayout();
+    const int scrollOffset = verticalScrollBar()->value();
+
+    int firstPosition = layout->hitTest(
+        QPointF(0, scrollOffset + exposed.top()), Qt::FuzzyHit);
+    QTextBlock block = document()->findBlock(qMax(0, firstPosition));
+    if (!block.isValid()) {
+        block = document()->firstBlock();
+    }
 
-    while (block.isValid()) {
-        blockNumber = block.blockNumber();
-        QTextCursor blockCursor(block);
-        int blockTop = static_cast<int>(cursorRect(blockCursor).top());
+    int blockTop =
+        qRound(layout->blockBoundingRect(block).top()) - scrollOffset;
+    if (blockTop > exposed.top() && block.previous().isValid()) {
+        block = block.previous();
+        blockTop =
+            qRound(layout->blockBoundingRect(block).top()) - scrollOffset;
+    }
 
-        if (blockTop > event->rect().bottom()) {
-            break;
-        }
+    while (block.isValid() && blockTop <= exposed.bottom()) {
+        QRectF blockRect = layout->blockBoundingRect(block);
+        blockTop = qRound(blockRect.top()) - scrollOffset;
 
-        if (block.isVisible() &&
-            blockTop + fontMetrics().height() > event->rect().top()) {
-            QString number = QString::number(blockNumber + 1);
-            painter.setPen(textColor);
+        if (block.isVisible() && blockTop + lineHeight > exposed.top()) {
+            QString number = QString::number(block.blockNumber() + 1);
             painter.drawText(0, blockTop, lineNumberArea->width() - 5,
-                             fontMetrics().height(), Qt::AlignRight, number);
+                             lineHeight, Qt::AlignRight, number);
         }
 
+        blockTop = qRound(blockRect.bottom()) - scrollOffset;
         block = block.next();
     }
 }
 
 void MarkdownEditor::setCurrentFilePath(const QString& filePath) {
     m_currentFilePath = filePath;
+    syncWordPredictor();
 }
 
 void MarkdownEditor::insertFromMimeData(const QMimeData* source) {
@@ -694,7 +1235,11 @@ void MarkdownEditor::insertFromMimeData(const QMimeData* source) {
     blockSignals(true);
     
     // Paste text
-    QTextEdit::insertFromMimeData(source);
+    if (m_largeFileView) {
+        m_largeFileView->defaultInsertFromMimeData(source);
+    } else {
+        QTextEdit::insertFromMimeData(source);
+    }
     
     // Re-enable signals
     blockSignals(false);
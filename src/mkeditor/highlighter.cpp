@@ -5,12 +5,22 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QFont>
+#include <QTextBlockUserData>
+
+/**
+ * Attached to blocks formatted while lazy highlighting is active, so
+ * the editor can tell which visible blocks still need a pass.
+ */
+class LazyHighlightMarker : public QTextBlockUserData {};
 
 MarkdownHighlighter::MarkdownHighlighter(QTextDocument* parent)
     : QSyntaxHighlighter(parent),
       currentColorScheme("light"),
       codeSyntaxEnabled(false),
-      currentCursorLine(-1) {
+      currentCursorLine(-1),
+      lazyHighlighting(false),
+      firstVisibleBlock(0),
+      lastVisibleBlock(-1) {
     setupFormats();
 }
 
@@ -340,6 +350,21 @@ void MarkdownHighlighter::setCurrentCursorLine(int lineNumber) {
     }
 }
 
+void MarkdownHighlighter::setLazyHighlighting(bool enabled) {
+    if (lazyHighlighting == enabled) {
+        return;
+    }
+    lazyHighlighting = enabled;
+    if (!enabled) {
+        rehighlight();
+    }
+}
+
+void MarkdownHighlighter::setVisibleBlockRange(int firstBlock, int lastBlock) {
+    firstVisibleBlock = firstBlock;
+    lastVisibleBlock = lastBlock;
+}
+
 QColor MarkdownHighlighter::getSubtleColor() const {
     if (currentColorScheme == "dark" || currentColorScheme == "solarized-dark") {
         return ColorPalette::getDarkTheme().subtleMarkup;
@@ -359,6 +384,19 @@ void MarkdownHighlighter::setRootPath(const QString& path) {
 }
 
 void MarkdownHighlighter::highlightBlock(const QString& text) {
+    if (lazyHighlighting) {
+        // Blocks away from the viewport keep their previous state so the
+        // code-block state does not cascade through the whole document.
+        int blockNumber = currentBlock().blockNumber();
+        if (blockNumber < firstVisibleBlock || blockNumber > lastVisibleBlock) {
+            setCurrentBlockUserData(nullptr);
+            return;
+        }
+        if (!currentBlockUserData()) {
+            setCurrentBlockUserData(new LazyHighlightMarker);
+        }
+    }
+
     // Check if we're starting or ending a code block
     int previousState = previousBlockState();
     bool inCodeBlock = (previousState == InCodeBlock);
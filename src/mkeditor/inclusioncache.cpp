@@ -0,0 +1,188 @@
+#include "inclusioncache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QTextStream>
+
+namespace {
+
+// Kept small enough that a long session does not hoard note texts; the
+// cache simply starts over when a table grows past it.
+const int MAX_ENTRIES = 512;
+
+}  // namespace
+
+InclusionCache* InclusionCache::instance() {
+    static InclusionCache cache;
+    return &cache;
+}
+
+InclusionCache::FileStamp InclusionCache::stamp(const QString& path) {
+    QFileInfo info(path);
+    FileStamp result;
+    result.path = path;
+    if (info.exists()) {
+        result.modified = info.lastModified();
+        result.size = info.size();
+    }
+    return result;
+}
+
+bool InclusionCache::isCurrent(const QVector<FileStamp>& stamps) {
+    for (const FileStamp& cached : stamps) {
+        if (!(stamp(cached.path) == cached)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void InclusionCache::trim() {
+    if (m_resolved.size() > MAX_ENTRIES) {
+        m_resolved.clear();
+    }
+    if (m_texts.size() > MAX_ENTRIES) {
+        m_texts.clear();
+    }
+    if (m_rendered.size() > MAX_ENTRIES) {
+        m_rendered.clear();
+    }
+}
+
+QString InclusionCache::resolve(const QString& dir, const QString& target,
+                                const QStringList& suffixes) {
+    const QString key =
+        dir + QChar('\n') + target + QChar('\n') + suffixes.join('|');
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_resolved.constFind(key);
+        if (it != m_resolved.constEnd()) {
+            // A deleted file is reported through invalidate(), but the
+            // watcher may not be running; one stat keeps this honest.
+            if (QFileInfo::exists(*it)) {
+                return *it;
+            }
+            m_resolved.erase(it);
+        }
+    }
+
+    // Misses are not remembered, so a file created later is found.
+    QDir baseDir(dir);
+    for (const QString& suffix : suffixes) {
+        QString fullPath = baseDir.filePath(target + suffix);
+        if (QFileInfo::exists(fullPath)) {
+            fullPath = QFileInfo(fullPath).absoluteFilePath();
+            QMutexLocker locker(&m_mutex);
+            m_resolved.insert(key, fullPath);
+            trim();
+            return fullPath;
+        }
+    }
+    return QString();
+}
+
+QString InclusionCache::readText(const QString& path, QString& errorMsg) {
+    const FileStamp current = stamp(path);
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_texts.constFind(path);
+        if (it != m_texts.constEnd() && it->stamp == current) {
+            errorMsg.clear();
+            return it->text;
+        }
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        errorMsg = QString("Cannot read file: %1").arg(path);
+        return QString();
+    }
+    QTextStream in(&file);
+    in.setEncoding(QStringConverter::Utf8);
+    TextEntry entry;
+    entry.stamp = current;
+    entry.text = in.readAll();
+    file.close();
+    errorMsg.clear();
+
+    QMutexLocker locker(&m_mutex);
+    m_texts.insert(path, entry);
+    trim();
+    return entry.text;
+}
+
+bool InclusionCache::findRendered(const QString& key, QString& html,
+                                  QStringList& dependencies, int& depth) {
+    RenderedEntry entry;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_rendered.constFind(key);
+        if (it == m_rendered.constEnd()) {
+            return false;
+        }
+        entry = *it;
+    }
+    if (!isCurrent(entry.stamps)) {
+        QMutexLocker locker(&m_mutex);
+        m_rendered.remove(key);
+        return false;
+    }
+
+    html = entry.html;
+    dependencies.clear();
+    for (const FileStamp& fileStamp : entry.stamps) {
+        dependencies.append(fileStamp.path);
+    }
+    depth = entry.depth;
+    return true;
+}
+
+void InclusionCache::storeRendered(const QString& key, const QString& html,
+                                   const QStringList& dependencies,
+                                   int depth) {
+    RenderedEntry entry;
+    entry.html = html;
+    entry.depth = depth;
+    for (const QString& path : dependencies) {
+        entry.stamps.append(stamp(path));
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_rendered.insert(key, entry);
+    trim();
+}
+
+void InclusionCache::invalidate(const QString& path) {
+    QMutexLocker locker(&m_mutex);
+    m_texts.remove(path);
+    for (auto it = m_resolved.begin(); it != m_resolved.end();) {
+        if (it.value() == path) {
+            it = m_resolved.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = m_rendered.begin(); it != m_rendered.end();) {
+        bool dependsOnPath = false;
+        for (const FileStamp& fileStamp : it->stamps) {
+            if (fileStamp.path == path) {
+                dependsOnPath = true;
+                break;
+            }
+        }
+        if (dependsOnPath) {
+            it = m_rendered.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void InclusionCache::clear() {
+    QMutexLocker locker(&m_mutex);
+    m_resolved.clear();
+    m_texts.clear();
+    m_rendered.clear();
+}
@@ -402,5 +402,9 @@ void MarkdownEditor::keyPressEvent(QKeyEvent* event) {
         hidePrediction();
     }
 
-    QTextEdit::keyPressEvent(event);
+    if (m_largeFileView) {
+        m_largeFileView->defaultKeyPressEvent(event);
+    } else {
+        QTextEdit::keyPressEvent(event);
+    }
 }
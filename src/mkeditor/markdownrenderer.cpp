@@ -0,0 +1,1174 @@
+#include "markdownrenderer.h"
+
+#include <md4c.h>
+
+#include <QByteArray>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QRegularExpression>
+#include <QStringEncoder>
+#include <QThreadStorage>
+#include <algorithm>
+#include <cstring>
+
+#include "inclusioncache.h"
+#include "mermaidcache.h"
+#include "prerenderpool.h"
+#include "regexpatterns.h"
+#include "regexutils.h"
+
+namespace {
+
+// Brackets the index of a prerendered item in the document until the
+// item's HTML replaces it. Documents containing it are not prerendered.
+const char PLACEHOLDER_MARK = '\x1F';
+
+const unsigned PARSER_FLAGS =
+    MD_FLAG_TABLES |                    // Enable tables
+    MD_FLAG_STRIKETHROUGH |             // Enable ~~strikethrough~~
+    MD_FLAG_TASKLISTS |                 // Enable task lists [ ] [x]
+    MD_FLAG_LATEXMATHSPANS |            // Enable $math$ and $$math$$
+    MD_FLAG_WIKILINKS |                 // Enable [[wiki links]]
+    MD_FLAG_PERMISSIVEURLAUTOLINKS |    // Auto-link URLs
+    MD_FLAG_PERMISSIVEEMAILAUTOLINKS |  // Auto-link emails
+    MD_FLAG_PERMISSIVEWWWAUTOLINKS;     // Auto-link www.example.com
+
+void appendEscaped(QByteArray& out, const char* text, qsizetype size) {
+    qsizetype start = 0;
+    for (qsizetype i = 0; i < size; ++i) {
+        const char* entity = nullptr;
+        switch (text[i]) {
+            case '&':
+                entity = "&amp;";
+                break;
+            case '<':
+                entity = "&lt;";
+                break;
+            case '>':
+                entity = "&gt;";
+                break;
+            case '"':
+                entity = "&quot;";
+                break;
+            default:
+                continue;
+        }
+        out.append(text + start, i - start);
+        out.append(entity);
+        start = i + 1;
+    }
+    out.append(text + start, size - start);
+}
+
+void appendEscaped(QByteArray& out, const QByteArray& text) {
+    appendEscaped(out, text.constData(), text.size());
+}
+
+// Same character set md4c's HTML renderer leaves unescaped in URLs.
+void appendUrlEscaped(QByteArray& out, const char* text, qsizetype size) {
+    static const char hexDigits[] = "0123456789ABCDEF";
+    for (qsizetype i = 0; i < size; ++i) {
+        const uchar c = uchar(text[i]);
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+            (c >= '0' && c <= '9') ||
+            (c != 0 && std::strchr("~-_.+!*(),%#@?=;:/,+$", c))) {
+            out.append(char(c));
+        } else if (c == '&') {
+            out.append("&amp;");
+        } else if (c == '\'') {
+            out.append("&#x27;");
+        } else {
+            out.append('%');
+            out.append(hexDigits[c >> 4]);
+            out.append(hexDigits[c & 0xf]);
+        }
+    }
+}
+
+QByteArray attributeText(const MD_ATTRIBUTE& attribute) {
+    return QByteArray(attribute.text, attribute.size);
+}
+
+// Writes an attribute value; entities are kept as written since they
+// are valid in HTML attributes as they are.
+void appendAttribute(QByteArray& out, const MD_ATTRIBUTE& attribute,
+                     bool isUrl) {
+    for (int i = 0; attribute.substr_offsets[i] < attribute.size; ++i) {
+        const MD_OFFSET offset = attribute.substr_offsets[i];
+        const MD_SIZE size = attribute.substr_offsets[i + 1] - offset;
+        const char* text = attribute.text + offset;
+        switch (attribute.substr_types[i]) {
+            case MD_TEXT_NULLCHAR:
+                out.append("\xEF\xBF\xBD");
+                break;
+            case MD_TEXT_ENTITY:
+                out.append(text, size);
+                break;
+            default:
+                if (isUrl) {
+                    appendUrlEscaped(out, text, size);
+                } else {
+                    appendEscaped(out, text, size);
+                }
+                break;
+        }
+    }
+}
+
+// Byte buffers a render thread keeps from one render to the next, so a
+// preview refresh writes into memory it already has instead of growing
+// new buffers. Inclusions are rendered while the including note still
+// is, so each level takes a set of its own.
+struct RenderBuffers {
+    QByteArray source;
+    QByteArray document;
+    QByteArray scratch;
+    QByteArray headingHtml;
+    QByteArray codeText;
+};
+
+// A buffer grown past this by one huge note is freed after the render
+// rather than kept for the rest of the session.
+const qsizetype MAX_RETAINED_CAPACITY = 8 * 1024 * 1024;
+
+struct RenderArena {
+    QVector<RenderBuffers*> free;
+
+    ~RenderArena() { qDeleteAll(free); }
+};
+
+QThreadStorage<RenderArena*> threadArenas;
+
+RenderArena* arenaForThread() {
+    if (!threadArenas.hasLocalData()) {
+        threadArenas.setLocalData(new RenderArena);
+    }
+    return threadArenas.localData();
+}
+
+void recycle(QByteArray& buffer) {
+    if (buffer.capacity() > MAX_RETAINED_CAPACITY) {
+        buffer.clear();
+    } else {
+        // Keeps the allocation.
+        buffer.resize(0);
+    }
+}
+
+/**
+ * Takes a set of buffers from the thread's arena for the duration of
+ * one render and hands them back, emptied, when it goes out of scope.
+ */
+class RenderBuffersLease {
+   public:
+    RenderBuffersLease() : m_arena(arenaForThread()) {
+        m_buffers = m_arena->free.isEmpty() ? new RenderBuffers
+                                            : m_arena->free.takeLast();
+    }
+    ~RenderBuffersLease() {
+        recycle(m_buffers->source);
+        recycle(m_buffers->document);
+        recycle(m_buffers->scratch);
+        recycle(m_buffers->headingHtml);
+        recycle(m_buffers->codeText);
+        m_arena->free.append(m_buffers);
+    }
+    RenderBuffers& buffers() { return *m_buffers; }
+
+   private:
+    Q_DISABLE_COPY(RenderBuffersLease)
+    RenderArena* m_arena;
+    RenderBuffers* m_buffers;
+};
+
+// Encodes text into buffer, reusing its allocation.
+void encodeUtf8(const QString& text, QByteArray& buffer) {
+    QStringEncoder encoder(QStringEncoder::Utf8);
+    buffer.resize(encoder.requiredSpace(text.size()));
+    char* end = encoder.appendToBuffer(buffer.data(), text);
+    buffer.truncate(end - buffer.constData());
+}
+
+QString inclusionError(const QString& message) {
+    return QString(
+               "<div class=\"inclusion-error\" style=\"border: 1px solid "
+               "#ff6b6b; "
+               "background-color: #ffe0e0; padding: 10px; margin: 10px 0; "
+               "border-radius: 5px;\">"
+               "<strong>Inclusion Error:</strong> %1"
+               "</div>")
+        .arg(message.toHtmlEscaped());
+}
+
+}  // namespace
+
+/**
+ * Inclusions being expanded by one render, outermost first, and every
+ * file read along the way.
+ */
+struct MarkdownInclusionState {
+    QStringList stack;
+    QStringList dependencies;
+    // How many levels of inclusions the rendered document contains.
+    int depth = 0;
+    // Set when the output must not be cached: a cycle or the depth limit
+    // cut an inclusion short, so it depends on where the note was
+    // included from, or a diagram has no cached SVG yet.
+    bool provisional = false;
+
+    QString directory(const QString& basePath) const {
+        return stack.isEmpty() ? basePath
+                               : QFileInfo(stack.last()).absolutePath();
+    }
+};
+
+/**
+ * State of one md4c parse. Headings and code are rendered into side
+ * buffers until they are closed, because their final markup depends on
+ * their whole content. Side buffers are emptied with resize(0), which
+ * keeps their memory for the next heading or block.
+ */
+struct MarkdownRenderContext {
+    const MarkdownRenderer* renderer;
+    MarkdownInclusionState* inclusions;
+    RenderBuffers& buffers;
+
+    QByteArray document;
+    // Where finishing passes build the next version of document.
+    QByteArray scratch;
+    QByteArray* out;
+    int imageNesting = 0;
+
+    bool inHeading = false;
+    unsigned headingLevel = 0;
+    QByteArray headingHtml;
+    QByteArray headingText;
+    QHash<QString, int> anchorCounts;
+
+    bool inCode = false;
+    bool inMermaid = false;
+    bool inPrerenderedCode = false;
+    QByteArray codeText;
+    QByteArray codeLanguage;
+    QByteArray codeClass;
+
+    // Math and code handed to PrerenderPool, with the markup around
+    // each item and what to write if it cannot be rendered.
+    struct PendingMarkup {
+        QByteArray before;
+        QByteArray after;
+        QByteArray fallback;
+    };
+    bool prerender = false;
+    bool inMath = false;
+    QByteArray mathText;
+    QVector<PrerenderPool::Item> prerenderItems;
+    QVector<PendingMarkup> pendingMarkup;
+
+    bool inInclusion = false;
+    QByteArray inclusionTarget;
+    QByteArray inclusionText;
+
+    // Source lines of top-level blocks. md4c reports no positions, but
+    // text and attributes point into the source, so a block's line is
+    // that of the first of them. Blocks whose tag is written before it
+    // is known get the attribute inserted at the end, in one pass.
+    bool sourceLines = false;
+    const char* sourceStart = nullptr;
+    qsizetype sourceSize = 0;
+    QVector<qsizetype> lineStarts;
+    int blockDepth = 0;
+    int blockLine = 0;
+    qsizetype lineMarkPosition = -1;
+    QVector<QPair<qsizetype, int>> lineMarks;
+
+    // The large buffers are borrowed from the arena and returned with
+    // whatever they grew to.
+    MarkdownRenderContext(const MarkdownRenderer* r,
+                          MarkdownInclusionState* state,
+                          RenderBuffers& arenaBuffers)
+        : renderer(r), inclusions(state), buffers(arenaBuffers),
+          out(&document) {
+        document.swap(buffers.document);
+        scratch.swap(buffers.scratch);
+        headingHtml.swap(buffers.headingHtml);
+        codeText.swap(buffers.codeText);
+    }
+    ~MarkdownRenderContext() {
+        document.swap(buffers.document);
+        scratch.swap(buffers.scratch);
+        headingHtml.swap(buffers.headingHtml);
+        codeText.swap(buffers.codeText);
+    }
+
+    QString expandCodeInclusions(const QString& code);
+    void flushCode();
+    void closeMermaid();
+    void closePrerenderedCode();
+    void closeMath(PrerenderPool::Kind kind);
+    void addPrerendered(PrerenderPool::Kind kind, const QString& source,
+                        const QString& language, const PendingMarkup& markup);
+    void finishPrerendered();
+    void closeHeading();
+    void closeInclusion();
+
+    void startSourceLines(const QByteArray& utf8Data);
+    void markBlockStart(qsizetype tagLength);
+    void noteSourceText(const char* text);
+    QByteArray lineAttribute() const;
+    void applyLineMarks();
+
+    static int enterBlock(MD_BLOCKTYPE type, void* detail, void* userdata);
+    static int leaveBlock(MD_BLOCKTYPE type, void* detail, void* userdata);
+    static int enterSpan(MD_SPANTYPE type, void* detail, void* userdata);
+    static int leaveSpan(MD_SPANTYPE type, void* detail, void* userdata);
+    static int renderText(MD_TEXTTYPE type, const MD_CHAR* text,
+                          MD_SIZE size, void* userdata);
+};
+
+QString MarkdownRenderContext::expandCodeInclusions(const QString& code) {
+    // [[!file]] inside code pulls in the file's text verbatim.
+    static const QRegularExpression inclusionPattern(
+        RegexPatterns::INCLUSION_PATTERN);
+    QString expanded;
+    qsizetype position = 0;
+    QRegularExpressionMatchIterator it = inclusionPattern.globalMatch(code);
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        expanded += code.mid(position, match.capturedStart() - position);
+
+        QString errorMsg;
+        QString fileContent = renderer->readFileContent(
+            match.captured(1).trimmed(), errorMsg, *inclusions);
+        if (!errorMsg.isEmpty()) {
+            fileContent = QString("Error: %1").arg(errorMsg);
+        }
+        expanded += fileContent;
+        position = match.capturedEnd();
+    }
+    expanded += code.mid(position);
+    return expanded;
+}
+
+void MarkdownRenderContext::startSourceLines(const QByteArray& utf8Data) {
+    sourceLines = true;
+    sourceStart = utf8Data.constData();
+    sourceSize = utf8Data.size();
+    lineStarts.append(0);
+    for (qsizetype i = 0; i < utf8Data.size(); ++i) {
+        if (utf8Data[i] == '\n') {
+            lineStarts.append(i + 1);
+        }
+    }
+}
+
+void MarkdownRenderContext::markBlockStart(qsizetype tagLength) {
+    // Only blocks directly under the document, which md4c counts as
+    // depth 1, are marked.
+    if (sourceLines && blockDepth == 2) {
+        lineMarkPosition = document.size() + tagLength;
+    }
+}
+
+void MarkdownRenderContext::noteSourceText(const char* text) {
+    if (!sourceLines || blockDepth < 2 || blockLine > 0) {
+        return;
+    }
+    // Replacement characters and the like do not come from the source.
+    if (text < sourceStart || text >= sourceStart + sourceSize) {
+        return;
+    }
+    const qsizetype offset = text - sourceStart;
+    blockLine = int(std::upper_bound(lineStarts.cbegin(), lineStarts.cend(),
+                                     offset) -
+                    lineStarts.cbegin());
+    if (lineMarkPosition >= 0) {
+        lineMarks.append({lineMarkPosition, blockLine});
+        lineMarkPosition = -1;
+    }
+}
+
+QByteArray MarkdownRenderContext::lineAttribute() const {
+    if (!sourceLines || blockDepth != 2 || blockLine <= 0) {
+        return QByteArray();
+    }
+    return " data-source-line=\"" + QByteArray::number(blockLine) + '"';
+}
+
+void MarkdownRenderContext::applyLineMarks() {
+    QByteArray& result = scratch;
+    result.resize(0);
+    result.reserve(document.size() + lineMarks.size() * 24);
+    qsizetype position = 0;
+    for (const auto& mark : lineMarks) {
+        result.append(document.constData() + position, mark.first - position);
+        result.append(" data-source-line=\"" +
+                      QByteArray::number(mark.second) + '"');
+        position = mark.first;
+    }
+    result.append(document.constData() + position, document.size() - position);
+    document.swap(scratch);
+}
+
+void MarkdownRenderContext::flushCode() {
+    inCode = false;
+    if (!codeText.contains("[[!")) {
+        appendEscaped(*out, codeText);
+        return;
+    }
+    appendEscaped(*out,
+                  expandCodeInclusions(QString::fromUtf8(codeText)).toUtf8());
+}
+
+void MarkdownRenderContext::closePrerenderedCode() {
+    inPrerenderedCode = false;
+    inCode = false;
+    QString source = QString::fromUtf8(codeText);
+    if (codeText.contains("[[!")) {
+        source = expandCodeInclusions(source);
+    }
+
+    // The hljs class keeps the page from highlighting the block again.
+    const QByteArray pre = "<pre" + lineAttribute() + '>';
+    PendingMarkup markup;
+    markup.before = codeClass.isEmpty()
+                        ? pre + "<code class=\"hljs\">"
+                        : pre + "<code class=\"hljs language-" + codeClass +
+                              "\">";
+    markup.after = "</code></pre>\n";
+    markup.fallback = codeClass.isEmpty()
+                          ? pre + "<code>"
+                          : pre + "<code class=\"language-" + codeClass + "\">";
+    appendEscaped(markup.fallback, source.toUtf8());
+    markup.fallback.append(markup.after);
+    addPrerendered(PrerenderPool::Code, source,
+                   QString::fromUtf8(codeLanguage), markup);
+}
+
+void MarkdownRenderContext::closeMath(PrerenderPool::Kind kind) {
+    inMath = false;
+    const QByteArray delimiter =
+        kind == PrerenderPool::DisplayMath ? "$$" : "$";
+    PendingMarkup markup;
+    markup.fallback = delimiter;
+    appendEscaped(markup.fallback, mathText);
+    markup.fallback.append(delimiter);
+    addPrerendered(kind, QString::fromUtf8(mathText), QString(), markup);
+}
+
+void MarkdownRenderContext::addPrerendered(PrerenderPool::Kind kind,
+                                           const QString& source,
+                                           const QString& language,
+                                           const PendingMarkup& markup) {
+    PrerenderPool::Item item;
+    item.kind = kind;
+    item.source = source;
+    item.language = language;
+    out->append(PLACEHOLDER_MARK);
+    out->append(QByteArray::number(prerenderItems.size()));
+    out->append(PLACEHOLDER_MARK);
+    prerenderItems.append(item);
+    pendingMarkup.append(markup);
+}
+
+void MarkdownRenderContext::finishPrerendered() {
+    const QStringList rendered =
+        PrerenderPool::instance()->render(prerenderItems);
+
+    QByteArray& result = scratch;
+    result.resize(0);
+    result.reserve(document.size() * 2);
+    qsizetype position = 0;
+    while (true) {
+        const qsizetype start = document.indexOf(PLACEHOLDER_MARK, position);
+        if (start < 0) {
+            break;
+        }
+        const qsizetype end = document.indexOf(PLACEHOLDER_MARK, start + 1);
+        const int index = document.mid(start + 1, end - start - 1).toInt();
+        result.append(document.constData() + position, start - position);
+
+        const PendingMarkup& markup = pendingMarkup[index];
+        if (rendered[index].isNull()) {
+            result.append(markup.fallback);
+        } else {
+            result.append(markup.before);
+            result.append(rendered[index].toUtf8());
+            result.append(markup.after);
+        }
+        position = end + 1;
+    }
+    result.append(document.constData() + position, document.size() - position);
+    document.swap(scratch);
+}
+
+void MarkdownRenderContext::closeMermaid() {
+    inMermaid = false;
+    QByteArray code;
+    QByteArray* documentOut = out;
+    out = &code;
+    flushCode();
+    out = documentOut;
+
+    const QString key = MermaidCache::diagramKey(QString::fromUtf8(code),
+                                                 renderer->m_diagramTheme);
+    const QString svg =
+        MermaidCache::instance()->find(renderer->m_diagramWorkspace, key);
+    if (!svg.isEmpty()) {
+        out->append("<div class=\"mermaid-container\"" + lineAttribute() +
+                    '>');
+        out->append(svg.toUtf8());
+        out->append("</div>\n");
+        return;
+    }
+    inclusions->provisional = true;
+    out->append("<pre" + lineAttribute() +
+                "><code class=\"language-mermaid\" data-mermaid-key=\"" +
+                key.toLatin1() + "\">");
+    out->append(code);
+    out->append("</code></pre>\n");
+}
+
+void MarkdownRenderContext::closeHeading() {
+    inHeading = false;
+    out = &document;
+
+    QString slug = RegexUtils::generateSlug(QString::fromUtf8(headingText));
+    if (anchorCounts.contains(slug)) {
+        anchorCounts[slug]++;
+        slug += QString("-%1").arg(anchorCounts[slug]);
+    } else {
+        anchorCounts[slug] = 1;
+    }
+
+    const QByteArray tag = "h" + QByteArray::number(headingLevel);
+    out->append('<' + tag + lineAttribute());
+    if (!slug.isEmpty()) {
+        out->append(" id=\"");
+        appendEscaped(*out, slug.toUtf8());
+        out->append('"');
+    }
+    out->append('>');
+    out->append(headingHtml);
+    out->append("</" + tag + ">\n");
+}
+
+void MarkdownRenderContext::closeInclusion() {
+    inInclusion = false;
+    const QString target = QString::fromUtf8(inclusionTarget).trimmed();
+    QString display = QString::fromUtf8(inclusionText).trimmed();
+    if (display.startsWith("!")) {
+        display = target;
+    }
+    out->append(renderer->includeFile(target, display, *inclusions).toUtf8());
+}
+
+int MarkdownRenderContext::enterBlock(MD_BLOCKTYPE type, void* detail,
+                                      void* userdata) {
+    auto* context = static_cast<MarkdownRenderContext*>(userdata);
+    QByteArray& out = *context->out;
+
+    context->blockDepth++;
+    if (context->blockDepth == 2) {
+        context->blockLine = 0;
+        context->lineMarkPosition = -1;
+    }
+
+    switch (type) {
+        case MD_BLOCK_DOC:
+        case MD_BLOCK_HTML:
+            break;
+        case MD_BLOCK_QUOTE:
+            context->markBlockStart(11);
+            out.append("<blockquote>\n");
+            break;
+        case MD_BLOCK_UL:
+            context->markBlockStart(3);
+            out.append("<ul>\n");
+            break;
+        case MD_BLOCK_OL: {
+            const auto* ol = static_cast<const MD_BLOCK_OL_DETAIL*>(detail);
+            context->markBlockStart(3);
+            if (ol->start == 1) {
+                out.append("<ol>\n");
+            } else {
+                out.append("<ol start=\"" + QByteArray::number(ol->start) +
+                           "\">\n");
+            }
+            break;
+        }
+        case MD_BLOCK_LI: {
+            const auto* li = static_cast<const MD_BLOCK_LI_DETAIL*>(detail);
+            if (li->is_task) {
+                out.append(
+                    "<li class=\"task-list-item\"><input type=\"checkbox\" "
+                    "class=\"task-list-item-checkbox\" disabled");
+                if (li->task_mark == 'x' || li->task_mark == 'X') {
+                    out.append(" checked");
+                }
+                out.append(">");
+            } else {
+                out.append("<li>");
+            }
+            break;
+        }
+        case MD_BLOCK_HR:
+            out.append("<hr>\n");
+            break;
+        case MD_BLOCK_H:
+            context->inHeading = true;
+            context->headingLevel =
+                static_cast<const MD_BLOCK_H_DETAIL*>(detail)->level;
+            context->headingHtml.resize(0);
+            context->headingText.resize(0);
+            context->out = &context->headingHtml;
+            break;
+        case MD_BLOCK_CODE: {
+            const auto* code = static_cast<const MD_BLOCK_CODE_DETAIL*>(detail);
+            context->inCode = true;
+            context->codeText.resize(0);
+            if (code->info.text != nullptr) {
+                // The fence line, rather than the first line of code.
+                context->noteSourceText(code->info.text);
+            }
+            // Diagrams are written once their source is known, as the
+            // cached SVG if there is one.
+            if (!context->renderer->m_diagramTheme.isEmpty() &&
+                code->lang.text != nullptr &&
+                attributeText(code->lang) == "mermaid") {
+                context->inMermaid = true;
+                break;
+            }
+            if (context->prerender) {
+                context->inPrerenderedCode = true;
+                context->codeLanguage.clear();
+                context->codeClass.clear();
+                if (code->lang.text != nullptr) {
+                    context->codeLanguage = attributeText(code->lang);
+                    appendAttribute(context->codeClass, code->lang, false);
+                }
+                break;
+            }
+            context->markBlockStart(4);
+            out.append("<pre><code");
+            if (code->lang.text != nullptr) {
+                out.append(" class=\"language-");
+                appendAttribute(out, code->lang, false);
+                out.append('"');
+            }
+            out.append('>');
+            break;
+        }
+        case MD_BLOCK_P:
+            context->markBlockStart(2);
+            out.append("<p>");
+            break;
+        case MD_BLOCK_TABLE:
+            context->markBlockStart(6);
+            out.append("<table>\n");
+            break;
+        case MD_BLOCK_THEAD:
+            out.append("<thead>\n");
+            break;
+        case MD_BLOCK_TBODY:
+            out.append("<tbody>\n");
+            break;
+        case MD_BLOCK_TR:
+            out.append("<tr>\n");
+            break;
+        case MD_BLOCK_TH:
+        case MD_BLOCK_TD: {
+            out.append(type == MD_BLOCK_TH ? "<th" : "<td");
+            switch (static_cast<const MD_BLOCK_TD_DETAIL*>(detail)->align) {
+                case MD_ALIGN_LEFT:
+                    out.append(" align=\"left\"");
+                    break;
+                case MD_ALIGN_CENTER:
+                    out.append(" align=\"center\"");
+                    break;
+                case MD_ALIGN_RIGHT:
+                    out.append(" align=\"right\"");
+                    break;
+                default:
+                    break;
+            }
+            out.append('>');
+            break;
+        }
+    }
+    return 0;
+}
+
+int MarkdownRenderContext::leaveBlock(MD_BLOCKTYPE type, void* detail,
+                                      void* userdata) {
+    Q_UNUSED(detail);
+    auto* context = static_cast<MarkdownRenderContext*>(userdata);
+    QByteArray& out = *context->out;
+
+    switch (type) {
+        case MD_BLOCK_DOC:
+        case MD_BLOCK_HTML:
+        case MD_BLOCK_HR:
+            break;
+        case MD_BLOCK_QUOTE:
+            out.append("</blockquote>\n");
+            break;
+        case MD_BLOCK_UL:
+            out.append("</ul>\n");
+            break;
+        case MD_BLOCK_OL:
+            out.append("</ol>\n");
+            break;
+        case MD_BLOCK_LI:
+            out.append("</li>\n");
+            break;
+        case MD_BLOCK_H:
+            context->closeHeading();
+            break;
+        case MD_BLOCK_CODE:
+            if (context->inMermaid) {
+                context->closeMermaid();
+                break;
+            }
+            if (context->inPrerenderedCode) {
+                context->closePrerenderedCode();
+                break;
+            }
+            context->flushCode();
+            out.append("</code></pre>\n");
+            break;
+        case MD_BLOCK_P:
+            out.append("</p>\n");
+            break;
+        case MD_BLOCK_TABLE:
+            out.append("</table>\n");
+            break;
+        case MD_BLOCK_THEAD:
+            out.append("</thead>\n");
+            break;
+        case MD_BLOCK_TBODY:
+            out.append("</tbody>\n");
+            break;
+        case MD_BLOCK_TR:
+            out.append("</tr>\n");
+            break;
+        case MD_BLOCK_TH:
+            out.append("</th>\n");
+            break;
+        case MD_BLOCK_TD:
+            out.append("</td>\n");
+            break;
+    }
+    context->blockDepth--;
+    return 0;
+}
+
+int MarkdownRenderContext::enterSpan(MD_SPANTYPE type, void* detail,
+                                     void* userdata) {
+    auto* context = static_cast<MarkdownRenderContext*>(userdata);
+    QByteArray& out = *context->out;
+
+    if (type == MD_SPAN_A) {
+        context->noteSourceText(
+            static_cast<const MD_SPAN_A_DETAIL*>(detail)->href.text);
+    } else if (type == MD_SPAN_IMG) {
+        context->noteSourceText(
+            static_cast<const MD_SPAN_IMG_DETAIL*>(detail)->src.text);
+    }
+
+    // Inside an image label only the text is kept, as its alt text.
+    const bool insideImage = context->imageNesting > 0;
+    if (type == MD_SPAN_IMG) {
+        context->imageNesting++;
+    }
+    if (insideImage || context->inInclusion) {
+        return 0;
+    }
+
+    switch (type) {
+        case MD_SPAN_EM:
+            out.append("<em>");
+            break;
+        case MD_SPAN_STRONG:
+            out.append("<strong>");
+            break;
+        case MD_SPAN_U:
+            out.append("<u>");
+            break;
+        case MD_SPAN_DEL:
+            out.append("<del>");
+            break;
+        case MD_SPAN_CODE:
+            out.append("<code>");
+            context->inCode = true;
+            context->codeText.resize(0);
+            break;
+        case MD_SPAN_A: {
+            // Web links open in the browser; everything else is a link to
+            // another note, handled by the preview page.
+            const auto* a = static_cast<const MD_SPAN_A_DETAIL*>(detail);
+            const QByteArray href = attributeText(a->href);
+            const bool isWebLink =
+                href.startsWith("http://") || href.startsWith("https://");
+            out.append(isWebLink ? "<a href=\"" : "<a href=\"markdown:");
+            appendAttribute(out, a->href, true);
+            out.append('"');
+            if (a->title.text != nullptr) {
+                out.append(" title=\"");
+                appendAttribute(out, a->title, false);
+                out.append('"');
+            }
+            if (!isWebLink) {
+                out.append(" class=\"markdown-link\"");
+            }
+            out.append('>');
+            break;
+        }
+        case MD_SPAN_IMG: {
+            const auto* img = static_cast<const MD_SPAN_IMG_DETAIL*>(detail);
+            out.append("<img src=\"");
+            appendAttribute(out, img->src, true);
+            out.append("\" alt=\"");
+            break;
+        }
+        case MD_SPAN_LATEXMATH:
+        case MD_SPAN_LATEXMATH_DISPLAY:
+            if (context->prerender && context->renderer->isLatexEnabled()) {
+                context->inMath = true;
+                context->mathText.resize(0);
+            } else if (type == MD_SPAN_LATEXMATH) {
+                out.append(context->renderer->isLatexEnabled()
+                               ? "$"
+                               : "<x-equation>");
+            } else {
+                out.append(context->renderer->isLatexEnabled()
+                               ? "$$"
+                               : "<x-equation type=\"display\">");
+            }
+            break;
+        case MD_SPAN_WIKILINK: {
+            const auto* link =
+                static_cast<const MD_SPAN_WIKILINK_DETAIL*>(detail);
+            const QByteArray target = attributeText(link->target);
+            if (target.startsWith('!')) {
+                // Collect the label; the file is included when the link
+                // closes.
+                context->inInclusion = true;
+                context->inclusionTarget = target.mid(1);
+                context->inclusionText.resize(0);
+                break;
+            }
+            out.append("<a href=\"wiki:");
+            appendAttribute(out, link->target, false);
+            out.append("\" class=\"wiki-link\">");
+            break;
+        }
+    }
+    return 0;
+}
+
+int MarkdownRenderContext::leaveSpan(MD_SPANTYPE type, void* detail,
+                                     void* userdata) {
+    auto* context = static_cast<MarkdownRenderContext*>(userdata);
+    QByteArray& out = *context->out;
+
+    if (type == MD_SPAN_IMG) {
+        context->imageNesting--;
+    }
+    if (context->imageNesting > 0) {
+        return 0;
+    }
+    if (context->inInclusion) {
+        if (type == MD_SPAN_WIKILINK) {
+            context->closeInclusion();
+        }
+        return 0;
+    }
+
+    switch (type) {
+        case MD_SPAN_EM:
+            out.append("</em>");
+            break;
+        case MD_SPAN_STRONG:
+            out.append("</strong>");
+            break;
+        case MD_SPAN_U:
+            out.append("</u>");
+            break;
+        case MD_SPAN_DEL:
+            out.append("</del>");
+            break;
+        case MD_SPAN_CODE:
+            context->flushCode();
+            out.append("</code>");
+            break;
+        case MD_SPAN_A:
+        case MD_SPAN_WIKILINK:
+            out.append("</a>");
+            break;
+        case MD_SPAN_IMG: {
+            const auto* img = static_cast<const MD_SPAN_IMG_DETAIL*>(detail);
+            if (img->title.text != nullptr) {
+                out.append("\" title=\"");
+                appendAttribute(out, img->title, false);
+            }
+            out.append("\">");
+            break;
+        }
+        case MD_SPAN_LATEXMATH:
+            if (context->inMath) {
+                context->closeMath(PrerenderPool::InlineMath);
+            } else {
+                out.append(context->renderer->isLatexEnabled()
+                               ? "$"
+                               : "</x-equation>");
+            }
+            break;
+        case MD_SPAN_LATEXMATH_DISPLAY:
+            if (context->inMath) {
+                context->closeMath(PrerenderPool::DisplayMath);
+            } else {
+                out.append(context->renderer->isLatexEnabled()
+                               ? "$$"
+                               : "</x-equation>");
+            }
+            break;
+    }
+    return 0;
+}
+
+int MarkdownRenderContext::renderText(MD_TEXTTYPE type, const MD_CHAR* text,
+                                      MD_SIZE size, void* userdata) {
+    auto* context = static_cast<MarkdownRenderContext*>(userdata);
+    QByteArray& out = *context->out;
+
+    context->noteSourceText(text);
+    if (context->inInclusion) {
+        context->inclusionText.append(text, size);
+        return 0;
+    }
+    if (context->inHeading) {
+        if (type == MD_TEXT_BR || type == MD_TEXT_SOFTBR) {
+            context->headingText.append(' ');
+        } else if (type != MD_TEXT_HTML) {
+            context->headingText.append(text, size);
+        }
+    }
+    if (context->inMath) {
+        if (type == MD_TEXT_NULLCHAR) {
+            context->mathText.append("\xEF\xBF\xBD");
+        } else {
+            context->mathText.append(text, size);
+        }
+        return 0;
+    }
+    if (context->inCode) {
+        if (type == MD_TEXT_NULLCHAR) {
+            context->codeText.append("\xEF\xBF\xBD");
+        } else {
+            context->codeText.append(text, size);
+        }
+        return 0;
+    }
+
+    switch (type) {
+        case MD_TEXT_NULLCHAR:
+            out.append("\xEF\xBF\xBD");
+            break;
+        case MD_TEXT_BR:
+            out.append(context->imageNesting > 0 ? " " : "<br>\n");
+            break;
+        case MD_TEXT_SOFTBR:
+            out.append(context->imageNesting > 0 ? " " : "\n");
+            break;
+        case MD_TEXT_HTML:
+        case MD_TEXT_ENTITY:
+            out.append(text, size);
+            break;
+        default:
+            appendEscaped(out, text, size);
+            break;
+    }
+    return 0;
+}
+
+MarkdownRenderer::MarkdownRenderer()
+    : m_basePath(QDir::homePath()),
+      m_latexEnabled(true),
+      m_prerenderEnabled(false),
+      m_sourceLinesEnabled(false) {}
+
+void MarkdownRenderer::setBasePath(const QString& path) { m_basePath = path; }
+
+void MarkdownRenderer::setLatexEnabled(bool enabled) {
+    m_latexEnabled = enabled;
+}
+
+void MarkdownRenderer::setPrerenderEnabled(bool enabled) {
+    m_prerenderEnabled = enabled;
+}
+
+void MarkdownRenderer::setSourceLinesEnabled(bool enabled) {
+    m_sourceLinesEnabled = enabled;
+}
+
+void MarkdownRenderer::setDiagramCache(const QString& workspace,
+                                       const QString& theme) {
+    m_diagramWorkspace = workspace;
+    m_diagramTheme = theme;
+}
+
+QString MarkdownRenderer::render(const QString& markdown,
+                                 QStringList* includedFiles) const {
+    MarkdownInclusionState state;
+    QString html = renderDocument(markdown, state);
+    if (includedFiles) {
+        *includedFiles = state.dependencies;
+        includedFiles->removeDuplicates();
+    }
+    return html;
+}
+
+QString MarkdownRenderer::renderDocument(const QString& markdown,
+                                         MarkdownInclusionState& state) const {
+    // Declared first, so the context hands its buffers back before the
+    // lease returns them to the arena.
+    RenderBuffersLease lease;
+    QByteArray& utf8Data = lease.buffers().source;
+    encodeUtf8(markdown, utf8Data);
+
+    MarkdownRenderContext context(this, &state, lease.buffers());
+    context.document.reserve(utf8Data.size() + utf8Data.size() / 4);
+    context.prerender = m_prerenderEnabled &&
+                        !utf8Data.contains(PLACEHOLDER_MARK) &&
+                        PrerenderPool::instance()->isAvailable();
+    if (m_sourceLinesEnabled && state.stack.isEmpty()) {
+        context.startSourceLines(utf8Data);
+    }
+
+    MD_PARSER parser = {};
+    parser.abi_version = 0;
+    parser.flags = PARSER_FLAGS;
+    parser.enter_block = &MarkdownRenderContext::enterBlock;
+    parser.leave_block = &MarkdownRenderContext::leaveBlock;
+    parser.enter_span = &MarkdownRenderContext::enterSpan;
+    parser.leave_span = &MarkdownRenderContext::leaveSpan;
+    parser.text = &MarkdownRenderContext::renderText;
+
+    int result =
+        md_parse(utf8Data.constData(), utf8Data.size(), &parser, &context);
+    if (result != 0) {
+        return "<p style=\"color: red;\">Error parsing markdown</p>";
+    }
+    if (!context.lineMarks.isEmpty()) {
+        context.applyLineMarks();
+    }
+    if (!context.prerenderItems.isEmpty()) {
+        context.finishPrerendered();
+    }
+    // The one conversion of the output.
+    return QString::fromUtf8(context.document);
+}
+
+QString MarkdownRenderer::includeFile(const QString& linkTarget,
+                                      const QString& displayText,
+                                      MarkdownInclusionState& state) const {
+    static const QStringList noteSuffixes = {".md", ".markdown", ""};
+    InclusionCache* cache = InclusionCache::instance();
+
+    // Nested inclusions resolve against the note that contains them.
+    const QString resolvedPath = cache->resolve(
+        state.directory(m_basePath), linkTarget.trimmed(), noteSuffixes);
+    if (resolvedPath.isEmpty()) {
+        return inclusionError(QString("File not found: %1").arg(linkTarget));
+    }
+    if (state.stack.contains(resolvedPath)) {
+        state.provisional = true;
+        return inclusionError(
+            QString("Circular inclusion: %1").arg(linkTarget));
+    }
+    if (state.stack.size() >= MAX_INCLUSION_DEPTH) {
+        state.provisional = true;
+        return inclusionError(
+            QString("Inclusions nested deeper than %1 levels: %2")
+                .arg(MAX_INCLUSION_DEPTH)
+                .arg(linkTarget));
+    }
+
+    // Provisional output is never stored, so a cached note renders the
+    // same wherever it is included, as long as its own inclusions still
+    // fit under the depth limit here.
+    const QString cacheKey = QString("%1\n%2%3\n%4")
+                                 .arg(resolvedPath)
+                                 .arg(int(m_latexEnabled))
+                                 .arg(int(m_prerenderEnabled))
+                                 .arg(m_diagramTheme);
+    QString includedHtml;
+    QStringList includedFiles;
+    int includedDepth = 0;
+    const bool cached =
+        cache->findRendered(cacheKey, includedHtml, includedFiles,
+                            includedDepth) &&
+        state.stack.size() + includedDepth < MAX_INCLUSION_DEPTH;
+    if (!cached) {
+        QString errorMsg;
+        const QString content = cache->readText(resolvedPath, errorMsg);
+        if (!errorMsg.isEmpty()) {
+            return inclusionError(
+                QString("Cannot read file: %1").arg(linkTarget));
+        }
+        MarkdownInclusionState nested;
+        nested.stack = state.stack;
+        nested.stack.append(resolvedPath);
+        includedHtml = renderDocument(content, nested);
+        includedFiles = nested.dependencies;
+        includedFiles.prepend(resolvedPath);
+        includedFiles.removeDuplicates();
+        includedDepth = nested.depth;
+        if (nested.provisional) {
+            state.provisional = true;
+        } else {
+            cache->storeRendered(cacheKey, includedHtml, includedFiles,
+                                 includedDepth);
+        }
+    }
+    state.dependencies.append(includedFiles);
+    state.depth = qMax(state.depth, includedDepth + 1);
+
+    QString wrappedContent =
+        QString(
+            "<div class=\"included-content\" "
+            "style=\"border-left: 3px solid #4ade80; "
+            "padding-left: 15px; margin: 20px 0;\">"
+            "<div class=\"inclusion-title\" "
+            "style=\"font-weight: bold; color: #0a8a0a; "
+            "margin-bottom: 10px;\">%1</div>"
+            "%2"
+            "</div>")
+            .arg(displayText.toHtmlEscaped(), includedHtml);
+    return wrappedContent;
+}
+
+QString MarkdownRenderer::readFileContent(const QString& linkTarget,
+                                          QString& errorMsg,
+                                          MarkdownInclusionState& state) const {
+    static const QStringList codeSuffixes = {
+        "", ".md", ".markdown", ".txt", ".py",
+        ".cpp", ".java", ".js", ".rs", ".go"};
+    InclusionCache* cache = InclusionCache::instance();
+
+    const QString resolvedPath = cache->resolve(
+        state.directory(m_basePath), linkTarget.trimmed(), codeSuffixes);
+    if (resolvedPath.isEmpty()) {
+        errorMsg = QString("File not found: %1").arg(linkTarget);
+        return QString();
+    }
+    QString content = cache->readText(resolvedPath, errorMsg);
+    if (!errorMsg.isEmpty()) {
+        errorMsg = QString("Cannot read file: %1").arg(linkTarget);
+        return QString();
+    }
+    state.dependencies.append(resolvedPath);
+    return content;
+}
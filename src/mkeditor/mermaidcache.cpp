@@ -0,0 +1,110 @@
+#include "mermaidcache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+
+// Diagrams of a few notes fit easily; past this the memory copy starts
+// over and entries are read back from disk as they are needed.
+const qint64 MAX_MEMORY_BYTES = 32 * 1024 * 1024;
+
+}  // namespace
+
+MermaidCache::MermaidCache() : m_memoryBytes(0) {}
+
+MermaidCache* MermaidCache::instance() {
+    static MermaidCache cache;
+    return &cache;
+}
+
+QString MermaidCache::diagramKey(const QString& source, const QString& theme) {
+    return QString::fromLatin1(
+        QCryptographicHash::hash((theme + "\n" + source).toUtf8(),
+                                 QCryptographicHash::Sha1)
+            .toHex());
+}
+
+QString MermaidCache::cacheDirectory(const QString& workspace) {
+    const QString rootPath = QDir(workspace).absolutePath();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+           "/mermaid/" +
+           QString::fromLatin1(QCryptographicHash::hash(
+                                   rootPath.toUtf8(), QCryptographicHash::Sha1)
+                                   .toHex()
+                                   .left(16));
+}
+
+bool MermaidCache::isValidKey(const QString& key) {
+    // Keys come back from the page and become file names.
+    if (key.size() != 40) {
+        return false;
+    }
+    for (QChar c : key) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MermaidCache::remember(const QString& key, const QString& svg) {
+    if (m_memoryBytes + svg.size() * 2 > MAX_MEMORY_BYTES) {
+        m_svgs.clear();
+        m_memoryBytes = 0;
+    }
+    if (!m_svgs.contains(key)) {
+        m_svgs.insert(key, svg);
+        m_memoryBytes += svg.size() * 2;
+    }
+}
+
+QString MermaidCache::find(const QString& workspace, const QString& key) {
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_svgs.constFind(key);
+        if (it != m_svgs.constEnd()) {
+            return *it;
+        }
+    }
+    if (workspace.isEmpty() || !isValidKey(key)) {
+        return QString();
+    }
+
+    QFile file(cacheDirectory(workspace) + "/" + key + ".svg");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    const QString svg = QString::fromUtf8(file.readAll());
+    QMutexLocker locker(&m_mutex);
+    remember(key, svg);
+    return svg;
+}
+
+void MermaidCache::store(const QString& workspace, const QString& key,
+                         const QString& svg) {
+    if (!isValidKey(key) || svg.isEmpty()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        remember(key, svg);
+    }
+    if (workspace.isEmpty()) {
+        return;
+    }
+
+    const QString directory = cacheDirectory(workspace);
+    if (!QDir().mkpath(directory)) {
+        return;
+    }
+    QSaveFile file(directory + "/" + key + ".svg");
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(svg.toUtf8());
+        file.commit();
+    }
+}
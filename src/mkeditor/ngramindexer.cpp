@@ -0,0 +1,220 @@
+#include "ngramindexer.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QtConcurrent/QtConcurrent>
+
+#include "defs.h"
+#include "ngrammodel.h"
+#include "ngrammodelbuilder.h"
+
+namespace {
+
+quint64 fnv1a(const QByteArray& bytes,
+              quint64 hash = 14695981039346656037ULL) {
+    for (char c : bytes) {
+        hash ^= quint8(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+}  // namespace
+
+NgramIndexer::NgramIndexer(QObject* parent)
+    : QObject(parent),
+      m_watcher(new QFutureWatcher<std::shared_ptr<const NgramModel>>(this)),
+      m_refreshTimer(new QTimer(this)),
+      m_refreshPending(false) {
+    m_refreshTimer->setSingleShot(true);
+    // Saves (including auto-saves) arrive often; rebuilding at most every
+    // two minutes keeps the background work bounded.
+    m_refreshTimer->setInterval(2 * 60 * 1000);
+    connect(m_refreshTimer, &QTimer::timeout, this, &NgramIndexer::refresh);
+    connect(m_watcher, &QFutureWatcherBase::finished, this,
+            &NgramIndexer::onBuildFinished);
+}
+
+NgramIndexer::~NgramIndexer() {
+    m_cancelled.storeRelaxed(1);
+    m_watcher->waitForFinished();
+}
+
+QString NgramIndexer::cacheDirectory() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+           "/prediction";
+}
+
+QString NgramIndexer::cacheKey(const QString& rootPath) {
+    return QString::fromLatin1(
+        QCryptographicHash::hash(rootPath.toUtf8(), QCryptographicHash::Sha1)
+            .toHex()
+            .left(16));
+}
+
+void NgramIndexer::setWorkspace(const QString& rootPath) {
+    QString path = rootPath.isEmpty() ? QString()
+                                      : QDir(rootPath).absolutePath();
+    if (path == m_rootPath) {
+        refresh();
+        return;
+    }
+
+    m_rootPath = path;
+    m_refreshTimer->stop();
+    setModel(path.isEmpty() ? nullptr : openLatestModel(path));
+    refresh();
+}
+
+void NgramIndexer::scheduleRefresh() {
+    if (!m_rootPath.isEmpty() && !m_refreshTimer->isActive()) {
+        m_refreshTimer->start();
+    }
+}
+
+void NgramIndexer::refresh() {
+    m_refreshTimer->stop();
+
+    if (m_watcher->isRunning()) {
+        // Let the running job stop at the next file and start over with
+        // the current workspace once it has.
+        m_refreshPending = true;
+        m_cancelled.storeRelaxed(1);
+        return;
+    }
+    if (m_rootPath.isEmpty()) {
+        return;
+    }
+
+    QSettings settings(APP_LABEL, APP_LABEL);
+    int budgetMB = settings
+                       .value("editor/predictionModelBudgetMB",
+                              DEFAULT_PREDICTION_MODEL_BUDGET_MB)
+                       .toInt();
+    if (budgetMB <= 0) {
+        setModel(nullptr);
+        return;
+    }
+
+    m_refreshPending = false;
+    m_cancelled.storeRelaxed(0);
+    QString rootPath = m_rootPath;
+    qint64 budgetBytes = qint64(budgetMB) * 1024 * 1024;
+    m_watcher->setFuture(QtConcurrent::run([this, rootPath, budgetBytes]() {
+        return buildModel(rootPath, budgetBytes, &m_cancelled);
+    }));
+}
+
+void NgramIndexer::onBuildFinished() {
+    std::shared_ptr<const NgramModel> model = m_watcher->result();
+
+    if (m_refreshPending) {
+        refresh();
+        return;
+    }
+    if (model && (!m_model || model->sourceStamp() != m_model->sourceStamp())) {
+        setModel(model);
+    }
+}
+
+void NgramIndexer::setModel(std::shared_ptr<const NgramModel> model) {
+    if (model == m_model) {
+        return;
+    }
+    m_model = std::move(model);
+    emit modelChanged();
+}
+
+std::shared_ptr<const NgramModel> NgramIndexer::openLatestModel(
+    const QString& rootPath) {
+    QDir cacheDir(cacheDirectory());
+    const QFileInfoList candidates = cacheDir.entryInfoList(
+        QStringList() << cacheKey(rootPath) + "-*.bin", QDir::Files,
+        QDir::Time);
+    for (const QFileInfo& candidate : candidates) {
+        std::shared_ptr<const NgramModel> model =
+            NgramModel::open(candidate.absoluteFilePath());
+        if (model) {
+            return model;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const NgramModel> NgramIndexer::buildModel(
+    const QString& rootPath, qint64 budgetBytes, const QAtomicInt* cancelled) {
+    // The stamp is a sum of per-file hashes, so it does not depend on the
+    // order in which the directory is listed.
+    QDir root(rootPath);
+    QStringList files;
+    quint64 stamp = fnv1a(QByteArray::number(NgramFileHeader::VERSION) + ':' +
+                          QByteArray::number(budgetBytes));
+    QDirIterator it(rootPath, QStringList() << "*.md" << "*.markdown",
+                    QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        if (cancelled->loadRelaxed()) {
+            return nullptr;
+        }
+        QString filePath = it.next();
+        QFileInfo fileInfo = it.fileInfo();
+        quint64 fileHash = fnv1a(root.relativeFilePath(filePath).toUtf8());
+        fileHash = fnv1a(QByteArray::number(fileInfo.size()), fileHash);
+        fileHash = fnv1a(
+            QByteArray::number(fileInfo.lastModified().toMSecsSinceEpoch()),
+            fileHash);
+        stamp += fileHash;
+        files.append(filePath);
+    }
+    if (stamp == 0) {
+        stamp = 1;
+    }
+
+    QDir cacheDir(cacheDirectory());
+    if (!cacheDir.mkpath(".")) {
+        return nullptr;
+    }
+    const QString key = cacheKey(rootPath);
+    const QString modelPath = cacheDir.filePath(
+        QString("%1-%2.bin").arg(key).arg(stamp, 16, 16, QChar('0')));
+
+    if (QFileInfo::exists(modelPath)) {
+        std::shared_ptr<const NgramModel> model = NgramModel::open(modelPath);
+        if (model) {
+            return model;
+        }
+    }
+
+    NgramModelBuilder builder(budgetBytes);
+    for (const QString& filePath : files) {
+        if (cancelled->loadRelaxed()) {
+            return nullptr;
+        }
+        QFile file(filePath);
+        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            builder.addText(QString::fromUtf8(file.readAll()));
+        }
+    }
+
+    if (!builder.write(modelPath, stamp)) {
+        return nullptr;
+    }
+
+    // Older models of this workspace are no longer needed. A model that
+    // is still mapped may refuse removal on some platforms; it is
+    // retried on the next build.
+    const QFileInfoList stale = cacheDir.entryInfoList(
+        QStringList() << key + "-*.bin", QDir::Files);
+    for (const QFileInfo& fileInfo : stale) {
+        if (fileInfo.absoluteFilePath() != QFileInfo(modelPath).absoluteFilePath()) {
+            QFile::remove(fileInfo.absoluteFilePath());
+        }
+    }
+
+    return NgramModel::open(modelPath);
+}
@@ -0,0 +1,336 @@
+#include "ngrammodel.h"
+
+#include <limits>
+
+namespace {
+
+constexpr quint32 INVALID_ID = std::numeric_limits<quint32>::max();
+
+qint64 alignedSize(qint64 bytes) { return (bytes + 3) & ~qint64(3); }
+
+// Whether offsets[0..count] never decrease and end at last, so every
+// range they delimit lies within [0, last).
+bool offsetsValid(const quint32* offsets, qint64 count, quint32 last) {
+    for (qint64 i = 0; i < count; ++i) {
+        if (offsets[i] > offsets[i + 1]) {
+            return false;
+        }
+    }
+    return offsets[count] == last;
+}
+
+}  // namespace
+
+NgramModel::~NgramModel() {
+    if (m_data) {
+        m_file.unmap(const_cast<uchar*>(m_data));
+    }
+}
+
+std::shared_ptr<const NgramModel> NgramModel::open(const QString& filePath) {
+    std::shared_ptr<NgramModel> model(new NgramModel());
+    model->m_file.setFileName(filePath);
+    if (!model->m_file.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+
+    const qint64 size = model->m_file.size();
+    if (size < qint64(sizeof(NgramFileHeader))) {
+        return nullptr;
+    }
+
+    const uchar* data = model->m_file.map(0, size);
+    if (!data) {
+        return nullptr;
+    }
+    model->m_data = data;
+    model->m_size = size;
+
+    const auto* header = reinterpret_cast<const NgramFileHeader*>(data);
+    if (header->magic != NgramFileHeader::MAGIC ||
+        header->version != NgramFileHeader::VERSION ||
+        header->vocabularySize == 0) {
+        return nullptr;
+    }
+    model->m_header = header;
+
+    const qint64 vocabulary = header->vocabularySize;
+    const qint64 blocks = (vocabulary + NgramFileHeader::UNIGRAM_BLOCK - 1) /
+                          NgramFileHeader::UNIGRAM_BLOCK;
+
+    // Walk the sections in file order; every step is bounds-checked
+    // before a pointer into the mapping is handed out.
+    qint64 offset = sizeof(NgramFileHeader);
+    bool valid = true;
+    auto take = [&](qint64 bytes) -> const uchar* {
+        if (!valid || bytes < 0 || offset + bytes > size) {
+            valid = false;
+            return nullptr;
+        }
+        const uchar* section = data + offset;
+        offset += alignedSize(bytes);
+        return section;
+    };
+
+    model->m_wordOffsets =
+        reinterpret_cast<const quint32*>(take((vocabulary + 1) * 4));
+    model->m_strings = reinterpret_cast<const char*>(take(header->stringBytes));
+    model->m_unigramProb = take(vocabulary);
+    model->m_unigramBackoff = take(vocabulary);
+    model->m_blockBest = reinterpret_cast<const quint32*>(take(blocks * 4));
+    model->m_bigramOffsets =
+        reinterpret_cast<const quint32*>(take((vocabulary + 1) * 4));
+    model->m_bigrams = reinterpret_cast<const NgramBigramRecord*>(
+        take(qint64(header->bigramCount) * sizeof(NgramBigramRecord)));
+    model->m_trigramOffsets = reinterpret_cast<const quint32*>(
+        take((qint64(header->bigramCount) + 1) * 4));
+    model->m_trigrams = reinterpret_cast<const quint32*>(
+        take(qint64(header->trigramCount) * 4));
+
+    if (!valid || offset != size ||
+        !offsetsValid(model->m_wordOffsets, vocabulary,
+                      header->stringBytes) ||
+        !offsetsValid(model->m_bigramOffsets, vocabulary,
+                      header->bigramCount) ||
+        !offsetsValid(model->m_trigramOffsets, header->bigramCount,
+                      header->trigramCount)) {
+        return nullptr;
+    }
+
+    // Lookups index the unigram tables with these ids unchecked, so a
+    // damaged file must not get past here; the indexer rebuilds it.
+    for (qint64 i = 0; i < blocks; ++i) {
+        if (model->m_blockBest[i] >= vocabulary) {
+            return nullptr;
+        }
+    }
+    for (quint32 i = 0; i < header->bigramCount; ++i) {
+        if (model->m_bigrams[i].word >= vocabulary) {
+            return nullptr;
+        }
+    }
+    for (quint32 i = 0; i < header->trigramCount; ++i) {
+        if ((model->m_trigrams[i] >> 8) >= vocabulary) {
+            return nullptr;
+        }
+    }
+
+    return model;
+}
+
+quint32 NgramModel::vocabularySize() const {
+    return m_header ? m_header->vocabularySize : 0;
+}
+
+quint64 NgramModel::sourceStamp() const {
+    return m_header ? m_header->sourceStamp : 0;
+}
+
+QByteArray NgramModel::wordAt(quint32 id) const {
+    const quint32 begin = m_wordOffsets[id];
+    return QByteArray::fromRawData(m_strings + begin,
+                                   m_wordOffsets[id + 1] - begin);
+}
+
+quint32 NgramModel::findWord(const QByteArray& word) const {
+    quint32 first = 0;
+    quint32 end = m_header->vocabularySize;
+    while (first < end) {
+        const quint32 middle = first + (end - first) / 2;
+        if (wordAt(middle) < word) {
+            first = middle + 1;
+        } else {
+            end = middle;
+        }
+    }
+    return first < m_header->vocabularySize && wordAt(first) == word
+               ? first
+               : INVALID_ID;
+}
+
+void NgramModel::prefixRange(const QByteArray& prefix, quint32& first,
+                             quint32& end) const {
+    // Words are sorted, so the ones starting with prefix are contiguous:
+    // the range starts at the first word not below prefix and ends at
+    // the first word whose leading bytes sort after it.
+    quint32 low = 0;
+    quint32 high = m_header->vocabularySize;
+    while (low < high) {
+        const quint32 middle = low + (high - low) / 2;
+        if (wordAt(middle) < prefix) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    first = low;
+
+    high = m_header->vocabularySize;
+    while (low < high) {
+        const quint32 middle = low + (high - low) / 2;
+        if (wordAt(middle).startsWith(prefix)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    end = low;
+}
+
+quint32 NgramModel::findBigram(quint32 previous, quint32 word) const {
+    quint32 first = m_bigramOffsets[previous];
+    quint32 end = m_bigramOffsets[previous + 1];
+    while (first < end) {
+        const quint32 middle = first + (end - first) / 2;
+        if (m_bigrams[middle].word < word) {
+            first = middle + 1;
+        } else {
+            end = middle;
+        }
+    }
+    return first < m_bigramOffsets[previous + 1] &&
+                   m_bigrams[first].word == word
+               ? first
+               : INVALID_ID;
+}
+
+quint32 NgramModel::bestUnigram(quint32 first, quint32 end,
+                                quint32 skip) const {
+    // A lower quantized value means a higher probability. Whole blocks
+    // are answered from the precomputed per-block best, so a short
+    // prefix costs its range divided by the block size.
+    const quint32 block = NgramFileHeader::UNIGRAM_BLOCK;
+    quint32 best = INVALID_ID;
+    auto consider = [&](quint32 id) {
+        if (id != skip &&
+            (best == INVALID_ID || m_unigramProb[id] < m_unigramProb[best])) {
+            best = id;
+        }
+    };
+
+    quint32 id = first;
+    while (id < end && id % block != 0) {
+        consider(id++);
+    }
+    while (id + block <= end) {
+        const quint32 blockBest = m_blockBest[id / block];
+        if (blockBest == skip) {
+            for (quint32 i = id; i < id + block; ++i) {
+                consider(i);
+            }
+        } else {
+            consider(blockBest);
+        }
+        id += block;
+    }
+    while (id < end) {
+        consider(id++);
+    }
+    return best;
+}
+
+NgramModel::Prediction NgramModel::predict(
+    const QString& prefix, const QString& previousWord,
+    const QString& beforePrevious) const {
+    Prediction prediction;
+    const QByteArray prefixBytes = prefix.toLower().toUtf8();
+    if (prefixBytes.isEmpty()) {
+        return prediction;
+    }
+
+    quint32 first = 0;
+    quint32 end = 0;
+    prefixRange(prefixBytes, first, end);
+    if (first >= end) {
+        return prediction;
+    }
+    // Completions must be longer than the prefix itself.
+    const quint32 exact = wordAt(first) == prefixBytes ? first : INVALID_ID;
+
+    quint32 bestId = INVALID_ID;
+    auto consider = [&](quint32 id, int order, float log10Probability) {
+        if (id != exact && (bestId == INVALID_ID ||
+                            log10Probability > prediction.log10Probability)) {
+            bestId = id;
+            prediction.order = order;
+            prediction.log10Probability = log10Probability;
+        }
+    };
+
+    const quint32 previous = previousWord.isEmpty()
+                                 ? INVALID_ID
+                                 : findWord(previousWord.toLower().toUtf8());
+    const quint32 older = beforePrevious.isEmpty()
+                              ? INVALID_ID
+                              : findWord(beforePrevious.toLower().toUtf8());
+
+    // In backoff form the score of a word seen after a longer context is
+    // never below its backed-off score, so taking the maximum over all
+    // orders picks the word with the highest interpolated probability.
+    float unigramBackoff = 0.0f;
+    if (previous != INVALID_ID) {
+        float bigramBackoff = 0.0f;
+        const quint32 context =
+            older != INVALID_ID ? findBigram(older, previous) : INVALID_ID;
+        if (context != INVALID_ID) {
+            bigramBackoff = NgramQuantizer::decode(m_bigrams[context].backoff);
+
+            quint32 low = m_trigramOffsets[context];
+            quint32 high = m_trigramOffsets[context + 1];
+            while (low < high) {
+                const quint32 middle = low + (high - low) / 2;
+                if ((m_trigrams[middle] >> 8) < first) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            for (quint32 i = low; i < m_trigramOffsets[context + 1]; ++i) {
+                const quint32 id = m_trigrams[i] >> 8;
+                if (id >= end) {
+                    break;
+                }
+                consider(id, 3,
+                         NgramQuantizer::decode(m_trigrams[i] & 0xff));
+            }
+        }
+
+        quint32 low = m_bigramOffsets[previous];
+        quint32 high = m_bigramOffsets[previous + 1];
+        while (low < high) {
+            const quint32 middle = low + (high - low) / 2;
+            if (m_bigrams[middle].word < first) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        for (quint32 i = low; i < m_bigramOffsets[previous + 1]; ++i) {
+            if (m_bigrams[i].word >= end) {
+                break;
+            }
+            consider(m_bigrams[i].word, 2,
+                     bigramBackoff +
+                         NgramQuantizer::decode(m_bigrams[i].probability));
+        }
+
+        unigramBackoff =
+            bigramBackoff + NgramQuantizer::decode(m_unigramBackoff[previous]);
+    }
+
+    if (prefix.length() >= 2) {
+        const quint32 id = bestUnigram(first, end, exact);
+        if (id != INVALID_ID) {
+            consider(id, 1,
+                     unigramBackoff +
+                         NgramQuantizer::decode(m_unigramProb[id]));
+        }
+    }
+
+    if (bestId != INVALID_ID) {
+        prediction.word = QString::fromUtf8(wordAt(bestId));
+    } else {
+        prediction.order = 0;
+    }
+    return prediction;
+}
@@ -0,0 +1,450 @@
+#include "ngrammodelbuilder.h"
+
+#include <QMap>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "ngrammodel.h"
+#include "regexpatterns.h"
+
+namespace {
+
+constexpr quint32 SENTENCE_START = 0;
+constexpr quint32 MAX_WORD_ID = (1u << 21) - 1;
+constexpr quint32 INVALID_ID = std::numeric_limits<quint32>::max();
+constexpr double DISCOUNT = 0.75;
+// Rough footprint of one QHash<quint64, quint32> node while counting.
+constexpr qint64 BYTES_PER_COUNT_ENTRY = 32;
+
+struct Trigram {
+    quint32 first;
+    quint32 second;
+    quint32 third;
+    quint32 count;
+
+    bool operator<(const Trigram& other) const {
+        if (first != other.first) return first < other.first;
+        if (second != other.second) return second < other.second;
+        return third < other.third;
+    }
+};
+
+struct Bigram {
+    quint32 first;
+    quint32 second;
+    quint32 continuation;  // Distinct words seen before (first, second).
+
+    bool operator<(const Bigram& other) const {
+        return first != other.first ? first < other.first
+                                    : second < other.second;
+    }
+};
+
+quint64 packTrigram(quint32 first, quint32 second, quint32 third) {
+    return (quint64(first) << 42) | (quint64(second) << 21) | third;
+}
+
+float toLog10(double probability) {
+    return probability > 0.0 ? float(std::log10(probability))
+                              : -NgramQuantizer::FLOOR;
+}
+
+bool endsSentence(QStringView gap) {
+    for (const QChar c : gap) {
+        if (c == '.' || c == '!' || c == '?' || c == '\n') {
+            return true;
+        }
+    }
+    return false;
+}
+
+qint64 alignedSize(qint64 bytes) { return (bytes + 3) & ~qint64(3); }
+
+bool writeSection(QSaveFile& file, const void* data, qint64 bytes) {
+    static const char padding[4] = {0, 0, 0, 0};
+    if (bytes > 0 &&
+        file.write(static_cast<const char*>(data), bytes) != bytes) {
+        return false;
+    }
+    const qint64 extra = alignedSize(bytes) - bytes;
+    return extra == 0 || file.write(padding, extra) == extra;
+}
+
+int findBigram(const QVector<Bigram>& bigrams, quint32 first,
+               quint32 second) {
+    Bigram key{first, second, 0};
+    auto it = std::lower_bound(bigrams.constBegin(), bigrams.constEnd(), key);
+    if (it == bigrams.constEnd() || it->first != first ||
+        it->second != second) {
+        return -1;
+    }
+    return int(it - bigrams.constBegin());
+}
+
+}  // namespace
+
+NgramModelBuilder::NgramModelBuilder(qint64 memoryBudgetBytes)
+    : m_memoryBudget(memoryBudgetBytes),
+      m_tokenCount(0),
+      m_maxTrigramEntries(int(qBound<qint64>(
+          1024, memoryBudgetBytes / BYTES_PER_COUNT_ENTRY,
+          std::numeric_limits<int>::max() / 2))) {
+    // Id 0 is the sentence-start marker; the empty string sorts first,
+    // so it keeps that id in the written file.
+    m_words.append(QByteArray());
+    m_ids.insert(QByteArray(), SENTENCE_START);
+}
+
+quint32 NgramModelBuilder::intern(const QString& word) {
+    const QByteArray bytes = word.toUtf8();
+    auto it = m_ids.constFind(bytes);
+    if (it != m_ids.constEnd()) {
+        return it.value();
+    }
+    if (quint32(m_words.size()) > MAX_WORD_ID) {
+        return INVALID_ID;
+    }
+
+    const quint32 id = m_words.size();
+    m_words.append(bytes);
+    m_ids.insert(bytes, id);
+    return id;
+}
+
+void NgramModelBuilder::addText(const QString& text) {
+    static const QRegularExpression wordRegex(RegexPatterns::WORD_BOUNDARY);
+    QRegularExpressionMatchIterator it = wordRegex.globalMatch(text);
+
+    quint32 first = SENTENCE_START;
+    quint32 second = SENTENCE_START;
+    qsizetype lastEnd = 0;
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        if (endsSentence(QStringView(text).mid(
+                lastEnd, match.capturedStart() - lastEnd))) {
+            first = SENTENCE_START;
+            second = SENTENCE_START;
+        }
+        lastEnd = match.capturedEnd();
+
+        const quint32 word = intern(match.captured(0).toLower());
+        if (word == INVALID_ID) {
+            first = SENTENCE_START;
+            second = SENTENCE_START;
+            continue;
+        }
+
+        countTrigram(first, second, word);
+        ++m_tokenCount;
+        first = second;
+        second = word;
+    }
+}
+
+void NgramModelBuilder::countTrigram(quint32 first, quint32 second,
+                                     quint32 third) {
+    m_trigramCounts[packTrigram(first, second, third)]++;
+    if (m_trigramCounts.size() > m_maxTrigramEntries) {
+        pruneSingletons();
+    }
+}
+
+void NgramModelBuilder::pruneSingletons() {
+    // Drop the rarest trigrams until a quarter of the table is free, so
+    // pruning runs rarely even on very large workspaces.
+    const qsizetype target = m_maxTrigramEntries * 3 / 4;
+    for (quint32 threshold = 1; m_trigramCounts.size() > target;
+         ++threshold) {
+        for (auto it = m_trigramCounts.begin(); it != m_trigramCounts.end();) {
+            if (it.value() <= threshold) {
+                it = m_trigramCounts.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+bool NgramModelBuilder::write(const QString& filePath,
+                              quint64 sourceStamp) const {
+    // Sorted ids let the reader map a prefix to one contiguous range.
+    const quint32 vocabulary = m_words.size();
+    QVector<quint32> order(vocabulary);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [this](quint32 a, quint32 b) {
+        return m_words[a] < m_words[b];
+    });
+    QVector<quint32> remap(vocabulary);
+    for (quint32 i = 0; i < vocabulary; ++i) {
+        remap[order[i]] = i;
+    }
+
+    QVector<Trigram> trigrams;
+    trigrams.reserve(m_trigramCounts.size());
+    for (auto it = m_trigramCounts.constBegin();
+         it != m_trigramCounts.constEnd(); ++it) {
+        const quint64 key = it.key();
+        trigrams.append({remap[quint32(key >> 42)],
+                         remap[quint32((key >> 21) & MAX_WORD_ID)],
+                         remap[quint32(key & MAX_WORD_ID)], it.value()});
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+
+    // Kneser-Ney continuation counts for the bigram level: how many
+    // distinct words precede each (v, w).
+    QVector<Bigram> bigrams;
+    {
+        QVector<Bigram> pairs;
+        pairs.reserve(trigrams.size());
+        for (const Trigram& trigram : trigrams) {
+            pairs.append({trigram.second, trigram.third, 1});
+        }
+        std::sort(pairs.begin(), pairs.end());
+        for (const Bigram& pair : pairs) {
+            if (!bigrams.isEmpty() && bigrams.last().first == pair.first &&
+                bigrams.last().second == pair.second) {
+                bigrams.last().continuation++;
+            } else {
+                bigrams.append(pair);
+            }
+        }
+    }
+
+    QVector<quint32> followerTypes(vocabulary, 0);
+    QVector<quint64> followerTotals(vocabulary, 0);
+    QVector<quint32> unigramContinuation(vocabulary, 0);
+    for (const Bigram& bigram : bigrams) {
+        followerTypes[bigram.first]++;
+        followerTotals[bigram.first] += bigram.continuation;
+        unigramContinuation[bigram.second]++;
+    }
+
+    QVector<double> unigramProb(vocabulary, 0.0);
+    QVector<double> unigramBackoff(vocabulary, 1.0);
+    const double unigramTotal = double(bigrams.size()) + vocabulary - 1;
+    for (quint32 w = 1; w < vocabulary; ++w) {
+        unigramProb[w] = (unigramContinuation[w] + 1.0) / unigramTotal;
+    }
+    for (quint32 v = 0; v < vocabulary; ++v) {
+        if (followerTotals[v] > 0) {
+            unigramBackoff[v] =
+                DISCOUNT * followerTypes[v] / double(followerTotals[v]);
+        }
+    }
+
+    QVector<double> bigramProb(bigrams.size());
+    QVector<double> bigramBackoff(bigrams.size(), 1.0);
+    for (int i = 0; i < bigrams.size(); ++i) {
+        const Bigram& bigram = bigrams[i];
+        bigramProb[i] =
+            qMax(bigram.continuation - DISCOUNT, 0.0) /
+                double(followerTotals[bigram.first]) +
+            unigramBackoff[bigram.first] * unigramProb[bigram.second];
+    }
+
+    // Trigram level, grouped by context (u, v). Contexts are visited in
+    // the same order as the bigram records they attach to.
+    QVector<int> trigramContext(trigrams.size(), -1);
+    QVector<double> trigramProb(trigrams.size(), 0.0);
+    for (int start = 0; start < trigrams.size();) {
+        int end = start;
+        quint64 total = 0;
+        while (end < trigrams.size() &&
+               trigrams[end].first == trigrams[start].first &&
+               trigrams[end].second == trigrams[start].second) {
+            total += trigrams[end].count;
+            ++end;
+        }
+
+        const int context =
+            findBigram(bigrams, trigrams[start].first, trigrams[start].second);
+        if (context >= 0) {
+            const double backoff = DISCOUNT * (end - start) / double(total);
+            bigramBackoff[context] = backoff;
+            for (int i = start; i < end; ++i) {
+                const int lower = findBigram(bigrams, trigrams[i].second,
+                                             trigrams[i].third);
+                trigramContext[i] = context;
+                trigramProb[i] =
+                    qMax(trigrams[i].count - DISCOUNT, 0.0) / double(total) +
+                    backoff * (lower >= 0 ? bigramProb[lower] : 0.0);
+            }
+        }
+        start = end;
+    }
+
+    // Fit the file into the budget: drop trigrams below a rising count
+    // cutoff first, then bigrams by continuation count. Backoff weights
+    // keep their unpruned values, as with ordinary count cutoffs.
+    qint64 stringBytes = 0;
+    for (const QByteArray& word : m_words) {
+        stringBytes += word.size();
+    }
+    const qint64 blocks = (qint64(vocabulary) + NgramFileHeader::UNIGRAM_BLOCK -
+                           1) / NgramFileHeader::UNIGRAM_BLOCK;
+    const qint64 baseSize =
+        sizeof(NgramFileHeader) + 4 * (qint64(vocabulary) + 1) +
+        alignedSize(stringBytes) + 2 * alignedSize(vocabulary) + 4 * blocks +
+        4 * (qint64(vocabulary) + 1) + 4;
+    if (baseSize > m_memoryBudget) {
+        return false;
+    }
+
+    auto fileSize = [&](qint64 bigramCount, qint64 trigramCount) {
+        return baseSize + bigramCount * qint64(sizeof(NgramBigramRecord) + 4) +
+               trigramCount * 4;
+    };
+
+    // Counts kept at each cutoff come from histograms, so finding the
+    // cutoff does not rescan the n-gram lists.
+    QMap<quint32, qint64> trigramHistogram;
+    for (int i = 0; i < trigrams.size(); ++i) {
+        if (trigramContext[i] >= 0) {
+            trigramHistogram[trigrams[i].count]++;
+        }
+    }
+    QMap<quint32, qint64> bigramHistogram;
+    for (const Bigram& bigram : bigrams) {
+        bigramHistogram[bigram.continuation]++;
+    }
+
+    quint32 minTrigramCount = 1;
+    qint64 trigramCount = 0;
+    for (qint64 kept : trigramHistogram) {
+        trigramCount += kept;
+    }
+    for (auto it = trigramHistogram.constBegin();
+         it != trigramHistogram.constEnd() &&
+         fileSize(bigrams.size(), trigramCount) > m_memoryBudget;
+         ++it) {
+        trigramCount -= it.value();
+        minTrigramCount = it.key() + 1;
+    }
+
+    quint32 minContinuation = 1;
+    qint64 bigramCount = bigrams.size();
+    for (auto it = bigramHistogram.constBegin();
+         it != bigramHistogram.constEnd() && trigramCount == 0 &&
+         fileSize(bigramCount, 0) > m_memoryBudget;
+         ++it) {
+        bigramCount -= it.value();
+        minContinuation = it.key() + 1;
+    }
+
+    // Lay out the sections.
+    QVector<quint32> wordOffsets;
+    QByteArray strings;
+    wordOffsets.reserve(vocabulary + 1);
+    strings.reserve(stringBytes);
+    for (quint32 id : order) {
+        wordOffsets.append(strings.size());
+        strings.append(m_words[id]);
+    }
+    wordOffsets.append(strings.size());
+
+    QVector<quint8> quantizedUnigrams(vocabulary);
+    QVector<quint8> quantizedBackoff(vocabulary);
+    for (quint32 w = 0; w < vocabulary; ++w) {
+        quantizedUnigrams[w] = NgramQuantizer::encode(toLog10(unigramProb[w]));
+        quantizedBackoff[w] =
+            NgramQuantizer::encode(toLog10(unigramBackoff[w]));
+    }
+
+    QVector<quint32> blockBest(blocks);
+    for (qint64 b = 0; b < blocks; ++b) {
+        quint32 best = quint32(b * NgramFileHeader::UNIGRAM_BLOCK);
+        const quint32 end = quint32(qMin<qint64>(
+            vocabulary, (b + 1) * NgramFileHeader::UNIGRAM_BLOCK));
+        for (quint32 id = best + 1; id < end; ++id) {
+            if (quantizedUnigrams[id] < quantizedUnigrams[best]) {
+                best = id;
+            }
+        }
+        blockBest[b] = best;
+    }
+
+    QVector<quint32> bigramOffsets(vocabulary + 1, 0);
+    QVector<NgramBigramRecord> bigramRecords;
+    QVector<int> recordOfBigram(bigrams.size(), -1);
+    bigramRecords.reserve(bigramCount);
+    for (int i = 0; i < bigrams.size(); ++i) {
+        if (bigrams[i].continuation < minContinuation) {
+            continue;
+        }
+        recordOfBigram[i] = bigramRecords.size();
+        bigramOffsets[bigrams[i].first + 1]++;
+        NgramBigramRecord record;
+        record.word = bigrams[i].second;
+        record.probability = NgramQuantizer::encode(toLog10(bigramProb[i]));
+        record.backoff = NgramQuantizer::encode(toLog10(bigramBackoff[i]));
+        record.reserved = 0;
+        bigramRecords.append(record);
+    }
+    for (quint32 v = 0; v < vocabulary; ++v) {
+        bigramOffsets[v + 1] += bigramOffsets[v];
+    }
+
+    QVector<quint32> trigramOffsets(bigramRecords.size() + 1, 0);
+    QVector<quint32> trigramEntries;
+    trigramEntries.reserve(trigramCount);
+    if (trigramCount > 0 && minContinuation == 1) {
+        for (int i = 0; i < trigrams.size(); ++i) {
+            if (trigramContext[i] < 0 ||
+                trigrams[i].count < minTrigramCount) {
+                continue;
+            }
+            const int record = recordOfBigram[trigramContext[i]];
+            if (record < 0) {
+                continue;
+            }
+            trigramOffsets[record + 1]++;
+            trigramEntries.append(
+                (trigrams[i].third << 8) |
+                NgramQuantizer::encode(toLog10(trigramProb[i])));
+        }
+    }
+    for (int r = 0; r < bigramRecords.size(); ++r) {
+        trigramOffsets[r + 1] += trigramOffsets[r];
+    }
+
+    NgramFileHeader header;
+    header.magic = NgramFileHeader::MAGIC;
+    header.version = NgramFileHeader::VERSION;
+    header.sourceStamp = sourceStamp;
+    header.vocabularySize = vocabulary;
+    header.stringBytes = strings.size();
+    header.bigramCount = bigramRecords.size();
+    header.trigramCount = trigramEntries.size();
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    bool ok =
+        writeSection(file, &header, sizeof(header)) &&
+        writeSection(file, wordOffsets.constData(),
+                     wordOffsets.size() * 4) &&
+        writeSection(file, strings.constData(), strings.size()) &&
+        writeSection(file, quantizedUnigrams.constData(), vocabulary) &&
+        writeSection(file, quantizedBackoff.constData(), vocabulary) &&
+        writeSection(file, blockBest.constData(), blockBest.size() * 4) &&
+        writeSection(file, bigramOffsets.constData(),
+                     bigramOffsets.size() * 4) &&
+        writeSection(file, bigramRecords.constData(),
+                     bigramRecords.size() * qint64(sizeof(NgramBigramRecord))) &&
+        writeSection(file, trigramOffsets.constData(),
+                     trigramOffsets.size() * 4) &&
+        writeSection(file, trigramEntries.constData(),
+                     trigramEntries.size() * 4);
+
+    if (!ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
@@ -0,0 +1,173 @@
+#include "prerenderpool.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QJSEngine>
+#include <QJSValue>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QtConcurrent/QtConcurrent>
+
+namespace {
+
+const char* const SCRIPT_FILES[] = {":/js/katex.min.js",
+                                    ":/js/highlight.min.js"};
+
+// Rendered markup of a few large notes; past this the cache starts over.
+const qint64 MAX_CACHE_BYTES = 32 * 1024 * 1024;
+
+struct ScriptEngine {
+    QJSEngine engine;
+    QJSValue katex;
+    QJSValue hljs;
+    bool ready = false;
+};
+
+// A QJSEngine must stay on the thread that created it, so every worker
+// thread gets its own, made on first use.
+QThreadStorage<ScriptEngine*> threadEngines;
+
+ScriptEngine* engineForThread(const QString& script) {
+    if (!threadEngines.hasLocalData()) {
+        auto* scriptEngine = new ScriptEngine;
+        QJSValue result = scriptEngine->engine.evaluate(script);
+        QJSValue global = scriptEngine->engine.globalObject();
+        scriptEngine->katex = global.property("katex");
+        scriptEngine->hljs = global.property("hljs");
+        scriptEngine->ready = !result.isError() &&
+                              scriptEngine->katex.isObject() &&
+                              scriptEngine->hljs.isObject();
+        if (!scriptEngine->ready) {
+            qWarning() << "Failed to load prerender scripts:"
+                       << result.toString();
+        }
+        threadEngines.setLocalData(scriptEngine);
+    }
+    return threadEngines.localData();
+}
+
+}  // namespace
+
+PrerenderPool::PrerenderPool() : m_pool(new QThreadPool), m_cacheBytes(0) {
+    // Starting an engine means parsing both libraries, so its thread is
+    // kept for the whole session instead of expiring when idle.
+    m_pool->setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+    m_pool->setExpiryTimeout(-1);
+
+    for (const char* path : SCRIPT_FILES) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Failed to load prerender script:" << path;
+            m_script.clear();
+            return;
+        }
+        m_script += QString::fromUtf8(file.readAll()) + "\n;\n";
+    }
+}
+
+PrerenderPool* PrerenderPool::instance() {
+    static PrerenderPool pool;
+    return &pool;
+}
+
+QByteArray PrerenderPool::cacheKey(const Item& item) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(item.kind) + '\n' +
+                 item.language.toUtf8() + '\n');
+    hash.addData(item.source.toUtf8());
+    return hash.result();
+}
+
+QString PrerenderPool::renderItem(const Item& item) const {
+    ScriptEngine* scriptEngine = engineForThread(m_script);
+    if (!scriptEngine->ready) {
+        return QString();
+    }
+    QJSValue options = scriptEngine->engine.newObject();
+    QJSValue result;
+
+    if (item.kind == Code) {
+        QJSValue hljs = scriptEngine->hljs;
+        if (item.language.isEmpty()) {
+            result = hljs.property("highlightAuto")
+                         .callWithInstance(hljs, {item.source});
+        } else if (!hljs.property("getLanguage")
+                        .callWithInstance(hljs, {item.language})
+                        .toBool()) {
+            // Unknown languages stay plain, as they did in the page.
+            return item.source.toHtmlEscaped();
+        } else {
+            options.setProperty("language", item.language);
+            options.setProperty("ignoreIllegals", true);
+            result = hljs.property("highlight")
+                         .callWithInstance(hljs, {item.source, options});
+        }
+        if (result.isError()) {
+            return QString();
+        }
+        return result.property("value").toString();
+    }
+
+    // Same options the page passes to KaTeX's auto-render.
+    options.setProperty("displayMode", item.kind == DisplayMath);
+    options.setProperty("throwOnError", false);
+    options.setProperty("strict", false);
+    QJSValue katex = scriptEngine->katex;
+    result = katex.property("renderToString")
+                 .callWithInstance(katex, {item.source, options});
+    if (result.isError()) {
+        return QString();
+    }
+    return result.toString();
+}
+
+QStringList PrerenderPool::render(const QVector<Item>& items) {
+    QVector<QByteArray> keys;
+    keys.reserve(items.size());
+    for (const Item& item : items) {
+        keys.append(cacheKey(item));
+    }
+
+    QStringList results;
+    results.reserve(items.size());
+    QVector<int> missing;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (int i = 0; i < items.size(); ++i) {
+            auto it = m_cache.constFind(keys[i]);
+            if (it != m_cache.constEnd()) {
+                results.append(*it);
+            } else {
+                results.append(QString());
+                missing.append(i);
+            }
+        }
+    }
+    if (missing.isEmpty() || !isAvailable()) {
+        return results;
+    }
+
+    const QList<QString> rendered = QtConcurrent::blockingMapped(
+        m_pool, missing, [this, &items](int index) {
+            return renderItem(items[index]);
+        });
+
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < missing.size(); ++i) {
+        const QString& html = rendered[i];
+        results[missing[i]] = html;
+        if (html.isNull()) {
+            continue;
+        }
+        if (m_cacheBytes + html.size() * 2 > MAX_CACHE_BYTES) {
+            m_cache.clear();
+            m_cacheBytes = 0;
+        }
+        m_cache.insert(keys[missing[i]], html);
+        m_cacheBytes += html.size() * 2;
+    }
+    return results;
+}
@@ -1,30 +1,35 @@
 #include "markdownpreview.h"
 
-#include <md4c-html.h>
-
 #include <QAction>
 #include <QApplication>
 #include <QContextMenuEvent>
 #include <QDesktopServices>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileSystemWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QKeySequence>
-#include <QMap>
 #include <QMenu>
-#include <QRegularExpression>
 #include <QSettings>
 #include <QShortcut>
 #include <QStyleHints>
 #include <QTextDocument>
 #include <QTimer>
 #include <QUrl>
+#include <QWebChannel>
 #include <QWebEnginePage>
 #include <QWebEngineProfile>
 #include <QWebEngineSettings>
 
 #include "defs.h"
-#include "regexpatterns.h"
-#include "regexutils.h"
+#include "inclusioncache.h"
+#include "mermaidcache.h"
+#include "previewbridge.h"
+#include "previewpatch.h"
+#include "previewschemehandler.h"
 #include "thememanager.h"
 
 class WikiLinkPage : public QWebEnginePage {
@@ -57,11 +62,23 @@ class WikiLinkPage : public QWebEnginePage {
             emit preview->markdownLinkClicked(url.toLocalFile());
             return false;
         }
+        // Relative links in raw HTML resolve against the page's
+        // treemk://preview directory.
+        QString previewFile = PreviewSchemeHandler::localFilePath(url);
+        if (previewFile.endsWith(".md", Qt::CaseInsensitive)) {
+            emit preview->markdownLinkClicked(previewFile);
+            return false;
+        }
         if (url.hasFragment()) {
             QString fragment = url.fragment();
             QString path = url.path();
             
-            if (path.isEmpty() || path == "/" || url.scheme().isEmpty()) {
+            // Pages whose base was switched resolve #anchors against
+            // the note's directory.
+            if (path.isEmpty() || path == "/" || url.scheme().isEmpty() ||
+                (url.scheme() == QString::fromLatin1(
+                                     PreviewSchemeHandler::SCHEME) &&
+                 path.endsWith('/'))) {
                 emit preview->internalLinkClicked(fragment);
                 return false;
             }
@@ -77,22 +94,45 @@ class WikiLinkPage : public QWebEnginePage {
     MarkdownPreview* preview;
 };
 
+int MarkdownPreview::nextPreviewId = 1;
+
 MarkdownPreview::MarkdownPreview(QWidget* parent)
     : QWebEngineView(parent),
       currentTheme("light"),
       basePath(QDir::homePath()),
-      latexEnabled(true),
       lastScrollPercentage(0.0),
+      lastSourceLine(0.0),
       lastMarkdownContent(""),
-      scrollCheckTimer(nullptr),
-      isScrollingFromEditor(false) {
+      isScrollingFromEditor(false),
+      bridge(nullptr),
+      inclusionWatcher(nullptr),
+      previewId(nextPreviewId++),
+      shellVersion(0),
+      loadedShellVersion(-1),
+      pageLoaded(false),
+      hasPendingBlocks(false),
+      renderInFlight(false),
+      hasQueuedRender(false) {
     setContextMenuPolicy(Qt::CustomContextMenu);
     WikiLinkPage* wikiPage = new WikiLinkPage(this);
     setPage(wikiPage);
     page()->settings()->setAttribute(
         QWebEngineSettings::LocalContentCanAccessRemoteUrls, true);
+
+    // The page pushes scroll positions and rendered diagrams as they
+    // happen, so nothing has to poll it.
+    bridge = new PreviewBridge(this);
+    connect(bridge, &PreviewBridge::scrolled, this,
+            &MarkdownPreview::onPageScrolled);
+    connect(bridge, &PreviewBridge::diagramRendered, this,
+            &MarkdownPreview::onDiagramRendered);
+    QWebChannel* channel = new QWebChannel(this);
+    channel->registerObject("treemkBridge", bridge);
+    page()->setWebChannel(channel);
     connect(this, &QWidget::customContextMenuRequested, this,
             &MarkdownPreview::showContextMenu);
+    connect(this, &QWebEngineView::loadFinished, this,
+            &MarkdownPreview::onLoadFinished);
     QShortcut* reloadShortcut = new QShortcut(QKeySequence(Qt::Key_F5), this);
     connect(reloadShortcut, &QShortcut::activated, this,
             &MarkdownPreview::reloadPreview);
@@ -104,27 +144,337 @@ MarkdownPreview::MarkdownPreview(QWidget* parent)
                 &MarkdownPreview::onThemeChanged);
     }
 
-    scrollCheckTimer = new QTimer(this);
-    scrollCheckTimer->setInterval(200);
-    connect(scrollCheckTimer, &QTimer::timeout, this,
-            &MarkdownPreview::checkScrollPosition);
-    scrollCheckTimer->start();
+    inclusionWatcher = new QFileSystemWatcher(this);
+    connect(inclusionWatcher, &QFileSystemWatcher::fileChanged, this,
+            &MarkdownPreview::onIncludedFileChanged);
+
+    // One render at a time; see setMarkdownContent().
+    renderPool.setMaxThreadCount(1);
+    // Math and code arrive as finished markup instead of being typeset
+    // by the page.
+    renderer.setPrerenderEnabled(true);
+    // Blocks carry their source lines for scroll sync.
+    renderer.setSourceLinesEnabled(true);
 }
 
-MarkdownPreview::~MarkdownPreview() {}
+MarkdownPreview::~MarkdownPreview() {
+    // Running jobs post back to this object; let them finish first.
+    renderPool.clear();
+    renderPool.waitForDone();
+    PreviewSchemeHandler::instance()->removeDocument(previewId);
+}
 
-void MarkdownPreview::setBasePath(const QString& path) { basePath = path; }
+void MarkdownPreview::setBasePath(const QString& path) {
+    basePath = path;
+    renderer.setBasePath(path);
+}
 
-void MarkdownPreview::setLatexEnabled(bool enabled) { latexEnabled = enabled; }
+void MarkdownPreview::setLatexEnabled(bool enabled) {
+    renderer.setLatexEnabled(enabled);
+}
+
+void MarkdownPreview::setWorkspacePath(const QString& path) {
+    workspacePath = path;
+    renderer.setDiagramCache(workspacePath, mermaidTheme);
+}
 
-void MarkdownPreview::setMarkdownContent(const QString& markdown) {
+void MarkdownPreview::setMarkdownContent(const QString& markdown,
+                                         int documentId, quint64 revision) {
     lastMarkdownContent = markdown;
-    QString html = convertMarkdownToHtml(markdown);
-    html = processWikiLinks(html);
-    html = addHeadingIds(html);
-    if (latexEnabled) {
-        html = processLatexFormulas(html);
+    // The renderer looks diagrams up for the shell's Mermaid theme.
+    if (shellParts.isEmpty()) {
+        rebuildPageShell();
+    }
+
+    if (documentId > 0) {
+        // Switching back to an unchanged tab shows its last output. This
+        // outdates the render in flight and any request waiting for it.
+        QStringList blocks;
+        QStringList includedFiles;
+        if (renderCache.find(documentId, revision, renderSettings(), blocks,
+                             includedFiles)) {
+            hasQueuedRender = false;
+            const int generation = renderGeneration.fetchAndAddRelaxed(1) + 1;
+            showRenderedBlocks(generation, blocks, includedFiles);
+            return;
+        }
+    }
+
+    RenderRequest request;
+    request.markdown = markdown;
+    request.documentId = documentId;
+    request.revision = revision;
+    // One render at a time: a request made meanwhile waits for the one
+    // in flight, and replaces any request already waiting.
+    if (renderInFlight) {
+        queuedRender = request;
+        hasQueuedRender = true;
+        return;
+    }
+    startRender(request);
+}
+
+void MarkdownPreview::startRender(RenderRequest request) {
+    // Rendering runs on the pool so a large note never blocks typing.
+    // Each render bumps the generation; a job that is already outdated
+    // when it starts is skipped, and an outdated result is dropped.
+    renderInFlight = true;
+    request.settings = renderSettings();
+    const int generation = renderGeneration.fetchAndAddRelaxed(1) + 1;
+    const MarkdownRenderer snapshot = renderer;
+    renderPool.start([this, generation, snapshot, request]() {
+        QElapsedTimer timer;
+        timer.start();
+        QStringList blocks;
+        QStringList includedFiles;
+        const bool current = generation == renderGeneration.loadRelaxed();
+        if (current) {
+            blocks = PreviewPatch::splitBlocks(
+                snapshot.render(request.markdown, &includedFiles));
+        }
+        const qint64 elapsed = timer.elapsed();
+        QMetaObject::invokeMethod(
+            this,
+            [this, generation, request, current, blocks, includedFiles,
+             elapsed]() {
+                finishRender(generation, request, current, blocks,
+                             includedFiles, elapsed);
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+void MarkdownPreview::finishRender(int generation,
+                                   const RenderRequest& request,
+                                   bool rendered, const QStringList& blocks,
+                                   const QStringList& includedFiles,
+                                   qint64 elapsedMs) {
+    renderInFlight = false;
+    if (rendered) {
+        storeRenderedBlocks(request, blocks, includedFiles);
+        emit renderFinished(request.documentId, elapsedMs);
+        showRenderedBlocks(generation, blocks, includedFiles);
+    }
+    if (hasQueuedRender) {
+        hasQueuedRender = false;
+        startRender(queuedRender);
+    }
+}
+
+QString MarkdownPreview::renderSettings() const {
+    // Everything besides the note itself that goes into its blocks.
+    return QString("%1\n%2\n%3\n%4")
+        .arg(basePath)
+        .arg(int(renderer.isLatexEnabled()))
+        .arg(workspacePath, mermaidTheme);
+}
+
+void MarkdownPreview::storeRenderedBlocks(const RenderRequest& request,
+                                          const QStringList& blocks,
+                                          const QStringList& includedFiles) {
+    if (request.documentId <= 0) {
+        return;
+    }
+    // Diagrams without a cached SVG yet are rendered by the page; the
+    // next render of the note picks their SVG up instead.
+    for (const QString& block : blocks) {
+        if (block.contains("data-mermaid-key")) {
+            renderCache.remove(request.documentId);
+            return;
+        }
+    }
+    renderCache.store(request.documentId, request.revision, request.settings,
+                      blocks, includedFiles);
+}
+
+void MarkdownPreview::showRenderedBlocks(int generation,
+                                         const QStringList& blocks,
+                                         const QStringList& includedFiles) {
+    if (generation != renderGeneration.loadRelaxed()) {
+        return;
+    }
+    watchIncludedFiles(includedFiles);
+
+    // The page is only reloaded when its shell changes (theme or
+    // styles); otherwise the changed blocks are patched in place and the
+    // scripts, diagrams and layout of the rest survive.
+    if (shellParts.isEmpty()) {
+        rebuildPageShell();
+        if (shellParts.isEmpty()) {
+            return;
+        }
     }
+    if (loadedShellVersion != shellVersion) {
+        loadPage(blocks);
+        return;
+    }
+    if (!pageLoaded) {
+        pendingBlocks = blocks;
+        hasPendingBlocks = true;
+        return;
+    }
+    applyBlocks(blocks);
+}
+
+void MarkdownPreview::loadPage(const QStringList& blocks) {
+    loadedShellVersion = shellVersion;
+    loadedBasePath = basePath;
+    pageLoaded = false;
+    hasPendingBlocks = false;
+    pendingBlocks.clear();
+    renderedBlockKeys = PreviewPatch::blockKeys(blocks);
+    renderedBlockLines = blockLines(blocks);
+
+    QJsonObject scrollPosition;
+    scrollPosition["line"] = lastSourceLine;
+    scrollPosition["percentage"] = lastScrollPercentage;
+    QJsonArray lines;
+    for (int line : renderedBlockLines) {
+        lines.append(line);
+    }
+    scrollPosition["lines"] = lines;
+
+    // The initial blocks sit inside a script element, which must not see
+    // a closing tag or a comment opener in the content.
+    QString blocksJson = blocksToJson(blocks)
+                             .replace("</", "<\\/")
+                             .replace("<!--", "<\\!--");
+    QString fullHtml =
+        shellParts[0] +
+        QString::fromUtf8(
+            QJsonDocument(scrollPosition).toJson(QJsonDocument::Compact)) +
+        shellParts[1] + blocksJson + shellParts[2];
+    // Served through the treemk: scheme; setHtml() cannot take pages
+    // over 2 MB, which notes with inclusions easily reach.
+    load(PreviewSchemeHandler::instance()->setDocument(
+        previewId, basePath, fullHtml.toUtf8()));
+}
+
+void MarkdownPreview::applyBlocks(const QStringList& blocks) {
+    QVector<size_t> keys = PreviewPatch::blockKeys(blocks);
+    // A note from another directory only needs another base URL, but
+    // every block is replaced so that its relative URLs resolve anew.
+    const bool baseChanged = basePath != loadedBasePath;
+    PreviewPatch::Patch patch;
+    if (baseChanged) {
+        loadedBasePath = basePath;
+        patch.removeCount = renderedBlockKeys.size();
+        patch.blocks = blocks;
+    } else {
+        patch = PreviewPatch::diff(renderedBlockKeys, keys, blocks);
+    }
+    renderedBlockKeys = keys;
+    // Blocks keep their keys when only their line changes, so the lines
+    // are sent on their own, and only when they moved.
+    QVector<int> lines = blockLines(blocks);
+    const bool linesChanged = lines != renderedBlockLines;
+    renderedBlockLines = lines;
+    if (patch.isEmpty() && !linesChanged && !baseChanged) {
+        return;
+    }
+
+    QString script = "if (window.treemkPreview) {";
+    if (baseChanged) {
+        QString url = QString::fromUtf8(
+            PreviewSchemeHandler::baseUrl(basePath).toEncoded());
+        url.replace('\\', "\\\\").replace('\'', "\\'");
+        script += QString("window.treemkPreview.setBase('%1');").arg(url);
+    }
+    script += QString("window.treemkPreview.patch(%1, %2, %3, %4);}")
+                  .arg(patch.start)
+                  .arg(patch.removeCount)
+                  .arg(blocksToJson(patch.blocks),
+                       linesChanged ? linesToJson(lines) : QString("null"));
+    page()->runJavaScript(script);
+}
+
+void MarkdownPreview::onLoadFinished(bool ok) {
+    if (!ok) {
+        // Force a full load on the next update.
+        loadedShellVersion = -1;
+        return;
+    }
+    pageLoaded = true;
+    if (hasPendingBlocks) {
+        hasPendingBlocks = false;
+        applyBlocks(pendingBlocks);
+        pendingBlocks.clear();
+    }
+}
+
+void MarkdownPreview::watchIncludedFiles(const QStringList& files) {
+    const QStringList watched = inclusionWatcher->files();
+    QStringList removed;
+    for (const QString& path : watched) {
+        if (!files.contains(path)) {
+            removed.append(path);
+        }
+    }
+    if (!removed.isEmpty()) {
+        inclusionWatcher->removePaths(removed);
+    }
+    // Files replaced by a save drop out of the watcher, so they are
+    // added again after every render.
+    QStringList added;
+    for (const QString& path : files) {
+        if (!watched.contains(path) && !path.startsWith(':')) {
+            added.append(path);
+        }
+    }
+    if (!added.isEmpty()) {
+        inclusionWatcher->addPaths(added);
+    }
+}
+
+void MarkdownPreview::onIncludedFileChanged(const QString& path) {
+    InclusionCache::instance()->invalidate(path);
+    if (!lastMarkdownContent.isEmpty()) {
+        setMarkdownContent(lastMarkdownContent);
+    }
+}
+
+void MarkdownPreview::onDiagramRendered(const QString& key,
+                                        const QString& svg) {
+    // Diagrams rendered by the page are stored, so the next render of
+    // the same source puts the SVG in directly.
+    MermaidCache::instance()->store(workspacePath, key, svg);
+}
+
+QVector<int> MarkdownPreview::blockLines(const QStringList& blocks) const {
+    QVector<int> lines;
+    lines.reserve(blocks.size() + 1);
+    for (const QString& block : blocks) {
+        lines.append(PreviewPatch::sourceLine(block));
+    }
+    // The line past the end closes the range of the last block.
+    lines.append(int(lastMarkdownContent.count('\n')) + 2);
+    return lines;
+}
+
+QString MarkdownPreview::blocksToJson(const QStringList& blocks) {
+    return QString::fromUtf8(
+        QJsonDocument(QJsonArray::fromStringList(blocks))
+            .toJson(QJsonDocument::Compact));
+}
+
+QString MarkdownPreview::linesToJson(const QVector<int>& lines) {
+    QStringList numbers;
+    numbers.reserve(lines.size());
+    for (int line : lines) {
+        numbers.append(QString::number(line));
+    }
+    return '[' + numbers.join(',') + ']';
+}
+
+void MarkdownPreview::reloadStyles() {
+    shellParts.clear();
+    ++shellVersion;
+    if (!lastMarkdownContent.isEmpty()) {
+        setMarkdownContent(lastMarkdownContent);
+    }
+}
+
+QString MarkdownPreview::pageStyleSheet() const {
     QString baseStyleSheet = ThemeManager::instance()->getPreviewStyleSheet();
     QString imageStyleSheet = "img { max-width: 100%; height: auto; }";
     QString taskStyles;
@@ -135,7 +485,20 @@ void MarkdownPreview::setMarkdownContent(const QString& markdown) {
     }
     QString previewStyleSheet =
         baseStyleSheet + "\n" + imageStyleSheet + "\n" + taskStyles;
-    QString highlightTheme = "highlight-github.min.css";
+    // The setting holds the path of a stylesheet picked in the settings
+    // dialog; older settings may hold the CSS itself.
+    QSettings appSettings(APP_LABEL, APP_LABEL);
+    QString customCSS = appSettings.value("preview/customCSS", "").toString();
+    QFile customFile(customCSS);
+    if (!customCSS.isEmpty() && customFile.exists() &&
+        customFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        customCSS = QString::fromUtf8(customFile.readAll());
+        customFile.close();
+    }
+    return previewStyleSheet + "\n" + customCSS;
+}
+
+bool MarkdownPreview::isDarkScheme() const {
     QSettings appSettings(APP_LABEL, APP_LABEL);
     QString previewScheme =
         appSettings.value("appearance/previewColorScheme", "auto").toString();
@@ -155,40 +518,45 @@ void MarkdownPreview::setMarkdownContent(const QString& markdown) {
     } else if (previewScheme == "dark") {
         isDark = true;
     }
+    return isDark;
+}
 
-    if (isDark) {
-        highlightTheme = "highlight-github-dark.min.css";
-    }
-    QString customCSS = appSettings.value("preview/customCSS", "").toString();
-    previewStyleSheet += "\n" + customCSS;
+void MarkdownPreview::rebuildPageShell() {
+    const QString previewStyleSheet = pageStyleSheet();
+    const bool isDark = isDarkScheme();
+    const QString highlightTheme = isDark ? "highlight-github-dark.min.css"
+                                          : "highlight-github.min.css";
     QFile templateFile(":/templates/preview-template.html");
     if (!templateFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
         qWarning() << "Failed to load preview template";
         return;
     }
-    QString fullHtml = QString::fromUtf8(templateFile.readAll());
+    QString shell = QString::fromUtf8(templateFile.readAll());
     templateFile.close();
-    QString mermaidTheme = isDark ? "dark" : "default";
-    fullHtml.replace("HIGHLIGHT_THEME", highlightTheme);
-    fullHtml.replace("MERMAID_THEME", mermaidTheme);
-    fullHtml.replace("CUSTOM_STYLESHEET", previewStyleSheet);
-    fullHtml.replace("SCROLL_PERCENTAGE",
-                     QString::number(lastScrollPercentage));
-    fullHtml.replace("MARKDOWN_CONTENT", html);
-    QUrl baseUrl;
-    if (basePath.startsWith("qrc:") || basePath.startsWith(":/")) {
-        QString qrcPath = basePath;
-        if (qrcPath.startsWith(":/")) {
-            qrcPath = "qrc" + qrcPath;
-        }
-        if (!qrcPath.endsWith("/")) {
-            qrcPath += "/";
-        }
-        baseUrl = QUrl(qrcPath);
-    } else {
-        baseUrl = QUrl::fromLocalFile(basePath + "/");
+    mermaidTheme = isDark ? "dark" : "default";
+    renderer.setDiagramCache(workspacePath, mermaidTheme);
+    shell.replace("HIGHLIGHT_THEME", highlightTheme);
+    shell.replace("MERMAID_THEME", mermaidTheme);
+
+    // Split around the per-load values before the stylesheet goes in, so
+    // that its text cannot be mistaken for a placeholder.
+    const QLatin1String scrollMarker("SCROLL_POSITION");
+    const QLatin1String blocksMarker("MARKDOWN_BLOCKS");
+    const int scrollPos = shell.indexOf(scrollMarker);
+    const int blocksPos =
+        scrollPos < 0 ? -1 : shell.indexOf(blocksMarker, scrollPos);
+    if (blocksPos < 0) {
+        qWarning() << "Preview template lacks its placeholders";
+        return;
     }
-    setHtml(fullHtml, baseUrl);
+    const int scrollEnd = scrollPos + scrollMarker.size();
+    QStringList parts;
+    parts << shell.left(scrollPos) << shell.mid(scrollEnd, blocksPos - scrollEnd)
+          << shell.mid(blocksPos + blocksMarker.size());
+    for (QString& part : parts) {
+        part.replace("CUSTOM_STYLESHEET", previewStyleSheet);
+    }
+    shellParts = parts;
 }
 
 void MarkdownPreview::scrollToAnchor(const QString& anchor) {
@@ -216,11 +584,17 @@ void MarkdownPreview::scrollToAnchor(const QString& anchor) {
 
 void MarkdownPreview::setTheme(const QString& theme) { currentTheme = theme; }
 void MarkdownPreview::scrollToPercentage(double percentage) {
+    scrollToSourceLine(0.0, percentage);
+}
+
+void MarkdownPreview::scrollToSourceLine(double line, double percentage) {
     isScrollingFromEditor = true;
+    lastSourceLine = line;
     lastScrollPercentage = percentage;
-    QString script =
-        QString("if (document.body) window.scrollTo(0, document.body.scrollHeight * %1);")
-            .arg(percentage);
+    QString script = QString("if (window.treemkPreview) "
+                             "window.treemkPreview.scrollToLine(%1, %2);")
+                         .arg(line)
+                         .arg(percentage);
     page()->runJavaScript(script);
     QTimer::singleShot(300, this, [this]() { isScrollingFromEditor = false; });
 }
@@ -229,34 +603,6 @@ double MarkdownPreview::currentScrollPercentage() const {
     return lastScrollPercentage;
 }
 
-QString MarkdownPreview::convertMarkdownToHtml(const QString& markdown) {
-    struct OutputBuffer {
-        QString html;
-    };
-    auto processOutput = [](const MD_CHAR* data, MD_SIZE size, void* userdata) {
-        OutputBuffer* buffer = static_cast<OutputBuffer*>(userdata);
-        buffer->html.append(QString::fromUtf8(data, size));
-    };
-    OutputBuffer buffer;
-    QByteArray utf8Data = markdown.toUtf8();
-    unsigned parserFlags =
-        MD_FLAG_TABLES |                    // Enable tables
-        MD_FLAG_STRIKETHROUGH |             // Enable ~~strikethrough~~
-        MD_FLAG_TASKLISTS |                 // Enable task lists [ ] [x]
-        MD_FLAG_LATEXMATHSPANS |            // Enable $math$ and $$math$$
-        MD_FLAG_WIKILINKS |                 // Enable [[wiki links]]
-        MD_FLAG_PERMISSIVEURLAUTOLINKS |    // Auto-link URLs
-        MD_FLAG_PERMISSIVEEMAILAUTOLINKS |  // Auto-link emails
-        MD_FLAG_PERMISSIVEWWWAUTOLINKS;     // Auto-link www.example.com
-    unsigned rendererFlags = 0;
-    int result = md_html(utf8Data.constData(), utf8Data.size(), processOutput,
-                         &buffer, parserFlags, rendererFlags);
-    if (result != 0) {
-        return "<p style=\"color: red;\">Error parsing markdown</p>";
-    }
-    return buffer.html;
-}
-
 QString MarkdownPreview::getStyleSheet(const QString& theme) {
     QFile baseFile(":/css/preview-base.css");
     if (!baseFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -283,201 +629,6 @@ QString MarkdownPreview::getStyleSheet(const QString& theme) {
     return baseStyle + "\n" + themeStyle;
 }
 
-QString MarkdownPreview::processLatexFormulas(const QString& html) {
-    QString result = html;
-    result.replace(
-        QRegularExpression(RegexPatterns::LATEX_DISPLAY_EQUATION),
-        "$$\\1$$");
-    result.replace(
-        QRegularExpression(RegexPatterns::LATEX_INLINE_EQUATION),
-        "$\\1$");
-    return result;
-}
-
-QString MarkdownPreview::processWikiLinks(const QString& html) {
-    QString result = html;
-    
-    QRegularExpression codeBlockPattern(
-        RegexPatterns::HTML_CODE,
-        QRegularExpression::DotMatchesEverythingOption);
-    QRegularExpressionMatchIterator codeIt = codeBlockPattern.globalMatch(result);
-    QList<QRegularExpressionMatch> codeMatches;
-    while (codeIt.hasNext()) {
-        codeMatches.prepend(codeIt.next());
-    }
-    
-    for (const QRegularExpressionMatch& match : codeMatches) {
-        QString codeAttrs = match.captured(1);
-        QString codeContent = match.captured(2);
-        
-        QRegularExpression inclusionPattern(RegexPatterns::INCLUSION_PATTERN);
-        QRegularExpressionMatch inclMatch = inclusionPattern.match(codeContent);
-        if (!inclMatch.hasMatch()) {
-            continue;
-        }
-        
-        QString processedContent = codeContent;
-        while (true) {
-            QRegularExpressionMatch inclMatch = inclusionPattern.match(processedContent);
-            if (!inclMatch.hasMatch()) {
-                break;
-            }
-            
-            QString target = inclMatch.captured(1).trimmed();
-            
-            QString errorMsg;
-            QString fileContent = readFileContent(target, errorMsg);
-            
-            if (!errorMsg.isEmpty()) {
-                fileContent = QString("Error: %1").arg(errorMsg);
-            }
-            
-            fileContent = fileContent.toHtmlEscaped();
-            
-            processedContent.replace(inclMatch.capturedStart(), 
-                                    inclMatch.capturedLength(), 
-                                    fileContent);
-        }
-        
-        QString replacement = QString("<code%1>%2</code>").arg(codeAttrs, processedContent);
-        result.replace(match.capturedStart(), match.capturedLength(), replacement);
-    }
-    
-    QRegularExpression inclusionPattern(RegexPatterns::MD4C_WIKILINK_INCLUSION);
-    QRegularExpressionMatchIterator inclusionIt =
-        inclusionPattern.globalMatch(result);
-    QList<QRegularExpressionMatch> inclusionMatches;
-    while (inclusionIt.hasNext()) {
-        inclusionMatches.prepend(inclusionIt.next());
-    }
-    for (const QRegularExpressionMatch& match : inclusionMatches) {
-        QString target = match.captured(1).trimmed();
-        QString display = match.captured(2).trimmed();
-        if (display.startsWith("!")) {
-            display = target;
-        }
-        QString includedContent = resolveAndIncludeFile(target, display);
-        result.replace(match.capturedStart(), match.capturedLength(),
-                       includedContent);
-    }
-    result.replace(
-        QRegularExpression(RegexPatterns::MD4C_WIKILINK),
-        "<a href=\"wiki:\\1\" class=\"wiki-link\">\\2</a>");
-
-    QRegularExpression linkPattern(RegexPatterns::HTML_ANCHOR);
-    QRegularExpressionMatchIterator linkIt = linkPattern.globalMatch(result);
-    QList<QRegularExpressionMatch> linkMatches;
-    while (linkIt.hasNext()) {
-        linkMatches.prepend(linkIt.next());
-    }
-    for (const QRegularExpressionMatch& match : linkMatches) {
-        QString href = match.captured(1);
-        QString text = match.captured(2);
-        QString replacement;
-        if (href.startsWith("http://") || href.startsWith("https://")) {
-            replacement = QString("<a href=\"%1\">%2</a>").arg(href, text);
-        } else {
-            replacement =
-                QString(
-                    "<a href=\"markdown:%1\" class=\"markdown-link\">%2</a>")
-                    .arg(href, text);
-        }
-        result.replace(match.capturedStart(), match.capturedLength(),
-                       replacement);
-    }
-    return result;
-}
-
-QString MarkdownPreview::resolveAndIncludeFile(const QString& linkTarget,
-                                               const QString& displayText) {
-    QDir baseDir(basePath);
-    QString cleanTarget = linkTarget.trimmed();
-    QStringList possibleFiles;
-    possibleFiles << cleanTarget + ".md" << cleanTarget + ".markdown"
-                  << cleanTarget;
-    QString resolvedPath;
-    for (const QString& fileName : possibleFiles) {
-        QString fullPath = baseDir.filePath(fileName);
-        if (QFileInfo::exists(fullPath)) {
-            resolvedPath = fullPath;
-            break;
-        }
-    }
-    if (resolvedPath.isEmpty()) {
-        return QString(
-                   "<div class=\"inclusion-error\" style=\"border: 1px solid "
-                   "#ff6b6b; "
-                   "background-color: #ffe0e0; padding: 10px; margin: 10px 0; "
-                   "border-radius: 5px;\">"
-                   "<strong>Inclusion Error:</strong> File not found: %1"
-                   "</div>")
-            .arg(linkTarget.toHtmlEscaped());
-    }
-    QFile file(resolvedPath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return QString(
-                   "<div class=\"inclusion-error\" style=\"border: 1px solid "
-                   "#ff6b6b; "
-                   "background-color: #ffe0e0; padding: 10px; margin: 10px 0; "
-                   "border-radius: 5px;\">"
-                   "<strong>Inclusion Error:</strong> Cannot read file: %1"
-                   "</div>")
-            .arg(linkTarget.toHtmlEscaped());
-    }
-    QTextStream in(&file);
-    in.setEncoding(QStringConverter::Utf8);
-    QString content = in.readAll();
-    file.close();
-    QString includedHtml = convertMarkdownToHtml(content);
-    QString wrappedContent =
-        QString(
-            "<div class=\"included-content\" "
-            "style=\"border-left: 3px solid #4ade80; "
-            "padding-left: 15px; margin: 20px 0;\">"
-            "<div class=\"inclusion-title\" "
-            "style=\"font-weight: bold; color: #0a8a0a; "
-            "margin-bottom: 10px;\">%1</div>"
-            "%2"
-            "</div>")
-            .arg(displayText.toHtmlEscaped(), includedHtml);
-    return wrappedContent;
-}
-
-QString MarkdownPreview::readFileContent(const QString& linkTarget,
-                                         QString& errorMsg) {
-    QDir baseDir(basePath);
-    QString cleanTarget = linkTarget.trimmed();
-    QStringList possibleFiles;
-    possibleFiles << cleanTarget << cleanTarget + ".md"
-                  << cleanTarget + ".markdown" << cleanTarget + ".txt"
-                  << cleanTarget + ".py" << cleanTarget + ".cpp"
-                  << cleanTarget + ".java" << cleanTarget + ".js"
-                  << cleanTarget + ".rs" << cleanTarget + ".go";
-    QString resolvedPath;
-    for (const QString& fileName : possibleFiles) {
-        QString fullPath = baseDir.filePath(fileName);
-        if (QFileInfo::exists(fullPath)) {
-            resolvedPath = fullPath;
-            break;
-        }
-    }
-    if (resolvedPath.isEmpty()) {
-        errorMsg = QString("File not found: %1").arg(linkTarget);
-        return QString();
-    }
-    QFile file(resolvedPath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        errorMsg = QString("Cannot read file: %1").arg(linkTarget);
-        return QString();
-    }
-    QTextStream in(&file);
-    in.setEncoding(QStringConverter::Utf8);
-    QString content = in.readAll();
-    file.close();
-    errorMsg.clear();
-    return content;
-}
-
 void MarkdownPreview::showContextMenu(const QPoint& pos) {
     QString jsCode = QString(
                          "(function() {"
@@ -529,71 +680,27 @@ void MarkdownPreview::showContextMenu(const QPoint& pos) {
     });
 }
 
-void MarkdownPreview::reloadPreview() { reload(); }
-
-void MarkdownPreview::onThemeChanged() {
-    if (!lastMarkdownContent.isEmpty()) {
-        setMarkdownContent(lastMarkdownContent);
-    }
+void MarkdownPreview::reloadPreview() {
+    // The page was loaded with the blocks of its first render; reloading
+    // it as is would bring those back, so build it again from the
+    // current content, rendered anew.
+    loadedShellVersion = -1;
+    renderCache.clear();
+    setMarkdownContent(lastMarkdownContent);
 }
 
-QString MarkdownPreview::addHeadingIds(const QString& html) {
-    QString result = html;
-    QMap<QString, int> anchorCounts;
-    
-    QRegularExpression headingPattern(
-        RegexPatterns::HTML_HEADING,
-        QRegularExpression::CaseInsensitiveOption
-    );
-    
-    QRegularExpressionMatchIterator it = headingPattern.globalMatch(html);
-    QList<QRegularExpressionMatch> matches;
-    
-    while (it.hasNext()) {
-        matches.prepend(it.next());
-    }
-    
-    for (const QRegularExpressionMatch& match : matches) {
-        QString tag = match.captured(1);
-        QString attributes = match.captured(2);
-        QString headingText = match.captured(3);
-        
-        QString slug = RegexUtils::generateSlug(headingText);
-        
-        if (anchorCounts.contains(slug)) {
-            anchorCounts[slug]++;
-            slug += QString("-%1").arg(anchorCounts[slug]);
-        } else {
-            anchorCounts[slug] = 1;
-        }
-        
-        QString newHeading = QString(
-            "<%1%2 id=\"%3\">%4</%1>"
-        ).arg(tag, attributes, slug, headingText);
-        
-        result.replace(match.capturedStart(), match.capturedLength(), newHeading);
-    }
-    
-    return result;
-}
+void MarkdownPreview::onThemeChanged() { reloadStyles(); }
 
-void MarkdownPreview::checkScrollPosition() {
+void MarkdownPreview::onPageScrolled(double line, double percentage) {
     if (isScrollingFromEditor) {
         return;
     }
-    QString script =
-        "(function() {"
-        "  if (!document.body) return 0;"
-        "  var scrollPercentage = window.scrollY / (document.body.scrollHeight - window.innerHeight);"
-        "  return isNaN(scrollPercentage) ? 0 : scrollPercentage;"
-        "})();";
-
-    page()->runJavaScript(script, [this](const QVariant& result) {
-        bool ok;
-        double percentage = result.toDouble(&ok);
-        if (ok && qAbs(percentage - lastScrollPercentage) > 0.001) {
-            lastScrollPercentage = percentage;
-            emit scrollPercentageChanged(percentage);
-        }
-    });
+    if (qAbs(percentage - lastScrollPercentage) > 0.001) {
+        lastScrollPercentage = percentage;
+        emit scrollPercentageChanged(percentage);
+    }
+    if (line > 0 && qAbs(line - lastSourceLine) > 0.01) {
+        lastSourceLine = line;
+        emit sourceLineScrolled(line);
+    }
 }
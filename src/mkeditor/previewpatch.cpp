@@ -0,0 +1,208 @@
+#include "previewpatch.h"
+
+#include <QHash>
+
+namespace PreviewPatch {
+
+namespace {
+
+bool isVoidElement(QStringView name) {
+    static const char* const voidElements[] = {
+        "area", "base", "br", "col", "embed", "hr", "img",
+        "input", "link", "meta", "param", "source", "track", "wbr"};
+    for (const char* element : voidElements) {
+        if (name.compare(QLatin1String(element), Qt::CaseInsensitive) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isRawTextElement(QStringView name) {
+    return name.compare(QLatin1String("script"), Qt::CaseInsensitive) == 0 ||
+           name.compare(QLatin1String("style"), Qt::CaseInsensitive) == 0;
+}
+
+// Returns the index just past the '>' closing the tag that starts at
+// start, skipping quoted attribute values, or -1 if it never closes.
+int findTagEnd(const QString& html, int start) {
+    QChar quote;
+    for (int i = start + 1; i < html.size(); ++i) {
+        const QChar c = html.at(i);
+        if (!quote.isNull()) {
+            if (c == quote) {
+                quote = QChar();
+            }
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '>') {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+const QLatin1String SOURCE_LINE_ATTRIBUTE(" data-source-line=\"");
+
+// Finds the data-source-line attribute in the leading tag of block.
+// Returns its start, or -1, and sets end to just past its closing quote.
+int findSourceLine(const QString& block, int& end) {
+    if (!block.startsWith('<')) {
+        return -1;
+    }
+    const int tagEnd = findTagEnd(block, 0);
+    if (tagEnd < 0) {
+        return -1;
+    }
+    const int start =
+        int(QStringView(block).left(tagEnd).indexOf(SOURCE_LINE_ATTRIBUTE));
+    if (start < 0) {
+        return -1;
+    }
+    end = block.indexOf('"', start + SOURCE_LINE_ATTRIBUTE.size());
+    if (end < 0) {
+        return -1;
+    }
+    ++end;
+    return start;
+}
+
+}  // namespace
+
+QStringList splitBlocks(const QString& html) {
+    QStringList blocks;
+    const int length = html.size();
+    int depth = 0;
+    int blockStart = -1;
+    int i = 0;
+
+    auto finishBlock = [&](int end) {
+        if (blockStart >= 0) {
+            blocks.append(html.mid(blockStart, end - blockStart));
+            blockStart = -1;
+        }
+    };
+
+    while (i < length) {
+        const QChar c = html.at(i);
+        if (blockStart < 0) {
+            if (c.isSpace()) {
+                ++i;
+                continue;
+            }
+            blockStart = i;
+        }
+
+        if (c != '<') {
+            // Loose text at the top level ends with its line.
+            if (depth == 0 && c == '\n') {
+                finishBlock(i);
+            }
+            ++i;
+            continue;
+        }
+
+        if (QStringView(html).mid(i, 4) == QLatin1String("<!--")) {
+            const int end = html.indexOf("-->", i + 4);
+            i = end < 0 ? length : end + 3;
+            if (depth == 0) {
+                finishBlock(i);
+            }
+            continue;
+        }
+
+        const bool closing = i + 1 < length && html.at(i + 1) == '/';
+        const int nameStart = i + (closing ? 2 : 1);
+        int nameEnd = nameStart;
+        while (nameEnd < length && html.at(nameEnd).isLetterOrNumber()) {
+            ++nameEnd;
+        }
+        if (nameEnd == nameStart) {
+            // A bare '<' in text, or a declaration such as <!DOCTYPE>.
+            ++i;
+            continue;
+        }
+        const int tagEnd = findTagEnd(html, i);
+        if (tagEnd < 0) {
+            break;
+        }
+        const QStringView name =
+            QStringView(html).mid(nameStart, nameEnd - nameStart);
+
+        i = tagEnd;
+        if (closing) {
+            depth = qMax(0, depth - 1);
+        } else if (html.at(tagEnd - 2) != '/' && !isVoidElement(name)) {
+            if (isRawTextElement(name)) {
+                // Script and style bodies may contain '<' freely.
+                const int close = html.indexOf(
+                    QLatin1String("</") + name.toString(), i,
+                    Qt::CaseInsensitive);
+                if (close < 0) {
+                    i = length;
+                    break;
+                }
+                i = close;
+            }
+            ++depth;
+        }
+        if (depth == 0) {
+            finishBlock(i);
+        }
+    }
+    finishBlock(length);
+
+    return blocks;
+}
+
+QVector<size_t> blockKeys(const QStringList& blocks) {
+    QVector<size_t> keys;
+    keys.reserve(blocks.size());
+    for (const QString& block : blocks) {
+        int end = 0;
+        const int start = findSourceLine(block, end);
+        if (start < 0) {
+            keys.append(qHash(block));
+        } else {
+            keys.append(qHash(QStringView(block).left(start),
+                              qHash(QStringView(block).mid(end))));
+        }
+    }
+    return keys;
+}
+
+int sourceLine(const QString& block) {
+    int end = 0;
+    const int start = findSourceLine(block, end);
+    if (start < 0) {
+        return 0;
+    }
+    const int valueStart = start + SOURCE_LINE_ATTRIBUTE.size();
+    return QStringView(block).mid(valueStart, end - 1 - valueStart).toInt();
+}
+
+Patch diff(const QVector<size_t>& oldKeys, const QVector<size_t>& newKeys,
+           const QStringList& newBlocks) {
+    const int oldCount = oldKeys.size();
+    const int newCount = newKeys.size();
+
+    int prefix = 0;
+    while (prefix < oldCount && prefix < newCount &&
+           oldKeys.at(prefix) == newKeys.at(prefix)) {
+        ++prefix;
+    }
+    int suffix = 0;
+    while (suffix < oldCount - prefix && suffix < newCount - prefix &&
+           oldKeys.at(oldCount - 1 - suffix) ==
+               newKeys.at(newCount - 1 - suffix)) {
+        ++suffix;
+    }
+
+    Patch patch;
+    patch.start = prefix;
+    patch.removeCount = oldCount - prefix - suffix;
+    patch.blocks = newBlocks.mid(prefix, newCount - prefix - suffix);
+    return patch;
+}
+
+}  // namespace PreviewPatch
@@ -0,0 +1,66 @@
+#include "previewrendercache.h"
+
+#include <QFileInfo>
+
+namespace {
+
+qint64 entryBytes(const QStringList& blocks) {
+    qint64 bytes = 0;
+    for (const QString& block : blocks) {
+        bytes += block.size() * 2;
+    }
+    return bytes;
+}
+
+}  // namespace
+
+PreviewRenderCache::PreviewRenderCache(qint64 maxBytes)
+    : m_entries(maxBytes) {}
+
+QVector<QDateTime> PreviewRenderCache::modificationTimes(
+    const QStringList& files) {
+    QVector<QDateTime> times;
+    times.reserve(files.size());
+    for (const QString& path : files) {
+        times.append(QFileInfo(path).lastModified());
+    }
+    return times;
+}
+
+bool PreviewRenderCache::find(int documentId, quint64 revision,
+                              const QString& settings, QStringList& blocks,
+                              QStringList& includedFiles) {
+    // Looking an entry up marks it as the most recently used.
+    Entry* entry = m_entries.object(documentId);
+    if (!entry || entry->revision != revision || entry->settings != settings) {
+        return false;
+    }
+    // The note is unchanged, but a note it includes may not be.
+    if (modificationTimes(entry->includedFiles) != entry->includedModified) {
+        m_entries.remove(documentId);
+        return false;
+    }
+    blocks = entry->blocks;
+    includedFiles = entry->includedFiles;
+    return true;
+}
+
+void PreviewRenderCache::store(int documentId, quint64 revision,
+                               const QString& settings,
+                               const QStringList& blocks,
+                               const QStringList& includedFiles) {
+    auto* entry = new Entry;
+    entry->revision = revision;
+    entry->settings = settings;
+    entry->blocks = blocks;
+    entry->includedFiles = includedFiles;
+    entry->includedModified = modificationTimes(includedFiles);
+    // An entry larger than the whole cache is refused and deleted.
+    m_entries.insert(documentId, entry, qMax<qint64>(1, entryBytes(blocks)));
+}
+
+void PreviewRenderCache::remove(int documentId) {
+    m_entries.remove(documentId);
+}
+
+void PreviewRenderCache::clear() { m_entries.clear(); }
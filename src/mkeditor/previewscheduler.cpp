@@ -0,0 +1,52 @@
+#include "previewscheduler.h"
+
+#include <QTimer>
+
+namespace {
+
+// Weight of the newest render time; earlier ones fade out quickly, as
+// the note changes while it is edited.
+const double RENDER_TIME_WEIGHT = 0.3;
+
+// Documents remembered before the render times start over.
+const int MAX_DOCUMENTS = 256;
+
+}  // namespace
+
+PreviewScheduler::PreviewScheduler(QObject* parent)
+    : QObject(parent),
+      m_timer(new QTimer(this)),
+      m_minimumInterval(DEFAULT_MINIMUM_INTERVAL) {
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &PreviewScheduler::renderDue);
+}
+
+void PreviewScheduler::setMinimumInterval(int msec) {
+    m_minimumInterval = qMax(0, msec);
+}
+
+int PreviewScheduler::interval(int documentId) const {
+    // Waiting twice the render time keeps the editor responsive: at most
+    // a third of a steady typing session goes to rendering.
+    const double renderTime = m_renderTimes.value(documentId, 0.0);
+    const int adaptive = qMin(MAXIMUM_INTERVAL, int(renderTime * 2));
+    return qMax(m_minimumInterval, adaptive);
+}
+
+void PreviewScheduler::schedule(int documentId) {
+    m_timer->start(interval(documentId));
+}
+
+void PreviewScheduler::cancel() { m_timer->stop(); }
+
+void PreviewScheduler::recordRenderTime(int documentId, qint64 msec) {
+    auto it = m_renderTimes.find(documentId);
+    if (it == m_renderTimes.end()) {
+        if (m_renderTimes.size() >= MAX_DOCUMENTS) {
+            m_renderTimes.clear();
+        }
+        m_renderTimes.insert(documentId, double(msec));
+        return;
+    }
+    *it = *it * (1 - RENDER_TIME_WEIGHT) + msec * RENDER_TIME_WEIGHT;
+}
@@ -0,0 +1,176 @@
+#include "previewschemehandler.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QMimeDatabase>
+#include <QUrlQuery>
+#include <QWebEngineProfile>
+#include <QWebEngineUrlRequestJob>
+#include <QWebEngineUrlScheme>
+
+const QByteArray PreviewSchemeHandler::SCHEME = "treemk";
+
+namespace {
+
+const QString PREVIEW_HOST = "preview";
+const QString RESOURCE_HOST = "resource";
+
+QByteArray mimeTypeFor(const QString& path) {
+    static const QMimeDatabase database;
+    return database.mimeTypeForFile(path, QMimeDatabase::MatchExtension)
+        .name()
+        .toUtf8();
+}
+
+void replyWith(QWebEngineUrlRequestJob* job, const QByteArray& mimeType,
+               QIODevice* device, bool cacheable) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+    QMultiMap<QByteArray, QByteArray> headers;
+    headers.insert("Cache-Control", cacheable ? "max-age=31536000, immutable"
+                                              : "no-store");
+    job->setAdditionalResponseHeaders(headers);
+#else
+    Q_UNUSED(cacheable);
+#endif
+    // The engine reads the device on its IO thread until the job is gone.
+    QObject::connect(job, &QObject::destroyed, device, &QObject::deleteLater);
+    job->reply(mimeType, device);
+}
+
+}  // namespace
+
+PreviewSchemeHandler::PreviewSchemeHandler(QObject* parent)
+    : QWebEngineUrlSchemeHandler(parent), m_revision(0) {}
+
+void PreviewSchemeHandler::registerScheme() {
+    QWebEngineUrlScheme scheme(SCHEME);
+    scheme.setSyntax(QWebEngineUrlScheme::Syntax::Host);
+    // Local like file: pages were, so the existing web settings for
+    // remote images and file access still apply.
+    scheme.setFlags(QWebEngineUrlScheme::SecureScheme |
+                    QWebEngineUrlScheme::LocalScheme |
+                    QWebEngineUrlScheme::LocalAccessAllowed |
+                    QWebEngineUrlScheme::ContentSecurityPolicyIgnored);
+    QWebEngineUrlScheme::registerScheme(scheme);
+}
+
+PreviewSchemeHandler* PreviewSchemeHandler::instance() {
+    static PreviewSchemeHandler* handler = nullptr;
+    if (!handler) {
+        QWebEngineProfile* profile = QWebEngineProfile::defaultProfile();
+        handler = new PreviewSchemeHandler(profile);
+        profile->installUrlSchemeHandler(SCHEME, handler);
+    }
+    return handler;
+}
+
+QUrl PreviewSchemeHandler::baseUrl(const QString& basePath) {
+    QUrl url;
+    url.setScheme(QString::fromLatin1(SCHEME));
+    QString path;
+    if (basePath.startsWith("qrc:") || basePath.startsWith(":/")) {
+        url.setHost(RESOURCE_HOST);
+        path = basePath.mid(basePath.indexOf(':') + 1);
+    } else {
+        url.setHost(PREVIEW_HOST);
+        path = QDir::fromNativeSeparators(QDir(basePath).absolutePath());
+    }
+    if (!path.startsWith('/')) {
+        path.prepend('/');
+    }
+    if (!path.endsWith('/')) {
+        path += '/';
+    }
+    url.setPath(path);
+    return url;
+}
+
+QUrl PreviewSchemeHandler::setDocument(int id, const QString& basePath,
+                                       const QByteArray& html) {
+    m_documents.insert(id, html);
+
+    QUrl url = baseUrl(basePath);
+    // A fresh revision keeps the engine from reusing an earlier page.
+    url.setQuery(QString("document=%1&revision=%2").arg(id).arg(++m_revision));
+    return url;
+}
+
+void PreviewSchemeHandler::removeDocument(int id) { m_documents.remove(id); }
+
+QString PreviewSchemeHandler::localFilePath(const QUrl& url) {
+    if (url.scheme() != QString::fromLatin1(SCHEME) ||
+        url.host() != PREVIEW_HOST) {
+        return QString();
+    }
+    QString path = url.path();
+#ifdef Q_OS_WIN
+    // treemk://preview/C:/notes maps to C:/notes.
+    if (path.size() > 2 && path.at(0) == '/' && path.at(2) == ':') {
+        path.remove(0, 1);
+    }
+#endif
+    return path;
+}
+
+QByteArray PreviewSchemeHandler::resource(const QString& path) {
+    auto it = m_resources.constFind(path);
+    if (it != m_resources.constEnd()) {
+        return *it;
+    }
+    QFile file(":" + path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    // Bundled resources are few and never change while running; the
+    // big script bundle is decompressed once per session.
+    QByteArray data = file.readAll();
+    m_resources.insert(path, data);
+    return data;
+}
+
+void PreviewSchemeHandler::requestStarted(QWebEngineUrlRequestJob* job) {
+    const QUrl url = job->requestUrl();
+
+    const QUrlQuery query(url);
+    if (query.hasQueryItem("document")) {
+        bool ok = false;
+        const int id = query.queryItemValue("document").toInt(&ok);
+        auto it = m_documents.constFind(id);
+        if (!ok || it == m_documents.constEnd()) {
+            job->fail(QWebEngineUrlRequestJob::UrlNotFound);
+            return;
+        }
+        auto* buffer = new QBuffer();
+        buffer->setData(*it);
+        buffer->open(QIODevice::ReadOnly);
+        replyWith(job, "text/html", buffer, false);
+        return;
+    }
+
+    if (url.host() == RESOURCE_HOST) {
+        const QByteArray data = resource(url.path());
+        if (data.isNull()) {
+            job->fail(QWebEngineUrlRequestJob::UrlNotFound);
+            return;
+        }
+        auto* buffer = new QBuffer();
+        buffer->setData(data);
+        buffer->open(QIODevice::ReadOnly);
+        replyWith(job, mimeTypeFor(url.path()), buffer, true);
+        return;
+    }
+
+    const QString filePath = localFilePath(url);
+    if (filePath.isEmpty()) {
+        job->fail(QWebEngineUrlRequestJob::UrlInvalid);
+        return;
+    }
+    auto* file = new QFile(filePath);
+    if (!file->open(QIODevice::ReadOnly)) {
+        delete file;
+        job->fail(QWebEngineUrlRequestJob::UrlNotFound);
+        return;
+    }
+    replyWith(job, mimeTypeFor(filePath), file, false);
+}
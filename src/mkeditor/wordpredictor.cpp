@@ -3,152 +3,317 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QMutexLocker>
 #include <QRegularExpression>
+#include <QSet>
 
+#include "ngrammodel.h"
 #include "regexpatterns.h"
 
-WordPredictor::WordPredictor() {}
+WordPredictor::WordPredictor()
+    : m_index(std::make_shared<const CompletionIndex>()) {
+    // A single worker keeps updates in submission order, so paragraph
+    // deltas always apply on top of the document snapshot before them.
+    m_pool.setMaxThreadCount(1);
+}
+
+WordPredictor::~WordPredictor() {
+    m_pool.clear();
+    m_pool.waitForDone();
+}
 
 void WordPredictor::clear() {
-    m_wordFrequency.clear();
-    m_bigramFrequency.clear();
+    enqueue([this]() {
+        m_documentStats = WordStats();
+        m_directoryPath.clear();
+        m_excludedFilePath.clear();
+        m_fileEntries.clear();
+        m_wordFrequency.clear();
+        m_bigramFrequency.clear();
+    });
 }
 
-void WordPredictor::updateFromText(const QString& text) {
-    m_wordFrequency.clear();
-    m_bigramFrequency.clear();
+void WordPredictor::waitForUpdates() { m_pool.waitForDone(); }
 
-    QRegularExpression wordRegex(RegexPatterns::WORD_BOUNDARY);
+void WordPredictor::enqueue(std::function<void()> job) {
+    m_pendingUpdates.ref();
+    m_pool.start([this, job = std::move(job)]() {
+        job();
+        // Rebuilding the index is O(vocabulary), so it only happens once
+        // a burst of queued updates has been applied.
+        if (!m_pendingUpdates.deref()) {
+            publishIndex();
+        }
+    });
+}
+
+void WordPredictor::publishIndex() {
+    auto index = std::make_shared<const CompletionIndex>(m_wordFrequency,
+                                                         m_bigramFrequency);
+    QMutexLocker locker(&m_mutex);
+    m_index = std::move(index);
+}
+
+WordPredictor::WordStats WordPredictor::tokenize(const QString& text) {
+    WordStats stats;
+    static const QRegularExpression wordRegex(RegexPatterns::WORD_BOUNDARY);
     QRegularExpressionMatchIterator it = wordRegex.globalMatch(text);
 
-    QStringList words;
+    QString previous;
     while (it.hasNext()) {
         QRegularExpressionMatch match = it.next();
         QString word = match.captured(0).toLower();
-        words.append(word);
-        m_wordFrequency[word]++;
+        stats.words[word]++;
+        if (!previous.isEmpty()) {
+            stats.bigrams[qMakePair(previous, word)]++;
+        }
+        previous = word;
     }
 
-    for (int i = 0; i < words.size() - 1; i++) {
-        QPair<QString, QString> bigram(words[i], words[i + 1]);
-        m_bigramFrequency[bigram]++;
-    }
+    return stats;
 }
 
-void WordPredictor::updateFromDirectory(const QString& dirPath,
-                                        const QString& currentFilePath) {
-    QDir dir(dirPath);
-    if (!dir.exists()) {
-        return;
-    }
-
-    QStringList filters;
-    filters << "*.md" << "*.markdown";
-    QFileInfoList files = dir.entryInfoList(filters, QDir::Files);
+QString WordPredictor::firstWord(const QString& text) {
+    static const QRegularExpression wordRegex(RegexPatterns::WORD_BOUNDARY);
+    return wordRegex.match(text).captured(0).toLower();
+}
 
-    QRegularExpression wordRegex(RegexPatterns::WORD_BOUNDARY);
+QString WordPredictor::lastWord(const QString& text) {
+    static const QRegularExpression wordRegex(RegexPatterns::WORD_BOUNDARY);
+    QRegularExpressionMatchIterator it = wordRegex.globalMatch(text);
+    QString word;
+    while (it.hasNext()) {
+        word = it.next().captured(0);
+    }
+    return word.toLower();
+}
 
-    for (const QFileInfo& file : files) {
-        if (file.absoluteFilePath() == currentFilePath) {
-            continue;
+void WordPredictor::mergeStats(WordStats& target, const WordStats& delta,
+                               int sign) {
+    for (auto it = delta.words.constBegin(); it != delta.words.constEnd();
+         ++it) {
+        int& count = target.words[it.key()];
+        count += sign * it.value();
+        if (count <= 0) {
+            target.words.remove(it.key());
+        }
+    }
+    for (auto it = delta.bigrams.constBegin(); it != delta.bigrams.constEnd();
+         ++it) {
+        int& count = target.bigrams[it.key()];
+        count += sign * it.value();
+        if (count <= 0) {
+            target.bigrams.remove(it.key());
         }
+    }
+}
 
-        QFile f(file.absoluteFilePath());
-        if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            continue;
+void WordPredictor::applyToTotals(const WordStats& delta, int sign) {
+    for (auto it = delta.words.constBegin(); it != delta.words.constEnd();
+         ++it) {
+        int& count = m_wordFrequency[it.key()];
+        count += sign * it.value();
+        if (count <= 0) {
+            m_wordFrequency.remove(it.key());
+        }
+    }
+    for (auto it = delta.bigrams.constBegin(); it != delta.bigrams.constEnd();
+         ++it) {
+        int& count = m_bigramFrequency[it.key()];
+        count += sign * it.value();
+        if (count <= 0) {
+            m_bigramFrequency.remove(it.key());
         }
+    }
+}
+
+void WordPredictor::setDocumentText(const QString& text) {
+    enqueue([this, text]() {
+        WordStats stats = tokenize(text);
 
-        QString content = QString::fromUtf8(f.readAll());
-        f.close();
+        applyToTotals(m_documentStats, -1);
+        m_documentStats = stats;
+        applyToTotals(m_documentStats, 1);
+    });
+}
 
-        QRegularExpressionMatchIterator it = wordRegex.globalMatch(content);
-        QStringList words;
+void WordPredictor::applyParagraphEdit(const QString& oldText,
+                                       const QString& newText,
+                                       const QString& wordBefore,
+                                       const QString& wordAfter) {
+    enqueue([this, oldText, newText, wordBefore, wordAfter]() {
+        // The words around the range count the same on both sides and
+        // cancel out; only the bigrams across its edges change.
+        auto withContext = [&](const QString& text) {
+            return wordBefore + '\n' + text + '\n' + wordAfter;
+        };
+        WordStats removed = tokenize(withContext(oldText));
+        WordStats added = tokenize(withContext(newText));
+
+        mergeStats(m_documentStats, removed, -1);
+        mergeStats(m_documentStats, added, 1);
+        applyToTotals(removed, -1);
+        applyToTotals(added, 1);
+    });
+}
 
-        while (it.hasNext()) {
-            QRegularExpressionMatch match = it.next();
-            QString word = match.captured(0).toLower();
-            words.append(word);
-            m_wordFrequency[word]++;
+void WordPredictor::updateFromDirectory(const QString& dirPath,
+                                        const QString& currentFilePath) {
+    enqueue([this, dirPath, currentFilePath]() {
+        if (dirPath != m_directoryPath) {
+            for (const FileEntry& entry : m_fileEntries) {
+                if (entry.counted) {
+                    applyToTotals(entry.stats, -1);
+                }
+            }
+            m_fileEntries.clear();
+            m_directoryPath = dirPath;
         }
+        m_excludedFilePath = currentFilePath;
 
-        for (int i = 0; i < words.size() - 1; i++) {
-            QPair<QString, QString> bigram(words[i], words[i + 1]);
-            m_bigramFrequency[bigram]++;
+        QDir dir(dirPath);
+        if (!dir.exists()) {
+            return;
         }
-    }
-}
 
-QString WordPredictor::predictUnigram(const QString& prefix) const {
-    if (prefix.length() < 2) {
-        return QString();
-    }
+        QStringList filters;
+        filters << "*.md" << "*.markdown";
+        QFileInfoList files = dir.entryInfoList(filters, QDir::Files);
 
-    QString bestMatch;
-    int maxFrequency = 0;
+        QSet<QString> present;
+        for (const QFileInfo& file : files) {
+            present.insert(file.absoluteFilePath());
+            refreshFileEntry(file);
+        }
 
-    for (auto it = m_wordFrequency.constBegin();
-         it != m_wordFrequency.constEnd(); ++it) {
-        const QString& word = it.key();
-        if (word.startsWith(prefix, Qt::CaseInsensitive) &&
-            word.length() > prefix.length()) {
-            if (it.value() > maxFrequency) {
-                maxFrequency = it.value();
-                bestMatch = word;
+        const QStringList known = m_fileEntries.keys();
+        for (const QString& filePath : known) {
+            if (!present.contains(filePath)) {
+                dropFileEntry(filePath);
             }
         }
-    }
+    });
+}
 
-    return bestMatch;
+void WordPredictor::refreshFile(const QString& filePath) {
+    enqueue([this, filePath]() {
+        QFileInfo fileInfo(filePath);
+        if (m_directoryPath.isEmpty() ||
+            fileInfo.absolutePath() != QDir(m_directoryPath).absolutePath()) {
+            return;
+        }
+        if (fileInfo.exists()) {
+            refreshFileEntry(fileInfo);
+        } else {
+            dropFileEntry(fileInfo.absoluteFilePath());
+        }
+    });
 }
 
-QString WordPredictor::predictBigram(const QString& previousWord,
-                                     const QString& prefix) const {
-    if (previousWord.isEmpty() || prefix.length() < 1) {
-        return QString();
+void WordPredictor::refreshFileEntry(const QFileInfo& fileInfo) {
+    QString filePath = fileInfo.absoluteFilePath();
+    FileEntry& entry = m_fileEntries[filePath];
+    bool shouldCount = filePath != m_excludedFilePath;
+
+    if (!shouldCount) {
+        if (entry.counted) {
+            applyToTotals(entry.stats, -1);
+            entry.counted = false;
+        }
+        return;
     }
 
-    QString prevLower = previousWord.toLower();
-    QString prefixLower = prefix.toLower();
+    bool changed = entry.size != fileInfo.size() ||
+                   entry.lastModified != fileInfo.lastModified();
+    if (!changed) {
+        if (!entry.counted) {
+            applyToTotals(entry.stats, 1);
+            entry.counted = true;
+        }
+        return;
+    }
 
-    QString bestMatch;
-    int maxFrequency = 0;
+    WordStats stats;
+    QFile file(filePath);
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        stats = tokenize(QString::fromUtf8(file.readAll()));
+        file.close();
+    }
 
-    for (auto it = m_bigramFrequency.constBegin();
-         it != m_bigramFrequency.constEnd(); ++it) {
-        const QPair<QString, QString>& bigram = it.key();
+    if (entry.counted) {
+        applyToTotals(entry.stats, -1);
+    }
+    entry.stats = stats;
+    entry.size = fileInfo.size();
+    entry.lastModified = fileInfo.lastModified();
+    applyToTotals(entry.stats, 1);
+    entry.counted = true;
+}
 
-        if (bigram.first == prevLower &&
-            bigram.second.startsWith(prefixLower) &&
-            bigram.second.length() > prefixLower.length()) {
-            if (it.value() > maxFrequency) {
-                maxFrequency = it.value();
-                bestMatch = bigram.second;
-            }
-        }
+void WordPredictor::dropFileEntry(const QString& filePath) {
+    auto it = m_fileEntries.find(filePath);
+    if (it == m_fileEntries.end()) {
+        return;
     }
+    if (it->counted) {
+        applyToTotals(it->stats, -1);
+    }
+    m_fileEntries.erase(it);
+}
 
-    return bestMatch;
+void WordPredictor::setLanguageModel(
+    std::shared_ptr<const NgramModel> model) {
+    QMutexLocker locker(&m_mutex);
+    m_languageModel = std::move(model);
 }
 
 QString WordPredictor::predict(const QString& prefix,
-                               const QString& previousWord) const {
+                               const QString& previousWord,
+                               const QString& beforePrevious) const {
     if (prefix.length() < 1) {
         return QString();
     }
 
-    QString bigramPrediction = predictBigram(previousWord, prefix);
-    QString unigramPrediction = predictUnigram(prefix);
+    std::shared_ptr<const CompletionIndex> index;
+    std::shared_ptr<const NgramModel> languageModel;
+    {
+        QMutexLocker locker(&m_mutex);
+        index = m_index;
+        languageModel = m_languageModel;
+    }
+
+    // A workspace trigram is the most specific evidence there is, so it
+    // wins outright; otherwise the local statistics come first, since
+    // they reflect the document being edited.
+    NgramModel::Prediction workspace;
+    if (languageModel) {
+        workspace = languageModel->predict(prefix, previousWord, beforePrevious);
+        if (workspace.order == 3) {
+            return workspace.word;
+        }
+    }
 
-    if (!bigramPrediction.isEmpty()) {
-        QString prevLower = previousWord.toLower();
-        QPair<QString, QString> bigram(prevLower, bigramPrediction.toLower());
-        int bigramFreq = m_bigramFrequency.value(bigram, 0);
-        int unigramFreq = m_wordFrequency.value(unigramPrediction.toLower(), 0);
+    const QString prefixLower = prefix.toLower();
+    int unigram = prefix.length() >= 2 ? index->complete(prefixLower) : -1;
 
-        if (bigramFreq * 2 >= unigramFreq || unigramPrediction.isEmpty()) {
-            return bigramPrediction;
+    int previousId = -1;
+    int bigram = -1;
+    if (!previousWord.isEmpty()) {
+        previousId = index->wordId(previousWord.toLower());
+        bigram = index->completeAfter(previousId, prefixLower);
+    }
+
+    if (bigram >= 0) {
+        int bigramFreq = index->bigramFrequency(previousId, bigram);
+        int unigramFreq = index->frequency(unigram);
+
+        if (bigramFreq * 2 >= unigramFreq || unigram < 0) {
+            return index->word(bigram);
         }
     }
 
-    return unigramPrediction;
+    if (workspace.order == 2 || unigram < 0) {
+        return workspace.word;
+    }
+    return index->word(unigram);
 }
@@ -1,22 +1,28 @@
 #include "quickopendialog.h"
 
-#include <QDir>
-#include <QDirIterator>
 #include <QFileInfo>
 #include <QKeyEvent>
 #include <QLineEdit>
 #include <QListWidget>
 #include <QVBoxLayout>
 
-QuickOpenDialog::QuickOpenDialog(const QString& path, const QStringList& recent,
-                                 QWidget* parent)
-    : QDialog(parent), rootPath(path), recentFiles(recent) {
+#include "workspacecatalog.h"
+
+QuickOpenDialog::QuickOpenDialog(const WorkspaceCatalog* workspaceCatalog,
+                                 const QStringList& recent, QWidget* parent)
+    : QDialog(parent),
+      catalog(workspaceCatalog),
+      rootPath(workspaceCatalog->rootPath()),
+      recentFiles(recent) {
     setWindowTitle(tr("Quick Open"));
     setMinimumSize(600, 400);
 
     setupUI();
 
-    scanFilesIterative(rootPath, allFiles, 10);
+    // The catalog may still be listing the folder, or files may come and
+    // go while the dialog is open.
+    connect(catalog, &WorkspaceCatalog::catalogChanged, this,
+            &QuickOpenDialog::updateFileList);
 
     updateFileList();
 }
@@ -92,38 +98,39 @@ void QuickOpenDialog::updateFileList() {
     }
 
     // Show matching files
-    for (const QString& filePath : allFiles) {
-        // Skip if already in recent list and no search
-        if (pattern.isEmpty() && recentFiles.contains(filePath)) {
+    for (int i = 0; i < catalog->count(); ++i) {
+        const QStringView relativePath = catalog->relativePath(i);
+        if (!pattern.isEmpty() && !fuzzyMatch(pattern, relativePath)) {
             continue;
         }
 
-        // Show relative path if within rootPath
-        QString displayText;
-        if (!rootPath.isEmpty() && filePath.startsWith(rootPath + "/")) {
-            displayText = filePath.mid(rootPath.length() + 1);
-        } else {
-            QFileInfo info(filePath);
-            displayText = info.fileName();
+        const QString filePath = catalog->filePath(i);
+        // Skip if already in recent list and no search
+        if (pattern.isEmpty() && recentFiles.contains(filePath)) {
+            continue;
         }
 
-        if (pattern.isEmpty() || fuzzyMatch(pattern, displayText.toLower())) {
-            QListWidgetItem* item = new QListWidgetItem(displayText);
-            item->setData(Qt::UserRole, filePath);
-            item->setToolTip(filePath);
-            fileListWidget->addItem(item);
+        QListWidgetItem* item = new QListWidgetItem(relativePath.toString());
+        item->setData(Qt::UserRole, filePath);
+        item->setToolTip(filePath);
+        fileListWidget->addItem(item);
 
-            // Limit results
-            if (fileListWidget->count() >= 50) {
-                break;
-            }
+        // Limit results
+        if (fileListWidget->count() >= 50) {
+            break;
         }
     }
+
+    if (!catalog->isReady()) {
+        QListWidgetItem* item = new QListWidgetItem(tr("Listing files..."));
+        item->setFlags(Qt::NoItemFlags);
+        fileListWidget->addItem(item);
+    }
 }
 
 void QuickOpenDialog::onItemDoubleClicked() {
     QListWidgetItem* item = fileListWidget->currentItem();
-    if (item) {
+    if (item && !item->data(Qt::UserRole).toString().isEmpty()) {
         selectedFile = item->data(Qt::UserRole).toString();
         emit fileSelected(selectedFile);
         accept();
@@ -132,36 +139,13 @@ void QuickOpenDialog::onItemDoubleClicked() {
 
 QString QuickOpenDialog::getSelectedFile() const { return selectedFile; }
 
-void QuickOpenDialog::scanFilesIterative(const QString& dirPath,
-                                         QList<QString>& files, int maxDepth) {
-    QStringList filters;
-    filters << "*.md" << "*.markdown";
-
-    QDirIterator it(dirPath, filters, QDir::Files | QDir::NoSymLinks,
-                    QDirIterator::Subdirectories);
-
-    QDir rootDir(dirPath);
-
-    while (it.hasNext()) {
-        QString filePath = it.next();
-
-        QString relativePath = rootDir.relativeFilePath(filePath);
-        int depth = relativePath.count('/');
-        if (depth > maxDepth) {
-            continue;
-        }
-
-        files.append(filePath);
-    }
-}
-
 bool QuickOpenDialog::fuzzyMatch(const QString& pattern,
-                                 const QString& text) const {
+                                 QStringView text) const {
     int patternIndex = 0;
     int textIndex = 0;
 
     while (patternIndex < pattern.length() && textIndex < text.length()) {
-        if (pattern[patternIndex] == text[textIndex]) {
+        if (pattern[patternIndex] == text[textIndex].toLower()) {
             patternIndex++;
         }
         textIndex++;
@@ -115,6 +115,18 @@ void SettingsDialog::setupEditorTab() {
         tr("Predict words based on document frequency and patterns"));
     behaviorLayout->addRow(enableWordPredictionCheckBox);
 
+    predictionModelBudgetSpinBox = new QSpinBox();
+    predictionModelBudgetSpinBox->setRange(0, 1024);
+    predictionModelBudgetSpinBox->setSuffix(tr(" MB"));
+    predictionModelBudgetSpinBox->setSpecialValueText(tr("Disabled"));
+    predictionModelBudgetSpinBox->setToolTip(
+        tr("Maximum size of the workspace-wide prediction model, built in "
+           "the background from every markdown file in the folder"));
+    behaviorLayout->addRow(tr("Workspace prediction model:"),
+                           predictionModelBudgetSpinBox);
+    connect(enableWordPredictionCheckBox, &QCheckBox::toggled,
+            predictionModelBudgetSpinBox, &QSpinBox::setEnabled);
+
     lineBreakCheckBox = new QCheckBox(tr("Enable line breaking"));
     behaviorLayout->addRow(lineBreakCheckBox);
 
@@ -127,6 +139,17 @@ void SettingsDialog::setupEditorTab() {
     connect(lineBreakCheckBox, &QCheckBox::toggled, lineBreakColumnsSpinBox,
             &QSpinBox::setEnabled);
 
+    largeFileThresholdSpinBox = new QSpinBox();
+    largeFileThresholdSpinBox->setRange(0, 1024);
+    largeFileThresholdSpinBox->setSuffix(tr(" MB"));
+    largeFileThresholdSpinBox->setSpecialValueText(tr("Disabled"));
+    largeFileThresholdSpinBox->setToolTip(
+        tr("Files at least this large open in large-file mode: no word "
+           "wrap, highlighting limited to the visible area, no live "
+           "preview"));
+    behaviorLayout->addRow(tr("Large file mode from:"),
+                           largeFileThresholdSpinBox);
+
     layout->addWidget(behaviorGroup);
     layout->addStretch();
 
@@ -206,6 +229,28 @@ void SettingsDialog::setupMainTab() {
 
     layout->addWidget(cssGroup);
 
+    // PDF export group
+    QGroupBox* pdfGroup = new QGroupBox(tr("PDF Export"));
+    QFormLayout* pdfLayout = new QFormLayout(pdfGroup);
+
+    pdfPageSizeComboBox = new QComboBox();
+    for (const char* pageSize : {"A4", "A5", "A3", "Letter", "Legal"}) {
+        pdfPageSizeComboBox->addItem(pageSize, pageSize);
+    }
+    pdfLayout->addRow(tr("Page size:"), pdfPageSizeComboBox);
+
+    pdfOrientationComboBox = new QComboBox();
+    pdfOrientationComboBox->addItem(tr("Portrait"), "portrait");
+    pdfOrientationComboBox->addItem(tr("Landscape"), "landscape");
+    pdfLayout->addRow(tr("Orientation:"), pdfOrientationComboBox);
+
+    pdfMarginSpinBox = new QSpinBox();
+    pdfMarginSpinBox->setRange(0, 50);
+    pdfMarginSpinBox->setSuffix(tr(" mm"));
+    pdfLayout->addRow(tr("Margins:"), pdfMarginSpinBox);
+
+    layout->addWidget(pdfGroup);
+
     // General settings group
     QGroupBox* generalGroup = new QGroupBox(tr("General"));
     QFormLayout* generalLayout = new QFormLayout(generalGroup);
@@ -252,6 +297,12 @@ void SettingsDialog::setupMainTab() {
            "from current file)"));
     workspaceLayout->addRow(tr("Link search depth:"), linkSearchDepthSpinBox);
 
+    updateLinksOnRenameCheckBox =
+        new QCheckBox(tr("Update links when renaming notes"));
+    updateLinksOnRenameCheckBox->setToolTip(
+        tr("Rewrite the links in notes that point to a renamed note"));
+    workspaceLayout->addRow(updateLinksOnRenameCheckBox);
+
     layout->addWidget(workspaceGroup);
 
     // Shortcuts group
@@ -305,6 +356,18 @@ void SettingsDialog::loadSettings() {
     lineBreakColumnsSpinBox->setValue(
         settings.value("editor/lineBreakColumns", 80).toInt());
     lineBreakColumnsSpinBox->setEnabled(lineBreakCheckBox->isChecked());
+    largeFileThresholdSpinBox->setValue(
+        settings
+            .value("editor/largeFileThresholdMB",
+                   DEFAULT_LARGE_FILE_THRESHOLD_MB)
+            .toInt());
+    predictionModelBudgetSpinBox->setValue(
+        settings
+            .value("editor/predictionModelBudgetMB",
+                   DEFAULT_PREDICTION_MODEL_BUDGET_MB)
+            .toInt());
+    predictionModelBudgetSpinBox->setEnabled(
+        enableWordPredictionCheckBox->isChecked());
 
     // Preview settings
     previewRefreshRateSpinBox->setValue(
@@ -314,6 +377,18 @@ void SettingsDialog::loadSettings() {
     customCSSLineEdit->setText(
         settings.value("preview/customCSS", "").toString());
 
+    // PDF export settings
+    int pageSizeIndex = pdfPageSizeComboBox->findData(
+        settings.value("export/pdfPageSize", DEFAULT_PDF_PAGE_SIZE).toString());
+    if (pageSizeIndex >= 0) pdfPageSizeComboBox->setCurrentIndex(pageSizeIndex);
+    int orientationIndex = pdfOrientationComboBox->findData(
+        settings.value("export/pdfOrientation", "portrait").toString());
+    if (orientationIndex >= 0) {
+        pdfOrientationComboBox->setCurrentIndex(orientationIndex);
+    }
+    pdfMarginSpinBox->setValue(
+        settings.value("export/pdfMarginMM", DEFAULT_PDF_MARGIN_MM).toInt());
+
     // General settings
     bool autoSaveEnabled = settings.value("autoSaveEnabled", true).toBool();
     autoSaveEnabledCheck->setChecked(autoSaveEnabled);
@@ -333,6 +408,8 @@ void SettingsDialog::loadSettings() {
     linkSearchDepthSpinBox->setValue(
         settings.value("workspace/linkSearchDepth", DEFAULT_LINK_SEARCH_DEPTH)
             .toInt());
+    updateLinksOnRenameCheckBox->setChecked(
+        settings.value("workspace/updateLinksOnRename", true).toBool());
 
     // Appearance settings
     QString theme = settings.value("appearance/appTheme", "system").toString();
@@ -365,6 +442,10 @@ void SettingsDialog::saveSettings() {
                       lineBreakCheckBox->isChecked());
     settings.setValue("editor/lineBreakColumns",
                       lineBreakColumnsSpinBox->value());
+    settings.setValue("editor/largeFileThresholdMB",
+                      largeFileThresholdSpinBox->value());
+    settings.setValue("editor/predictionModelBudgetMB",
+                      predictionModelBudgetSpinBox->value());
 
     // Preview settings
     settings.setValue("previewTheme", themeComboBox->currentData().toString());
@@ -373,6 +454,13 @@ void SettingsDialog::saveSettings() {
     settings.setValue("preview/fontSize", previewFontSizeSpinBox->value());
     settings.setValue("preview/customCSS", customCSSLineEdit->text());
 
+    // PDF export settings
+    settings.setValue("export/pdfPageSize",
+                      pdfPageSizeComboBox->currentData().toString());
+    settings.setValue("export/pdfOrientation",
+                      pdfOrientationComboBox->currentData().toString());
+    settings.setValue("export/pdfMarginMM", pdfMarginSpinBox->value());
+
     // General settings
     settings.setValue("autoSaveEnabled", autoSaveEnabledCheck->isChecked());
     settings.setValue("autoSaveInterval", autoSaveIntervalSpinBox->value());
@@ -386,6 +474,8 @@ void SettingsDialog::saveSettings() {
 
     settings.setValue("workspace/linkSearchDepth",
                       linkSearchDepthSpinBox->value());
+    settings.setValue("workspace/updateLinksOnRename",
+                      updateLinksOnRenameCheckBox->isChecked());
 
     QString theme = themeComboBox->currentData().toString();
     settings.setValue("appearance/appTheme", theme);
@@ -2,27 +2,34 @@
 
 #include <QFileInfo>
 #include <QScrollBar>
+#include <QSettings>
 #include <QSplitter>
+#include <QTextBlock>
 #include <QTextStream>
 #include <QTimer>
 #include <QVBoxLayout>
 
+#include "defs.h"
 #include "fileutils.h"
 #include "markdowneditor.h"
 #include "markdownpreview.h"
 #include "navigationhistory.h"
 #include "outlinepanel.h"
 
+int TabEditor::nextDocumentId = 1;
+
 TabEditor::TabEditor(QWidget* parent)
     : QWidget(parent),
       m_editor(nullptr),
       m_sharedPreview(nullptr),
-      m_previewTimer(nullptr),
       m_navigationHistory(nullptr),
       m_isModified(false),
       m_ownSaved(false),
       m_lastScrollPercentage(0.0),
-      m_isScrollingFromPreview(false) {
+      m_lastSourceLine(0.0),
+      m_isScrollingFromPreview(false),
+      m_documentId(nextDocumentId++),
+      m_revision(0) {
     m_navigationHistory = new NavigationHistory(this);
     setupUI();
 }
@@ -38,7 +45,7 @@ void TabEditor::setupUI() {
 
     connect(m_editor, &MarkdownEditor::textChanged, this,
             &TabEditor::onDocumentModified);
-    connect(m_editor->verticalScrollBar(), &QScrollBar::valueChanged, this,
+    connect(m_editor, &MarkdownEditor::scrolled, this,
             &TabEditor::onEditorScrolled);
     connect(m_editor, &MarkdownEditor::cursorPositionChanged, this,
             &TabEditor::onEditorScrolled);
@@ -53,11 +60,6 @@ void TabEditor::setupUI() {
             &TabEditor::openLinkInNewWindowRequested);
     connect(m_editor, &MarkdownEditor::aiAssistRequested, this,
             &TabEditor::aiAssistRequested);
-
-    m_previewTimer = new QTimer(this);
-    m_previewTimer->setSingleShot(true);
-    m_previewTimer->setInterval(1000);
-    connect(m_previewTimer, &QTimer::timeout, this, &TabEditor::updatePreview);
 }
 
 QString TabEditor::fileName() const {
@@ -80,12 +82,28 @@ bool TabEditor::loadFile(const QString& filePath) {
         return false;
     }
 
+    // Large files switch to large-file mode before their text goes in,
+    // so they are never laid out as a regular note; other files leave it
+    // after, so the regular layout only ever sees their own text.
+    QSettings settings(APP_LABEL, APP_LABEL);
+    qint64 thresholdMB =
+        settings
+            .value("editor/largeFileThresholdMB",
+                   DEFAULT_LARGE_FILE_THRESHOLD_MB)
+            .toLongLong();
+    const bool largeFile =
+        thresholdMB > 0 && file.size() >= thresholdMB * 1024 * 1024;
+    if (largeFile) {
+        m_editor->setLargeFileMode(true);
+    }
+
     QTextStream in(&file);
     in.setEncoding(QStringConverter::Utf8);
     QString content = in.readAll();
     file.close();
 
     m_editor->setPlainText(content);
+    m_editor->setLargeFileMode(largeFile);
     m_editor->document()->setModified(false);
 
     m_filePath = filePath;
@@ -138,11 +156,11 @@ void TabEditor::setContent(const QString& content) {
 }
 
 void TabEditor::onDocumentModified() {
+    ++m_revision;
     if (!m_isModified) {
         setModified(true);
     }
-
-    m_previewTimer->start();
+    emit documentModified();
 }
 
 void TabEditor::setSharedPreview(MarkdownPreview* preview) {
@@ -157,8 +175,8 @@ void TabEditor::updatePreviewContent(MarkdownPreview* preview) {
         QFileInfo fileInfo(m_filePath);
         preview->setBasePath(fileInfo.absolutePath());
     }
-    preview->setMarkdownContent(markdown);
-    preview->scrollToPercentage(m_lastScrollPercentage);
+    preview->setMarkdownContent(markdown, m_documentId, m_revision);
+    preview->scrollToSourceLine(m_lastSourceLine, m_lastScrollPercentage);
 }
 
 void TabEditor::updatePreview() {
@@ -177,9 +195,14 @@ void TabEditor::onEditorScrolled() {
     if (maximum > 0) {
         m_lastScrollPercentage =
             static_cast<double>(scrollBar->value()) / maximum;
-        
+        // The preview places the line between the blocks around it,
+        // which stays aligned where images and diagrams make the two
+        // sides differ in height.
+        m_lastSourceLine = m_editor->topSourceLine();
+
         if (m_sharedPreview) {
-            m_sharedPreview->scrollToPercentage(m_lastScrollPercentage);
+            m_sharedPreview->scrollToSourceLine(m_lastSourceLine,
+                                                m_lastScrollPercentage);
         }
     }
 }
@@ -194,3 +217,22 @@ void TabEditor::setEditorScrollFromPreview(double percentage) {
     
     QTimer::singleShot(300, this, [this]() { m_isScrollingFromPreview = false; });
 }
+
+void TabEditor::setEditorLineFromPreview(double line) {
+    const QTextBlock block =
+        m_editor->document()->findBlockByNumber(static_cast<int>(line) - 1);
+    if (!block.isValid()) {
+        return;
+    }
+    m_isScrollingFromPreview = true;
+    m_lastSourceLine = line;
+    m_editor->scrollToSourceLine(line);
+
+    QScrollBar* scrollBar = m_editor->verticalScrollBar();
+    if (scrollBar->maximum() > 0) {
+        m_lastScrollPercentage =
+            static_cast<double>(scrollBar->value()) / scrollBar->maximum();
+    }
+
+    QTimer::singleShot(300, this, [this]() { m_isScrollingFromPreview = false; });
+}
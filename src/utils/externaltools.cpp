@@ -0,0 +1,125 @@
+#include "externaltools.h"
+
+#include <QMutexLocker>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTimer>
+
+ExternalTools::ExternalTools() : m_nextJobId(1) {}
+
+ExternalTools* ExternalTools::instance() {
+    static ExternalTools tools;
+    return &tools;
+}
+
+QString ExternalTools::findTool(const QString& program) {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_paths.constFind(program);
+    if (it != m_paths.constEnd()) {
+        return *it;
+    }
+    // Searches the PATH directly instead of starting `which`.
+    const QString path = QStandardPaths::findExecutable(program);
+    m_paths.insert(program, path);
+    return path;
+}
+
+void ExternalTools::clearCache() {
+    QMutexLocker locker(&m_mutex);
+    m_paths.clear();
+}
+
+int ExternalTools::run(const Job& job, QObject* context, Callback callback) {
+    const int jobId = m_nextJobId++;
+    RunningJob& running = m_jobs[jobId];
+    running.process = new QProcess(this);
+    running.context = context;
+    running.callback = std::move(callback);
+    running.description = job.description;
+    m_jobOrder.append(jobId);
+
+    QProcess* process = running.process;
+    if (!job.workingDirectory.isEmpty()) {
+        process->setWorkingDirectory(job.workingDirectory);
+    }
+    connect(process, &QProcess::finished, this,
+            [this, jobId]() { finishJob(jobId, true); });
+    // Queued, as start() may fail right away and the caller must get
+    // the id before the callback runs.
+    connect(
+        process, &QProcess::errorOccurred, this,
+        [this, jobId](QProcess::ProcessError error) {
+            // Crashes and kills also end in finished().
+            if (error == QProcess::FailedToStart) {
+                finishJob(jobId, false);
+            }
+        },
+        Qt::QueuedConnection);
+    if (job.timeoutMs > 0) {
+        running.timer = new QTimer(this);
+        running.timer->setSingleShot(true);
+        connect(running.timer, &QTimer::timeout, this, [this, jobId]() {
+            auto it = m_jobs.find(jobId);
+            if (it != m_jobs.end()) {
+                it->timedOut = true;
+                it->process->kill();
+            }
+        });
+        running.timer->start(job.timeoutMs);
+    }
+
+    // A program missing from the PATH fails to start like any other.
+    const QString path = findTool(job.program);
+    process->start(path.isEmpty() ? job.program : path, job.arguments);
+    reportRunningJobs();
+    return jobId;
+}
+
+void ExternalTools::cancel(int jobId) {
+    auto it = m_jobs.find(jobId);
+    if (it == m_jobs.end()) {
+        return;
+    }
+    it->cancelled = true;
+    it->process->kill();
+}
+
+void ExternalTools::finishJob(int jobId, bool started) {
+    auto it = m_jobs.find(jobId);
+    if (it == m_jobs.end()) {
+        return;
+    }
+    const RunningJob running = *it;
+    m_jobs.erase(it);
+    m_jobOrder.removeOne(jobId);
+
+    Result result;
+    result.started = started;
+    result.timedOut = running.timedOut;
+    result.cancelled = running.cancelled;
+    if (started && running.process->exitStatus() == QProcess::NormalExit) {
+        result.exitCode = running.process->exitCode();
+    }
+    result.standardOutput = running.process->readAllStandardOutput();
+    result.standardError = running.process->readAllStandardError();
+    result.errorString = running.process->errorString();
+
+    if (running.timer) {
+        running.timer->stop();
+        running.timer->deleteLater();
+    }
+    // Called from the process's own signals.
+    running.process->deleteLater();
+    reportRunningJobs();
+
+    if (running.context && running.callback) {
+        running.callback(result);
+    }
+}
+
+void ExternalTools::reportRunningJobs() {
+    const QString description =
+        m_jobOrder.isEmpty() ? QString()
+                             : m_jobs.value(m_jobOrder.last()).description;
+    emit runningJobsChanged(m_jobs.size(), description);
+}
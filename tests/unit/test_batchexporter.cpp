@@ -0,0 +1,189 @@
+#include <QtTest/QtTest>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "batchexporter.h"
+#include "inclusioncache.h"
+
+class TestBatchExporter : public QObject {
+    Q_OBJECT
+
+private:
+    static void writeFile(const QString& path, const QByteArray& content);
+
+private slots:
+    void testExportFolder_KeepsLayout();
+    void testExportFolder_SkipsUnchangedNotes();
+    void testExportFolder_IncludedNoteChangeReexports();
+    void testExportFolder_RemovesPagesOfDeletedNotes();
+    void testExportFolder_OptionsChangeRemovesDeletedPages();
+    void testExportFolder_FreshDependencyIsCheckedAgain();
+};
+
+void TestBatchExporter::writeFile(const QString& path,
+                                  const QByteArray& content) {
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(content);
+}
+
+void TestBatchExporter::testExportFolder_KeepsLayout() {
+    QTemporaryDir source;
+    QTemporaryDir output;
+    QVERIFY(source.isValid() && output.isValid());
+    writeFile(source.filePath("a.md"), "# A\n");
+    writeFile(source.filePath("sub/b.md"), "# B\n");
+    writeFile(source.filePath("notes.txt"), "not a note\n");
+
+    HtmlExporter::Options options;
+    options.latexEnabled = false;
+    const BatchExporter::Summary summary = BatchExporter::exportFolder(
+        source.path(), output.path(), options, 2);
+
+    QVERIFY(summary.errors.isEmpty());
+    QCOMPARE(summary.exported, 2);
+    QVERIFY(QFile::exists(output.filePath("a.html")));
+    QVERIFY(QFile::exists(output.filePath("sub/b.html")));
+    QVERIFY(!QFile::exists(output.filePath("notes.html")));
+    QVERIFY(QFile::exists(output.filePath(BatchExporter::MANIFEST_NAME)));
+}
+
+void TestBatchExporter::testExportFolder_SkipsUnchangedNotes() {
+    QTemporaryDir source;
+    QTemporaryDir output;
+    QVERIFY(source.isValid() && output.isValid());
+    writeFile(source.filePath("a.md"), "# A\n");
+    writeFile(source.filePath("b.md"), "# B\n");
+
+    HtmlExporter::Options options;
+    options.latexEnabled = false;
+    BatchExporter::exportFolder(source.path(), output.path(), options, 2);
+
+    writeFile(source.filePath("b.md"), "# B changed\n");
+    BatchExporter::Summary summary = BatchExporter::exportFolder(
+        source.path(), output.path(), options, 2);
+    QCOMPARE(summary.exported, 1);
+    QCOMPARE(summary.skipped, 1);
+
+    // A deleted page is written again even though its note is unchanged.
+    QVERIFY(QFile::remove(output.filePath("a.html")));
+    summary = BatchExporter::exportFolder(source.path(), output.path(),
+                                          options, 2);
+    QCOMPARE(summary.exported, 1);
+    QCOMPARE(summary.skipped, 1);
+
+    // Other settings make every page stale.
+    options.styleSheet = "body { margin: 0; }";
+    summary = BatchExporter::exportFolder(source.path(), output.path(),
+                                          options, 2);
+    QCOMPARE(summary.exported, 2);
+    QCOMPARE(summary.skipped, 0);
+}
+
+void TestBatchExporter::testExportFolder_IncludedNoteChangeReexports() {
+    QTemporaryDir source;
+    QTemporaryDir output;
+    QVERIFY(source.isValid() && output.isValid());
+    writeFile(source.filePath("main.md"), "[[!part]]\n");
+    writeFile(source.filePath("part.md"), "Old part\n");
+
+    HtmlExporter::Options options;
+    options.latexEnabled = false;
+    BatchExporter::exportFolder(source.path(), output.path(), options, 2);
+
+    writeFile(source.filePath("part.md"), "New part\n");
+    InclusionCache::instance()->clear();
+    const BatchExporter::Summary summary = BatchExporter::exportFolder(
+        source.path(), output.path(), options, 2);
+    // Both the included note and the note including it are stale.
+    QCOMPARE(summary.exported, 2);
+
+    QFile page(output.filePath("main.html"));
+    QVERIFY(page.open(QIODevice::ReadOnly));
+    QVERIFY(page.readAll().contains("New part"));
+}
+
+void TestBatchExporter::testExportFolder_RemovesPagesOfDeletedNotes() {
+    QTemporaryDir source;
+    QTemporaryDir output;
+    QVERIFY(source.isValid() && output.isValid());
+    writeFile(source.filePath("a.md"), "# A\n");
+    writeFile(source.filePath("gone.md"), "# Gone\n");
+
+    HtmlExporter::Options options;
+    options.latexEnabled = false;
+    BatchExporter::exportFolder(source.path(), output.path(), options, 2);
+    QVERIFY(QFile::exists(output.filePath("gone.html")));
+
+    QVERIFY(QFile::remove(source.filePath("gone.md")));
+    const BatchExporter::Summary summary = BatchExporter::exportFolder(
+        source.path(), output.path(), options, 2);
+    QCOMPARE(summary.removed, 1);
+    QCOMPARE(summary.skipped, 1);
+    QVERIFY(!QFile::exists(output.filePath("gone.html")));
+}
+
+void TestBatchExporter::testExportFolder_OptionsChangeRemovesDeletedPages() {
+    QTemporaryDir source;
+    QTemporaryDir output;
+    QVERIFY(source.isValid() && output.isValid());
+    writeFile(source.filePath("a.md"), "# A\n");
+    writeFile(source.filePath("gone.md"), "# Gone\n");
+
+    HtmlExporter::Options options;
+    options.latexEnabled = false;
+    BatchExporter::exportFolder(source.path(), output.path(), options, 2);
+
+    QVERIFY(QFile::remove(source.filePath("gone.md")));
+    options.darkScheme = true;
+    BatchExporter::Summary summary = BatchExporter::exportFolder(
+        source.path(), output.path(), options, 2);
+    QCOMPARE(summary.removed, 1);
+    QCOMPARE(summary.exported, 1);
+    QCOMPARE(summary.skipped, 0);
+    QVERIFY(!QFile::exists(output.filePath("gone.html")));
+
+    summary = BatchExporter::exportFolder(source.path(), output.path(),
+                                          options, 2);
+    QCOMPARE(summary.skipped, 1);
+}
+
+void TestBatchExporter::testExportFolder_FreshDependencyIsCheckedAgain() {
+    QTemporaryDir source;
+    QTemporaryDir output;
+    QVERIFY(source.isValid() && output.isValid());
+    writeFile(source.filePath("main.md"), "[[!part]]\n");
+    writeFile(source.filePath("part.md"), "Part\n");
+
+    HtmlExporter::Options options;
+    options.latexEnabled = false;
+    BatchExporter::exportFolder(source.path(), output.path(), options, 2);
+
+    // part.md may have changed while main.md was rendered, so its hash
+    // was not trusted and main.md is exported again.
+    InclusionCache::instance()->clear();
+    BatchExporter::Summary summary = BatchExporter::exportFolder(
+        source.path(), output.path(), options, 2);
+    QCOMPARE(summary.exported, 1);
+    QCOMPARE(summary.skipped, 1);
+
+    // Once it is older than the rendering, its hash is kept.
+    QFile part(source.filePath("part.md"));
+    QVERIFY(part.open(QIODevice::ReadWrite));
+    QVERIFY(part.setFileTime(QDateTime::currentDateTime().addSecs(-60),
+                             QFileDevice::FileModificationTime));
+    part.close();
+    summary = BatchExporter::exportFolder(source.path(), output.path(),
+                                          options, 2);
+    QCOMPARE(summary.exported, 1);
+    summary = BatchExporter::exportFolder(source.path(), output.path(),
+                                          options, 2);
+    QCOMPARE(summary.exported, 0);
+    QCOMPARE(summary.skipped, 2);
+}
+
+QTEST_MAIN(TestBatchExporter)
+#include "test_batchexporter.moc"
@@ -0,0 +1,126 @@
+#include <QtTest/QtTest>
+#include <QSignalSpy>
+
+#include "externaltools.h"
+
+class TestExternalTools : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testFindTool_CachesLookups();
+    void testRun_CollectsOutput();
+    void testRun_TimesOut();
+    void testCancel_KillsJob();
+    void testRun_MissingProgram();
+
+private:
+    ExternalTools::Result runAndWait(const ExternalTools::Job& job,
+                                     int* jobId = nullptr);
+};
+
+void TestExternalTools::initTestCase() {
+#ifdef Q_OS_WIN
+    QSKIP("The jobs run POSIX shell commands");
+#endif
+}
+
+ExternalTools::Result TestExternalTools::runAndWait(
+    const ExternalTools::Job& job, int* jobId) {
+    ExternalTools::Result result;
+    bool done = false;
+    const int id = ExternalTools::instance()->run(
+        job, this, [&](const ExternalTools::Result& r) {
+            result = r;
+            done = true;
+        });
+    if (jobId) {
+        *jobId = id;
+    }
+    // The callback never runs before run() returned.
+    if (done) {
+        qWarning("Callback ran inside run()");
+        return ExternalTools::Result();
+    }
+    QTest::qWaitFor([&]() { return done; }, 5000);
+    return result;
+}
+
+void TestExternalTools::testFindTool_CachesLookups() {
+    ExternalTools* tools = ExternalTools::instance();
+    const QString sh = tools->findTool("sh");
+    QVERIFY(!sh.isEmpty());
+    QCOMPARE(tools->findTool("sh"), sh);
+    QVERIFY(tools->isAvailable("sh"));
+    QVERIFY(!tools->isAvailable("treemk-no-such-tool"));
+
+    tools->clearCache();
+    QCOMPARE(tools->findTool("sh"), sh);
+}
+
+void TestExternalTools::testRun_CollectsOutput() {
+    ExternalTools::Job job;
+    job.program = "sh";
+    job.arguments << "-c" << "echo hi; echo oops >&2; exit 3";
+    job.description = "Greeting";
+
+    QSignalSpy spy(ExternalTools::instance(),
+                   &ExternalTools::runningJobsChanged);
+    const ExternalTools::Result result = runAndWait(job);
+    QVERIFY(result.started);
+    QCOMPARE(result.exitCode, 3);
+    QVERIFY(!result.succeeded());
+    QCOMPARE(result.standardOutput, QByteArray("hi\n"));
+    QCOMPARE(result.standardError, QByteArray("oops\n"));
+
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(0).at(0).toInt(), 1);
+    QCOMPARE(spy.at(0).at(1).toString(), QString("Greeting"));
+    QCOMPARE(spy.at(1).at(0).toInt(), 0);
+    QCOMPARE(ExternalTools::instance()->runningCount(), 0);
+}
+
+void TestExternalTools::testRun_TimesOut() {
+    ExternalTools::Job job;
+    job.program = "sleep";
+    job.arguments << "5";
+    job.timeoutMs = 100;
+
+    QElapsedTimer timer;
+    timer.start();
+    const ExternalTools::Result result = runAndWait(job);
+    QVERIFY(result.timedOut);
+    QVERIFY(!result.succeeded());
+    QVERIFY(timer.elapsed() < 4000);
+}
+
+void TestExternalTools::testCancel_KillsJob() {
+    ExternalTools* tools = ExternalTools::instance();
+    ExternalTools::Job job;
+    job.program = "sleep";
+    job.arguments << "5";
+
+    ExternalTools::Result result;
+    bool done = false;
+    const int id = tools->run(job, this, [&](const ExternalTools::Result& r) {
+        result = r;
+        done = true;
+    });
+    QVERIFY(tools->isRunning(id));
+    tools->cancel(id);
+    QTRY_VERIFY_WITH_TIMEOUT(done, 4000);
+    QVERIFY(result.cancelled);
+    QVERIFY(!tools->isRunning(id));
+}
+
+void TestExternalTools::testRun_MissingProgram() {
+    ExternalTools::Job job;
+    job.program = "treemk-no-such-tool";
+    const ExternalTools::Result result = runAndWait(job);
+    QVERIFY(!result.started);
+    QVERIFY(!result.succeeded());
+    QVERIFY(!result.errorString.isEmpty());
+}
+
+QTEST_MAIN(TestExternalTools)
+#include "test_externaltools.moc"
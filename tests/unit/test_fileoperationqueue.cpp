@@ -0,0 +1,181 @@
+#include <QtTest/QtTest>
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "fileoperationqueue.h"
+
+class TestFileOperationQueue : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void testRun_CopiesTree();
+    void testRun_RefusesExistingTarget();
+    void testRun_MovesAndDeletes();
+    void testCopyFile_ReportsEveryByte();
+    void testCancel_LeavesNoPartialCopy();
+    void testQueue_RunsInOrder();
+
+private:
+    void writeFile(const QString& path, const QByteArray& content);
+    QByteArray readFile(const QString& path);
+
+    QTemporaryDir* m_dir;
+};
+
+void TestFileOperationQueue::init() {
+    m_dir = new QTemporaryDir();
+    QVERIFY(m_dir->isValid());
+    QVERIFY(QDir().mkpath(m_dir->filePath("notes/images/.hidden")));
+    writeFile(m_dir->filePath("notes/a.md"), "# A\n");
+    writeFile(m_dir->filePath("notes/images/b.png"), QByteArray(5000, 'b'));
+    writeFile(m_dir->filePath("notes/images/.hidden/c"), "c");
+}
+
+void TestFileOperationQueue::cleanup() { delete m_dir; }
+
+void TestFileOperationQueue::writeFile(const QString& path,
+                                       const QByteArray& content) {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(content);
+}
+
+QByteArray TestFileOperationQueue::readFile(const QString& path) {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void TestFileOperationQueue::testRun_CopiesTree() {
+    FileOperationQueue::Operation operation;
+    operation.type = FileOperationQueue::Copy;
+    operation.source = m_dir->filePath("notes");
+    operation.target = m_dir->filePath("copy");
+
+    qint64 lastDone = 0;
+    qint64 lastTotal = 0;
+    const QString error = FileOperationQueue::run(
+        operation, nullptr,
+        [&](qint64 done, qint64 total, const QString&) {
+            QVERIFY(done >= lastDone);
+            lastDone = done;
+            lastTotal = total;
+        });
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+    QCOMPARE(lastTotal, qint64(4 + 5000 + 1));
+    QCOMPARE(lastDone, lastTotal);
+
+    QCOMPARE(readFile(m_dir->filePath("copy/a.md")), QByteArray("# A\n"));
+    QCOMPARE(readFile(m_dir->filePath("copy/images/b.png")),
+             QByteArray(5000, 'b'));
+    QCOMPARE(readFile(m_dir->filePath("copy/images/.hidden/c")),
+             QByteArray("c"));
+    QVERIFY(QFile::exists(m_dir->filePath("notes/a.md")));
+}
+
+void TestFileOperationQueue::testRun_RefusesExistingTarget() {
+    FileOperationQueue::Operation operation;
+    operation.type = FileOperationQueue::Copy;
+    operation.source = m_dir->filePath("notes/a.md");
+    operation.target = m_dir->filePath("notes/images/b.png");
+    QVERIFY(!FileOperationQueue::run(operation).isEmpty());
+    QCOMPARE(readFile(m_dir->filePath("notes/images/b.png")),
+             QByteArray(5000, 'b'));
+
+    // Nor into itself.
+    operation.source = m_dir->filePath("notes");
+    operation.target = m_dir->filePath("notes/images/notes");
+    QVERIFY(!FileOperationQueue::run(operation).isEmpty());
+    QVERIFY(!QFile::exists(operation.target));
+}
+
+void TestFileOperationQueue::testRun_MovesAndDeletes() {
+    FileOperationQueue::Operation operation;
+    operation.type = FileOperationQueue::Move;
+    operation.source = m_dir->filePath("notes/images");
+    operation.target = m_dir->filePath("images");
+    QVERIFY(FileOperationQueue::run(operation).isEmpty());
+    QVERIFY(!QFile::exists(operation.source));
+    QCOMPARE(readFile(m_dir->filePath("images/b.png")), QByteArray(5000, 'b'));
+
+    operation.type = FileOperationQueue::Delete;
+    operation.source = m_dir->filePath("images");
+    QVERIFY(FileOperationQueue::run(operation).isEmpty());
+    QVERIFY(!QFile::exists(operation.source));
+}
+
+void TestFileOperationQueue::testCopyFile_ReportsEveryByte() {
+    const QString source = m_dir->filePath("large.bin");
+    QByteArray content(3 * 1024 * 1024 + 17, '\0');
+    for (int i = 0; i < content.size(); ++i) {
+        content[i] = char(i * 31);
+    }
+    writeFile(source, content);
+
+    qint64 copied = 0;
+    const QString target = m_dir->filePath("large-copy.bin");
+    const QString error = FileOperationQueue::copyFile(
+        source, target, nullptr, [&](qint64 bytes) { copied += bytes; });
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+    QCOMPARE(copied, qint64(content.size()));
+    QCOMPARE(readFile(target), content);
+
+    // The target is never overwritten.
+    QVERIFY(!FileOperationQueue::copyFile(source, target, nullptr, {})
+                 .isEmpty());
+}
+
+void TestFileOperationQueue::testCancel_LeavesNoPartialCopy() {
+    QAtomicInt cancelled(1);
+    FileOperationQueue::Operation operation;
+    operation.type = FileOperationQueue::Copy;
+    operation.source = m_dir->filePath("notes");
+    operation.target = m_dir->filePath("copy");
+    QVERIFY(!FileOperationQueue::run(operation, &cancelled).isEmpty());
+    QVERIFY(!QFile::exists(operation.target));
+
+    operation.type = FileOperationQueue::Move;
+    QVERIFY(QDir().mkpath(m_dir->filePath("elsewhere")));
+    operation.target = m_dir->filePath("elsewhere/notes");
+    // Renames are instant and therefore not cancelled.
+    QVERIFY(FileOperationQueue::run(operation, &cancelled).isEmpty());
+    QVERIFY(QFile::exists(m_dir->filePath("elsewhere/notes/a.md")));
+}
+
+void TestFileOperationQueue::testQueue_RunsInOrder() {
+    FileOperationQueue queue;
+    QSignalSpy busySpy(&queue, &FileOperationQueue::busyChanged);
+    QList<int> finishedIds;
+    QList<bool> results;
+    connect(&queue, &FileOperationQueue::finished, this,
+            [&](int jobId, const FileOperationQueue::Operation&,
+                bool success, bool, const QString&) {
+                finishedIds.append(jobId);
+                results.append(success);
+            });
+
+    const int copyId =
+        queue.copy(m_dir->filePath("notes"), m_dir->filePath("copy"));
+    const int removeId = queue.remove(m_dir->filePath("notes"));
+    const int droppedId = queue.remove(m_dir->filePath("copy"));
+    QVERIFY(queue.isBusy());
+    queue.cancel(droppedId);
+
+    QTRY_COMPARE(finishedIds.size(), 3);
+    QCOMPARE(finishedIds,
+             QList<int>() << droppedId << copyId << removeId);
+    QCOMPARE(results, QList<bool>() << false << true << true);
+    QVERIFY(QFile::exists(m_dir->filePath("copy/a.md")));
+    QVERIFY(!QFile::exists(m_dir->filePath("notes")));
+
+    QTRY_VERIFY(!queue.isBusy());
+    QCOMPARE(busySpy.count(), 2);
+    QCOMPARE(busySpy.at(0).at(0).toBool(), true);
+    QCOMPARE(busySpy.at(1).at(0).toBool(), false);
+}
+
+QTEST_MAIN(TestFileOperationQueue)
+#include "test_fileoperationqueue.moc"
@@ -0,0 +1,130 @@
+#include <QtTest/QtTest>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QUrl>
+
+#include "htmlexporter.h"
+
+class TestHtmlExporter : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testExport_StandalonePage();
+    void testExport_NoteLinksPointAtExports();
+    void testExport_InlinesLocalImages();
+    void testExport_AbsoluteImageLinks();
+    void testExport_DiagramWithoutWorkspace();
+    void testStart_WritesFileInBackground();
+};
+
+void TestHtmlExporter::testExport_StandalonePage() {
+    HtmlExporter::Options options;
+    options.styleSheet = "body { color: #123456; }";
+    options.latexEnabled = false;
+    const QString html = HtmlExporter::exportDocument(
+        "# Title *here*\n\nText\n", "/notes/note.md", options);
+
+    QVERIFY(html.startsWith("<!DOCTYPE html>"));
+    QVERIFY(html.contains("<title>Title here</title>"));
+    QVERIFY(html.contains("body { color: #123456; }"));
+    QVERIFY(html.contains("<p>Text</p>"));
+    // Nothing is left to load from the application.
+    QVERIFY(!html.contains("treemk:"));
+    QVERIFY(!html.contains("<script"));
+}
+
+void TestHtmlExporter::testExport_NoteLinksPointAtExports() {
+    HtmlExporter::Options options;
+    options.latexEnabled = false;
+    const QString html = HtmlExporter::exportDocument(
+        "[[Other Note]] [doc](sub/doc.md#part) [web](https://example.com)\n",
+        "/notes/note.md", options);
+
+    QVERIFY(html.contains("href=\"Other Note.html\""));
+    QVERIFY(html.contains("href=\"sub/doc.html#part\""));
+    QVERIFY(html.contains("href=\"https://example.com\""));
+    QVERIFY(!html.contains("wiki:"));
+    QVERIFY(!html.contains("markdown:"));
+}
+
+void TestHtmlExporter::testExport_InlinesLocalImages() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile image(dir.filePath("pixel.gif"));
+    QVERIFY(image.open(QIODevice::WriteOnly));
+    image.write(QByteArray::fromBase64(
+        "R0lGODlhAQABAAAAACH5BAEKAAEALAAAAAABAAEAAAICTAEAOw=="));
+    image.close();
+
+    HtmlExporter::Options options;
+    options.latexEnabled = false;
+    const QString html = HtmlExporter::exportDocument(
+        "![pixel](pixel.gif) ![missing](missing.png)\n",
+        dir.filePath("note.md"), options);
+
+    QVERIFY(html.contains("<img src=\"data:image/gif;base64,R0lGODlh"));
+    QVERIFY(html.contains("<img src=\"missing.png\""));
+}
+
+void TestHtmlExporter::testExport_AbsoluteImageLinks() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    HtmlExporter::Options options;
+    options.latexEnabled = false;
+    options.absoluteImageLinks = true;
+    const QString html = HtmlExporter::exportDocument(
+        "![missing](img/missing%20one.png) ![web](https://example.com/a.png)\n",
+        dir.filePath("note.md"), options);
+
+    const QString expected =
+        QUrl::fromLocalFile(dir.filePath("img/missing one.png")).toEncoded();
+    QVERIFY(html.contains("<img src=\"" + expected + '"'));
+    QVERIFY(html.contains("<img src=\"https://example.com/a.png\""));
+}
+
+void TestHtmlExporter::testExport_DiagramWithoutWorkspace() {
+    HtmlExporter::Options options;
+    options.latexEnabled = false;
+    QVERIFY(options.workspacePath.isEmpty());
+    const QString html = HtmlExporter::exportDocument(
+        "```mermaid\ngraph TD\n  A --> B\n```\n", "/notes/note.md", options);
+
+    // Left for the embedded script, not shipped as highlighted code.
+    QVERIFY(html.contains("<pre class=\"mermaid\""));
+    QVERIFY(html.contains("A --&gt; B"));
+    QVERIFY(!html.contains("language-mermaid"));
+    QVERIFY(html.contains("<script"));
+}
+
+void TestHtmlExporter::testStart_WritesFileInBackground() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString sourcePath = dir.filePath("note.md");
+    QFile source(sourcePath);
+    QVERIFY(source.open(QIODevice::WriteOnly));
+    source.write("Exported\n");
+    source.close();
+
+    HtmlExporter exporter;
+    QSignalSpy progressSpy(&exporter, &HtmlExporter::progressChanged);
+    QSignalSpy finishedSpy(&exporter, &HtmlExporter::finished);
+    const QString outputPath = dir.filePath("out/note.html");
+    HtmlExporter::Options options;
+    options.latexEnabled = false;
+    QVERIFY(exporter.start(sourcePath, outputPath, options));
+    QVERIFY(!exporter.start(sourcePath, outputPath, options));
+
+    QVERIFY(finishedSpy.wait(5000));
+    QCOMPARE(finishedSpy.first().at(0).toBool(), true);
+    QCOMPARE(finishedSpy.first().at(1).toString(), outputPath);
+    QVERIFY(!progressSpy.isEmpty());
+
+    QFile output(outputPath);
+    QVERIFY(output.open(QIODevice::ReadOnly));
+    QVERIFY(output.readAll().contains("<p>Exported</p>"));
+}
+
+QTEST_MAIN(TestHtmlExporter)
+#include "test_htmlexporter.moc"
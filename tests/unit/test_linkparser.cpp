@@ -58,6 +58,7 @@ private slots:
   void testResolveLinkTarget_DepthLimit();
   void testResolveLinkTarget_WithExtension();
   void testResolveLinkTarget_NotFound();
+  void testResolveLinkTargetBeforeRename();
 
   // Home directory boundary tests
   void testHomeDirectoryBoundary();
@@ -410,6 +411,41 @@ void TestLinkParser::testResolveLinkTarget_NotFound() {
   QVERIFY(resolved.isEmpty());
 }
 
+void TestLinkParser::testResolveLinkTargetBeforeRename() {
+  createFile("current.md", "Current file.");
+  createFile("notes/idea.md", "Renamed from foo.md.");
+  createFile("notes/other.md", "Next to it.");
+  createFile("archive/foo.md", "Another foo.");
+
+  const QString notesDir =
+      QFileInfo(getFilePath("notes")).canonicalFilePath();
+  const QString oldPath = getFilePath("notes/foo.md");
+  const QString newPath = getFilePath("notes/idea.md");
+  const QString expected = notesDir + "/foo.md";
+
+  // Next to the note, by the name it had
+  QCOMPARE(linkParser->resolveLinkTargetBeforeRename(
+               "foo", getFilePath("notes/other.md"), 2, oldPath, newPath),
+           expected);
+  QCOMPARE(linkParser->resolveLinkTargetBeforeRename(
+               "notes/foo", getFilePath("current.md"), 2, oldPath, newPath),
+           expected);
+  // The folders below are searched in order, and "archive" comes first.
+  QCOMPARE(linkParser->resolveLinkTargetBeforeRename(
+               "foo", getFilePath("current.md"), 2, oldPath, newPath),
+           getFilePath("archive/foo.md"));
+  // The new name did not exist yet.
+  QVERIFY(linkParser
+              ->resolveLinkTargetBeforeRename(
+                  "idea", getFilePath("notes/other.md"), 1, oldPath, newPath)
+              .isEmpty());
+
+  QFile::remove(getFilePath("archive/foo.md"));
+  QCOMPARE(linkParser->resolveLinkTargetBeforeRename(
+               "foo", getFilePath("current.md"), 2, oldPath, newPath),
+           expected);
+}
+
 // Home directory boundary tests
 
 void TestLinkParser::testHomeDirectoryBoundary() {
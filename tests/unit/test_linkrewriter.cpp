@@ -0,0 +1,186 @@
+#include <QtTest/QtTest>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "linkrewriter.h"
+
+class TestLinkRewriter : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testRewrite_WikiLinks();
+    void testRewrite_MarkdownLinks();
+    void testRewrite_LeavesOtherLinks();
+    void testRewrite_ExtensionMustMatch();
+    void testRewrite_MarkdownFragmentAndEncoding();
+    void testRewrite_OnlyLinksTheFilterAccepts();
+    void testEdits_AreAscending();
+    void testRewriteFiles_OnlyTouchesReferrers();
+    void testStart_RunsQueuedRewritesInOrder();
+
+private:
+    QString rewrite(const QString& content, const QString& oldFileName,
+                    const QString& newFileName);
+    void writeFile(const QString& path, const QByteArray& content);
+    QByteArray readFile(const QString& path);
+};
+
+QString TestLinkRewriter::rewrite(const QString& content,
+                                  const QString& oldFileName,
+                                  const QString& newFileName) {
+    return LinkRewriter::applyEdits(
+        content, LinkRewriter::linkEdits(content, oldFileName, newFileName));
+}
+
+void TestLinkRewriter::writeFile(const QString& path,
+                                 const QByteArray& content) {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(content);
+}
+
+QByteArray TestLinkRewriter::readFile(const QString& path) {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void TestLinkRewriter::testRewrite_WikiLinks() {
+    QCOMPARE(rewrite("See [[note]].", "note.md", "idea.md"),
+             QString("See [[idea]]."));
+    QCOMPARE(rewrite("See [[note.md]].", "note.md", "idea.md"),
+             QString("See [[idea.md]]."));
+    QCOMPARE(rewrite("[[sub/note|the note]]", "note.md", "idea.md"),
+             QString("[[sub/idea|the note]]"));
+    QCOMPARE(rewrite("[[!note]] and [[ note#Heading ]]", "note.md", "idea.md"),
+             QString("[[!idea]] and [[ idea#Heading ]]"));
+}
+
+void TestLinkRewriter::testRewrite_MarkdownLinks() {
+    QCOMPARE(rewrite("[Note](note.md)", "note.md", "idea.md"),
+             QString("[Note](idea.md)"));
+    QCOMPARE(rewrite("![Chart](../img/note.md)", "note.md", "idea.md"),
+             QString("![Chart](../img/idea.md)"));
+    // Only the file name changes, not a folder of the same name.
+    QCOMPARE(rewrite("[x](note.md/note.md)", "note.md", "idea.md"),
+             QString("[x](note.md/idea.md)"));
+}
+
+void TestLinkRewriter::testRewrite_LeavesOtherLinks() {
+    const QString content =
+        "[[notes]] [[other]] [a](https://example.com/note.md) "
+        "[b](note.mdx) note.md";
+    QVERIFY(LinkRewriter::linkEdits(content, "note.md", "idea.md").isEmpty());
+    QVERIFY(LinkRewriter::linkEdits("[[note]]", "note.md", "").isEmpty());
+}
+
+void TestLinkRewriter::testRewrite_ExtensionMustMatch() {
+    const QString content = "[[note.png]] ![x](note.png) [[note.txt]]";
+    QVERIFY(LinkRewriter::linkEdits(content, "note.md", "idea.md").isEmpty());
+    // Without an extension, a link only means a markdown note.
+    QVERIFY(LinkRewriter::linkEdits("[[note]]", "note.txt", "idea.txt")
+                .isEmpty());
+    QCOMPARE(rewrite(content, "note.png", "chart.png"),
+             QString("[[chart.png]] ![x](chart.png) [[note.txt]]"));
+    QCOMPARE(rewrite("[[Note]]", "note.markdown", "idea.markdown"),
+             QString("[[idea]]"));
+}
+
+void TestLinkRewriter::testRewrite_MarkdownFragmentAndEncoding() {
+    QCOMPARE(rewrite("[b](note.md#intro)", "note.md", "idea.md"),
+             QString("[b](idea.md#intro)"));
+    QCOMPARE(rewrite("[c](sub/my%20note.md#a)", "my note.md", "new note.md"),
+             QString("[c](sub/new%20note.md#a)"));
+    QCOMPARE(rewrite("[d](<my note.md>) [e](my note.md)", "my note.md",
+                     "idea.md"),
+             QString("[d](<my note.md>) [e](idea.md)"));
+}
+
+void TestLinkRewriter::testRewrite_OnlyLinksTheFilterAccepts() {
+    QStringList seen;
+    const LinkRewriter::LinkFilter filter =
+        [&seen](const QString& target, const QString& referrer) {
+            seen.append(referrer + ":" + target);
+            return !target.startsWith("archive/");
+        };
+    const QString content =
+        "[[archive/note]] [[notes/note]] [a](archive/note.md) "
+        "[b](notes/not%65.md#x)";
+    QCOMPARE(LinkRewriter::applyEdits(
+                 content, LinkRewriter::linkEdits(content, "note.md",
+                                                  "idea.md", "/a.md", filter)),
+             QString("[[archive/note]] [[notes/idea]] [a](archive/note.md) "
+                     "[b](notes/idea.md#x)"));
+    // Fragments are left out and names decoded before asking.
+    QCOMPARE(seen, QStringList() << "/a.md:archive/note" << "/a.md:notes/note"
+                                 << "/a.md:archive/note.md"
+                                 << "/a.md:notes/note.md");
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString a = dir.filePath("a.md");
+    writeFile(a, "[[archive/note]] [[notes/note#x]]");
+    seen.clear();
+    const LinkRewriter::Summary summary = LinkRewriter::rewriteFiles(
+        QStringList() << a, "note.md", "idea.md", 1, filter);
+    QCOMPARE(summary.updated, 1);
+    QCOMPARE(seen, QStringList() << a + ":archive/note" << a + ":notes/note");
+    QCOMPARE(readFile(a), QByteArray("[[archive/note]] [[notes/idea#x]]"));
+}
+
+void TestLinkRewriter::testEdits_AreAscending() {
+    const QString content = "[B](note.md) then [[note]] then [C](note.md)";
+    const QList<LinkRewriter::Edit> edits =
+        LinkRewriter::linkEdits(content, "note.md", "idea.md");
+    QCOMPARE(edits.size(), 3);
+    QVERIFY(edits.at(0).position < edits.at(1).position);
+    QVERIFY(edits.at(1).position < edits.at(2).position);
+    QCOMPARE(LinkRewriter::applyEdits(content, edits),
+             QString("[B](idea.md) then [[idea]] then [C](idea.md)"));
+}
+
+void TestLinkRewriter::testRewriteFiles_OnlyTouchesReferrers() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString a = dir.filePath("a.md");
+    const QString b = dir.filePath("b.md");
+    writeFile(a, "Links to [[note]] and [[note|again]].\n");
+    writeFile(b, "No links here.\n");
+    const QDateTime untouched = QFileInfo(b).lastModified();
+
+    const LinkRewriter::Summary summary = LinkRewriter::rewriteFiles(
+        QStringList() << a << b << dir.filePath("missing.md"), "note.md",
+        "idea.md", 2);
+    QCOMPARE(summary.updated, 1);
+    QCOMPARE(summary.errors.size(), 1);
+    QVERIFY(summary.errors.first().contains("missing.md"));
+
+    QCOMPARE(readFile(a),
+             QByteArray("Links to [[idea]] and [[idea|again]].\n"));
+    QCOMPARE(readFile(b), QByteArray("No links here.\n"));
+    QCOMPARE(QFileInfo(b).lastModified(), untouched);
+}
+
+void TestLinkRewriter::testStart_RunsQueuedRewritesInOrder() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString a = dir.filePath("a.md");
+    writeFile(a, "[[one]] [[two]]");
+
+    LinkRewriter rewriter;
+    QSignalSpy spy(&rewriter, &LinkRewriter::finished);
+    // The second rename depends on the first having been applied.
+    rewriter.start(QStringList() << a, "one.md", "three.md");
+    rewriter.start(QStringList() << a, "three.md", "four.md");
+    rewriter.start(QStringList() << a, "two.md", "five.md");
+
+    QTRY_COMPARE(spy.count(), 3);
+    for (const QList<QVariant>& arguments : spy) {
+        QCOMPARE(arguments.at(0).toInt(), 1);
+        QVERIFY(arguments.at(1).toStringList().isEmpty());
+    }
+    QCOMPARE(readFile(a), QByteArray("[[four]] [[five]]"));
+}
+
+QTEST_MAIN(TestLinkRewriter)
+#include "test_linkrewriter.moc"
@@ -0,0 +1,328 @@
+#include <QtTest/QtTest>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "inclusioncache.h"
+#include "markdownrenderer.h"
+#include "mermaidcache.h"
+
+class TestMarkdownRenderer : public QObject {
+    Q_OBJECT
+
+private:
+    static void writeFile(const QString& path, const QByteArray& content);
+
+private slots:
+    void testBlocks_MatchMd4cHtml();
+    void testHeadings_GetUniqueIds();
+    void testHeadings_IdFromPlainText();
+    void testLinks_WikiAndMarkdown();
+    void testMath_Delimiters();
+    void testInclusion_RendersIncludedNote();
+    void testInclusion_Nested();
+    void testInclusion_Cycle();
+    void testInclusion_ChangedFileIsReRendered();
+    void testInclusion_MissingFile();
+    void testInclusion_InsideCode();
+    void testMermaid_UsesCachedSvg();
+    void testPrerender_MathAndCode();
+    void testSourceLines_TopLevelBlocks();
+    void testRender_ReusedBuffersStartEmpty();
+    void testEscaping();
+};
+
+void TestMarkdownRenderer::writeFile(const QString& path,
+                                     const QByteArray& content) {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(content);
+}
+
+void TestMarkdownRenderer::testBlocks_MatchMd4cHtml() {
+    MarkdownRenderer renderer;
+
+    QCOMPARE(renderer.render("Hello *world*\n"),
+             QString("<p>Hello <em>world</em></p>\n"));
+    QCOMPARE(renderer.render("- [x] done\n- [ ] todo\n"),
+             QString("<ul>\n"
+                     "<li class=\"task-list-item\"><input type=\"checkbox\" "
+                     "class=\"task-list-item-checkbox\" disabled checked>"
+                     "done</li>\n"
+                     "<li class=\"task-list-item\"><input type=\"checkbox\" "
+                     "class=\"task-list-item-checkbox\" disabled>todo</li>\n"
+                     "</ul>\n"));
+    QCOMPARE(renderer.render("```cpp\nint a;\n```\n"),
+             QString("<pre><code class=\"language-cpp\">int a;\n"
+                     "</code></pre>\n"));
+    QCOMPARE(renderer.render("| a | b |\n|:--|--:|\n| 1 | 2 |\n"),
+             QString("<table>\n<thead>\n<tr>\n"
+                     "<th align=\"left\">a</th>\n"
+                     "<th align=\"right\">b</th>\n"
+                     "</tr>\n</thead>\n<tbody>\n<tr>\n"
+                     "<td align=\"left\">1</td>\n"
+                     "<td align=\"right\">2</td>\n"
+                     "</tr>\n</tbody>\n</table>\n"));
+}
+
+void TestMarkdownRenderer::testHeadings_GetUniqueIds() {
+    MarkdownRenderer renderer;
+
+    QString html = renderer.render("# Intro\n\n## Intro\n\n### Intro\n");
+
+    QVERIFY(html.contains("<h1 id=\"intro\">Intro</h1>"));
+    QVERIFY(html.contains("<h2 id=\"intro-2\">Intro</h2>"));
+    QVERIFY(html.contains("<h3 id=\"intro-3\">Intro</h3>"));
+}
+
+void TestMarkdownRenderer::testHeadings_IdFromPlainText() {
+    MarkdownRenderer renderer;
+
+    // Inline markup does not end up in the id.
+    QString html = renderer.render("## Using `code` and **bold**\n");
+
+    QVERIFY(html.contains(
+        "<h2 id=\"using-code-and-bold\">Using <code>code</code> and "
+        "<strong>bold</strong></h2>"));
+}
+
+void TestMarkdownRenderer::testLinks_WikiAndMarkdown() {
+    MarkdownRenderer renderer;
+
+    QString html = renderer.render(
+        "[[Some Page|shown]] [note](other.md) [web](https://example.com)\n");
+
+    QVERIFY(html.contains(
+        "<a href=\"wiki:Some Page\" class=\"wiki-link\">shown</a>"));
+    QVERIFY(html.contains(
+        "<a href=\"markdown:other.md\" class=\"markdown-link\">note</a>"));
+    QVERIFY(html.contains("<a href=\"https://example.com\">web</a>"));
+}
+
+void TestMarkdownRenderer::testMath_Delimiters() {
+    MarkdownRenderer renderer;
+
+    QString html = renderer.render("Inline $a<b$ and $$x^2$$\n");
+    QVERIFY(html.contains("$a&lt;b$"));
+    QVERIFY(html.contains("$$x^2$$"));
+
+    renderer.setLatexEnabled(false);
+    html = renderer.render("Inline $a$ and $$b$$\n");
+    QVERIFY(html.contains("<x-equation>a</x-equation>"));
+    QVERIFY(html.contains("<x-equation type=\"display\">b</x-equation>"));
+}
+
+void TestMarkdownRenderer::testInclusion_RendersIncludedNote() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    writeFile(dir.filePath("part.md"), "## Part\n\nSome text.\n");
+
+    MarkdownRenderer renderer;
+    renderer.setBasePath(dir.path());
+    QStringList includedFiles;
+    QString html = renderer.render("[[!part|The part]]\n", &includedFiles);
+
+    QVERIFY(html.contains("class=\"included-content\""));
+    QVERIFY(html.contains(">The part</div>"));
+    QVERIFY(html.contains("<h2 id=\"part\">Part</h2>"));
+    const QString partPath = QFileInfo(dir.filePath("part.md")).absoluteFilePath();
+    QCOMPARE(includedFiles, QStringList{partPath});
+}
+
+void TestMarkdownRenderer::testInclusion_Nested() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(QDir(dir.path()).mkdir("sub"));
+    writeFile(dir.filePath("sub/outer.md"), "Outer [[!inner]]\n");
+    // Resolved next to outer.md, not the base path.
+    writeFile(dir.filePath("sub/inner.md"), "Inner text\n");
+
+    MarkdownRenderer renderer;
+    renderer.setBasePath(dir.path());
+    QStringList includedFiles;
+    QString html = renderer.render("[[!sub/outer]]\n", &includedFiles);
+
+    QVERIFY(html.contains("Outer"));
+    QVERIFY(html.contains("<p>Inner text</p>"));
+    QCOMPARE(includedFiles.size(), 2);
+}
+
+void TestMarkdownRenderer::testInclusion_Cycle() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    writeFile(dir.filePath("a.md"), "A [[!b]]\n");
+    writeFile(dir.filePath("b.md"), "B [[!a]]\n");
+    writeFile(dir.filePath("self.md"), "Self [[!self]]\n");
+
+    MarkdownRenderer renderer;
+    renderer.setBasePath(dir.path());
+
+    QString html = renderer.render("[[!a]]\n");
+    QVERIFY(html.contains("Circular inclusion: a"));
+    QCOMPARE(html.count("class=\"included-content\""), 2);
+
+    html = renderer.render("[[!self]]\n");
+    QVERIFY(html.contains("Circular inclusion: self"));
+}
+
+void TestMarkdownRenderer::testInclusion_ChangedFileIsReRendered() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("part.md");
+    writeFile(path, "First\n");
+
+    MarkdownRenderer renderer;
+    renderer.setBasePath(dir.path());
+    QVERIFY(renderer.render("[[!part]]\n").contains("First"));
+
+    // A different size is enough to tell the cached copy is stale.
+    writeFile(path, "Second version\n");
+    QVERIFY(renderer.render("[[!part]]\n").contains("Second version"));
+
+    // Same size and possibly the same mtime: only a change notification
+    // tells them apart.
+    writeFile(path, "Third  version\n");
+    InclusionCache::instance()->invalidate(QFileInfo(path).absoluteFilePath());
+    QVERIFY(renderer.render("[[!part]]\n").contains("Third  version"));
+}
+
+void TestMarkdownRenderer::testInclusion_MissingFile() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    MarkdownRenderer renderer;
+    renderer.setBasePath(dir.path());
+    QString html = renderer.render("[[!missing]]\n");
+
+    QVERIFY(html.contains("class=\"inclusion-error\""));
+    QVERIFY(html.contains("File not found: missing"));
+}
+
+void TestMarkdownRenderer::testInclusion_InsideCode() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(dir.filePath("snippet.py"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("if a < b:\n    pass\n");
+    file.close();
+
+    MarkdownRenderer renderer;
+    renderer.setBasePath(dir.path());
+    QString html = renderer.render("```python\n[[!snippet.py]]\n```\n");
+
+    QCOMPARE(html, QString("<pre><code class=\"language-python\">"
+                           "if a &lt; b:\n    pass\n\n</code></pre>\n"));
+}
+
+void TestMarkdownRenderer::testMermaid_UsesCachedSvg() {
+    const QString markdown = "```mermaid\ngraph TD; A-->B;\n```\n";
+    MarkdownRenderer renderer;
+
+    // Without a diagram theme the block is plain code.
+    QCOMPARE(renderer.render(markdown),
+             QString("<pre><code class=\"language-mermaid\">"
+                     "graph TD; A--&gt;B;\n</code></pre>\n"));
+
+    renderer.setDiagramCache(QString(), "default");
+    const QString key =
+        MermaidCache::diagramKey("graph TD; A--&gt;B;\n", "default");
+    QCOMPARE(renderer.render(markdown),
+             QString("<pre><code class=\"language-mermaid\" "
+                     "data-mermaid-key=\"%1\">graph TD; A--&gt;B;\n"
+                     "</code></pre>\n")
+                 .arg(key));
+
+    MermaidCache::instance()->store(QString(), key, "<svg>AB</svg>");
+    QCOMPARE(renderer.render(markdown),
+             QString("<div class=\"mermaid-container\"><svg>AB</svg>"
+                     "</div>\n"));
+
+    // Another theme is another diagram.
+    renderer.setDiagramCache(QString(), "dark");
+    QVERIFY(renderer.render(markdown).contains("data-mermaid-key"));
+}
+
+void TestMarkdownRenderer::testPrerender_MathAndCode() {
+    MarkdownRenderer renderer;
+    renderer.setPrerenderEnabled(true);
+
+    QString html = renderer.render("Inline $x^2$ and $$y$$\n");
+    QCOMPARE(html.count("<span class=\"katex\">"), 2);
+    QVERIFY(html.contains("katex-display"));
+    QVERIFY(!html.contains("$x^2$"));
+
+    html = renderer.render("```cpp\nint a;\n```\n");
+    QVERIFY(html.startsWith("<pre><code class=\"hljs language-cpp\">"
+                            "<span class=\"hljs-type\">int</span> a;"));
+    QVERIFY(html.endsWith("</code></pre>\n"));
+
+    // Unknown languages are escaped but not highlighted.
+    QCOMPARE(renderer.render("```nolang\na<b\n```\n"),
+             QString("<pre><code class=\"hljs language-nolang\">a&lt;b\n"
+                     "</code></pre>\n"));
+
+    // With LaTeX off, math stays as elements.
+    renderer.setLatexEnabled(false);
+    QVERIFY(renderer.render("$a$\n").contains("<x-equation>a</x-equation>"));
+}
+
+void TestMarkdownRenderer::testSourceLines_TopLevelBlocks() {
+    MarkdownRenderer renderer;
+    renderer.setSourceLinesEnabled(true);
+
+    const QString html = renderer.render(
+        "# Title\n"
+        "\n"
+        "Para one\n"
+        "continues\n"
+        "\n"
+        "- item\n"
+        "  - nested\n"
+        "\n"
+        "```cpp\n"
+        "int a;\n"
+        "```\n"
+        "> quote\n");
+
+    QVERIFY(html.startsWith("<h1 data-source-line=\"1\" id=\"title\">"));
+    QVERIFY(html.contains("<p data-source-line=\"3\">Para one\n"));
+    QVERIFY(html.contains("<ul data-source-line=\"6\">"));
+    QVERIFY(html.contains("<pre data-source-line=\"9\"><code "
+                          "class=\"language-cpp\">"));
+    QVERIFY(html.contains("<blockquote data-source-line=\"12\">"));
+    // Nested blocks are not marked.
+    QCOMPARE(html.count("data-source-line"), 5);
+}
+
+void TestMarkdownRenderer::testRender_ReusedBuffersStartEmpty() {
+    MarkdownRenderer renderer;
+    renderer.setSourceLinesEnabled(true);
+    QString longNote;
+    for (int i = 0; i < 200; ++i) {
+        longNote += QString("## Heading %1\n\n```\ncode %1\n```\n\n").arg(i);
+    }
+    QVERIFY(renderer.render(longNote).size() > longNote.size());
+
+    // Nothing of the long note may leak into a later, shorter one.
+    QCOMPARE(renderer.render("# Short\n"),
+             QString("<h1 data-source-line=\"1\" id=\"short\">Short</h1>\n"));
+    renderer.setSourceLinesEnabled(false);
+    QCOMPARE(renderer.render("```\nx\n```\n"),
+             QString("<pre><code>x\n</code></pre>\n"));
+}
+
+void TestMarkdownRenderer::testEscaping() {
+    MarkdownRenderer renderer;
+
+    QCOMPARE(renderer.render("a < b & \"c\"\n"),
+             QString("<p>a &lt; b &amp; &quot;c&quot;</p>\n"));
+    QCOMPARE(renderer.render("![alt *text*](img.png \"Title\")\n"),
+             QString("<p><img src=\"img.png\" alt=\"alt text\" "
+                     "title=\"Title\"></p>\n"));
+    QCOMPARE(renderer.render("<div>raw</div>\n"),
+             QString("<div>raw</div>\n"));
+}
+
+QTEST_MAIN(TestMarkdownRenderer)
+#include "test_markdownrenderer.moc"
@@ -0,0 +1,65 @@
+#include <QtTest/QtTest>
+#include <QPageLayout>
+#include <QPageSize>
+
+#include "pdfexporter.h"
+
+class TestPdfExporter : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testPageLayout_PageSize_data();
+    void testPageLayout_PageSize();
+    void testPageLayout_Orientation();
+    void testPageLayout_Margins();
+};
+
+void TestPdfExporter::testPageLayout_PageSize_data() {
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<int>("id");
+
+    QTest::newRow("A3") << "A3" << int(QPageSize::A3);
+    QTest::newRow("A4") << "A4" << int(QPageSize::A4);
+    QTest::newRow("A5") << "A5" << int(QPageSize::A5);
+    QTest::newRow("Letter") << "Letter" << int(QPageSize::Letter);
+    QTest::newRow("Legal") << "Legal" << int(QPageSize::Legal);
+    QTest::newRow("unknown") << "Tabloid" << int(QPageSize::A4);
+    QTest::newRow("empty") << "" << int(QPageSize::A4);
+}
+
+void TestPdfExporter::testPageLayout_PageSize() {
+    QFETCH(QString, name);
+    QFETCH(int, id);
+
+    const QPageLayout layout = PdfExporter::pageLayout(name, false, 10);
+    QCOMPARE(int(layout.pageSize().id()), id);
+    QVERIFY(layout.isValid());
+}
+
+void TestPdfExporter::testPageLayout_Orientation() {
+    const QPageLayout portrait = PdfExporter::pageLayout("A4", false, 10);
+    QCOMPARE(portrait.orientation(), QPageLayout::Portrait);
+    QVERIFY(portrait.fullRect().height() > portrait.fullRect().width());
+
+    const QPageLayout landscape = PdfExporter::pageLayout("A4", true, 10);
+    QCOMPARE(landscape.orientation(), QPageLayout::Landscape);
+    QVERIFY(landscape.fullRect().width() > landscape.fullRect().height());
+    // The paper stays the same, only turned.
+    QCOMPARE(landscape.pageSize().id(), QPageSize::A4);
+}
+
+void TestPdfExporter::testPageLayout_Margins() {
+    const QPageLayout layout = PdfExporter::pageLayout("Letter", false, 12.5);
+    QCOMPARE(layout.units(), QPageLayout::Millimeter);
+    const QMarginsF margins = layout.margins();
+    QCOMPARE(margins.left(), 12.5);
+    QCOMPARE(margins.top(), 12.5);
+    QCOMPARE(margins.right(), 12.5);
+    QCOMPARE(margins.bottom(), 12.5);
+
+    // Negative margins are taken as none.
+    QVERIFY(PdfExporter::pageLayout("A4", false, -5).margins().isNull());
+}
+
+QTEST_MAIN(TestPdfExporter)
+#include "test_pdfexporter.moc"
@@ -0,0 +1,180 @@
+#include <QtTest/QtTest>
+
+#include "previewpatch.h"
+
+class TestPreviewPatch : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testSplit_TopLevelBlocks();
+    void testSplit_NestedAndVoidElements();
+    void testSplit_RawTextAndComments();
+    void testSplit_UnbalancedHtml();
+
+    void testDiff_Unchanged();
+    void testDiff_ChangedBlock();
+    void testDiff_InsertedAndRemovedBlocks();
+    void testDiff_DuplicateBlocks();
+    void testDiff_MovedBlocksKeepTheirKeys();
+};
+
+void TestPreviewPatch::testSplit_TopLevelBlocks() {
+    QString html =
+        "<h1 id=\"title\">Title</h1>\n"
+        "<p>First paragraph.</p>\n"
+        "<pre><code class=\"language-cpp\">if (a &lt; b) {}\n</code></pre>\n";
+
+    QStringList blocks = PreviewPatch::splitBlocks(html);
+
+    QCOMPARE(blocks.size(), 3);
+    QCOMPARE(blocks[0], QString("<h1 id=\"title\">Title</h1>"));
+    QCOMPARE(blocks[1], QString("<p>First paragraph.</p>"));
+    QVERIFY(blocks[2].startsWith("<pre>"));
+    QVERIFY(blocks[2].endsWith("</pre>"));
+}
+
+void TestPreviewPatch::testSplit_NestedAndVoidElements() {
+    QString html =
+        "<ul>\n<li>one</li>\n<li>two<br></li>\n</ul>\n"
+        "<hr />\n"
+        "<p><img src=\"a.png\" alt=\"a > b\"> caption</p>\n";
+
+    QStringList blocks = PreviewPatch::splitBlocks(html);
+
+    QCOMPARE(blocks.size(), 3);
+    QCOMPARE(blocks[0], QString("<ul>\n<li>one</li>\n<li>two<br></li>\n</ul>"));
+    QCOMPARE(blocks[1], QString("<hr />"));
+    QCOMPARE(blocks[2],
+             QString("<p><img src=\"a.png\" alt=\"a > b\"> caption</p>"));
+}
+
+void TestPreviewPatch::testSplit_RawTextAndComments() {
+    QString html =
+        "<script>if (a <b) {}</script>\n"
+        "<!-- note -->\n"
+        "<p>after</p>\n";
+
+    QStringList blocks = PreviewPatch::splitBlocks(html);
+
+    QCOMPARE(blocks.size(), 3);
+    QCOMPARE(blocks[0], QString("<script>if (a <b) {}</script>"));
+    QCOMPARE(blocks[1], QString("<!-- note -->"));
+    QCOMPARE(blocks[2], QString("<p>after</p>"));
+}
+
+void TestPreviewPatch::testSplit_UnbalancedHtml() {
+    QString html =
+        "<p>before</p>\n"
+        "<div class=\"open\">\n"
+        "<p>inside</p>\n"
+        "<p>still inside</p>\n";
+
+    QStringList blocks = PreviewPatch::splitBlocks(html);
+
+    QCOMPARE(blocks.size(), 2);
+    QCOMPARE(blocks[0], QString("<p>before</p>"));
+    QVERIFY(blocks[1].startsWith("<div class=\"open\">"));
+    QVERIFY(blocks[1].endsWith("<p>still inside</p>\n"));
+
+    // A stray closing tag does not swallow the blocks after it.
+    blocks = PreviewPatch::splitBlocks("</div>\n<p>a</p>\n<p>b</p>\n");
+    QCOMPARE(blocks.size(), 3);
+    QCOMPARE(blocks[2], QString("<p>b</p>"));
+}
+
+void TestPreviewPatch::testDiff_Unchanged() {
+    QStringList blocks;
+    blocks << "<p>a</p>" << "<p>b</p>";
+    QVector<size_t> keys = PreviewPatch::blockKeys(blocks);
+
+    PreviewPatch::Patch patch = PreviewPatch::diff(keys, keys, blocks);
+
+    QVERIFY(patch.isEmpty());
+}
+
+void TestPreviewPatch::testDiff_ChangedBlock() {
+    QStringList oldBlocks;
+    oldBlocks << "<p>a</p>" << "<p>b</p>" << "<p>c</p>";
+    QStringList newBlocks;
+    newBlocks << "<p>a</p>" << "<p>b!</p>" << "<p>c</p>";
+
+    PreviewPatch::Patch patch =
+        PreviewPatch::diff(PreviewPatch::blockKeys(oldBlocks),
+                           PreviewPatch::blockKeys(newBlocks), newBlocks);
+
+    QCOMPARE(patch.start, 1);
+    QCOMPARE(patch.removeCount, 1);
+    QCOMPARE(patch.blocks, QStringList() << "<p>b!</p>");
+}
+
+void TestPreviewPatch::testDiff_InsertedAndRemovedBlocks() {
+    QStringList oldBlocks;
+    oldBlocks << "<p>a</p>" << "<p>c</p>";
+    QStringList newBlocks;
+    newBlocks << "<p>a</p>" << "<p>b</p>" << "<p>c</p>";
+
+    PreviewPatch::Patch inserted =
+        PreviewPatch::diff(PreviewPatch::blockKeys(oldBlocks),
+                           PreviewPatch::blockKeys(newBlocks), newBlocks);
+    QCOMPARE(inserted.start, 1);
+    QCOMPARE(inserted.removeCount, 0);
+    QCOMPARE(inserted.blocks, QStringList() << "<p>b</p>");
+
+    PreviewPatch::Patch removed =
+        PreviewPatch::diff(PreviewPatch::blockKeys(newBlocks),
+                           PreviewPatch::blockKeys(oldBlocks), oldBlocks);
+    QCOMPARE(removed.start, 1);
+    QCOMPARE(removed.removeCount, 1);
+    QVERIFY(removed.blocks.isEmpty());
+
+    PreviewPatch::Patch cleared = PreviewPatch::diff(
+        PreviewPatch::blockKeys(oldBlocks), QVector<size_t>(), QStringList());
+    QCOMPARE(cleared.start, 0);
+    QCOMPARE(cleared.removeCount, 2);
+    QVERIFY(cleared.blocks.isEmpty());
+}
+
+void TestPreviewPatch::testDiff_DuplicateBlocks() {
+    // Adding a copy of a repeated block must not overlap the kept prefix
+    // and suffix.
+    QStringList oldBlocks;
+    oldBlocks << "<hr />" << "<hr />";
+    QStringList newBlocks;
+    newBlocks << "<hr />" << "<hr />" << "<hr />";
+
+    PreviewPatch::Patch patch =
+        PreviewPatch::diff(PreviewPatch::blockKeys(oldBlocks),
+                           PreviewPatch::blockKeys(newBlocks), newBlocks);
+
+    QCOMPARE(patch.start, 2);
+    QCOMPARE(patch.removeCount, 0);
+    QCOMPARE(patch.blocks, QStringList() << "<hr />");
+}
+
+void TestPreviewPatch::testDiff_MovedBlocksKeepTheirKeys() {
+    // A line inserted above shifts the source lines of the blocks below;
+    // they must not be replaced for that alone.
+    QStringList oldBlocks;
+    oldBlocks << "<p data-source-line=\"1\">One</p>"
+              << "<p data-source-line=\"3\">Two</p>";
+    QStringList newBlocks;
+    newBlocks << "<p data-source-line=\"1\">One</p>"
+              << "<p data-source-line=\"3\">New</p>"
+              << "<p data-source-line=\"5\">Two</p>";
+
+    PreviewPatch::Patch patch =
+        PreviewPatch::diff(PreviewPatch::blockKeys(oldBlocks),
+                           PreviewPatch::blockKeys(newBlocks), newBlocks);
+
+    QCOMPARE(patch.start, 1);
+    QCOMPARE(patch.removeCount, 0);
+    QCOMPARE(patch.blocks, QStringList() << newBlocks[1]);
+    QCOMPARE(PreviewPatch::sourceLine(newBlocks[2]), 5);
+    QCOMPARE(PreviewPatch::sourceLine("<hr />"), 0);
+    QCOMPARE(PreviewPatch::sourceLine(
+                 "<p>Text data-source-line=\"2\"</p>"),
+             0);
+}
+
+QTEST_MAIN(TestPreviewPatch)
+#include "test_previewpatch.moc"
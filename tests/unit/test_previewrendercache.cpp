@@ -0,0 +1,80 @@
+#include <QtTest/QtTest>
+#include <QDateTime>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "previewrendercache.h"
+
+class TestPreviewRenderCache : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testFind_MatchesRevisionAndSettings();
+    void testFind_MissesWhenIncludedFileChanged();
+    void testStore_DropsLeastRecentlyUsed();
+};
+
+void TestPreviewRenderCache::testFind_MatchesRevisionAndSettings() {
+    PreviewRenderCache cache;
+    QStringList blocks;
+    QStringList includedFiles;
+    QVERIFY(!cache.find(1, 3, "settings", blocks, includedFiles));
+
+    cache.store(1, 3, "settings", QStringList() << "<p>One</p>",
+                QStringList());
+    QVERIFY(cache.find(1, 3, "settings", blocks, includedFiles));
+    QCOMPARE(blocks, QStringList() << "<p>One</p>");
+    QVERIFY(includedFiles.isEmpty());
+
+    QVERIFY(!cache.find(1, 4, "settings", blocks, includedFiles));
+    QVERIFY(!cache.find(1, 3, "other settings", blocks, includedFiles));
+    QVERIFY(!cache.find(2, 3, "settings", blocks, includedFiles));
+
+    cache.remove(1);
+    QVERIFY(!cache.find(1, 3, "settings", blocks, includedFiles));
+}
+
+void TestPreviewRenderCache::testFind_MissesWhenIncludedFileChanged() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("included.md");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("Included");
+    file.close();
+
+    PreviewRenderCache cache;
+    cache.store(1, 1, "settings", QStringList() << "<p>Included</p>",
+                QStringList() << path);
+    QStringList blocks;
+    QStringList includedFiles;
+    QVERIFY(cache.find(1, 1, "settings", blocks, includedFiles));
+    QCOMPARE(includedFiles, QStringList() << path);
+
+    QVERIFY(file.open(QIODevice::Append));
+    QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(60),
+                             QFileDevice::FileModificationTime));
+    file.close();
+    QVERIFY(!cache.find(1, 1, "settings", blocks, includedFiles));
+}
+
+void TestPreviewRenderCache::testStore_DropsLeastRecentlyUsed() {
+    // Room for two blocks of 8 characters, 16 bytes each.
+    PreviewRenderCache cache(32);
+    const QStringList blocks = QStringList() << "<p>A</p>";
+    cache.store(1, 1, "s", blocks, QStringList());
+    cache.store(2, 1, "s", blocks, QStringList());
+
+    QStringList found;
+    QStringList includedFiles;
+    // Showing the first document again makes the second the oldest.
+    QVERIFY(cache.find(1, 1, "s", found, includedFiles));
+    cache.store(3, 1, "s", blocks, QStringList());
+
+    QVERIFY(cache.find(1, 1, "s", found, includedFiles));
+    QVERIFY(!cache.find(2, 1, "s", found, includedFiles));
+    QVERIFY(cache.find(3, 1, "s", found, includedFiles));
+}
+
+QTEST_MAIN(TestPreviewRenderCache)
+#include "test_previewrendercache.moc"
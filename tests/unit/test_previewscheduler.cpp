@@ -0,0 +1,62 @@
+#include <QtTest/QtTest>
+#include <QSignalSpy>
+
+#include "previewscheduler.h"
+
+class TestPreviewScheduler : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testSchedule_CoalescesRequests();
+    void testInterval_FollowsRenderTime();
+    void testCancel_DropsScheduledRender();
+};
+
+void TestPreviewScheduler::testSchedule_CoalescesRequests() {
+    PreviewScheduler scheduler;
+    scheduler.setMinimumInterval(50);
+    QSignalSpy spy(&scheduler, &PreviewScheduler::renderDue);
+
+    for (int i = 0; i < 5; ++i) {
+        scheduler.schedule(1);
+        QTest::qWait(10);
+    }
+    QVERIFY(spy.wait(1000));
+    QTest::qWait(100);
+    QCOMPARE(spy.count(), 1);
+}
+
+void TestPreviewScheduler::testInterval_FollowsRenderTime() {
+    PreviewScheduler scheduler;
+    scheduler.setMinimumInterval(100);
+    QCOMPARE(scheduler.interval(1), 100);
+
+    // Fast renders keep the minimum.
+    scheduler.recordRenderTime(1, 20);
+    QCOMPARE(scheduler.interval(1), 100);
+
+    // Slow renders wait twice their smoothed time, up to the maximum.
+    scheduler.recordRenderTime(2, 400);
+    QCOMPARE(scheduler.interval(2), 800);
+    scheduler.recordRenderTime(2, 400);
+    QCOMPARE(scheduler.interval(2), 800);
+    scheduler.recordRenderTime(3, 10000);
+    QCOMPARE(scheduler.interval(3), PreviewScheduler::MAXIMUM_INTERVAL);
+
+    // Other documents are unaffected.
+    QCOMPARE(scheduler.interval(4), 100);
+}
+
+void TestPreviewScheduler::testCancel_DropsScheduledRender() {
+    PreviewScheduler scheduler;
+    scheduler.setMinimumInterval(20);
+    QSignalSpy spy(&scheduler, &PreviewScheduler::renderDue);
+
+    scheduler.schedule(1);
+    scheduler.cancel();
+    QTest::qWait(100);
+    QCOMPARE(spy.count(), 0);
+}
+
+QTEST_MAIN(TestPreviewScheduler)
+#include "test_previewscheduler.moc"
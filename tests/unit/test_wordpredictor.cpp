@@ -0,0 +1,461 @@
+#include <QtTest/QtTest>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <cstring>
+#include "completionindex.h"
+#include "ngrammodel.h"
+#include "ngrammodelbuilder.h"
+#include "wordpredictor.h"
+
+class TestWordPredictor : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testIndex_Empty();
+    void testIndex_CompletesMostFrequent();
+    void testIndex_SkipsExactMatch();
+    void testIndex_TieGoesToAlphabeticalFirst();
+    void testIndex_UnknownPrefix();
+    void testIndex_WordIdAndFrequency();
+    void testIndex_CompleteAfter();
+    void testIndex_CompleteAfterFiltersPrefix();
+    void testIndex_CompleteAfterMatchesScan();
+
+    void testPredictor_DocumentText();
+    void testPredictor_ParagraphEdit();
+    void testPredictor_ParagraphEditAcrossLines();
+    void testPredictor_PrefersBigram();
+    void testPredictor_Directory();
+    void testPredictor_RefreshFile();
+    void testPredictor_Clear();
+    void testPredictor_UsesLanguageModelTrigram();
+
+    void testNgram_RoundTrip();
+    void testNgram_TrigramContext();
+    void testNgram_SentenceBoundary();
+    void testNgram_RejectsCorruptFile();
+    void testNgram_RejectsCorruptTables();
+    void testNgram_StaysWithinBudget();
+
+private:
+    static CompletionIndex makeIndex(const QString& text);
+};
+
+CompletionIndex TestWordPredictor::makeIndex(const QString& text) {
+    QHash<QString, int> words;
+    QHash<QPair<QString, QString>, int> bigrams;
+    const QStringList tokens = text.split(' ', Qt::SkipEmptyParts);
+    for (int i = 0; i < tokens.size(); ++i) {
+        words[tokens[i]]++;
+        if (i > 0) {
+            bigrams[qMakePair(tokens[i - 1], tokens[i])]++;
+        }
+    }
+    return CompletionIndex(words, bigrams);
+}
+
+void TestWordPredictor::testIndex_Empty() {
+    CompletionIndex index;
+    QVERIFY(index.isEmpty());
+    QCOMPARE(index.complete("ab"), -1);
+    QCOMPARE(index.wordId("abc"), -1);
+    QCOMPARE(index.completeAfter(0, "a"), -1);
+    QCOMPARE(index.word(-1), QString());
+
+    CompletionIndex built = makeIndex("");
+    QVERIFY(built.isEmpty());
+    QCOMPARE(built.complete("ab"), -1);
+}
+
+void TestWordPredictor::testIndex_CompletesMostFrequent() {
+    CompletionIndex index =
+        makeIndex("markdown market market marker market markdown");
+    QCOMPARE(index.word(index.complete("mar")), QString("market"));
+    QCOMPARE(index.word(index.complete("markd")), QString("markdown"));
+}
+
+void TestWordPredictor::testIndex_SkipsExactMatch() {
+    CompletionIndex index = makeIndex("note note note notes");
+    QCOMPARE(index.word(index.complete("note")), QString("notes"));
+    QCOMPARE(index.complete("notes"), -1);
+}
+
+void TestWordPredictor::testIndex_TieGoesToAlphabeticalFirst() {
+    CompletionIndex index = makeIndex("tree trek trend");
+    QCOMPARE(index.word(index.complete("tre")), QString("tree"));
+}
+
+void TestWordPredictor::testIndex_UnknownPrefix() {
+    CompletionIndex index = makeIndex("alpha beta gamma");
+    QCOMPARE(index.complete("zz"), -1);
+    QCOMPARE(index.complete("alphax"), -1);
+}
+
+void TestWordPredictor::testIndex_WordIdAndFrequency() {
+    CompletionIndex index = makeIndex("beta alpha beta");
+    QCOMPARE(index.wordCount(), 2);
+    QCOMPARE(index.wordId("alpha"), 0);
+    QCOMPARE(index.wordId("beta"), 1);
+    QCOMPARE(index.wordId("bet"), -1);
+    QCOMPARE(index.frequency(1), 2);
+    QCOMPARE(index.bigramFrequency(1, 0), 1);
+    QCOMPARE(index.bigramFrequency(0, 0), 0);
+}
+
+void TestWordPredictor::testIndex_CompleteAfter() {
+    CompletionIndex index = makeIndex(
+        "quantum mechanics quantum mechanics quantum field mechanism "
+        "mechanism mechanism");
+    int quantum = index.wordId("quantum");
+    QVERIFY(quantum >= 0);
+    QCOMPARE(index.word(index.completeAfter(quantum, "me")),
+             QString("mechanics"));
+    QCOMPARE(index.word(index.complete("me")), QString("mechanism"));
+    QCOMPARE(index.bigramFrequency(quantum, index.wordId("mechanics")), 2);
+}
+
+void TestWordPredictor::testIndex_CompleteAfterFiltersPrefix() {
+    CompletionIndex index = makeIndex("open file open folder open form");
+    int open = index.wordId("open");
+    QCOMPARE(index.word(index.completeAfter(open, "fo")), QString("folder"));
+    QCOMPARE(index.word(index.completeAfter(open, "fi")), QString("file"));
+    QCOMPARE(index.completeAfter(open, "file"), -1);
+    QCOMPARE(index.completeAfter(open, "x"), -1);
+}
+
+void TestWordPredictor::testIndex_CompleteAfterMatchesScan() {
+    // Many followers of "the" with repeated frequencies, compared with
+    // a scan of every word for each prefix.
+    QHash<QString, int> words;
+    QHash<QPair<QString, QString>, int> bigrams;
+    words["the"] = 1;
+    const QString letters = "abc";
+    for (int i = 0; i < 27; ++i) {
+        QString word;
+        for (int n = i, length = 1 + i % 3; length > 0; --length, n /= 3) {
+            word += letters[n % 3];
+        }
+        words[word] = 1;
+        bigrams[qMakePair(QString("the"), word)] = 1 + (i * 7) % 5;
+    }
+    CompletionIndex index(words, bigrams);
+    const int the = index.wordId("the");
+
+    QStringList prefixes;
+    prefixes << "";
+    for (int id = 0; id < index.wordCount(); ++id) {
+        const QString word = index.word(id);
+        for (int length = 1; length <= word.length(); ++length) {
+            prefixes << word.left(length);
+        }
+    }
+    for (const QString& prefix : prefixes) {
+        int expected = -1;
+        for (int id = 0; id < index.wordCount(); ++id) {
+            const QString word = index.word(id);
+            if (word.length() > prefix.length() && word.startsWith(prefix) &&
+                index.bigramFrequency(the, id) >
+                    index.bigramFrequency(the, expected)) {
+                expected = id;
+            }
+        }
+        QCOMPARE(index.completeAfter(the, prefix), expected);
+    }
+}
+
+void TestWordPredictor::testPredictor_DocumentText() {
+    WordPredictor predictor;
+    predictor.setDocumentText("Prediction predicts predictable prediction");
+    predictor.waitForUpdates();
+
+    QCOMPARE(predictor.predict("pre"), QString("prediction"));
+    QCOMPARE(predictor.predict("Pre"), QString("prediction"));
+    QCOMPARE(predictor.predict("p"), QString());
+}
+
+void TestWordPredictor::testPredictor_ParagraphEdit() {
+    WordPredictor predictor;
+    predictor.setDocumentText("alpha\nbeta");
+    predictor.applyParagraphEdit("beta", "gamma gamma");
+    predictor.waitForUpdates();
+
+    QCOMPARE(predictor.predict("be"), QString());
+    QCOMPARE(predictor.predict("ga"), QString("gamma"));
+    QCOMPARE(predictor.predict("al"), QString("alpha"));
+}
+
+void TestWordPredictor::testPredictor_ParagraphEditAcrossLines() {
+    QCOMPARE(WordPredictor::firstWord("- [ ] Static typing"),
+             QString("static"));
+    QCOMPARE(WordPredictor::lastWord("alpha Beta 42"), QString("beta"));
+
+    WordPredictor predictor;
+    predictor.setDocumentText("alpha beta\nstatic typing\nstatic");
+    // The bigram from the line above now leads to the edited line.
+    predictor.applyParagraphEdit("static typing", "string typing", "beta",
+                                 "static");
+    predictor.waitForUpdates();
+
+    QCOMPARE(predictor.predict("st", "beta"), QString("string"));
+    QCOMPARE(predictor.predict("st", "typing"), QString("static"));
+}
+
+void TestWordPredictor::testPredictor_PrefersBigram() {
+    WordPredictor predictor;
+    predictor.setDocumentText(
+        "static typing static typing string string string");
+    predictor.waitForUpdates();
+
+    QCOMPARE(predictor.predict("st"), QString("string"));
+    QCOMPARE(predictor.predict("ty", "static"), QString("typing"));
+}
+
+void TestWordPredictor::testPredictor_Directory() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    auto writeFile = [&dir](const QString& name, const QString& content) {
+        QFile file(dir.filePath(name));
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+        QTextStream out(&file);
+        out << content;
+    };
+    writeFile("current.md", "excluded excluded excluded");
+    writeFile("other.md", "exclusive");
+    writeFile("notes.txt", "exclamation");
+
+    WordPredictor predictor;
+    predictor.updateFromDirectory(dir.path(), dir.filePath("current.md"));
+    predictor.waitForUpdates();
+
+    QCOMPARE(predictor.predict("exc"), QString("exclusive"));
+
+    QVERIFY(QFile::remove(dir.filePath("other.md")));
+    predictor.updateFromDirectory(dir.path(), dir.filePath("current.md"));
+    predictor.waitForUpdates();
+
+    QCOMPARE(predictor.predict("exc"), QString());
+}
+
+void TestWordPredictor::testPredictor_RefreshFile() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    auto writeFile = [&dir](const QString& name, const QString& content) {
+        QFile file(dir.filePath(name));
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+        QTextStream out(&file);
+        out << content;
+    };
+    writeFile("current.md", "nothing");
+
+    WordPredictor predictor;
+    predictor.updateFromDirectory(dir.path(), dir.filePath("current.md"));
+    predictor.waitForUpdates();
+    QCOMPARE(predictor.predict("ele"), QString());
+
+    // Added next to the current note
+    writeFile("added.md", "elephant");
+    predictor.refreshFile(dir.filePath("added.md"));
+    predictor.waitForUpdates();
+    QCOMPARE(predictor.predict("ele"), QString("elephant"));
+
+    writeFile("added.md", "elevation elevation");
+    predictor.refreshFile(dir.filePath("added.md"));
+    predictor.waitForUpdates();
+    QCOMPARE(predictor.predict("ele"), QString("elevation"));
+
+    QVERIFY(QFile::remove(dir.filePath("added.md")));
+    predictor.refreshFile(dir.filePath("added.md"));
+    predictor.waitForUpdates();
+    QCOMPARE(predictor.predict("ele"), QString());
+
+    // Files in other folders are not counted.
+    QVERIFY(QDir(dir.path()).mkdir("sub"));
+    writeFile("sub/other.md", "elegant");
+    predictor.refreshFile(dir.filePath("sub/other.md"));
+    predictor.waitForUpdates();
+    QCOMPARE(predictor.predict("ele"), QString());
+}
+
+void TestWordPredictor::testPredictor_Clear() {
+    WordPredictor predictor;
+    predictor.setDocumentText("something");
+    predictor.clear();
+    predictor.waitForUpdates();
+
+    QCOMPARE(predictor.predict("som"), QString());
+}
+
+void TestWordPredictor::testPredictor_UsesLanguageModelTrigram() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    NgramModelBuilder builder(1024 * 1024);
+    builder.addText("the quick brown fox. the quick brown fox.");
+    QVERIFY(builder.write(dir.filePath("model.bin"), 1));
+
+    WordPredictor predictor;
+    predictor.setDocumentText("quick bread quick bread quick bread");
+    predictor.setLanguageModel(NgramModel::open(dir.filePath("model.bin")));
+    predictor.waitForUpdates();
+
+    // A workspace bigram does not override the document's own bigram,
+    // but a workspace trigram does.
+    QCOMPARE(predictor.predict("br", "quick"), QString("bread"));
+    QCOMPARE(predictor.predict("br", "quick", "the"), QString("brown"));
+}
+
+void TestWordPredictor::testNgram_RoundTrip() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    NgramModelBuilder builder(1024 * 1024);
+    builder.addText("Markdown notes and markdown files. Notes about notes.");
+    QCOMPARE(builder.tokenCount(), qint64(8));
+    QVERIFY(builder.write(dir.filePath("model.bin"), 42));
+
+    std::shared_ptr<const NgramModel> model =
+        NgramModel::open(dir.filePath("model.bin"));
+    QVERIFY(model);
+    QCOMPARE(model->sourceStamp(), quint64(42));
+    // Five distinct words plus the sentence-start marker.
+    QCOMPARE(model->vocabularySize(), quint32(6));
+
+    NgramModel::Prediction prediction = model->predict("no", QString());
+    QVERIFY(prediction.isValid());
+    QCOMPARE(prediction.word, QString("notes"));
+    QCOMPARE(prediction.order, 1);
+
+    QVERIFY(!model->predict("notes", QString()).isValid());
+    QVERIFY(!model->predict("zz", QString()).isValid());
+}
+
+void TestWordPredictor::testNgram_TrigramContext() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    NgramModelBuilder builder(1024 * 1024);
+    builder.addText(
+        "open the folder. open the file. close the file. close the file.");
+    QVERIFY(builder.write(dir.filePath("model.bin"), 1));
+    std::shared_ptr<const NgramModel> model =
+        NgramModel::open(dir.filePath("model.bin"));
+    QVERIFY(model);
+
+    NgramModel::Prediction afterOpen = model->predict("f", "the", "open");
+    QCOMPARE(afterOpen.order, 3);
+    QVERIFY(afterOpen.word == "folder" || afterOpen.word == "file");
+
+    NgramModel::Prediction afterClose = model->predict("f", "the", "close");
+    QCOMPARE(afterClose.order, 3);
+    QCOMPARE(afterClose.word, QString("file"));
+
+    NgramModel::Prediction bigramOnly = model->predict("f", "the", "unknown");
+    QCOMPARE(bigramOnly.order, 2);
+    QCOMPARE(bigramOnly.word, QString("file"));
+}
+
+void TestWordPredictor::testNgram_SentenceBoundary() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    NgramModelBuilder builder(1024 * 1024);
+    builder.addText("alpha beta.\ngamma delta");
+    QVERIFY(builder.write(dir.filePath("model.bin"), 1));
+    std::shared_ptr<const NgramModel> model =
+        NgramModel::open(dir.filePath("model.bin"));
+    QVERIFY(model);
+
+    // "gamma" starts a new sentence, so it never follows "beta".
+    QVERIFY(model->predict("ga", "beta").order != 2);
+    QCOMPARE(model->predict("de", "gamma").order, 2);
+}
+
+void TestWordPredictor::testNgram_RejectsCorruptFile() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    NgramModelBuilder builder(1024 * 1024);
+    builder.addText("some words for a small model");
+    QVERIFY(builder.write(dir.filePath("model.bin"), 1));
+
+    QFile file(dir.filePath("model.bin"));
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(file.size() - 4));
+    file.close();
+
+    QVERIFY(!NgramModel::open(dir.filePath("model.bin")));
+    QVERIFY(!NgramModel::open(dir.filePath("missing.bin")));
+}
+
+void TestWordPredictor::testNgram_RejectsCorruptTables() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("model.bin");
+
+    NgramModelBuilder builder(1024 * 1024);
+    builder.addText("some words for a small model with some words");
+    QVERIFY(builder.write(path, 1));
+    QVERIFY(NgramModel::open(path));
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray original = file.readAll();
+    file.close();
+    NgramFileHeader header;
+    memcpy(&header, original.constData(), sizeof(header));
+    QVERIFY(header.bigramCount > 0);
+
+    auto aligned = [](qint64 bytes) { return (bytes + 3) & ~qint64(3); };
+    const qint64 vocabulary = header.vocabularySize;
+    const qint64 blocks = (vocabulary + NgramFileHeader::UNIGRAM_BLOCK - 1) /
+                          NgramFileHeader::UNIGRAM_BLOCK;
+    const qint64 wordOffsets = sizeof(NgramFileHeader);
+    const qint64 bigrams = wordOffsets + aligned((vocabulary + 1) * 4) +
+                           aligned(header.stringBytes) +
+                           2 * aligned(vocabulary) + blocks * 4 +
+                           (vocabulary + 1) * 4;
+
+    // A word offset past the strings, and a follower id past the
+    // vocabulary, with the sizes and the last offsets still intact.
+    const qint64 positions[] = {wordOffsets + 4, bigrams};
+    for (qint64 position : positions) {
+        QByteArray damaged = original;
+        const quint32 value = 0xffffff00;
+        memcpy(damaged.data() + position, &value, sizeof(value));
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        file.write(damaged);
+        file.close();
+        QVERIFY(!NgramModel::open(path));
+    }
+}
+
+void TestWordPredictor::testNgram_StaysWithinBudget() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QString text;
+    for (int i = 0; i < 2000; ++i) {
+        text += QString("word%1 ").arg(QChar('a' + i % 26)) +
+                QString(QChar('a' + (i * 7) % 26)).repeated(3) + " ";
+        text += QString(QChar('a' + (i * 13) % 26)).repeated(4) +
+                QString(QChar('a' + i % 26)) + " ";
+    }
+
+    NgramModelBuilder unbounded(64 * 1024 * 1024);
+    unbounded.addText(text);
+    QVERIFY(unbounded.write(dir.filePath("full.bin"), 1));
+    const qint64 fullSize = QFileInfo(dir.filePath("full.bin")).size();
+
+    const qint64 budget = fullSize - 64;
+    NgramModelBuilder bounded(budget);
+    bounded.addText(text);
+    QVERIFY(bounded.write(dir.filePath("small.bin"), 1));
+    QVERIFY(QFileInfo(dir.filePath("small.bin")).size() <= budget);
+    QVERIFY(NgramModel::open(dir.filePath("small.bin")));
+}
+
+QTEST_MAIN(TestWordPredictor)
+#include "test_wordpredictor.moc"
@@ -0,0 +1,192 @@
+#include <QtTest/QtTest>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "workspacecatalog.h"
+
+class TestWorkspaceCatalog : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void testList_SkipsHiddenAndDeepFiles();
+    void testCatalog_IsSortedAndRelative();
+    void testChanges_AddAndRemove();
+    void testRename_MovesDirectoryContents();
+    void testRescan_ListsDirectoryAgain();
+    void testChanges_WaitForListing();
+
+private:
+    void writeFile(const QString& relativePath);
+    QStringList paths(const WorkspaceCatalog& catalog);
+    void waitUntilReady(WorkspaceCatalog& catalog);
+
+    QTemporaryDir* m_dir;
+    QString m_root;
+};
+
+void TestWorkspaceCatalog::init() {
+    m_dir = new QTemporaryDir();
+    QVERIFY(m_dir->isValid());
+    m_root = QDir(m_dir->path()).absolutePath();
+    writeFile("b.md");
+    writeFile("a.markdown");
+    writeFile("notes/c.md");
+    writeFile("notes/image.png");
+    writeFile(".hidden/d.md");
+    writeFile("notes/.e.md");
+}
+
+void TestWorkspaceCatalog::cleanup() { delete m_dir; }
+
+void TestWorkspaceCatalog::writeFile(const QString& relativePath) {
+    const QString path = m_root + '/' + relativePath;
+    QVERIFY(QDir().mkpath(QFileInfo(path).path()));
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("x");
+}
+
+QStringList TestWorkspaceCatalog::paths(const WorkspaceCatalog& catalog) {
+    QStringList result;
+    for (int i = 0; i < catalog.count(); ++i) {
+        result.append(catalog.relativePath(i).toString());
+    }
+    return result;
+}
+
+void TestWorkspaceCatalog::waitUntilReady(WorkspaceCatalog& catalog) {
+    QTRY_VERIFY(catalog.isReady());
+}
+
+void TestWorkspaceCatalog::testList_SkipsHiddenAndDeepFiles() {
+    QString deep = "d0";
+    for (int i = 1; i <= 11; ++i) {
+        deep += "/d" + QString::number(i);
+    }
+    writeFile(deep + "/too-deep.md");
+    writeFile("d0/d1/d2/d3/d4/d5/d6/d7/d8/d9/deep-enough.md");
+
+    const WorkspaceCatalog::Listing listing =
+        WorkspaceCatalog::list(m_root, m_root);
+    QStringList found;
+    for (const WorkspaceCatalog::Entry& entry : listing.entries) {
+        found.append(listing.pool.mid(entry.offset, entry.length));
+    }
+    QCOMPARE(found, QStringList()
+                        << "a.markdown" << "b.md"
+                        << "d0/d1/d2/d3/d4/d5/d6/d7/d8/d9/deep-enough.md"
+                        << "notes/c.md");
+
+    QAtomicInt cancelled(1);
+    QVERIFY(WorkspaceCatalog::list(m_root, m_root, &cancelled)
+                .entries.isEmpty());
+}
+
+void TestWorkspaceCatalog::testCatalog_IsSortedAndRelative() {
+    WorkspaceCatalog catalog;
+    QVERIFY(!catalog.isReady());
+    catalog.setRootPath(m_root);
+    waitUntilReady(catalog);
+
+    QCOMPARE(paths(catalog),
+             QStringList() << "a.markdown" << "b.md" << "notes/c.md");
+    QCOMPARE(catalog.filePath(2), m_root + "/notes/c.md");
+    QVERIFY(catalog.contains("b.md"));
+    QVERIFY(!catalog.contains("notes/image.png"));
+
+    catalog.setRootPath(QString());
+    QCOMPARE(catalog.count(), 0);
+    QVERIFY(!catalog.isReady());
+}
+
+void TestWorkspaceCatalog::testChanges_AddAndRemove() {
+    WorkspaceCatalog catalog;
+    catalog.setRootPath(m_root);
+    waitUntilReady(catalog);
+    QSignalSpy spy(&catalog, &WorkspaceCatalog::catalogChanged);
+
+    WorkspaceChangeSet changes;
+    changes << WorkspaceChange(WorkspaceChange::Added, m_root + "/aa.md",
+                               false)
+            << WorkspaceChange(WorkspaceChange::Modified, m_root + "/b.md",
+                               false)
+            << WorkspaceChange(WorkspaceChange::Added, m_root + "/x.png",
+                               false)
+            << WorkspaceChange(WorkspaceChange::Added, m_root + "/.git/y.md",
+                               false)
+            << WorkspaceChange(WorkspaceChange::Added, "/elsewhere/z.md",
+                               false);
+    catalog.applyChanges(changes);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(paths(catalog), QStringList() << "a.markdown" << "aa.md"
+                                           << "b.md" << "notes/c.md");
+
+    // Removing a folder drops everything below it, but not its
+    // neighbours whose names merely start the same.
+    writeFile("notes-old.md");
+    catalog.applyChanges(WorkspaceChangeSet()
+                         << WorkspaceChange(WorkspaceChange::Added,
+                                            m_root + "/notes-old.md", false)
+                         << WorkspaceChange(WorkspaceChange::Removed,
+                                            m_root + "/notes", true));
+    QCOMPARE(paths(catalog), QStringList() << "a.markdown" << "aa.md"
+                                           << "b.md" << "notes-old.md");
+}
+
+void TestWorkspaceCatalog::testRename_MovesDirectoryContents() {
+    WorkspaceCatalog catalog;
+    catalog.setRootPath(m_root);
+    waitUntilReady(catalog);
+
+    catalog.applyChanges(WorkspaceChangeSet() << WorkspaceChange(
+                             WorkspaceChange::Renamed, m_root + "/c.md",
+                             false, m_root + "/b.md"));
+    QCOMPARE(paths(catalog),
+             QStringList() << "a.markdown" << "c.md" << "notes/c.md");
+
+    QVERIFY(QDir().rename(m_root + "/notes", m_root + "/archive"));
+    catalog.applyChanges(WorkspaceChangeSet() << WorkspaceChange(
+                             WorkspaceChange::Renamed, m_root + "/archive",
+                             true, m_root + "/notes"));
+    QTRY_VERIFY(catalog.contains("archive/c.md"));
+    QCOMPARE(paths(catalog),
+             QStringList() << "a.markdown" << "archive/c.md" << "c.md");
+}
+
+void TestWorkspaceCatalog::testRescan_ListsDirectoryAgain() {
+    WorkspaceCatalog catalog;
+    catalog.setRootPath(m_root);
+    waitUntilReady(catalog);
+
+    writeFile("notes/sub/f.md");
+    QVERIFY(QFile::remove(m_root + "/notes/c.md"));
+    catalog.applyChanges(WorkspaceChangeSet() << WorkspaceChange(
+                             WorkspaceChange::Rescan, m_root + "/notes",
+                             true));
+    QTRY_VERIFY(catalog.contains("notes/sub/f.md"));
+    QCOMPARE(paths(catalog),
+             QStringList() << "a.markdown" << "b.md" << "notes/sub/f.md");
+}
+
+void TestWorkspaceCatalog::testChanges_WaitForListing() {
+    for (int i = 0; i < 500; ++i) {
+        writeFile(QString("many/%1.md").arg(i));
+    }
+    WorkspaceCatalog catalog;
+    catalog.setRootPath(m_root);
+    // Reported while the root is still being listed: applied after it,
+    // so the listing does not bring the note back.
+    QVERIFY(QFile::remove(m_root + "/b.md"));
+    catalog.applyChanges(WorkspaceChangeSet() << WorkspaceChange(
+                             WorkspaceChange::Removed, m_root + "/b.md",
+                             false));
+    waitUntilReady(catalog);
+    QCOMPARE(catalog.count(), 502);
+    QVERIFY(!catalog.contains("b.md"));
+}
+
+QTEST_MAIN(TestWorkspaceCatalog)
+#include "test_workspacecatalog.moc"
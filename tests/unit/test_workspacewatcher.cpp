@@ -0,0 +1,197 @@
+#include <QtTest/QtTest>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "workspacewatcher.h"
+
+class TestWorkspaceWatcher : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void testFileEvents_AreTyped();
+    void testSafeSave_ArrivesAsOneChange();
+    void testRename_KeepsOldPath();
+    void testNewDirectory_IsWatched();
+    void testDirectoryRename_MovesWatches();
+    void testExistingDirectories_AreWatched();
+
+private:
+    void writeFile(const QString& path, const QByteArray& content);
+    WorkspaceChangeSet nextBatch();
+    WorkspaceChange find(const WorkspaceChangeSet& changes,
+                         const QString& path);
+
+    QTemporaryDir* m_dir;
+    WorkspaceWatcher* m_watcher;
+    QList<WorkspaceChangeSet> m_batches;
+};
+
+void TestWorkspaceWatcher::initTestCase() {
+#ifndef Q_OS_LINUX
+    QSKIP("Typed events need inotify");
+#endif
+}
+
+void TestWorkspaceWatcher::init() {
+    m_dir = new QTemporaryDir();
+    QVERIFY(m_dir->isValid());
+    m_batches.clear();
+    m_watcher = new WorkspaceWatcher();
+    m_watcher->setDebounceInterval(50);
+    connect(m_watcher, &WorkspaceWatcher::changesReady, this,
+            [this](const WorkspaceChangeSet& changes) {
+                m_batches.append(changes);
+            });
+    m_watcher->setRootPath(m_dir->path());
+}
+
+void TestWorkspaceWatcher::cleanup() {
+    delete m_watcher;
+    delete m_dir;
+}
+
+void TestWorkspaceWatcher::writeFile(const QString& path,
+                                     const QByteArray& content) {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(content);
+}
+
+WorkspaceChangeSet TestWorkspaceWatcher::nextBatch() {
+    if (m_batches.isEmpty()) {
+        QTest::qWaitFor([this]() { return !m_batches.isEmpty(); }, 3000);
+    }
+    return m_batches.isEmpty() ? WorkspaceChangeSet()
+                               : m_batches.takeFirst();
+}
+
+WorkspaceChange TestWorkspaceWatcher::find(const WorkspaceChangeSet& changes,
+                                           const QString& path) {
+    for (const WorkspaceChange& change : changes) {
+        if (change.path == path) {
+            return change;
+        }
+    }
+    return WorkspaceChange(WorkspaceChange::Rescan, QString(), false);
+}
+
+void TestWorkspaceWatcher::testFileEvents_AreTyped() {
+    const QString note = m_dir->filePath("note.md");
+    writeFile(note, "one");
+    WorkspaceChangeSet changes = nextBatch();
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.first().type, WorkspaceChange::Added);
+    QCOMPARE(changes.first().path, note);
+
+    // A burst of writes is a single change.
+    for (int i = 0; i < 20; ++i) {
+        writeFile(note, QByteArray::number(i));
+    }
+    changes = nextBatch();
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.first().type, WorkspaceChange::Modified);
+
+    QVERIFY(QFile::remove(note));
+    changes = nextBatch();
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.first().type, WorkspaceChange::Removed);
+
+    // Created and removed within a batch is no change at all.
+    writeFile(m_dir->filePath("scratch.md"), "x");
+    QVERIFY(QFile::remove(m_dir->filePath("scratch.md")));
+    QTest::qWait(300);
+    QVERIFY(m_batches.isEmpty());
+}
+
+void TestWorkspaceWatcher::testSafeSave_ArrivesAsOneChange() {
+    const QString note = m_dir->filePath("note.md");
+    writeFile(note, "one");
+    nextBatch();
+
+    const QString temporary = m_dir->filePath("note.md.tmp");
+    writeFile(temporary, "two");
+    QVERIFY(QFile::remove(note));
+    QVERIFY(QFile::rename(temporary, note));
+
+    const WorkspaceChangeSet changes = nextBatch();
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.first().path, note);
+    QVERIFY(changes.first().type != WorkspaceChange::Removed);
+}
+
+void TestWorkspaceWatcher::testRename_KeepsOldPath() {
+    const QString oldPath = m_dir->filePath("a.md");
+    const QString newPath = m_dir->filePath("b.md");
+    writeFile(oldPath, "a");
+    nextBatch();
+
+    QVERIFY(QFile::rename(oldPath, newPath));
+    const WorkspaceChangeSet changes = nextBatch();
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.first().type, WorkspaceChange::Renamed);
+    QCOMPARE(changes.first().oldPath, oldPath);
+    QCOMPARE(changes.first().path, newPath);
+
+    // Hidden names are not reported.
+    QVERIFY(QFile::rename(newPath, m_dir->filePath(".b.md")));
+    QCOMPARE(nextBatch().first().type, WorkspaceChange::Removed);
+}
+
+void TestWorkspaceWatcher::testNewDirectory_IsWatched() {
+    const QString sub = m_dir->filePath("sub");
+    QVERIFY(QDir().mkpath(sub + "/deeper"));
+    writeFile(sub + "/deeper/x.md", "x");
+
+    WorkspaceChangeSet changes = nextBatch();
+    QCOMPARE(find(changes, sub).type, WorkspaceChange::Added);
+    QVERIFY(find(changes, sub).isDir);
+    QCOMPARE(find(changes, sub + "/deeper/x.md").type,
+             WorkspaceChange::Added);
+
+    writeFile(sub + "/deeper/x.md", "y");
+    changes = nextBatch();
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.first().type, WorkspaceChange::Modified);
+    QCOMPARE(changes.first().path, sub + "/deeper/x.md");
+}
+
+void TestWorkspaceWatcher::testDirectoryRename_MovesWatches() {
+    const QString sub = m_dir->filePath("sub");
+    QVERIFY(QDir().mkpath(sub));
+    nextBatch();
+
+    const QString renamed = m_dir->filePath("renamed");
+    QVERIFY(QDir().rename(sub, renamed));
+    WorkspaceChangeSet changes = nextBatch();
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.first().type, WorkspaceChange::Renamed);
+    QVERIFY(changes.first().isDir);
+
+    writeFile(renamed + "/x.md", "x");
+    changes = nextBatch();
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.first().path, renamed + "/x.md");
+}
+
+void TestWorkspaceWatcher::testExistingDirectories_AreWatched() {
+    QTemporaryDir dir;
+    QVERIFY(QDir().mkpath(dir.filePath("a/b")));
+    QVERIFY(QDir().mkpath(dir.filePath(".git/objects")));
+
+    m_watcher->setRootPath(dir.path());
+    // The root, a and a/b, but nothing below .git.
+    QTRY_COMPARE(m_watcher->watchedDirectoryCount(), 3);
+
+    writeFile(dir.filePath("a/b/x.md"), "x");
+    writeFile(dir.filePath(".git/objects/x"), "x");
+    const WorkspaceChangeSet changes = nextBatch();
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.first().path, dir.filePath("a/b/x.md"));
+}
+
+QTEST_MAIN(TestWorkspaceWatcher)
+#include "test_workspacewatcher.moc"